@@ -0,0 +1,48 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace runtime {
+
+Arena::Arena(size_t block_size)
+    : block_size_(max(block_size, sizeof(DestructorRecord)))
+    {
+    }
+
+Arena::~Arena() {
+    for (DestructorRecord* record = last_record_; record; record = record->prev) {
+        record->destroy(record->object);
+    }
+}
+
+size_t Arena::GetObjectCount() const {
+    return object_count_;
+}
+
+size_t Arena::GetAllocatedSize() const {
+    return allocated_size_;
+}
+
+void* Arena::Allocate(size_t size, size_t align) {
+    auto aligned = [align](std::byte* p) {
+        const auto address = reinterpret_cast<uintptr_t>(p);
+        return p + ((align - address % align) % align);
+    };
+    std::byte* begin = aligned(pos_);
+    if (!pos_ || begin > end_ || static_cast<size_t>(end_ - begin) < size) {
+        // Объект, не помещающийся в обычный блок, получает собственный блок
+        const size_t new_block_size = max(block_size_, size + align);
+        blocks_.emplace_back(new std::byte[new_block_size]);
+        allocated_size_ += new_block_size;
+        pos_ = blocks_.back().get();
+        end_ = pos_ + new_block_size;
+        begin = aligned(pos_);
+    }
+    pos_ = begin + size;
+    return begin;
+}
+
+}  // namespace runtime
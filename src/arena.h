@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace runtime {
+
+// Монотонная арена. Объекты размещаются подряд в крупных блоках памяти и не освобождаются
+// по отдельности: при разрушении арены деструкторы всех объектов вызываются в порядке,
+// обратном созданию, после чего блоки освобождаются целиком. Деструкторы вызываются в цикле,
+// поэтому длинные цепочки ссылающихся друг на друга объектов не переполняют стек
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena();
+
+    // Создаёт в арене объект типа T. Объект существует, пока существует арена
+    template <typename T, typename... Args>
+    T* Make(Args&&... args);
+
+    // Возвращает количество созданных в арене объектов
+    [[nodiscard]] size_t GetObjectCount() const;
+
+    // Возвращает объём памяти, выделенной под блоки арены
+    [[nodiscard]] size_t GetAllocatedSize() const;
+
+private:
+    // Запись о деструкторе объекта. Записи размещаются в арене перед своими объектами
+    // и образуют список от последнего созданного объекта к первому
+    struct DestructorRecord {
+        void (*destroy)(void* object);
+        void* object;
+        DestructorRecord* prev;
+    };
+
+    // Выделяет size байт с выравниванием align
+    void* Allocate(size_t size, size_t align);
+
+    size_t block_size_;
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    size_t allocated_size_ = 0;
+    std::byte* pos_ = nullptr;
+    std::byte* end_ = nullptr;
+    DestructorRecord* last_record_ = nullptr;
+    size_t object_count_ = 0;
+};
+
+template <typename T, typename... Args>
+T* Arena::Make(Args&&... args) {
+    if constexpr (std::is_trivially_destructible_v<T>) {
+        ++object_count_;
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    } else {
+        // Память под запись выделяется заранее, чтобы запись появилась только
+        // после успешного создания объекта
+        auto* record = static_cast<DestructorRecord*>(
+            Allocate(sizeof(DestructorRecord), alignof(DestructorRecord)));
+        T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        *record = {[](void* p) {
+                       static_cast<T*>(p)->~T();
+                   },
+                   object, last_record_};
+        last_record_ = record;
+        ++object_count_;
+        return object;
+    }
+}
+
+}  // namespace runtime
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Запрещает компилятору выбрасывать вычисление value как неиспользуемое
+template <class T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Возвращает объём памяти, выделенной в куче, либо 0, если его нельзя узнать
+inline size_t HeapInUse() {
+#ifdef __GLIBC__
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Результат бенчмарка, дополненный собственной метрикой (например, расходом памяти на объект)
+struct BenchResult {
+    size_t operations = 0;
+    double metric = 0;
+    std::string metric_unit;
+};
+
+// Запускает функции-бенчмарки и выводит время их работы.
+// Бенчмарк выполняет фиксированный объём работы и возвращает количество выполненных операций
+// либо BenchResult
+class BenchRunner {
+public:
+    // Запускаются только бенчмарки, в имени которых встречается filter
+    explicit BenchRunner(std::string filter = {}, std::ostream& out = std::cout)
+        : filter_(std::move(filter))
+        , out_(out) {
+    }
+
+    template <class BenchFunc>
+    void RunBench(BenchFunc func, const std::string& bench_name) {
+        if (bench_name.find(filter_) == std::string::npos) {
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        BenchResult result;
+        if constexpr (std::is_same_v<decltype(func()), BenchResult>) {
+            result = func();
+        } else {
+            result.operations = func();
+        }
+        const std::chrono::duration<double, std::milli> elapsed
+            = std::chrono::steady_clock::now() - start;
+        const size_t operations = result.operations;
+
+        out_ << std::left << std::setw(NAME_WIDTH) << bench_name << std::right << std::fixed
+             << std::setprecision(1) << std::setw(10) << elapsed.count() << " ms";
+        if (operations > 0) {
+            out_ << std::setprecision(2) << std::setw(12) << elapsed.count() * 1e6 / operations
+                 << " ns/op";
+        }
+        if (!result.metric_unit.empty()) {
+            out_ << std::setprecision(1) << std::setw(12) << result.metric << ' '
+                 << result.metric_unit;
+        }
+        out_ << std::endl;
+    }
+
+private:
+    static constexpr int NAME_WIDTH = 56;
+
+    std::string filter_;
+    std::ostream& out_;
+};
+
+#define RUN_BENCH(br, func) br.RunBench(func, #func)
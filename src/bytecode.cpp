@@ -0,0 +1,614 @@
+#include "bytecode.h"
+
+#include "vm.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+using namespace std;
+
+namespace vm {
+
+using runtime::ObjectHolder;
+
+namespace {
+
+const runtime::Symbol SELF{"self"};
+const runtime::Symbol INIT_METHOD{"__init__"};
+
+// Изменение глубины стека значений после выполнения инструкции
+int StackEffect(const Instruction& instr) {
+    switch (instr.op) {
+        case OpCode::LOAD_CONST:
+        case OpCode::LOAD_NONE:
+        case OpCode::LOAD_NAME:
+        case OpCode::LOAD_LOCAL:
+        case OpCode::PRINT_NEWLINE:
+        case OpCode::DEFINE_CLASS:
+        case OpCode::NEW_OBJECT:
+        case OpCode::EXEC_NODE:
+        case OpCode::FOR_RANGE:
+        case OpCode::FOR_EACH:
+            return 1;
+        case OpCode::LOAD_FIELD:
+        case OpCode::CHECK_RECEIVER:
+        case OpCode::STORE_NAME:
+        case OpCode::STORE_LOCAL:
+        case OpCode::STRINGIFY:
+        case OpCode::LEN:
+        case OpCode::NOT:
+        case OpCode::JUMP:
+        case OpCode::RETURN:
+        case OpCode::PRINT_SEPARATOR:
+            return 0;
+        case OpCode::STORE_FIELD:
+        case OpCode::LOAD_INDEX:
+        case OpCode::POP:
+        case OpCode::PRINT_ITEM:
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MULT:
+        case OpCode::DIV:
+        case OpCode::AND:
+        case OpCode::OR:
+        case OpCode::COMPARE:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::RETURN_VALUE:
+            return -1;
+        case OpCode::STORE_INDEX:
+            return -2;
+        case OpCode::CALL_METHOD:
+        case OpCode::TAIL_CALL:
+            return -static_cast<int>(instr.arg2);
+        case OpCode::NEW_INSTANCE:
+            return 1 - static_cast<int>(instr.arg2);
+        case OpCode::BUILD_LIST:
+            return 1 - static_cast<int>(instr.arg);
+        case OpCode::BUILD_DICT:
+            return 1 - 2 * static_cast<int>(instr.arg);
+    }
+    return 0;
+}
+
+const char* OpCodeName(OpCode op) {
+    switch (op) {
+        case OpCode::LOAD_CONST: return "LOAD_CONST";
+        case OpCode::LOAD_NONE: return "LOAD_NONE";
+        case OpCode::LOAD_NAME: return "LOAD_NAME";
+        case OpCode::LOAD_LOCAL: return "LOAD_LOCAL";
+        case OpCode::LOAD_FIELD: return "LOAD_FIELD";
+        case OpCode::STORE_NAME: return "STORE_NAME";
+        case OpCode::STORE_LOCAL: return "STORE_LOCAL";
+        case OpCode::STORE_FIELD: return "STORE_FIELD";
+        case OpCode::CHECK_RECEIVER: return "CHECK_RECEIVER";
+        case OpCode::LOAD_INDEX: return "LOAD_INDEX";
+        case OpCode::STORE_INDEX: return "STORE_INDEX";
+        case OpCode::POP: return "POP";
+        case OpCode::PRINT_SEPARATOR: return "PRINT_SEPARATOR";
+        case OpCode::PRINT_ITEM: return "PRINT_ITEM";
+        case OpCode::PRINT_NEWLINE: return "PRINT_NEWLINE";
+        case OpCode::CALL_METHOD: return "CALL_METHOD";
+        case OpCode::TAIL_CALL: return "TAIL_CALL";
+        case OpCode::NEW_INSTANCE: return "NEW_INSTANCE";
+        case OpCode::NEW_OBJECT: return "NEW_OBJECT";
+        case OpCode::BUILD_LIST: return "BUILD_LIST";
+        case OpCode::BUILD_DICT: return "BUILD_DICT";
+        case OpCode::STRINGIFY: return "STRINGIFY";
+        case OpCode::LEN: return "LEN";
+        case OpCode::ADD: return "ADD";
+        case OpCode::SUB: return "SUB";
+        case OpCode::MULT: return "MULT";
+        case OpCode::DIV: return "DIV";
+        case OpCode::AND: return "AND";
+        case OpCode::OR: return "OR";
+        case OpCode::NOT: return "NOT";
+        case OpCode::COMPARE: return "COMPARE";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::FOR_RANGE: return "FOR_RANGE";
+        case OpCode::FOR_EACH: return "FOR_EACH";
+        case OpCode::DEFINE_CLASS: return "DEFINE_CLASS";
+        case OpCode::RETURN: return "RETURN";
+        case OpCode::RETURN_VALUE: return "RETURN_VALUE";
+        case OpCode::EXEC_NODE: return "EXEC_NODE";
+    }
+    return "UNKNOWN";
+}
+
+}  // namespace
+
+// ----------- Compiler -----------------------
+
+// Переводит узлы AST в байткод. Каждый узел компилируется как выражение,
+// оставляющее на стеке ровно одно значение
+class Compiler {
+public:
+    explicit Compiler(Program& program)
+        : program_(program)
+        {}
+
+    void CompileProgram() {
+        CodeBuilder builder{program_.code_};
+        const runtime::Executable* tree = program_.tree_.get();
+        // Парсер возвращает дерево внутри ast::Program, владеющей его узлами
+        if (const auto* parsed = dynamic_cast<const ast::Program*>(tree)) {
+            tree = &parsed->GetTree();
+        }
+        CompileNode(builder, *tree);
+        builder.Emit(OpCode::RETURN_VALUE);
+    }
+
+private:
+    struct CodeBuilder {
+        CodeObject& code;
+        int depth = 0;
+        std::unordered_map<runtime::Symbol, uint32_t> name_indices = {};
+        // Номера слотов локальных переменных метода; пусто, если переменные ищутся по имени
+        std::unordered_map<runtime::Symbol, uint32_t> slots = {};
+
+        size_t Emit(OpCode op, uint32_t arg = 0, uint32_t arg2 = 0) {
+            code.code.push_back({op, arg, arg2, AddCache(op)});
+            depth += StackEffect(code.code.back());
+            assert(depth >= 0);
+            code.max_stack = std::max(code.max_stack, static_cast<size_t>(depth));
+            return code.code.size() - 1;
+        }
+
+        void PatchJump(size_t instr_index) {
+            code.code[instr_index].arg = static_cast<uint32_t>(code.code.size());
+        }
+
+        uint32_t AddName(runtime::Symbol name) {
+            const auto [it, inserted] = name_indices.emplace(
+                    name, static_cast<uint32_t>(code.names.size()));
+            if (inserted) {
+                code.names.push_back(name);
+            }
+            return it->second;
+        }
+
+        // Кладёт на стек значение переменной name из слота либо из Closure
+        void EmitLoad(runtime::Symbol name) {
+            if (const auto it = slots.find(name); it != slots.end()) {
+                Emit(OpCode::LOAD_LOCAL, it->second);
+            } else {
+                Emit(OpCode::LOAD_NAME, AddName(name));
+            }
+        }
+
+        // Присваивает переменной name значение с вершины стека
+        void EmitStore(runtime::Symbol name) {
+            if (const auto it = slots.find(name); it != slots.end()) {
+                Emit(OpCode::STORE_LOCAL, it->second);
+            } else {
+                Emit(OpCode::STORE_NAME, AddName(name));
+            }
+        }
+
+        // Добавляет встроенный кэш для инструкции op, если он ей нужен
+        uint32_t AddCache(OpCode op) {
+            const auto add = [](auto& caches) {
+                caches.emplace_back();
+                return static_cast<uint32_t>(caches.size() - 1);
+            };
+            switch (op) {
+                case OpCode::CALL_METHOD:
+                case OpCode::TAIL_CALL:
+                    return add(code.method_caches);
+                case OpCode::LOAD_FIELD:
+                    return add(code.field_load_caches);
+                case OpCode::STORE_FIELD:
+                    return add(code.field_store_caches);
+                default:
+                    return 0;
+            }
+        }
+
+        uint32_t AddConstant(ObjectHolder value) {
+            code.constants.push_back(std::move(value));
+            return static_cast<uint32_t>(code.constants.size() - 1);
+        }
+    };
+
+    void CompileNode(CodeBuilder& builder, const runtime::Executable& node) {
+        using namespace ast;
+
+        if (const auto* num = dynamic_cast<const NumericConst*>(&node)) {
+            builder.Emit(OpCode::LOAD_CONST, builder.AddConstant(ObjectHolder::Own(
+                    runtime::Number(num->GetValue().GetValue()))));
+        } else if (const auto* str = dynamic_cast<const StringConst*>(&node)) {
+            builder.Emit(OpCode::LOAD_CONST, builder.AddConstant(ObjectHolder::Own(
+                    runtime::String(str->GetValue().GetValue()))));
+        } else if (const auto* boolean = dynamic_cast<const BoolConst*>(&node)) {
+            builder.Emit(OpCode::LOAD_CONST, builder.AddConstant(ObjectHolder::Own(
+                    runtime::Bool(boolean->GetValue().GetValue()))));
+        } else if (dynamic_cast<const None*>(&node)) {
+            builder.Emit(OpCode::LOAD_NONE);
+        } else if (const auto* var = dynamic_cast<const VariableValue*>(&node)) {
+            CompileVariableValue(builder, *var);
+        } else if (const auto* assign = dynamic_cast<const Assignment*>(&node)) {
+            CompileNode(builder, assign->GetValue());
+            builder.EmitStore(assign->GetVarName());
+        } else if (const auto* field_assign = dynamic_cast<const FieldAssignment*>(&node)) {
+            CompileVariableValue(builder, field_assign->GetObject());
+            if (!IsConstant(field_assign->GetValue())) {
+                builder.Emit(OpCode::CHECK_RECEIVER, 0);
+            }
+            CompileNode(builder, field_assign->GetValue());
+            builder.Emit(OpCode::STORE_FIELD, builder.AddName(field_assign->GetFieldName()));
+        } else if (const auto* list = dynamic_cast<const ListLiteral*>(&node)) {
+            CompileArgs(builder, list->GetItems());
+            builder.Emit(OpCode::BUILD_LIST, static_cast<uint32_t>(list->GetItems().size()));
+        } else if (const auto* dict = dynamic_cast<const DictLiteral*>(&node)) {
+            CompileArgs(builder, dict->GetItems());
+            builder.Emit(OpCode::BUILD_DICT, static_cast<uint32_t>(dict->GetItems().size() / 2));
+        } else if (const auto* index = dynamic_cast<const ast::Index*>(&node)) {
+            CompileNode(builder, index->GetObject());
+            CompileNode(builder, index->GetIndex());
+            builder.Emit(OpCode::LOAD_INDEX);
+        } else if (const auto* index_assign = dynamic_cast<const IndexAssignment*>(&node)) {
+            CompileNode(builder, index_assign->GetObject());
+            CompileNode(builder, index_assign->GetIndex());
+            CompileNode(builder, index_assign->GetValue());
+            builder.Emit(OpCode::STORE_INDEX);
+        } else if (const auto* print = dynamic_cast<const Print*>(&node)) {
+            // Как и ast::Print, разделитель выводится до вычисления очередного аргумента
+            bool is_first = true;
+            for (const auto& arg : print->GetArgs()) {
+                if (!is_first) {
+                    builder.Emit(OpCode::PRINT_SEPARATOR);
+                }
+                is_first = false;
+                CompileNode(builder, *arg);
+                builder.Emit(OpCode::PRINT_ITEM);
+            }
+            builder.Emit(OpCode::PRINT_NEWLINE);
+        } else if (const auto* call = dynamic_cast<const MethodCall*>(&node)) {
+            CompileNode(builder, call->GetObject());
+            if (!AreConstants(call->GetArgs())) {
+                builder.Emit(OpCode::CHECK_RECEIVER, 1);
+            }
+            CompileArgs(builder, call->GetArgs());
+            builder.Emit(call->IsTailCall() ? OpCode::TAIL_CALL : OpCode::CALL_METHOD,
+                         builder.AddName(call->GetMethodName()),
+                         static_cast<uint32_t>(call->GetArgs().size()));
+        } else if (const auto* new_inst = dynamic_cast<const NewInstance*>(&node)) {
+            CompileNewInstance(builder, *new_inst);
+        } else if (const auto* stringify = dynamic_cast<const Stringify*>(&node)) {
+            CompileNode(builder, stringify->GetArgument());
+            builder.Emit(OpCode::STRINGIFY);
+        } else if (const auto* len = dynamic_cast<const Len*>(&node)) {
+            CompileNode(builder, len->GetArgument());
+            builder.Emit(OpCode::LEN);
+        } else if (const auto* not_op = dynamic_cast<const Not*>(&node)) {
+            CompileNode(builder, not_op->GetArgument());
+            builder.Emit(OpCode::NOT);
+        } else if (const auto* cmp = dynamic_cast<const Comparison*>(&node)) {
+            CompileBinary(builder, *cmp, OpCode::COMPARE);
+            builder.code.comparators.push_back(cmp->GetComparator());
+            builder.code.code.back().arg
+                = static_cast<uint32_t>(builder.code.comparators.size() - 1);
+        } else if (const auto* add = dynamic_cast<const Add*>(&node)) {
+            CompileBinary(builder, *add, OpCode::ADD);
+        } else if (const auto* sub = dynamic_cast<const Sub*>(&node)) {
+            CompileBinary(builder, *sub, OpCode::SUB);
+        } else if (const auto* mult = dynamic_cast<const Mult*>(&node)) {
+            CompileBinary(builder, *mult, OpCode::MULT);
+        } else if (const auto* div = dynamic_cast<const Div*>(&node)) {
+            CompileBinary(builder, *div, OpCode::DIV);
+        } else if (const auto* or_op = dynamic_cast<const Or*>(&node)) {
+            CompileBinary(builder, *or_op, OpCode::OR);
+        } else if (const auto* and_op = dynamic_cast<const And*>(&node)) {
+            CompileBinary(builder, *and_op, OpCode::AND);
+        } else if (const auto* compound = dynamic_cast<const Compound*>(&node)) {
+            for (const auto& stmt : compound->GetStatements()) {
+                CompileNode(builder, *stmt);
+                builder.Emit(OpCode::POP);
+            }
+            builder.Emit(OpCode::LOAD_NONE);
+        } else if (const auto* ret = dynamic_cast<const Return*>(&node)) {
+            CompileNode(builder, ret->GetStatement());
+            builder.Emit(OpCode::RETURN);
+        } else if (const auto* cls_def = dynamic_cast<const ClassDefinition*>(&node)) {
+            const auto& cls = *cls_def->GetClass().TryAs<runtime::Class>();
+            builder.Emit(OpCode::DEFINE_CLASS, builder.AddConstant(CompileClass(cls)));
+        } else if (const auto* if_else = dynamic_cast<const IfElse*>(&node)) {
+            CompileIfElse(builder, *if_else);
+        } else if (const auto* while_loop = dynamic_cast<const While*>(&node)) {
+            CompileWhile(builder, *while_loop);
+        } else if (const auto* for_range = dynamic_cast<const ForRange*>(&node)) {
+            CompileForRange(builder, *for_range);
+        } else if (const auto* for_each = dynamic_cast<const ForEach*>(&node)) {
+            CompileForEach(builder, *for_each);
+        } else {
+            // Вложенные тела методов и узлы, неизвестные компилятору, исполняются
+            // интерпретатором AST
+            builder.code.nodes.push_back(const_cast<runtime::Executable*>(&node));
+            builder.Emit(OpCode::EXEC_NODE,
+                         static_cast<uint32_t>(builder.code.nodes.size() - 1));
+        }
+    }
+
+    void CompileVariableValue(CodeBuilder& builder, const ast::VariableValue& var) {
+        const auto& ids = var.GetDottedIds();
+        uint32_t prev = builder.AddName(ids.front());
+        builder.EmitLoad(ids.front());
+        for (size_t i = 1; i < ids.size(); ++i) {
+            const uint32_t field = builder.AddName(ids[i]);
+            builder.Emit(OpCode::LOAD_FIELD, field, prev);
+            prev = field;
+        }
+    }
+
+    void CompileArgs(CodeBuilder& builder,
+                     const std::vector<ast::StatementPtr>& args) {
+        for (const auto& arg : args) {
+            CompileNode(builder, *arg);
+        }
+    }
+
+    void CompileBinary(CodeBuilder& builder, const ast::BinaryOperation& node, OpCode op) {
+        CompileNode(builder, node.GetLhs());
+        CompileNode(builder, node.GetRhs());
+        builder.Emit(op);
+    }
+
+    void CompileIfElse(CodeBuilder& builder, const ast::IfElse& node) {
+        CompileNode(builder, node.GetCondition());
+        const size_t jump_to_else = builder.Emit(OpCode::JUMP_IF_FALSE);
+        const int depth = builder.depth;
+
+        CompileNode(builder, node.GetIfBody());
+        const size_t jump_to_end = builder.Emit(OpCode::JUMP);
+
+        builder.depth = depth;
+        builder.PatchJump(jump_to_else);
+        if (const auto* else_body = node.GetElseBody()) {
+            CompileNode(builder, *else_body);
+        } else {
+            builder.Emit(OpCode::LOAD_NONE);
+        }
+        builder.PatchJump(jump_to_end);
+    }
+
+    void CompileWhile(CodeBuilder& builder, const ast::While& node) {
+        const auto loop_start = static_cast<uint32_t>(builder.code.code.size());
+        CompileNode(builder, node.GetCondition());
+        const size_t jump_to_end = builder.Emit(OpCode::JUMP_IF_FALSE);
+
+        CompileNode(builder, node.GetBody());
+        builder.Emit(OpCode::POP);
+        builder.Emit(OpCode::JUMP, loop_start);
+
+        builder.PatchJump(jump_to_end);
+        builder.Emit(OpCode::LOAD_NONE);
+    }
+
+    // Текущее значение переменной цикла, stop и step лежат на стеке, пока выполняется цикл,
+    // поэтому итерация не обращается к Closure и не выделяет память
+    void CompileForRange(CodeBuilder& builder, const ast::ForRange& node) {
+        const int depth = builder.depth;
+        if (const auto* start = node.GetStart()) {
+            CompileNode(builder, *start);
+        } else {
+            builder.Emit(OpCode::LOAD_NONE);
+        }
+        CompileNode(builder, node.GetStop());
+        if (const auto* step = node.GetStep()) {
+            CompileNode(builder, *step);
+        } else {
+            builder.Emit(OpCode::LOAD_NONE);
+        }
+
+        const auto loop_start = static_cast<uint32_t>(builder.code.code.size());
+        const size_t jump_to_end = builder.Emit(OpCode::FOR_RANGE);
+        builder.EmitStore(node.GetVarName());
+        builder.Emit(OpCode::POP);
+        CompileNode(builder, node.GetBody());
+        builder.Emit(OpCode::POP);
+        builder.Emit(OpCode::JUMP, loop_start);
+
+        builder.depth = depth;
+        builder.PatchJump(jump_to_end);
+        builder.Emit(OpCode::LOAD_NONE);
+    }
+
+    // Список и номер очередного элемента лежат на стеке, пока выполняется цикл
+    void CompileForEach(CodeBuilder& builder, const ast::ForEach& node) {
+        const int depth = builder.depth;
+        CompileNode(builder, node.GetIterable());
+        builder.Emit(OpCode::LOAD_CONST,
+                     builder.AddConstant(ObjectHolder::Own(runtime::Number(0))));
+
+        const auto loop_start = static_cast<uint32_t>(builder.code.code.size());
+        const size_t jump_to_end = builder.Emit(OpCode::FOR_EACH);
+        builder.EmitStore(node.GetVarName());
+        builder.Emit(OpCode::POP);
+        CompileNode(builder, node.GetBody());
+        builder.Emit(OpCode::POP);
+        builder.Emit(OpCode::JUMP, loop_start);
+
+        builder.depth = depth;
+        builder.PatchJump(jump_to_end);
+        builder.Emit(OpCode::LOAD_NONE);
+    }
+
+    void CompileNewInstance(CodeBuilder& builder, const ast::NewInstance& node) {
+        const auto& src_cls = node.GetClass();
+        const uint32_t cls = builder.AddConstant(CompileClass(src_cls));
+        // Методы класса известны при компиляции. Как и ast::NewInstance, аргументы
+        // вычисляются, только если у класса есть __init__ с таким числом параметров
+        const auto* init = src_cls.GetMethod(INIT_METHOD);
+        if (!init || init->formal_params.size() != node.GetArgs().size()) {
+            builder.Emit(OpCode::NEW_OBJECT, cls);
+            return;
+        }
+        CompileArgs(builder, node.GetArgs());
+        builder.Emit(OpCode::NEW_INSTANCE, cls, static_cast<uint32_t>(node.GetArgs().size()));
+    }
+
+    // Вычисление константы не выводит данных и не выбрасывает исключений, поэтому
+    // для него не нужна предварительная проверка получателя
+    static bool IsConstant(const runtime::Executable& node) {
+        return dynamic_cast<const ast::NumericConst*>(&node)
+            || dynamic_cast<const ast::StringConst*>(&node)
+            || dynamic_cast<const ast::BoolConst*>(&node)
+            || dynamic_cast<const ast::None*>(&node);
+    }
+
+    static bool AreConstants(const std::vector<ast::StatementPtr>& nodes) {
+        return std::all_of(nodes.begin(), nodes.end(), [](const auto& node) {
+            return IsConstant(*node);
+        });
+    }
+
+    // Парсер объявляет класс только после разбора его тела, поэтому методы класса не могут
+    // создавать его экземпляры и компиляция класса не зацикливается
+    ObjectHolder CompileClass(const runtime::Class& cls) {
+        if (const auto it = program_.classes_.find(&cls); it != program_.classes_.end()) {
+            return it->second;
+        }
+        const runtime::Class* parent = nullptr;
+        if (cls.GetParent()) {
+            parent = CompileClass(*cls.GetParent()).TryAs<runtime::Class>();
+        }
+
+        std::vector<runtime::Method> methods;
+        for (const auto& method : cls.GetMethods()) {
+            methods.push_back({method.name, method.formal_params,
+                               std::make_unique<Function>(CompileMethod(method))});
+        }
+
+        auto result = ObjectHolder::Own(runtime::Class(cls.GetName(), std::move(methods), parent));
+        program_.classes_.emplace(&cls, result);
+        return result;
+    }
+
+    // Компилирует тело метода. Первый проход находит имена, которым присваиваются значения,
+    // второй размещает их вместе с self и параметрами в слотах кадра.
+    // Код, исполняющий узлы AST или объявляющий классы, обращается к переменным по имени
+    std::unique_ptr<CodeObject> CompileMethod(const runtime::Method& method) {
+        auto code = CompileMethodBody(*method.body, {});
+        const bool needs_closure = !code->nodes.empty()
+            || std::any_of(code->code.begin(), code->code.end(), [](const Instruction& instr) {
+                   return instr.op == OpCode::DEFINE_CLASS;
+               });
+        if (needs_closure) {
+            return code;
+        }
+
+        std::vector<runtime::Symbol> slot_names{SELF};
+        slot_names.insert(slot_names.end(), method.formal_params.begin(),
+                          method.formal_params.end());
+        const size_t num_params = slot_names.size();
+        std::unordered_map<runtime::Symbol, uint32_t> slots;
+        for (size_t i = 0; i < slot_names.size(); ++i) {
+            slots[slot_names[i]] = static_cast<uint32_t>(i);
+        }
+        for (const auto& instr : code->code) {
+            if (instr.op == OpCode::STORE_NAME
+                && slots.emplace(code->names[instr.arg], slot_names.size()).second) {
+                slot_names.push_back(code->names[instr.arg]);
+            }
+        }
+
+        code = CompileMethodBody(*method.body, std::move(slots));
+        code->slot_names = std::move(slot_names);
+        code->num_params = num_params;
+        return code;
+    }
+
+    std::unique_ptr<CodeObject> CompileMethodBody(
+            const runtime::Executable& body, std::unordered_map<runtime::Symbol, uint32_t> slots) {
+        auto code = std::make_unique<CodeObject>();
+        CodeBuilder builder{*code, 0, {}, std::move(slots)};
+        if (const auto* method_body = dynamic_cast<const ast::MethodBody*>(&body)) {
+            CompileNode(builder, method_body->GetBody());
+            builder.Emit(OpCode::POP);
+            builder.Emit(OpCode::LOAD_NONE);
+        } else {
+            CompileNode(builder, body);
+        }
+        builder.Emit(OpCode::RETURN_VALUE);
+        return code;
+    }
+
+    Program& program_;
+};
+
+// ----------- Program -----------------------
+
+Program::Program(std::unique_ptr<runtime::Executable> tree)
+    : tree_(std::move(tree))
+    {}
+
+ObjectHolder Program::Execute(runtime::Closure& closure, runtime::Context& context) {
+    return Run(code_, closure, context);
+}
+
+const CodeObject& Program::GetCode() const {
+    return code_;
+}
+
+std::unique_ptr<Program> Compile(std::unique_ptr<runtime::Executable> tree) {
+    auto program = std::make_unique<Program>(std::move(tree));
+    Compiler{*program}.CompileProgram();
+    return program;
+}
+
+// ----------- Disassembler -----------------------
+
+std::ostream& operator<<(std::ostream& os, const CodeObject& code) {
+    for (size_t i = 0; i < code.code.size(); ++i) {
+        const auto& instr = code.code[i];
+        os << i << ' ' << OpCodeName(instr.op);
+        switch (instr.op) {
+            case OpCode::LOAD_NAME:
+            case OpCode::STORE_NAME:
+            case OpCode::LOAD_FIELD:
+            case OpCode::STORE_FIELD:
+                os << ' ' << code.names[instr.arg];
+                break;
+            case OpCode::LOAD_LOCAL:
+            case OpCode::STORE_LOCAL:
+                os << ' ' << code.slot_names[instr.arg];
+                break;
+            case OpCode::CALL_METHOD:
+            case OpCode::TAIL_CALL:
+                os << ' ' << code.names[instr.arg] << ' ' << instr.arg2;
+                break;
+            case OpCode::NEW_INSTANCE:
+                os << ' ' << code.constants[instr.arg].TryAs<runtime::Class>()->GetName() << ' '
+                   << instr.arg2;
+                break;
+            case OpCode::NEW_OBJECT:
+                os << ' ' << code.constants[instr.arg].TryAs<runtime::Class>()->GetName();
+                break;
+            case OpCode::LOAD_CONST:
+            case OpCode::DEFINE_CLASS: {
+                runtime::DummyContext context;
+                os << ' ';
+                code.constants[instr.arg]->Print(os, context);
+                break;
+            }
+            case OpCode::COMPARE:
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::FOR_RANGE:
+            case OpCode::CHECK_RECEIVER:
+            case OpCode::FOR_EACH:
+            case OpCode::BUILD_LIST:
+            case OpCode::BUILD_DICT:
+            case OpCode::EXEC_NODE:
+                os << ' ' << instr.arg;
+                break;
+            default:
+                break;
+        }
+        os << '\n';
+    }
+    return os;
+}
+
+}  // namespace vm
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "runtime.h"
+#include "statement.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vm {
+
+// Коды инструкций стековой виртуальной машины.
+// Каждая инструкция-выражение оставляет на стеке ровно одно значение
+enum class OpCode : std::uint8_t {
+    LOAD_CONST,       // кладёт на стек constants[arg]
+    LOAD_NONE,        // кладёт на стек None
+    LOAD_NAME,        // кладёт на стек значение переменной names[arg]
+    LOAD_LOCAL,       // кладёт на стек значение локальной переменной из слота arg
+    LOAD_FIELD,       // заменяет объект на вершине стека значением его поля names[arg],
+                      // names[arg2] - имя объекта для сообщения об ошибке
+    STORE_NAME,       // присваивает переменной names[arg] значение с вершины стека, не снимая его
+    STORE_LOCAL,      // присваивает слоту arg значение с вершины стека, не снимая его
+    STORE_FIELD,      // снимает значение и объект, присваивает значение полю names[arg] объекта
+                      // и кладёт значение обратно
+    CHECK_RECEIVER,   // проверяет, не снимая, что на вершине стека экземпляр класса, у которого
+                      // присваивается поле (arg == 0) или вызывается метод (arg != 0, допустим
+                      // также список). Выполняется до вычисления присваиваемого значения
+                      // и аргументов, как в ast::FieldAssignment и ast::MethodCall
+    LOAD_INDEX,       // снимает индекс и список или словарь, кладёт элемент с этим индексом
+    STORE_INDEX,      // снимает значение, индекс и список или словарь, присваивает значение
+                      // элементу и кладёт значение обратно
+    POP,              // снимает значение с вершины стека
+    PRINT_SEPARATOR,  // выводит пробел между значениями команды print
+    PRINT_ITEM,       // снимает значение и выводит его
+    PRINT_NEWLINE,    // завершает строку вывода и кладёт на стек None
+    CALL_METHOD,      // снимает arg2 аргументов и объект, кладёт результат вызова метода names[arg]
+                      // экземпляра класса либо встроенного метода списка
+    TAIL_CALL,        // то же, что CALL_METHOD, но если вызывается метод, которому принадлежит код,
+                      // аргументы заменяют self и параметры в слотах текущего кадра,
+                      // остальные слоты очищаются и выполнение начинается с первой инструкции
+    NEW_INSTANCE,     // снимает arg2 аргументов, создаёт экземпляр класса constants[arg],
+                      // вызывает у него __init__ и кладёт экземпляр на стек
+    NEW_OBJECT,       // создаёт экземпляр класса constants[arg], у которого нет __init__
+                      // с нужным числом параметров, и кладёт его на стек. Аргументы конструктора
+                      // при этом не вычисляются
+    BUILD_LIST,       // снимает arg значений и кладёт список из них
+    BUILD_DICT,       // снимает arg пар ключ-значение (ключ ниже значения) и кладёт словарь
+                      // из них
+    STRINGIFY,        // заменяет значение на вершине стека его строковым представлением
+    LEN,              // заменяет список, словарь или строку на вершине стека их длиной
+    ADD,              // снимает rhs и lhs, кладёт lhs + rhs
+    SUB,              // снимает rhs и lhs, кладёт lhs - rhs
+    MULT,             // снимает rhs и lhs, кладёт lhs * rhs
+    DIV,              // снимает rhs и lhs, кладёт lhs / rhs
+    AND,              // снимает rhs и lhs, кладёт Bool(lhs and rhs)
+    OR,               // снимает rhs и lhs, кладёт Bool(lhs or rhs)
+    NOT,              // заменяет значение на вершине стека на Bool(not value)
+    COMPARE,          // снимает rhs и lhs, кладёт Bool(comparators[arg](lhs, rhs))
+    JUMP,             // переходит к инструкции arg
+    JUMP_IF_FALSE,    // снимает значение и переходит к инструкции arg, если оно приводится к False
+    FOR_RANGE,        // под вершиной стека лежат текущее значение, stop и step цикла for;
+                      // если диапазон закончился, снимает их и переходит к инструкции arg,
+                      // иначе кладёт текущее значение на стек и заменяет его следующим
+    FOR_EACH,         // под вершиной стека лежат список или словарь и номер очередного элемента;
+                      // если элементы закончились, снимает их и переходит к инструкции arg,
+                      // иначе кладёт элемент на стек и увеличивает номер
+    DEFINE_CLASS,     // связывает класс constants[arg] с его именем и кладёт класс на стек
+    RETURN,           // снимает значение; если оно не None - возвращает его из метода,
+                      // иначе кладёт None (как ast::Return)
+    RETURN_VALUE,     // завершает выполнение, возвращая значение с вершины стека
+    EXEC_NODE,        // выполняет узел AST nodes[arg] и кладёт результат на стек;
+                      // если узел выполнил return, возвращает его результат
+};
+
+struct Instruction {
+    OpCode op;
+    std::uint32_t arg = 0;
+    std::uint32_t arg2 = 0;
+    // Номер встроенного кэша инструкций CALL_METHOD, TAIL_CALL, LOAD_FIELD и STORE_FIELD
+    std::uint32_t cache = 0;
+};
+
+struct CodeObject;
+
+// Метод, найденный инструкцией CALL_METHOD или TAIL_CALL. code - байткод метода со слотами,
+// если его можно вызвать без Closure, иначе nullptr
+struct CachedMethod {
+    const runtime::Method* method = nullptr;
+    const CodeObject* code = nullptr;
+};
+
+using CallMethodCache = runtime::InlineCache<const runtime::Class*, CachedMethod>;
+
+// Скомпилированный фрагмент кода: тело метода или программа верхнего уровня
+struct CodeObject {
+    std::vector<Instruction> code;
+    std::vector<runtime::ObjectHolder> constants;
+    std::vector<runtime::Symbol> names;
+    std::vector<ast::Comparison::Comparator> comparators;
+    // Узлы AST, которые компилятор не умеет переводить в байткод
+    std::vector<runtime::Executable*> nodes;
+    // Встроенные кэши инструкций. Заполняются во время выполнения
+    mutable std::vector<CallMethodCache> method_caches;
+    mutable std::vector<runtime::FieldLoadCache> field_load_caches;
+    mutable std::vector<runtime::FieldStoreCache> field_store_caches;
+    // Имена локальных переменных метода по номерам слотов. Первые num_params слотов
+    // занимают self и параметры метода. У кода верхнего уровня слотов нет
+    std::vector<runtime::Symbol> slot_names;
+    size_t num_params = 0;
+    // Максимальная глубина стека значений
+    size_t max_stack = 0;
+
+    // Возвращает true, если локальные переменные кода размещены в слотах
+    [[nodiscard]] bool HasSlots() const {
+        return num_params != 0;
+    }
+};
+
+// Выводит в os дизассемблированный код
+std::ostream& operator<<(std::ostream& os, const CodeObject& code);
+
+// Программа, скомпилированная в байткод.
+// Владеет исходным AST, поскольку инструкции EXEC_NODE ссылаются на его узлы
+class Program : public runtime::Executable {
+public:
+    explicit Program(std::unique_ptr<runtime::Executable> tree);
+
+    // Выполняет программу на виртуальной машине
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const CodeObject& GetCode() const;
+
+private:
+    friend class Compiler;
+
+    std::unique_ptr<runtime::Executable> tree_;
+    CodeObject code_;
+    // Классы с методами, скомпилированными в байткод, по исходным классам из AST
+    std::unordered_map<const runtime::Class*, runtime::ObjectHolder> classes_;
+};
+
+// Компилирует дерево, построенное parse::ParseProgram, в байткод
+std::unique_ptr<Program> Compile(std::unique_ptr<runtime::Executable> tree);
+
+}  // namespace vm
@@ -0,0 +1,217 @@
+#include "char_scan.h"
+
+#include <atomic>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MYTHON_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace parse::scan {
+
+namespace {
+
+// ----------- Побайтовый поиск -----------------------
+
+const char* FindNewlineScalar(const char* begin, const char* end) {
+    while (begin != end && *begin != '\n') {
+        ++begin;
+    }
+    return begin;
+}
+
+const char* FindQuoteOrBackslashScalar(const char* begin, const char* end, char quote) {
+    while (begin != end && *begin != quote && *begin != '\\') {
+        ++begin;
+    }
+    return begin;
+}
+
+const char* SkipSpacesScalar(const char* begin, const char* end) {
+    while (begin != end && *begin == ' ') {
+        ++begin;
+    }
+    return begin;
+}
+
+#ifdef MYTHON_SCAN_X86
+
+// Каждая функция просматривает текст целыми блоками, пока они помещаются в [begin, end),
+// и дочитывает остаток побайтово. Бит i маски соответствует байту i блока
+
+// ----------- SSE2 -----------------------
+
+constexpr int SSE2_BLOCK = 16;
+
+__attribute__((target("sse2")))
+unsigned MatchSse2(const char* p, __m128i c) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, c)));
+}
+
+__attribute__((target("sse2")))
+const char* FindNewlineSse2(const char* begin, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - begin >= SSE2_BLOCK; begin += SSE2_BLOCK) {
+        if (const unsigned mask = MatchSse2(begin, newline)) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindNewlineScalar(begin, end);
+}
+
+__attribute__((target("sse2")))
+const char* FindQuoteOrBackslashSse2(const char* begin, const char* end, char quote) {
+    const __m128i quotes = _mm_set1_epi8(quote);
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; end - begin >= SSE2_BLOCK; begin += SSE2_BLOCK) {
+        if (const unsigned mask = MatchSse2(begin, quotes) | MatchSse2(begin, backslash)) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindQuoteOrBackslashScalar(begin, end, quote);
+}
+
+__attribute__((target("sse2")))
+const char* SkipSpacesSse2(const char* begin, const char* end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    for (; end - begin >= SSE2_BLOCK; begin += SSE2_BLOCK) {
+        if (const unsigned mask = ~MatchSse2(begin, space) & 0xFFFFU) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return SkipSpacesScalar(begin, end);
+}
+
+// ----------- AVX2 -----------------------
+
+constexpr int AVX2_BLOCK = 32;
+
+__attribute__((target("avx2")))
+unsigned MatchAvx2(const char* p, __m256i c) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, c)));
+}
+
+__attribute__((target("avx2")))
+const char* FindNewlineAvx2(const char* begin, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; end - begin >= AVX2_BLOCK; begin += AVX2_BLOCK) {
+        if (const unsigned mask = MatchAvx2(begin, newline)) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindNewlineSse2(begin, end);
+}
+
+__attribute__((target("avx2")))
+const char* FindQuoteOrBackslashAvx2(const char* begin, const char* end, char quote) {
+    const __m256i quotes = _mm256_set1_epi8(quote);
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    for (; end - begin >= AVX2_BLOCK; begin += AVX2_BLOCK) {
+        if (const unsigned mask = MatchAvx2(begin, quotes) | MatchAvx2(begin, backslash)) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindQuoteOrBackslashSse2(begin, end, quote);
+}
+
+__attribute__((target("avx2")))
+const char* SkipSpacesAvx2(const char* begin, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    for (; end - begin >= AVX2_BLOCK; begin += AVX2_BLOCK) {
+        if (const unsigned mask = ~MatchAvx2(begin, space)) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return SkipSpacesSse2(begin, end);
+}
+
+#endif  // MYTHON_SCAN_X86
+
+// ----------- Выбор реализации -----------------------
+
+struct Functions {
+    Level level;
+    const char* (*find_newline)(const char*, const char*);
+    const char* (*find_quote_or_backslash)(const char*, const char*, char);
+    const char* (*skip_spaces)(const char*, const char*);
+};
+
+constexpr Functions SCALAR_FUNCTIONS{Level::SCALAR, FindNewlineScalar, FindQuoteOrBackslashScalar,
+                                     SkipSpacesScalar};
+#ifdef MYTHON_SCAN_X86
+constexpr Functions SSE2_FUNCTIONS{Level::SSE2, FindNewlineSse2, FindQuoteOrBackslashSse2,
+                                   SkipSpacesSse2};
+constexpr Functions AVX2_FUNCTIONS{Level::AVX2, FindNewlineAvx2, FindQuoteOrBackslashAvx2,
+                                   SkipSpacesAvx2};
+#endif
+
+// Возвращает реализацию для level либо nullptr, если процессор её не поддерживает
+const Functions* FindFunctions(Level level) {
+    switch (level) {
+        case Level::SCALAR:
+            return &SCALAR_FUNCTIONS;
+#ifdef MYTHON_SCAN_X86
+        case Level::SSE2:
+            return __builtin_cpu_supports("sse2") ? &SSE2_FUNCTIONS : nullptr;
+        case Level::AVX2:
+            return __builtin_cpu_supports("avx2") ? &AVX2_FUNCTIONS : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const Functions& GetBestFunctions() {
+    for (Level level : {Level::AVX2, Level::SSE2}) {
+        if (const Functions* functions = FindFunctions(level)) {
+            return *functions;
+        }
+    }
+    return SCALAR_FUNCTIONS;
+}
+
+// Выбранная реализация. Меняется только через SetLevel
+std::atomic<const Functions*>& Current() {
+    static std::atomic<const Functions*> current{&GetBestFunctions()};
+    return current;
+}
+
+const Functions& GetFunctions() {
+    return *Current().load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+Level GetBestLevel() {
+    return GetBestFunctions().level;
+}
+
+Level GetLevel() {
+    return GetFunctions().level;
+}
+
+bool SetLevel(Level level) {
+    const Functions* functions = FindFunctions(level);
+    if (!functions) {
+        return false;
+    }
+    Current().store(functions, std::memory_order_relaxed);
+    return true;
+}
+
+const char* FindNewline(const char* begin, const char* end) {
+    return GetFunctions().find_newline(begin, end);
+}
+
+const char* FindQuoteOrBackslash(const char* begin, const char* end, char quote) {
+    return GetFunctions().find_quote_or_backslash(begin, end, quote);
+}
+
+const char* SkipSpaces(const char* begin, const char* end) {
+    return GetFunctions().skip_spaces(begin, end);
+}
+
+}  // namespace parse::scan
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Поиск символов в тексте программы блоками по 16 (SSE2) или 32 (AVX2) байта.
+// Реализация выбирается при запуске по возможностям процессора; на других архитектурах
+// используется побайтовый поиск. Все реализации возвращают одинаковый результат
+namespace parse::scan {
+
+// Набор инструкций, которым выполняется поиск
+enum class Level : std::uint8_t {
+    SCALAR,  // побайтовый поиск
+    SSE2,    // блоками по 16 байт
+    AVX2,    // блоками по 32 байта
+};
+
+// Возвращает лучший набор инструкций, поддерживаемый процессором
+[[nodiscard]] Level GetBestLevel();
+
+// Возвращает набор инструкций, которым выполняется поиск
+[[nodiscard]] Level GetLevel();
+
+// Выбирает набор инструкций для поиска (например, в тестах и бенчмарках).
+// Если процессор его не поддерживает, возвращает false и оставляет прежний
+bool SetLevel(Level level);
+
+// Возвращает указатель на первый символ '\n' в [begin, end) либо end
+[[nodiscard]] const char* FindNewline(const char* begin, const char* end);
+
+// Возвращает указатель на первый символ quote или '\\' в [begin, end) либо end
+[[nodiscard]] const char* FindQuoteOrBackslash(const char* begin, const char* end, char quote);
+
+// Возвращает указатель на первый символ, отличный от пробела, в [begin, end) либо end
+[[nodiscard]] const char* SkipSpaces(const char* begin, const char* end);
+
+}  // namespace parse::scan
@@ -0,0 +1,808 @@
+#include "flat_ast.h"
+
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace flat {
+
+using runtime::ObjectHolder;
+
+namespace {
+
+const runtime::Symbol INIT_METHOD{"__init__"};
+
+const char* NodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::CONST: return "CONST";
+        case NodeKind::NONE: return "NONE";
+        case NodeKind::LOAD_NAME: return "LOAD_NAME";
+        case NodeKind::LOAD_FIELD: return "LOAD_FIELD";
+        case NodeKind::ASSIGN: return "ASSIGN";
+        case NodeKind::FIELD_ASSIGN: return "FIELD_ASSIGN";
+        case NodeKind::LIST: return "LIST";
+        case NodeKind::DICT: return "DICT";
+        case NodeKind::INDEX: return "INDEX";
+        case NodeKind::STORE_INDEX: return "STORE_INDEX";
+        case NodeKind::PRINT: return "PRINT";
+        case NodeKind::CALL: return "CALL";
+        case NodeKind::TAIL_CALL: return "TAIL_CALL";
+        case NodeKind::NEW_INSTANCE: return "NEW_INSTANCE";
+        case NodeKind::STRINGIFY: return "STRINGIFY";
+        case NodeKind::LEN: return "LEN";
+        case NodeKind::ADD: return "ADD";
+        case NodeKind::SUB: return "SUB";
+        case NodeKind::MULT: return "MULT";
+        case NodeKind::DIV: return "DIV";
+        case NodeKind::AND: return "AND";
+        case NodeKind::OR: return "OR";
+        case NodeKind::NOT: return "NOT";
+        case NodeKind::COMPARE: return "COMPARE";
+        case NodeKind::COMPOUND: return "COMPOUND";
+        case NodeKind::RETURN: return "RETURN";
+        case NodeKind::METHOD_BODY: return "METHOD_BODY";
+        case NodeKind::CLASS_DEF: return "CLASS_DEF";
+        case NodeKind::IF_ELSE: return "IF_ELSE";
+        case NodeKind::WHILE: return "WHILE";
+        case NodeKind::FOR_RANGE: return "FOR_RANGE";
+        case NodeKind::FOR_EACH: return "FOR_EACH";
+        case NodeKind::EXEC_NODE: return "EXEC_NODE";
+    }
+    return "UNKNOWN";
+}
+
+// ----------- Evaluator -----------------------
+
+// Вычисляет узлы плоского дерева. Дочерние узлы вычисляются рекурсивно
+// в том же порядке, что и в исходном AST. Узел root - тело выполняемого метода
+// либо корень программы
+class Evaluator {
+public:
+    Evaluator(Tree& tree, NodeId root, runtime::Closure& closure, runtime::Context& context)
+        : tree_(tree)
+        , root_(root)
+        , closure_(closure)
+        , context_(context)
+        {}
+
+    ObjectHolder Eval(NodeId node) {
+        const NodeId arg0 = tree_.arg0[node];
+        const NodeId arg1 = tree_.arg1[node];
+        const NodeId arg2 = tree_.arg2[node];
+        switch (tree_.kinds[node]) {
+            case NodeKind::CONST:
+                return tree_.constants[arg0];
+            case NodeKind::NONE:
+                return {};
+            case NodeKind::LOAD_NAME:
+                return LoadName(tree_.names[arg0]);
+            case NodeKind::LOAD_FIELD:
+                return LoadField(arg0, tree_.field_loads[arg1]);
+            case NodeKind::ASSIGN: {
+                auto value = Eval(arg0);
+                closure_[tree_.names[arg1]] = value;
+                return value;
+            }
+            case NodeKind::FIELD_ASSIGN:
+                return AssignField(arg0, arg1, tree_.field_stores[arg2]);
+            case NodeKind::LIST:
+                return MakeList(arg0, arg1);
+            case NodeKind::DICT:
+                return MakeDict(arg0, arg1);
+            case NodeKind::INDEX: {
+                const auto object = Eval(arg0);
+                return runtime::GetItem(object, Eval(arg1), context_);
+            }
+            case NodeKind::STORE_INDEX:
+                return StoreIndex(arg0, arg1, arg2);
+            case NodeKind::PRINT:
+                return Print(arg0, arg1);
+            case NodeKind::CALL:
+                return CallMethod(arg0, arg1, tree_.method_calls[arg2], false);
+            case NodeKind::TAIL_CALL:
+                return CallMethod(arg0, arg1, tree_.method_calls[arg2], true);
+            case NodeKind::NEW_INSTANCE:
+                return NewInstance(arg0, arg1, *tree_.classes[arg2].TryAs<runtime::Class>());
+            case NodeKind::STRINGIFY:
+                return Stringify(Eval(arg0));
+            case NodeKind::LEN:
+                return runtime::Len(Eval(arg0));
+            case NodeKind::ADD: {
+                const auto lhs = Eval(arg0);
+                return runtime::Add(lhs, Eval(arg1), context_);
+            }
+            case NodeKind::SUB: {
+                const auto lhs = Eval(arg0);
+                return runtime::Sub(lhs, Eval(arg1), context_);
+            }
+            case NodeKind::MULT: {
+                const auto lhs = Eval(arg0);
+                return runtime::Mult(lhs, Eval(arg1), context_);
+            }
+            case NodeKind::DIV: {
+                const auto lhs = Eval(arg0);
+                return runtime::Div(lhs, Eval(arg1), context_);
+            }
+            case NodeKind::AND: {
+                // Как и ast::And, вычисляет оба аргумента
+                const bool lhs = runtime::IsTrue(Eval(arg0));
+                const bool rhs = runtime::IsTrue(Eval(arg1));
+                return ObjectHolder::Own(runtime::Bool(lhs && rhs));
+            }
+            case NodeKind::OR: {
+                const bool lhs = runtime::IsTrue(Eval(arg0));
+                const bool rhs = runtime::IsTrue(Eval(arg1));
+                return ObjectHolder::Own(runtime::Bool(lhs || rhs));
+            }
+            case NodeKind::NOT:
+                return ObjectHolder::Own(runtime::Bool(!runtime::IsTrue(Eval(arg0))));
+            case NodeKind::COMPARE: {
+                const auto lhs = Eval(arg0);
+                const auto rhs = Eval(arg1);
+                const bool result = tree_.comparators[arg2](lhs, rhs, context_);
+                return ObjectHolder::Own(runtime::Bool(result));
+            }
+            case NodeKind::COMPOUND:
+                for (NodeId i = arg0; i < arg0 + arg1; ++i) {
+                    auto result = Eval(tree_.children[i]);
+                    if (context_.GetCompletion() != runtime::Completion::NORMAL) {
+                        return result;
+                    }
+                }
+                return {};
+            case NodeKind::RETURN: {
+                auto result = Eval(arg0);
+                // return None не прерывает выполнение метода
+                if (result) {
+                    context_.SetCompletion(runtime::Completion::RETURN);
+                }
+                return result;
+            }
+            case NodeKind::METHOD_BODY: {
+                auto result = Eval(arg0);
+                while (context_.GetCompletion() == runtime::Completion::TAIL_CALL) {
+                    context_.SetCompletion(runtime::Completion::NORMAL);
+                    result = Eval(arg0);
+                }
+                if (context_.GetCompletion() == runtime::Completion::RETURN) {
+                    context_.SetCompletion(runtime::Completion::NORMAL);
+                    return result;
+                }
+                return {};
+            }
+            case NodeKind::CLASS_DEF: {
+                const auto& cls = tree_.classes[arg0];
+                closure_[cls.TryAs<runtime::Class>()->GetName()] = cls;
+                return cls;
+            }
+            case NodeKind::IF_ELSE:
+                if (runtime::IsTrue(Eval(arg0))) {
+                    return Eval(arg1);
+                }
+                return arg2 != NO_NODE ? Eval(arg2) : ObjectHolder::None();
+            case NodeKind::WHILE:
+                while (runtime::IsTrue(Eval(arg0))) {
+                    auto result = Eval(arg1);
+                    if (context_.GetCompletion() != runtime::Completion::NORMAL) {
+                        return result;
+                    }
+                }
+                return {};
+            case NodeKind::FOR_RANGE:
+                return ForRange(arg0, arg1, tree_.names[arg2]);
+            case NodeKind::FOR_EACH:
+                return ForEach(arg0, arg1, tree_.names[arg2]);
+            case NodeKind::EXEC_NODE:
+                return tree_.nodes[arg0]->Execute(closure_, context_);
+        }
+        assert(false);
+        return {};
+    }
+
+private:
+    // Обработчики узлов с локальными объектами (потоками, векторами аргументов) не встраиваются
+    // в Eval: иначе они увеличивают кадр стека каждого уровня рекурсии Eval, и глубокая рекурсия
+    // методов Mython переполняет стек раньше, чем при обходе дерева указателей
+
+    ObjectHolder LoadName(runtime::Symbol name) const {
+        const auto it = closure_.find(name);
+        if (it == closure_.end()) {
+            throw runtime_error("No field with name \""s + name.GetName() + "\""s);
+        }
+        return it->second;
+    }
+
+    // Возвращает имя переменной или поля, значение которых вычисляет узел node
+    [[nodiscard]] const string& GetVariableName(NodeId node) const {
+        if (tree_.kinds[node] == NodeKind::LOAD_FIELD) {
+            return tree_.field_loads[tree_.arg1[node]].name.GetName();
+        }
+        return tree_.names[tree_.arg0[node]].GetName();
+    }
+
+    __attribute__((noinline)) ObjectHolder LoadField(NodeId object_node, FieldLoad& field) {
+        const auto object = Eval(object_node);
+        const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
+        if (!cls_inst_ptr) {
+            throw runtime_error("Failed to cast \""s + GetVariableName(object_node)
+                                + "\" to <ClassInstance>"s);
+        }
+        const auto field_ptr = cls_inst_ptr->FindField(field.name, field.cache);
+        if (!field_ptr) {
+            throw runtime_error("No field with name \""s + field.name.GetName() + "\""s);
+        }
+        return cls_inst_ptr->LoadField(*field_ptr);
+    }
+
+    __attribute__((noinline)) ObjectHolder AssignField(NodeId object_node, NodeId value_node,
+                                                       FieldStore& field) {
+        const auto object = Eval(object_node);
+        const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
+        if (!cls_inst_ptr) {
+            ast::detail::ThrowClassIntanceCastError(object, "FieldAssignment"s);
+        }
+        auto value = Eval(value_node);
+        cls_inst_ptr->SetField(field.name, value, field.cache);
+        return value;
+    }
+
+    __attribute__((noinline)) ObjectHolder MakeList(NodeId first, NodeId count) {
+        runtime::List list;
+        for (NodeId i = first; i < first + count; ++i) {
+            list.Append(Eval(tree_.children[i]));
+        }
+        return ObjectHolder::Own(std::move(list));
+    }
+
+    __attribute__((noinline)) ObjectHolder MakeDict(NodeId first, NodeId count) {
+        runtime::Dict dict;
+        for (NodeId i = first; i + 1 < first + count; i += 2) {
+            auto key = Eval(tree_.children[i]);
+            dict.Set(std::move(key), Eval(tree_.children[i + 1]), context_);
+        }
+        return ObjectHolder::Own(std::move(dict));
+    }
+
+    __attribute__((noinline)) ObjectHolder StoreIndex(NodeId object_node, NodeId index_node,
+                                                      NodeId value_node) {
+        const auto object = Eval(object_node);
+        const auto index = Eval(index_node);
+        auto value = Eval(value_node);
+        runtime::SetItem(object, index, value, context_);
+        return value;
+    }
+
+    __attribute__((noinline)) ObjectHolder Print(NodeId first, NodeId count) {
+        ostream& out = context_.GetOutputStream();
+        for (NodeId i = first; i < first + count; ++i) {
+            if (i != first) {
+                out.put(' ');
+            }
+            const auto obj = Eval(tree_.children[i]);
+            if (!obj) {
+                out << "None"sv;
+            } else if (const auto* number = obj.TryAs<runtime::Number>()) {
+                context_.WriteNumber(number->GetValue());
+            } else {
+                obj->Print(out, context_);
+            }
+        }
+        context_.EndLine();
+        return {};
+    }
+
+    // Вычисляет узлы children[first .. first + count)
+    vector<ObjectHolder> EvalArgs(NodeId first, NodeId count) {
+        vector<ObjectHolder> args;
+        args.reserve(count);
+        for (NodeId i = first; i < first + count; ++i) {
+            args.push_back(Eval(tree_.children[i]));
+        }
+        return args;
+    }
+
+    __attribute__((noinline)) ObjectHolder CallMethod(NodeId first, NodeId count,
+                                                      MethodCall& call, bool is_tail_call) {
+        const auto object = Eval(tree_.children[first]);
+        if (auto* list = object.TryAs<runtime::List>()) {
+            auto args = EvalArgs(first + 1, count - 1);
+            return list->Call(call.name, args.data(), args.size());
+        }
+        const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
+        if (!cls_inst_ptr) {
+            ast::detail::ThrowClassIntanceCastError(object, "MethodCall"s);
+        }
+        const auto args = EvalArgs(first + 1, count - 1);
+        const auto method = cls_inst_ptr->GetClass().GetMethod(call.name, call.cache);
+        if (method && method->formal_params.size() == args.size()) {
+            if (is_tail_call && IsCurrentMethod(*method)) {
+                runtime::BindArguments(*method, object, args, closure_);
+                context_.SetCompletion(runtime::Completion::TAIL_CALL);
+                return {};
+            }
+            return cls_inst_ptr->Call(*method, args, context_);
+        }
+        // Сообщение об ошибке формирует поиск метода по имени
+        return cls_inst_ptr->Call(call.name, args, context_);
+    }
+
+    // Возвращает true, если тело метода method - выполняемое тело root_. Подкласс мог
+    // переопределить метод, вызываемый узлом TAIL_CALL, и тогда кадр не заменяется
+    [[nodiscard]] bool IsCurrentMethod(const runtime::Method& method) const {
+        const auto* function = dynamic_cast<const Function*>(method.body.get());
+        return function && &function->GetTree() == &tree_ && function->GetRoot() == root_;
+    }
+
+    __attribute__((noinline)) ObjectHolder NewInstance(NodeId first, NodeId count,
+                                                       const runtime::Class& cls) {
+        auto instance = ObjectHolder::Own(runtime::ClassInstance(cls));
+        auto* cls_inst_ptr = instance.TryAs<runtime::ClassInstance>();
+        if (cls_inst_ptr->HasMethod(INIT_METHOD, count)) {
+            cls_inst_ptr->Call(INIT_METHOD, EvalArgs(first, count), context_);
+        }
+        return instance;
+    }
+
+    __attribute__((noinline)) ObjectHolder Stringify(const ObjectHolder& obj) {
+        ostringstream out;
+        if (!obj) {
+            out << "None"sv;
+        } else {
+            obj->Print(out, context_);
+        }
+        return ObjectHolder::Own(runtime::String(out.str()));
+    }
+
+    __attribute__((noinline)) ObjectHolder ForRange(NodeId first, NodeId body,
+                                                    runtime::Symbol var_name) {
+        const auto start = Eval(tree_.children[first]);
+        const auto stop = Eval(tree_.children[first + 1]);
+        const auto step = Eval(tree_.children[first + 2]);
+        const auto range = runtime::Range::FromArgs(start, stop, step);
+
+        // Как и в ast::ForRange, переменная ищется в closure один раз
+        ObjectHolder* var = nullptr;
+        for (int value = range.start; range.Contains(value); value = range.Next(value)) {
+            if (!var) {
+                var = &closure_[var_name];
+            }
+            *var = ObjectHolder::Own(runtime::Number(value));
+            auto result = Eval(body);
+            if (context_.GetCompletion() != runtime::Completion::NORMAL) {
+                return result;
+            }
+        }
+        return {};
+    }
+
+    __attribute__((noinline)) ObjectHolder ForEach(NodeId iterable_node, NodeId body,
+                                                   runtime::Symbol var_name) {
+        const auto iterable = Eval(iterable_node);
+        ObjectHolder item;
+        ObjectHolder* var = nullptr;
+        for (size_t i = 0; runtime::GetIterationItem(iterable, i, item); ++i) {
+            if (!var) {
+                var = &closure_[var_name];
+            }
+            *var = std::move(item);
+            auto result = Eval(body);
+            if (context_.GetCompletion() != runtime::Completion::NORMAL) {
+                return result;
+            }
+        }
+        return {};
+    }
+
+    Tree& tree_;
+    NodeId root_;
+    runtime::Closure& closure_;
+    runtime::Context& context_;
+};
+
+}  // namespace
+
+// ----------- Flattener -----------------------
+
+// Переводит узлы AST в плоское дерево. Дочерние узлы добавляются раньше родителя
+class Flattener {
+public:
+    explicit Flattener(Program& program)
+        : program_(program)
+        , tree_(program.tree_)
+        {}
+
+    void FlattenProgram() {
+        const runtime::Executable* root = program_.source_.get();
+        // Парсер возвращает дерево внутри ast::Program, владеющей его узлами
+        if (const auto* parsed = dynamic_cast<const ast::Program*>(root)) {
+            root = &parsed->GetTree();
+        }
+        program_.root_ = FlattenNode(*root);
+    }
+
+private:
+    NodeId AddNode(NodeKind kind, NodeId arg0 = 0, NodeId arg1 = 0, NodeId arg2 = 0) {
+        tree_.kinds.push_back(kind);
+        tree_.arg0.push_back(arg0);
+        tree_.arg1.push_back(arg1);
+        tree_.arg2.push_back(arg2);
+        return static_cast<NodeId>(tree_.kinds.size() - 1);
+    }
+
+    template <typename T>
+    static NodeId Append(vector<T>& values, T value) {
+        values.push_back(std::move(value));
+        return static_cast<NodeId>(values.size() - 1);
+    }
+
+    NodeId AddName(runtime::Symbol name) {
+        const auto [it, inserted]
+            = name_indices_.emplace(name, static_cast<NodeId>(tree_.names.size()));
+        if (inserted) {
+            tree_.names.push_back(name);
+        }
+        return it->second;
+    }
+
+    // Переводит узлы nodes и добавляет их номера в список дочерних узлов.
+    // Возвращает начало списка
+    NodeId FlattenList(const vector<ast::StatementPtr>& nodes, NodeId first_child = NO_NODE) {
+        vector<NodeId> ids;
+        ids.reserve(nodes.size() + 1);
+        if (first_child != NO_NODE) {
+            ids.push_back(first_child);
+        }
+        for (const auto& node : nodes) {
+            ids.push_back(FlattenNode(*node));
+        }
+        const auto first = static_cast<NodeId>(tree_.children.size());
+        tree_.children.insert(tree_.children.end(), ids.begin(), ids.end());
+        return first;
+    }
+
+    NodeId FlattenNode(const runtime::Executable& node) {
+        using namespace ast;
+
+        if (const auto* num = dynamic_cast<const NumericConst*>(&node)) {
+            return AddNode(NodeKind::CONST, Append(tree_.constants, ObjectHolder::Own(
+                    runtime::Number(num->GetValue().GetValue()))));
+        }
+        if (const auto* str = dynamic_cast<const StringConst*>(&node)) {
+            return AddNode(NodeKind::CONST, Append(tree_.constants, ObjectHolder::Own(
+                    runtime::String(str->GetValue().GetValue()))));
+        }
+        if (const auto* boolean = dynamic_cast<const BoolConst*>(&node)) {
+            return AddNode(NodeKind::CONST, Append(tree_.constants, ObjectHolder::Own(
+                    runtime::Bool(boolean->GetValue().GetValue()))));
+        }
+        if (dynamic_cast<const None*>(&node)) {
+            return AddNode(NodeKind::NONE);
+        }
+        if (const auto* var = dynamic_cast<const VariableValue*>(&node)) {
+            return FlattenVariableValue(*var);
+        }
+        if (const auto* assign = dynamic_cast<const Assignment*>(&node)) {
+            const NodeId value = FlattenNode(assign->GetValue());
+            return AddNode(NodeKind::ASSIGN, value, AddName(assign->GetVarName()));
+        }
+        if (const auto* field_assign = dynamic_cast<const FieldAssignment*>(&node)) {
+            const NodeId object = FlattenVariableValue(field_assign->GetObject());
+            const NodeId value = FlattenNode(field_assign->GetValue());
+            const NodeId field
+                = Append(tree_.field_stores, FieldStore{field_assign->GetFieldName(), {}});
+            return AddNode(NodeKind::FIELD_ASSIGN, object, value, field);
+        }
+        if (const auto* list = dynamic_cast<const ListLiteral*>(&node)) {
+            const NodeId first = FlattenList(list->GetItems());
+            return AddNode(NodeKind::LIST, first, static_cast<NodeId>(list->GetItems().size()));
+        }
+        if (const auto* dict = dynamic_cast<const DictLiteral*>(&node)) {
+            const NodeId first = FlattenList(dict->GetItems());
+            return AddNode(NodeKind::DICT, first, static_cast<NodeId>(dict->GetItems().size()));
+        }
+        if (const auto* index = dynamic_cast<const ast::Index*>(&node)) {
+            const NodeId object = FlattenNode(index->GetObject());
+            return AddNode(NodeKind::INDEX, object, FlattenNode(index->GetIndex()));
+        }
+        if (const auto* index_assign = dynamic_cast<const IndexAssignment*>(&node)) {
+            const NodeId object = FlattenNode(index_assign->GetObject());
+            const NodeId index = FlattenNode(index_assign->GetIndex());
+            return AddNode(NodeKind::STORE_INDEX, object, index,
+                           FlattenNode(index_assign->GetValue()));
+        }
+        if (const auto* print = dynamic_cast<const Print*>(&node)) {
+            const NodeId first = FlattenList(print->GetArgs());
+            return AddNode(NodeKind::PRINT, first, static_cast<NodeId>(print->GetArgs().size()));
+        }
+        if (const auto* call = dynamic_cast<const ast::MethodCall*>(&node)) {
+            const NodeId first = FlattenList(call->GetArgs(), FlattenNode(call->GetObject()));
+            return AddNode(call->IsTailCall() ? NodeKind::TAIL_CALL : NodeKind::CALL, first,
+                           static_cast<NodeId>(call->GetArgs().size() + 1),
+                           Append(tree_.method_calls, flat::MethodCall{call->GetMethodName(), {}}));
+        }
+        if (const auto* new_inst = dynamic_cast<const ast::NewInstance*>(&node)) {
+            const NodeId cls = FlattenClass(new_inst->GetClass());
+            const NodeId first = FlattenList(new_inst->GetArgs());
+            return AddNode(NodeKind::NEW_INSTANCE, first,
+                           static_cast<NodeId>(new_inst->GetArgs().size()), cls);
+        }
+        if (const auto* stringify = dynamic_cast<const ast::Stringify*>(&node)) {
+            return AddNode(NodeKind::STRINGIFY, FlattenNode(stringify->GetArgument()));
+        }
+        if (const auto* len = dynamic_cast<const Len*>(&node)) {
+            return AddNode(NodeKind::LEN, FlattenNode(len->GetArgument()));
+        }
+        if (const auto* not_op = dynamic_cast<const Not*>(&node)) {
+            return AddNode(NodeKind::NOT, FlattenNode(not_op->GetArgument()));
+        }
+        if (const auto* cmp = dynamic_cast<const Comparison*>(&node)) {
+            const NodeId lhs = FlattenNode(cmp->GetLhs());
+            const NodeId rhs = FlattenNode(cmp->GetRhs());
+            return AddNode(NodeKind::COMPARE, lhs, rhs,
+                           Append(tree_.comparators, cmp->GetComparator()));
+        }
+        if (const auto* add = dynamic_cast<const Add*>(&node)) {
+            return FlattenBinary(*add, NodeKind::ADD);
+        }
+        if (const auto* sub = dynamic_cast<const Sub*>(&node)) {
+            return FlattenBinary(*sub, NodeKind::SUB);
+        }
+        if (const auto* mult = dynamic_cast<const Mult*>(&node)) {
+            return FlattenBinary(*mult, NodeKind::MULT);
+        }
+        if (const auto* div = dynamic_cast<const Div*>(&node)) {
+            return FlattenBinary(*div, NodeKind::DIV);
+        }
+        if (const auto* or_op = dynamic_cast<const Or*>(&node)) {
+            return FlattenBinary(*or_op, NodeKind::OR);
+        }
+        if (const auto* and_op = dynamic_cast<const And*>(&node)) {
+            return FlattenBinary(*and_op, NodeKind::AND);
+        }
+        if (const auto* compound = dynamic_cast<const Compound*>(&node)) {
+            const NodeId first = FlattenList(compound->GetStatements());
+            return AddNode(NodeKind::COMPOUND, first,
+                           static_cast<NodeId>(compound->GetStatements().size()));
+        }
+        if (const auto* ret = dynamic_cast<const Return*>(&node)) {
+            return AddNode(NodeKind::RETURN, FlattenNode(ret->GetStatement()));
+        }
+        if (const auto* body = dynamic_cast<const MethodBody*>(&node)) {
+            return AddNode(NodeKind::METHOD_BODY, FlattenNode(body->GetBody()));
+        }
+        if (const auto* cls_def = dynamic_cast<const ClassDefinition*>(&node)) {
+            return AddNode(NodeKind::CLASS_DEF,
+                           FlattenClass(*cls_def->GetClass().TryAs<runtime::Class>()));
+        }
+        if (const auto* if_else = dynamic_cast<const IfElse*>(&node)) {
+            const NodeId condition = FlattenNode(if_else->GetCondition());
+            const NodeId if_body = FlattenNode(if_else->GetIfBody());
+            const auto* else_body = if_else->GetElseBody();
+            return AddNode(NodeKind::IF_ELSE, condition, if_body,
+                           else_body ? FlattenNode(*else_body) : NO_NODE);
+        }
+        if (const auto* while_loop = dynamic_cast<const While*>(&node)) {
+            const NodeId condition = FlattenNode(while_loop->GetCondition());
+            return AddNode(NodeKind::WHILE, condition, FlattenNode(while_loop->GetBody()));
+        }
+        if (const auto* for_range = dynamic_cast<const ForRange*>(&node)) {
+            return FlattenForRange(*for_range);
+        }
+        if (const auto* for_each = dynamic_cast<const ForEach*>(&node)) {
+            const NodeId iterable = FlattenNode(for_each->GetIterable());
+            return AddNode(NodeKind::FOR_EACH, iterable, FlattenNode(for_each->GetBody()),
+                           AddName(for_each->GetVarName()));
+        }
+        // Узлы, неизвестные плоскому дереву, исполняются интерпретатором AST
+        return AddNode(NodeKind::EXEC_NODE,
+                       Append(tree_.nodes, const_cast<runtime::Executable*>(&node)));
+    }
+
+    NodeId FlattenVariableValue(const ast::VariableValue& var) {
+        const auto& ids = var.GetDottedIds();
+        NodeId node = AddNode(NodeKind::LOAD_NAME, AddName(ids.front()));
+        for (size_t i = 1; i < ids.size(); ++i) {
+            node = AddNode(NodeKind::LOAD_FIELD, node,
+                           Append(tree_.field_loads, FieldLoad{ids[i], {}}));
+        }
+        return node;
+    }
+
+    NodeId FlattenForRange(const ast::ForRange& node) {
+        const auto flatten_optional = [this](const ast::Statement* arg) {
+            return arg ? FlattenNode(*arg) : AddNode(NodeKind::NONE);
+        };
+        const NodeId args[] = {flatten_optional(node.GetStart()), FlattenNode(node.GetStop()),
+                               flatten_optional(node.GetStep())};
+        const auto first = static_cast<NodeId>(tree_.children.size());
+        tree_.children.insert(tree_.children.end(), begin(args), end(args));
+        const NodeId body = FlattenNode(node.GetBody());
+        return AddNode(NodeKind::FOR_RANGE, first, body, AddName(node.GetVarName()));
+    }
+
+    NodeId FlattenBinary(const ast::BinaryOperation& node, NodeKind kind) {
+        const NodeId lhs = FlattenNode(node.GetLhs());
+        const NodeId rhs = FlattenNode(node.GetRhs());
+        return AddNode(kind, lhs, rhs);
+    }
+
+    // Возвращает номер класса, методы которого переведены в плоское дерево.
+    // Номер занимается до перевода методов, поэтому методы могут создавать экземпляры
+    // своего класса
+    NodeId FlattenClass(const runtime::Class& cls) {
+        if (const auto it = class_indices_.find(&cls); it != class_indices_.end()) {
+            return it->second;
+        }
+        const auto index = Append(tree_.classes, ObjectHolder::None());
+        class_indices_.emplace(&cls, index);
+
+        const runtime::Class* parent = nullptr;
+        if (cls.GetParent()) {
+            parent = tree_.classes[FlattenClass(*cls.GetParent())].TryAs<runtime::Class>();
+            assert(parent != nullptr);
+        }
+
+        vector<runtime::Method> methods;
+        for (const auto& method : cls.GetMethods()) {
+            methods.push_back({method.name, method.formal_params,
+                               make_unique<Function>(tree_, FlattenNode(*method.body))});
+        }
+        tree_.classes[index]
+            = ObjectHolder::Own(runtime::Class(cls.GetName(), std::move(methods), parent));
+        return index;
+    }
+
+    Program& program_;
+    Tree& tree_;
+    unordered_map<runtime::Symbol, NodeId> name_indices_;
+    unordered_map<const runtime::Class*, NodeId> class_indices_;
+};
+
+// ----------- Tree -----------------------
+
+ostream& operator<<(ostream& os, const Tree& tree) {
+    for (NodeId node = 0; node < tree.GetSize(); ++node) {
+        const NodeId arg0 = tree.arg0[node];
+        const NodeId arg1 = tree.arg1[node];
+        const NodeId arg2 = tree.arg2[node];
+        const auto print_children = [&](NodeId first, NodeId count) {
+            for (NodeId i = first; i < first + count; ++i) {
+                os << ' ' << tree.children[i];
+            }
+        };
+
+        os << node << ' ' << NodeKindName(tree.kinds[node]);
+        switch (tree.kinds[node]) {
+            case NodeKind::CONST: {
+                runtime::DummyContext context;
+                os << ' ';
+                tree.constants[arg0]->Print(os, context);
+                break;
+            }
+            case NodeKind::LOAD_NAME:
+                os << ' ' << tree.names[arg0];
+                break;
+            case NodeKind::LOAD_FIELD:
+                os << ' ' << arg0 << ' ' << tree.field_loads[arg1].name;
+                break;
+            case NodeKind::ASSIGN:
+                os << ' ' << arg0 << ' ' << tree.names[arg1];
+                break;
+            case NodeKind::FIELD_ASSIGN:
+                os << ' ' << arg0 << ' ' << tree.field_stores[arg2].name << ' ' << arg1;
+                break;
+            case NodeKind::CALL:
+            case NodeKind::TAIL_CALL:
+                os << ' ' << tree.children[arg0] << ' ' << tree.method_calls[arg2].name;
+                print_children(arg0 + 1, arg1 - 1);
+                break;
+            case NodeKind::NEW_INSTANCE:
+                os << ' ' << tree.classes[arg2].TryAs<runtime::Class>()->GetName();
+                print_children(arg0, arg1);
+                break;
+            case NodeKind::PRINT:
+            case NodeKind::COMPOUND:
+            case NodeKind::LIST:
+            case NodeKind::DICT:
+                print_children(arg0, arg1);
+                break;
+            case NodeKind::STRINGIFY:
+            case NodeKind::LEN:
+            case NodeKind::NOT:
+            case NodeKind::RETURN:
+            case NodeKind::METHOD_BODY:
+            case NodeKind::EXEC_NODE:
+                os << ' ' << arg0;
+                break;
+            case NodeKind::ADD:
+            case NodeKind::SUB:
+            case NodeKind::MULT:
+            case NodeKind::DIV:
+            case NodeKind::AND:
+            case NodeKind::OR:
+            case NodeKind::INDEX:
+                os << ' ' << arg0 << ' ' << arg1;
+                break;
+            case NodeKind::COMPARE:
+            case NodeKind::STORE_INDEX:
+                os << ' ' << arg0 << ' ' << arg1 << ' ' << arg2;
+                break;
+            case NodeKind::CLASS_DEF:
+                os << ' ' << tree.classes[arg0].TryAs<runtime::Class>()->GetName();
+                break;
+            case NodeKind::IF_ELSE:
+                os << ' ' << arg0 << ' ' << arg1;
+                if (arg2 != NO_NODE) {
+                    os << ' ' << arg2;
+                }
+                break;
+            case NodeKind::WHILE:
+                os << ' ' << arg0 << ' ' << arg1;
+                break;
+            case NodeKind::FOR_RANGE:
+                os << ' ' << tree.names[arg2];
+                print_children(arg0, 3);
+                os << ' ' << arg1;
+                break;
+            case NodeKind::FOR_EACH:
+                os << ' ' << tree.names[arg2] << ' ' << arg0 << ' ' << arg1;
+                break;
+            case NodeKind::NONE:
+                break;
+        }
+        os << '\n';
+    }
+    return os;
+}
+
+ObjectHolder Evaluate(Tree& tree, NodeId root, runtime::Closure& closure,
+                      runtime::Context& context) {
+    return Evaluator{tree, root, closure, context}.Eval(root);
+}
+
+// ----------- Function -----------------------
+
+Function::Function(Tree& tree, NodeId root)
+    : tree_(tree)
+    , root_(root)
+    {}
+
+ObjectHolder Function::Execute(runtime::Closure& closure, runtime::Context& context) {
+    return Evaluate(tree_, root_, closure, context);
+}
+
+const Tree& Function::GetTree() const {
+    return tree_;
+}
+
+NodeId Function::GetRoot() const {
+    return root_;
+}
+
+// ----------- Program -----------------------
+
+Program::Program(std::unique_ptr<runtime::Executable> tree)
+    : source_(std::move(tree))
+    {}
+
+ObjectHolder Program::Execute(runtime::Closure& closure, runtime::Context& context) {
+    return Evaluate(tree_, root_, closure, context);
+}
+
+const Tree& Program::GetTree() const {
+    return tree_;
+}
+
+NodeId Program::GetRoot() const {
+    return root_;
+}
+
+std::unique_ptr<Program> Flatten(std::unique_ptr<runtime::Executable> tree) {
+    auto program = std::make_unique<Program>(std::move(tree));
+    Flattener{*program}.FlattenProgram();
+    return program;
+}
+
+}  // namespace flat
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "runtime.h"
+#include "statement.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace flat {
+
+// Номер узла плоского дерева
+using NodeId = std::uint32_t;
+
+// Номер, обозначающий отсутствующий узел (например, ветку else)
+constexpr NodeId NO_NODE = std::numeric_limits<NodeId>::max();
+
+// Виды узлов плоского дерева. Значения операндов arg0, arg1, arg2 узла зависят от его вида.
+// Списки дочерних узлов переменной длины хранятся подряд в Tree::children
+enum class NodeKind : std::uint8_t {
+    CONST,         // константа constants[arg0]
+    NONE,          // значение None
+    LOAD_NAME,     // значение переменной names[arg0]
+    LOAD_FIELD,    // значение поля field_loads[arg1] объекта, вычисленного узлом arg0
+    ASSIGN,        // присваивает переменной names[arg1] значение узла arg0
+    FIELD_ASSIGN,  // присваивает полю field_stores[arg2] объекта, вычисленного узлом arg0,
+                   // значение узла arg1
+    LIST,          // новый список из значений узлов children[arg0 .. arg0 + arg1)
+    DICT,          // новый словарь из чередующихся ключей и значений узлов
+                   // children[arg0 .. arg0 + arg1)
+    INDEX,         // элемент arg0[arg1] списка или словаря
+    STORE_INDEX,   // присваивает элементу arg0[arg1] списка или словаря значение узла arg2
+    PRINT,         // выводит значения узлов children[arg0 .. arg0 + arg1)
+    CALL,          // вызывает метод method_calls[arg2] у объекта или списка, вычисленного узлом
+                   // children[arg0], с аргументами children[arg0 + 1 .. arg0 + arg1)
+    TAIL_CALL,     // то же, что CALL, но вызов того же метода в хвостовой позиции заменяет
+                   // аргументы в closure и выполняет тело метода заново (ast::MethodCall)
+    NEW_INSTANCE,  // создаёт экземпляр класса classes[arg2] с аргументами конструктора
+                   // children[arg0 .. arg0 + arg1)
+    STRINGIFY,     // строковое представление значения узла arg0
+    LEN,           // длина списка, словаря или строки arg0
+    ADD,           // arg0 + arg1
+    SUB,           // arg0 - arg1
+    MULT,          // arg0 * arg1
+    DIV,           // arg0 / arg1
+    AND,           // arg0 and arg1
+    OR,            // arg0 or arg1
+    NOT,           // not arg0
+    COMPARE,       // comparators[arg2](arg0, arg1)
+    COMPOUND,      // последовательно выполняет узлы children[arg0 .. arg0 + arg1)
+    RETURN,        // return arg0
+    METHOD_BODY,   // тело метода arg0
+    CLASS_DEF,     // связывает класс classes[arg0] с его именем
+    IF_ELSE,       // if arg0: arg1 else: arg2 (arg2 может быть равен NO_NODE)
+    WHILE,         // while arg0: arg1
+    FOR_RANGE,     // for names[arg2] in range(children[arg0], children[arg0 + 1],
+                   // children[arg0 + 2]): arg1. Отсутствующие start и step - узлы NONE
+    FOR_EACH,      // for names[arg2] in arg0: arg1
+    EXEC_NODE,     // выполняет узел исходного AST nodes[arg0]
+};
+
+// Поле, к которому обращается узел LOAD_FIELD, и его встроенный кэш
+struct FieldLoad {
+    runtime::Symbol name;
+    runtime::FieldLoadCache cache;
+};
+
+// Поле, которому присваивает значение узел FIELD_ASSIGN, и его встроенный кэш
+struct FieldStore {
+    runtime::Symbol name;
+    runtime::FieldStoreCache cache;
+};
+
+// Метод, который вызывает узел CALL или TAIL_CALL, и его встроенный кэш
+struct MethodCall {
+    runtime::Symbol name;
+    runtime::MethodCache cache;
+};
+
+// Плоское представление AST. Узлы хранятся подряд в порядке обратного обхода (post-order):
+// дочерние узлы предшествуют родителю. Вид узла и его операнды лежат в параллельных массивах
+// и ссылаются на другие узлы и данные по 32-битным номерам, а не по указателям
+struct Tree {
+    std::vector<NodeKind> kinds;
+    std::vector<NodeId> arg0;
+    std::vector<NodeId> arg1;
+    std::vector<NodeId> arg2;
+    // Списки дочерних узлов PRINT, CALL, TAIL_CALL, NEW_INSTANCE, LIST, DICT, COMPOUND
+    // и FOR_RANGE
+    std::vector<NodeId> children;
+
+    std::vector<runtime::ObjectHolder> constants;
+    std::vector<runtime::Symbol> names;
+    std::vector<ast::Comparison::Comparator> comparators;
+    // Классы с методами, переведёнными в плоское дерево
+    std::vector<runtime::ObjectHolder> classes;
+    // Узлы исходного AST, которые нельзя перевести в плоское дерево
+    std::vector<runtime::Executable*> nodes;
+    // Встроенные кэши. Заполняются во время выполнения
+    std::vector<FieldLoad> field_loads;
+    std::vector<FieldStore> field_stores;
+    std::vector<MethodCall> method_calls;
+
+    // Возвращает количество узлов
+    [[nodiscard]] size_t GetSize() const {
+        return kinds.size();
+    }
+};
+
+// Выводит в os узлы дерева по одному в строке: номер, вид и операнды
+std::ostream& operator<<(std::ostream& os, const Tree& tree);
+
+// Вычисляет узел root дерева tree.
+// Переменные читаются и записываются в closure, вывод осуществляется через context
+runtime::ObjectHolder Evaluate(Tree& tree, NodeId root, runtime::Closure& closure,
+                               runtime::Context& context);
+
+// Тело метода, переведённое в плоское дерево
+class Function : public runtime::Executable {
+public:
+    Function(Tree& tree, NodeId root);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Tree& GetTree() const;
+    [[nodiscard]] NodeId GetRoot() const;
+
+private:
+    Tree& tree_;
+    NodeId root_;
+};
+
+// Программа, переведённая в плоское дерево.
+// Владеет исходным AST, поскольку узлы EXEC_NODE ссылаются на его узлы.
+// У программы, прочитанной из кэша (flat::Deserialize), исходного AST нет
+class Program : public runtime::Executable {
+public:
+    explicit Program(std::unique_ptr<runtime::Executable> tree);
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    // Выполняет программу обходом плоского дерева
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Tree& GetTree() const;
+    [[nodiscard]] NodeId GetRoot() const;
+
+private:
+    friend class Flattener;
+    friend class ProgramReader;
+
+    std::unique_ptr<runtime::Executable> source_;
+    Tree tree_;
+    NodeId root_ = NO_NODE;
+};
+
+// Переводит дерево, построенное parse::ParseProgram, в плоское представление
+std::unique_ptr<Program> Flatten(std::unique_ptr<runtime::Executable> tree);
+
+}  // namespace flat
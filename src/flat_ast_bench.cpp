@@ -0,0 +1,121 @@
+#include "bench_runner_p.h"
+#include "flat_ast.h"
+#include "lexer.h"
+#include "parse.h"
+
+#include <string>
+
+using namespace std;
+
+namespace flat {
+
+namespace {
+
+// ---- Обход дерева указателей и плоского дерева ----
+
+constexpr int FIB_ARGUMENT = 22;
+constexpr int EXPRESSION_TERMS = 64;
+constexpr int EXPRESSION_REPEAT = 16;
+constexpr int LONG_PROGRAM_STATEMENTS = 100'000;
+
+// Рекурсивное вычисление числа Фибоначчи: много вызовов методов и мелких выражений
+string MakeFibProgram() {
+    return R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+f = Fib()
+print f.calc()"s + to_string(FIB_ARGUMENT) + ")\n"s;
+}
+
+// Метод с длинным арифметическим выражением, вызываемый из рекурсии
+string MakeExpressionProgram() {
+    string expression = "a"s;
+    for (int i = 1; i < EXPRESSION_TERMS; ++i) {
+        expression += (i % 3 == 0 ? " - b * "s : " + a * "s) + to_string(i % 7 + 1);
+    }
+    return R"(
+class Expr:
+  def eval(a, b):
+    return )"s + expression + R"(
+
+  def repeat(n):
+    if n < 2:
+      return self.eval(n, 2)
+    return self.repeat(n - 1) + self.repeat(n - 2)
+
+e = Expr()
+print e.repeat()"s + to_string(EXPRESSION_REPEAT) + ")\n"s;
+}
+
+// Длинная линейная программа, каждая инструкция которой выполняется один раз.
+// Дерево не помещается в кэш процессора
+string MakeLongProgram() {
+    string program = "x = 1\ny = 2\n"s;
+    for (int i = 0; i < LONG_PROGRAM_STATEMENTS; ++i) {
+        const string n = to_string(i % 100 + 1);
+        program += i % 2 == 0 ? "x = (x + "s + n + ") * 3 / (y + "s + n + ") - x\n"s
+                              : "y = y - x * "s + n + " + (x + y) / "s + n + "\n"s;
+    }
+    program += "print x, y\n"s;
+    return program;
+}
+
+// Измеряет время выполнения program обходом дерева указателей либо плоского дерева.
+// Разбор программы и построение плоского дерева в измерение не входят
+BenchResult BenchTree(const string& program, bool use_flat) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = parse::ParseProgram(lexer);
+    if (use_flat) {
+        tree = Flatten(std::move(tree));
+    }
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    const auto start = chrono::steady_clock::now();
+    tree->Execute(closure, context);
+    const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    DoNotOptimize(context.output.str());
+    return {0, elapsed.count(), "ms execute"s};
+}
+
+BenchResult BenchFibPointerTree() {
+    return BenchTree(MakeFibProgram(), false);
+}
+
+BenchResult BenchFibFlatTree() {
+    return BenchTree(MakeFibProgram(), true);
+}
+
+BenchResult BenchExpressionPointerTree() {
+    return BenchTree(MakeExpressionProgram(), false);
+}
+
+BenchResult BenchExpressionFlatTree() {
+    return BenchTree(MakeExpressionProgram(), true);
+}
+
+BenchResult BenchLongProgramPointerTree() {
+    return BenchTree(MakeLongProgram(), false);
+}
+
+BenchResult BenchLongProgramFlatTree() {
+    return BenchTree(MakeLongProgram(), true);
+}
+
+}  // namespace
+
+void RunFlatAstBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, flat::BenchFibPointerTree);
+    RUN_BENCH(br, flat::BenchFibFlatTree);
+    RUN_BENCH(br, flat::BenchExpressionPointerTree);
+    RUN_BENCH(br, flat::BenchExpressionFlatTree);
+    RUN_BENCH(br, flat::BenchLongProgramPointerTree);
+    RUN_BENCH(br, flat::BenchLongProgramFlatTree);
+}
+
+}  // namespace flat
@@ -0,0 +1,386 @@
+#include "flat_ast.h"
+#include "lexer.h"
+#include "parse.h"
+#include "test_runner_p.h"
+#include "transform_test_p.h"
+
+using namespace std;
+
+namespace flat {
+
+namespace {
+
+unique_ptr<Program> FlattenProgram(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    return Flatten(parse::ParseProgram(lexer));
+}
+
+void TestPostOrderLayout() {
+    auto program = FlattenProgram("x = 1 + 2\nprint x, 'a'\n"s);
+
+    ostringstream dump;
+    dump << program->GetTree();
+    ASSERT_EQUAL(dump.str(),
+                 "0 CONST 1\n"
+                 "1 CONST 2\n"
+                 "2 ADD 0 1\n"
+                 "3 ASSIGN 2 x\n"
+                 "4 LOAD_NAME x\n"
+                 "5 CONST a\n"
+                 "6 PRINT 4 5\n"
+                 "7 COMPOUND 3 6\n"s);
+    ASSERT_EQUAL(program->GetRoot(), 7U);
+}
+
+void TestChildrenPrecedeParents() {
+    auto program = FlattenProgram(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0 and self.value < 100:
+      self.value = self.value + n
+    else:
+      return None
+    return self.value
+
+c = Counter()
+print c.add(2), str(c.value), not c.add(-1)
+)"s);
+    const Tree& tree = program->GetTree();
+    ASSERT_EQUAL(tree.arg0.size(), tree.GetSize());
+    ASSERT_EQUAL(tree.arg1.size(), tree.GetSize());
+    ASSERT_EQUAL(tree.arg2.size(), tree.GetSize());
+
+    const auto assert_child = [&tree](NodeId parent, NodeId child) {
+        ASSERT(child < parent);
+        ASSERT(child < tree.GetSize());
+    };
+    for (NodeId node = 0; node < tree.GetSize(); ++node) {
+        const NodeId arg0 = tree.arg0[node];
+        const NodeId arg1 = tree.arg1[node];
+        const NodeId arg2 = tree.arg2[node];
+        switch (tree.kinds[node]) {
+            case NodeKind::ADD:
+            case NodeKind::SUB:
+            case NodeKind::MULT:
+            case NodeKind::DIV:
+            case NodeKind::AND:
+            case NodeKind::OR:
+            case NodeKind::COMPARE:
+            case NodeKind::FIELD_ASSIGN:
+                assert_child(node, arg0);
+                assert_child(node, arg1);
+                break;
+            case NodeKind::LOAD_FIELD:
+            case NodeKind::ASSIGN:
+            case NodeKind::STRINGIFY:
+            case NodeKind::NOT:
+            case NodeKind::RETURN:
+            case NodeKind::METHOD_BODY:
+                assert_child(node, arg0);
+                break;
+            case NodeKind::IF_ELSE:
+                assert_child(node, arg0);
+                assert_child(node, arg1);
+                assert_child(node, arg2);
+                break;
+            case NodeKind::PRINT:
+            case NodeKind::CALL:
+            case NodeKind::NEW_INSTANCE:
+            case NodeKind::COMPOUND:
+                for (NodeId i = arg0; i < arg0 + arg1; ++i) {
+                    assert_child(node, tree.children.at(i));
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    // Корень программы добавляется последним
+    ASSERT_EQUAL(program->GetRoot(), static_cast<NodeId>(tree.GetSize() - 1));
+}
+
+void TestSameOutputAsPointerTree() {
+    const string program = R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+  def area():
+    return 0
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+  def __eq__(rhs):
+    return True
+
+class Node:
+  def __init__(value):
+    self.value = value
+
+class Copier:
+  def copy(node):
+    return Node(node.value + 1)
+
+r = Rect(10, 20)
+s = Shape()
+f = Fib()
+print r, s, r.area(), s.area(), str(r) + '!'
+print f.calc(15), 7 / 2, -3, not 1, 1 and 0, None or 'x', f == 1
+if r.area() > 100 and not s.area():
+  print 'big'
+else:
+  print 'small'
+x = r
+x.w = 1
+n = Node(1)
+c = Copier()
+n.next = c.copy(n)
+m = c.copy(n.next)
+print r.area(), x.h, n.next.value, m.value, 'a' < 'b', 2 >= 3, None == None
+)"s;
+    const auto [ast_output, flat_output] = RunBeforeAndAfter(Flatten, program);
+    ASSERT_EQUAL(flat_output,
+                 "Rect(10x20) Shape 200 0 Rect(10x20)!\n"
+                 "610 3 -3 False False True True\n"
+                 "big\n"
+                 "20 20 2 3 True False True\n"s);
+    ASSERT_EQUAL(flat_output, ast_output);
+}
+
+void TestLoops() {
+    const auto [ast_output, flat_output] = RunBeforeAndAfter(Flatten, R"(
+class Loops:
+  def sum_range(a, b, step):
+    total = 0
+    for i in range(a, b, step):
+      total = total + i
+    return total
+
+  def first_square_above(limit):
+    n = 0
+    while True:
+      n = n + 1
+      if n * n > limit:
+        return n
+
+  def nested(n):
+    count = 0
+    for i in range(n):
+      j = 0
+      while j < i:
+        j = j + 1
+        count = count + j
+    return count
+
+l = Loops()
+print l.sum_range(0, 10, 1), l.sum_range(10, -10, -3), l.sum_range(3, 3, 1)
+print l.first_square_above(50), l.nested(5)
+for k in range(2):
+  print k
+print k
+)"s);
+    ASSERT_EQUAL(flat_output, "45 7 0\n8 20\n0\n1\n1\n"s);
+    ASSERT_EQUAL(flat_output, ast_output);
+}
+
+void TestLists() {
+    const auto [ast_output, flat_output] = RunBeforeAndAfter(Flatten, R"(
+class Stack:
+  def __init__():
+    self.items = []
+
+  def push(value):
+    self.items.append(value)
+
+  def sum():
+    total = 0
+    for item in self.items:
+      total = total + item
+    return total
+
+  def top():
+    return self.items[len(self.items) - 1]
+
+s = Stack()
+for i in range(5):
+  s.push(i * i)
+print s.items, s.sum(), s.top(), len(s.items)
+grid = [[1, 2], [3, 4]]
+grid[1][0] = grid[0][1] * 10
+print grid, grid[-1][0], [] == [], ['a', None, True]
+words = ['x']
+words.append('y')
+words[0] = words[1] + '!'
+print words, len(words[0]), str(words)
+)"s);
+    ASSERT_EQUAL(flat_output,
+                 "[0, 1, 4, 9, 16] 30 16 5\n"
+                 "[[1, 2], [20, 4]] 20 True [a, None, True]\n"
+                 "[y!, y] 2 [y!, y]\n"s);
+    ASSERT_EQUAL(flat_output, ast_output);
+}
+
+void TestDicts() {
+    const auto [ast_output, flat_output] = RunBeforeAndAfter(Flatten, R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __hash__():
+    return self.x * 31 + self.y
+
+  def __eq__(other):
+    return self.x == other.x and self.y == other.y
+
+class Counter:
+  def __init__():
+    self.counts = {}
+
+  def add(word):
+    if word in self.counts:
+      self.counts[word] = self.counts[word] + 1
+    else:
+      self.counts[word] = 1
+
+  def total():
+    result = 0
+    for word in self.counts:
+      result = result + self.counts[word]
+    return result
+
+c = Counter()
+for w in ['a', 'b', 'a', 'c', 'a', 'b']:
+  c.add(w)
+print c.counts, c.total(), len(c.counts), 'd' in c.counts
+grid = {Point(0, 0): 'origin', Point(1, 2): 'p'}
+grid[Point(1, 2)] = 'q'
+print grid[Point(0, 0)], grid[Point(1, 2)], len(grid), Point(2, 1) in grid
+mixed = {1: 'one', '1': 'str', True: [1, 2], None: {}}
+print mixed[1], mixed['1'], mixed[True][1], mixed[None], 2 in [1, 2], 'bc' in 'abc'
+print {} == {}, {1: 2} == {1: 2}, str({'k': 'v'})
+)"s);
+    ASSERT_EQUAL(flat_output,
+                 "{a: 3, b: 2, c: 1} 6 3 False\n"
+                 "origin q 2 False\n"
+                 "one str 2 {} True True\n"
+                 "True True {k: v}\n"s);
+    ASSERT_EQUAL(flat_output, ast_output);
+}
+
+void TestTailCalls() {
+    const auto [ast_output, flat_output] = RunBeforeAndAfter(Flatten, R"(
+class Counter:
+  def count(n, acc):
+    if n == 0:
+      return acc
+    return self.count(n - 1, acc + 1)
+
+  def even(n):
+    if n < 2:
+      return n == 0
+    else:
+      return self.even(n - 2)
+
+  def after(n):
+    if n > 0:
+      return self.after(n - 1)
+    print 'after', n
+
+class Other:
+  def swap(n, other):
+    return 'other ' + str(n)
+
+class Swapper:
+  def swap(n, other):
+    if n == 0:
+      return 'swapper'
+    self = other
+    return self.swap(n - 1, other)
+
+c = Counter()
+print c.count(100000, 0), c.even(100001), c.even(100000)
+c.after(2)
+s = Swapper()
+print s.swap(3, Other()), s.swap(3, Swapper())
+)"s);
+    ASSERT_EQUAL(flat_output,
+                 "100000 False True\n"
+                 "after 0\n"
+                 "after 1\n"
+                 "after 2\n"
+                 "other 2 swapper\n"s);
+    ASSERT_EQUAL(flat_output, ast_output);
+}
+
+void TestRuntimeErrors() {
+    runtime::DummyContext context;
+    const auto run = [&context](const string& program) {
+        auto tree = FlattenProgram(program);
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+    };
+    ASSERT_THROWS(run("print y\n"s), std::runtime_error);
+    ASSERT_THROWS(run("x = 1\nprint x.y\n"s), std::runtime_error);
+    ASSERT_THROWS(run("x = 1\nx.y = 2\n"s), std::runtime_error);
+    ASSERT_THROWS(run("x = 1\nx.y()\n"s), std::runtime_error);
+    ASSERT_THROWS(run("print 1 / 0\n"s), std::runtime_error);
+    ASSERT_THROWS(run("print 1 + 'a'\n"s), std::runtime_error);
+    ASSERT_THROWS(run("class A:\n  def f():\n    return 1\na = A()\na.f(1)\n"s),
+                  std::runtime_error);
+    ASSERT(context.output.str().empty());
+}
+
+// Узел, неизвестный плоскому дереву
+struct CustomNode : runtime::Executable {
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context&) override {
+        closure["custom"s] = runtime::ObjectHolder::Own(runtime::Number(42));
+        return {};
+    }
+};
+
+void TestUnknownNodeFallback() {
+    auto tree = make_unique<ast::Compound>(make_unique<CustomNode>(),
+                                           ast::Print::Variable("custom"s));
+    auto program = Flatten(std::move(tree));
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "42\n"s);
+}
+
+}  // namespace
+
+void RunFlatAstTests(TestRunner& tr) {
+    RUN_TEST(tr, flat::TestPostOrderLayout);
+    RUN_TEST(tr, flat::TestChildrenPrecedeParents);
+    RUN_TEST(tr, flat::TestSameOutputAsPointerTree);
+    RUN_TEST(tr, flat::TestLoops);
+    RUN_TEST(tr, flat::TestLists);
+    RUN_TEST(tr, flat::TestDicts);
+    RUN_TEST(tr, flat::TestTailCalls);
+    RUN_TEST(tr, flat::TestRuntimeErrors);
+    RUN_TEST(tr, flat::TestUnknownNodeFallback);
+}
+
+}  // namespace flat
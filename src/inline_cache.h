@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+
+namespace runtime {
+
+class Class;
+class Shape;
+struct Method;
+
+// Счётчики попаданий и промахов встроенных кэшей одного вида
+struct InlineCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+};
+
+// Счётчики встроенных кэшей всех видов
+struct InlineCacheCounters {
+    InlineCacheStats method_calls;
+    InlineCacheStats field_loads;
+    InlineCacheStats field_stores;
+};
+
+// Счётчики, общие для всех точек вызова и обращения к полям
+inline InlineCacheCounters inline_cache_counters;
+
+// Выводит в os счётчики встроенных кэшей
+void PrintInlineCacheStats(std::ostream& os, const InlineCacheCounters& counters);
+
+// Полиморфный встроенный кэш точки вызова или обращения к полю.
+// Хранит результаты поиска для нескольких последних ключей (классов или форм объекта).
+// Пока в кэше один ключ, он мономорфен; при переполнении вытесняются самые старые записи
+template <typename Key, typename Value>
+class InlineCache {
+public:
+    static constexpr std::size_t CAPACITY = 4;
+
+    // Возвращает значение, сохранённое для key, либо nullptr и учитывает результат в stats
+    [[nodiscard]] const Value* Find(Key key, InlineCacheStats& stats) const {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (entries_[i].first == key) {
+                ++stats.hits;
+                return &entries_[i].second;
+            }
+        }
+        ++stats.misses;
+        return nullptr;
+    }
+
+    // Запоминает значение value для ключа key
+    const Value& Insert(Key key, Value value) {
+        auto& entry = size_ < CAPACITY ? entries_[size_++] : entries_[next_victim_++ % CAPACITY];
+        entry = {key, std::move(value)};
+        return entry.second;
+    }
+
+    // Возвращает количество запомненных ключей
+    [[nodiscard]] std::size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    std::array<std::pair<Key, Value>, CAPACITY> entries_ = {};
+    std::uint8_t size_ = 0;
+    std::uint8_t next_victim_ = 0;
+};
+
+// Кэш вызова метода: найденный метод для класса получателя
+using MethodCache = InlineCache<const Class*, const Method*>;
+
+// Кэш чтения поля: номер поля в форме объекта
+using FieldLoadCache = InlineCache<const Shape*, std::uint32_t>;
+
+// Запись кэша присваивания полю: номер поля и форма объекта после присваивания.
+// Если поле уже было, форма не меняется, иначе это форма, получаемая добавлением поля
+struct FieldStoreTarget {
+    const Shape* next_shape = nullptr;
+    std::uint32_t offset = 0;
+};
+
+// Кэш присваивания полю
+using FieldStoreCache = InlineCache<const Shape*, FieldStoreTarget>;
+
+}  // namespace runtime
@@ -1,7 +1,12 @@
 #include "lexer.h"
 
+#include "char_scan.h"
+
 #include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <utility>
 
 using namespace std;
 
@@ -10,7 +15,7 @@ namespace parse {
 bool operator==(const Token& lhs, const Token& rhs) {
     using namespace token_type;
 
-    if (lhs.index() != rhs.index()) {
+    if (lhs.GetKind() != rhs.GetKind()) {
         return false;
     }
     if (lhs.Is<Char>()) {
@@ -53,6 +58,9 @@ std::ostream& operator<<(std::ostream& os, const Token& rhs) {
     UNVALUED_OUTPUT(If);
     UNVALUED_OUTPUT(Else);
     UNVALUED_OUTPUT(Def);
+    UNVALUED_OUTPUT(While);
+    UNVALUED_OUTPUT(For);
+    UNVALUED_OUTPUT(In);
     UNVALUED_OUTPUT(Newline);
     UNVALUED_OUTPUT(Print);
     UNVALUED_OUTPUT(Indent);
@@ -74,177 +82,354 @@ std::ostream& operator<<(std::ostream& os, const Token& rhs) {
     return os << "Unknown token :("sv;
 }
 
-Lexer::Lexer(std::istream& input) {
-    ReadInput(input);
-    iter_ = tokens_.begin();
+// ----------- StringLiterals -----------------------
+
+StringLiterals::StringLiterals(StringLiterals&& other)
+    : literals_(std::move(other.literals_))
+    , blocks_(std::move(other.blocks_))
+    , pos_(std::exchange(other.pos_, nullptr))
+    , end_(std::exchange(other.end_, nullptr))
+    , appended_(std::move(other.appended_)) {
+}
+
+StringLiterals& StringLiterals::operator=(StringLiterals&& rhs) {
+    if (this != &rhs) {
+        literals_ = std::move(rhs.literals_);
+        blocks_ = std::move(rhs.blocks_);
+        pos_ = std::exchange(rhs.pos_, nullptr);
+        end_ = std::exchange(rhs.end_, nullptr);
+        appended_ = std::move(rhs.appended_);
+    }
+    return *this;
+}
+
+const token_type::String& StringLiterals::Add(std::string_view text) {
+    if (text.size() > static_cast<size_t>(end_ - pos_)) {
+        const size_t block_size = std::max(text.size(), BLOCK_SIZE);
+        blocks_.emplace_back(new char[block_size]);
+        pos_ = blocks_.back().get();
+        end_ = pos_ + block_size;
+    }
+    if (!text.empty()) {
+        std::memcpy(pos_, text.data(), text.size());
+    }
+    const std::string_view copy(pos_, text.size());
+    pos_ += text.size();
+    literals_.push_back(token_type::String{copy});
+    return literals_.back();
+}
+
+void StringLiterals::Append(StringLiterals&& other) {
+    appended_.push_back(std::move(other));
+}
+
+namespace {
+
+bool IsDigit(char c) {
+    return std::isdigit(static_cast<unsigned char>(c));
+}
+
+bool IsIdChar(char c) {
+    return c == '_' || std::isalnum(static_cast<unsigned char>(c));
+}
+
+// ----------- Таблица ключевых слов -----------------------
+
+struct KeywordEntry {
+    std::string_view word;  // пустая строка обозначает свободную ячейку
+    Keyword keyword = Keyword::CLASS;
+};
+
+constexpr KeywordEntry KEYWORDS[] = {
+    {"class"sv, Keyword::CLASS}, {"return"sv, Keyword::RETURN}, {"if"sv, Keyword::IF},
+    {"else"sv, Keyword::ELSE},   {"def"sv, Keyword::DEF},       {"print"sv, Keyword::PRINT},
+    {"and"sv, Keyword::AND},     {"or"sv, Keyword::OR},         {"not"sv, Keyword::NOT},
+    {"None"sv, Keyword::NONE},   {"True"sv, Keyword::TRUE},     {"False"sv, Keyword::FALSE},
+    {"while"sv, Keyword::WHILE}, {"for"sv, Keyword::FOR},       {"in"sv, Keyword::IN},
+};
+
+constexpr size_t KEYWORD_TABLE_SIZE = 64;
+
+// Хеш-функция, не дающая коллизий на ключевых словах. Слово не должно быть пустым
+constexpr size_t KeywordHash(std::string_view word) {
+    return (2 * word.size() + static_cast<unsigned char>(word.front())
+            + static_cast<unsigned char>(word.back())) % KEYWORD_TABLE_SIZE;
+}
+
+struct KeywordTable {
+    KeywordEntry entries[KEYWORD_TABLE_SIZE] = {};
+    size_t min_length = std::string_view::npos;
+    size_t max_length = 0;
+};
+
+// Строит таблицу при компиляции. Если хеш-функция перестанет быть совершенной
+// (например, после добавления ключевого слова), сработает static_assert ниже
+constexpr KeywordTable MakeKeywordTable() {
+    KeywordTable table;
+    for (const KeywordEntry& entry : KEYWORDS) {
+        table.entries[KeywordHash(entry.word)] = entry;
+        table.min_length = std::min(table.min_length, entry.word.size());
+        table.max_length = std::max(table.max_length, entry.word.size());
+    }
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = MakeKeywordTable();
+
+constexpr bool IsKeywordHashPerfect() {
+    for (const KeywordEntry& entry : KEYWORDS) {
+        if (KEYWORD_TABLE.entries[KeywordHash(entry.word)].word != entry.word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(IsKeywordHashPerfect(), "KeywordHash has collisions on keywords");
+
+}  // namespace
+
+std::optional<Keyword> FindKeyword(std::string_view word) {
+    if (word.size() < KEYWORD_TABLE.min_length || word.size() > KEYWORD_TABLE.max_length) {
+        return std::nullopt;
+    }
+    const KeywordEntry& entry = KEYWORD_TABLE.entries[KeywordHash(word)];
+    if (entry.word != word) {
+        return std::nullopt;
+    }
+    return entry.keyword;
+}
+
+Lexer::Lexer(std::istream& input, size_t chunk_size)
+    : input_(&input)
+    , chunk_size_(std::max<size_t>(chunk_size, 1))
+    {
+        NextToken();
+    }
+
+Lexer::Lexer(std::string_view source)
+    : pos_(source.data())
+    , end_(source.data() + source.size())
+    , base_(source.data())
+    {
+        NextToken();
+    }
+
+Lexer::Lexer(TokenList tokens)
+    : pending_(std::move(tokens.tokens))
+    , string_literals_(std::move(tokens.literals))
+    {
+        NextToken();
+    }
+
+StringLiterals Lexer::TakeStringLiterals() {
+    return std::exchange(string_literals_, {});
 }
 
 const Token& Lexer::CurrentToken() const {
-    return *iter_;
+    return current_;
 }
 
-Token Lexer::NextToken() {
-    if (next(iter_) != tokens_.end()) {
-        ++iter_;
+const Token& Lexer::NextToken() {
+    if (current_.Is<token_type::Eof>()) {
+        return current_;
+    }
+    if (pending_pos_ == pending_.size()) {
+        pending_.clear();
+        pending_pos_ = 0;
+        ReadTokens();
     }
-    return *iter_;
+    current_ = pending_[pending_pos_++];
+    return current_;
 }
 
-void Lexer::ReadInput(std::istream& input) {
+bool Lexer::HasChar(size_t n) {
+    return static_cast<size_t>(end_ - pos_) > n || Refill(n + 1);
+}
+
+bool Lexer::Refill(size_t min_size) {
+    if (!input_) {
+        return false;
+    }
+    size_t size = end_ - pos_;
+    base_offset_ = GetOffset();
+    if (size > 0 && pos_ != buffer_.data()) {
+        std::memmove(buffer_.data(), pos_, size);
+    }
+    while (size < min_size && *input_) {
+        if (buffer_.size() < size + chunk_size_) {
+            buffer_.resize(size + chunk_size_);
+        }
+        input_->read(buffer_.data() + size, static_cast<std::streamsize>(chunk_size_));
+        size += static_cast<size_t>(input_->gcount());
+    }
+    pos_ = buffer_.data();
+    end_ = pos_ + size;
+    base_ = pos_;
+    return size >= min_size;
+}
+
+void Lexer::ReadTokens() {
     using namespace std::literals;
 
-    bool is_stream_begin = true;
-    bool is_line_begin = true;
-    int indent_count = 0;
-    char c;
-    while (input) {
-        c = input.get();
-        if (!input.good()) {
-            break;
+    while (pending_.empty()) {
+        if (!HasChar(0)) {
+            Finish();
+            return;
         }
-        if (is_stream_begin) {
-            is_stream_begin = false;
+        token_begin_ = GetOffset();
+        const char c = *pos_;
+        if (is_stream_begin_) {
+            is_stream_begin_ = false;
             if (c == ' ') {
                 throw LexerError("Space in the begining of istream"s);
             }
         }
-        if (is_line_begin) {
+        if (is_line_begin_) {
             if (c == '\n') {
+                ++pos_;
                 continue;
             }
             if (c == '#') {
-                SkipComment(input);
+                SkipComment();
                 continue;
             }
             if (c == ' ') {
-                input.putback(c);
-                int space_count = IsNonemptyLine(input);
+                int space_count = IsNonemptyLine();
                 if (!space_count) {
                     continue;
                 } else {
-                    if (tokens_.empty()) {
+                    if (!has_tokens_) {
                         throw LexerError("Trying to indent before any token appears"s);
                     }
-                    is_line_begin = false;
+                    is_line_begin_ = false;
                     // проверка на наличие значимых токенов, что токены не пустые
-                    AdjustIndentCount(indent_count, space_count);
+                    AdjustIndentCount(indent_count_, space_count);
                     continue;
                 }
             } else {
-                input.putback(c);
-                is_line_begin = false;
-                AdjustIndentCount(indent_count, 0);
+                is_line_begin_ = false;
+                AdjustIndentCount(indent_count_, 0);
                 continue;
             }
 
         }
-        if (std::isdigit(c)) {
-            input.putback(c);
-            LoadNumber(input);
+        if (IsDigit(c)) {
+            LoadNumber();
             continue;
         }
         if (c == '\'' || c == '\"') {
-            input.putback(c);
-            LoadString(input);
+            LoadString();
             continue;
         }
-        if (c == '_' || std::isalpha(c)) {
-            input.putback(c);
-            LoadKeyWordOrId(input);
+        if (c == '_' || std::isalpha(static_cast<unsigned char>(c))) {
+            LoadKeyWordOrId();
             continue;
         }
+        ++pos_;
         if(operations_.find(c) != std::string::npos) {
-            tokens_.emplace_back(token_type::Char{c});
+            Emit(token_type::Char{c});
             continue;
         }
+        // Возвращает true и пропускает символ '=', если он следует за текущим символом
+        const auto skip_eq = [this] {
+            if (HasChar(0) && *pos_ == '=') {
+                ++pos_;
+                return true;
+            }
+            return false;
+        };
         switch(c) {
             case '=' :
-                if (input.peek() == '=') {
-                    input.get(c);
-                    tokens_.emplace_back(token_type::Eq{});
+                if (skip_eq()) {
+                    Emit(token_type::Eq{});
                 } else {
-                    tokens_.emplace_back(token_type::Char{c});
+                    Emit(token_type::Char{c});
                 }
                 continue;
             case '!' :
-                if (input.peek() == '=') {
-                    input.get(c);
-                    tokens_.emplace_back(token_type::NotEq{});
+                if (skip_eq()) {
+                    Emit(token_type::NotEq{});
                 }
                 continue;
             case '<' :
-                if (input.peek() == '=') {
-                    input.get(c);
-                    tokens_.emplace_back(token_type::LessOrEq{});
+                if (skip_eq()) {
+                    Emit(token_type::LessOrEq{});
                 } else {
-                    tokens_.emplace_back(token_type::Char{c});
+                    Emit(token_type::Char{c});
                 }
                 continue;
             case '>' :
-                if (input.peek() == '=') {
-                    input.get(c);
-                    tokens_.emplace_back(token_type::GreaterOrEq{});
+                if (skip_eq()) {
+                    Emit(token_type::GreaterOrEq{});
                 } else {
-                    tokens_.emplace_back(token_type::Char{c});
+                    Emit(token_type::Char{c});
                 }
                 continue;
 
             case '#' :
-                SkipComment(input);
-                if (input.good()) {
-                    input.putback('\n');
-                }
+                SkipComment();
                 continue;
             case '\n' :
-                tokens_.emplace_back(token_type::Newline{});
-                is_line_begin = true;
+                Emit(token_type::Newline{});
+                is_line_begin_ = true;
                 continue;
             case ' ' :
                 continue;
 
 
             default:
-                tokens_.emplace_back(token_type::Char{c});
+                Emit(token_type::Char{c});
         }
-
     }
+}
 
-    if (!tokens_.empty() && !tokens_.back().Is<token_type::Newline>()) {
-        tokens_.emplace_back(token_type::Newline{});
+void Lexer::Finish() {
+    token_begin_ = GetOffset();
+    if (has_tokens_ && !last_is_newline_) {
+        Emit(token_type::Newline{});
     }
-    if (indent_count > 0) {
-        while (indent_count) {
-            --indent_count;
-            tokens_.emplace_back(token_type::Dedent{});
-        }
+    while (indent_count_ > 0) {
+        --indent_count_;
+        Emit(token_type::Dedent{});
     }
-    tokens_.emplace_back(token_type::Eof{});
+    Emit(token_type::Eof{});
+}
+
+size_t Lexer::GetOffset() const {
+    return base_offset_ + (pos_ - base_);
 }
 
-int Lexer::IsNonemptyLine(std::istream& input) {
-    char c;
+void Lexer::Emit(Token token) {
+    has_tokens_ = true;
+    last_is_newline_ = token.Is<token_type::Newline>();
+    token.SetPosition(token_begin_, GetOffset() - token_begin_);
+    pending_.push_back(token);
+}
+
+int Lexer::IsNonemptyLine() {
     int space_count = 0;
-    while (input) {
-        c = input.get();
-        if (c != ' ') {
+    while (HasChar(0)) {
+        const char* non_space = scan::SkipSpaces(pos_, end_);
+        space_count += static_cast<int>(non_space - pos_);
+        pos_ = non_space;
+        if (pos_ != end_) {
             break;
         }
-        ++space_count;
     }
-    if (!input) {
+    if (!HasChar(0)) {
         return 0;
     }
-    switch(c) {
+    switch(*pos_) {
         case '\n' :
+            ++pos_;
             return 0;
         case '#' :
-            SkipComment(input);
+            SkipComment();
             return 0;
         default:
-            input.putback(c);
+            return space_count;
     }
-
-    return space_count;
 }
 
 void Lexer::AdjustIndentCount(int& indent_count, int space_count) {
@@ -257,11 +442,11 @@ void Lexer::AdjustIndentCount(int& indent_count, int space_count) {
             throw LexerError("Trying to make more indent than needs"s);
         } else if (diff == 1) {
             ++indent_count;
-            tokens_.emplace_back(token_type::Indent{});
+            Emit(token_type::Indent{});
         } else if (diff < 0) { // diff == 0 намеренно пропущен, т.к. в этом случае ничего делать не нужно
             while (diff) {
                 --indent_count;
-                tokens_.emplace_back(token_type::Dedent{});
+                Emit(token_type::Dedent{});
                 ++diff;
             }
             if (indent_count < 0) {
@@ -271,165 +456,154 @@ void Lexer::AdjustIndentCount(int& indent_count, int space_count) {
     }
 }
 
-void Lexer::LoadNumber(std::istream& input) {
+void Lexer::LoadNumber() {
     using namespace std::literals;
-    std::string parsed_num;
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw LexerError("Failed to read number from stream"s);
+    // После 0 не могут идти другие цифры
+    size_t length = 1;
+    if (*pos_ != '0') {
+        while (HasChar(length) && IsDigit(pos_[length])) {
+            ++length;
         }
-    };
-
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw LexerError("A digit is expected"s);
-        }
-        while (std::isdigit(input.peek())) {
-            read_char();
-        }
-    };
-
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 не могут идти другие цифры
-    } else {
-        read_digits();
     }
 
-    try {
-        tokens_.emplace_back(token_type::Number{std::stoi(parsed_num)});
-    } catch (...) {
-        throw LexerError("Unknown error while stoi(parsed_num)");
+    int value = 0;
+    const auto result = std::from_chars(pos_, pos_ + length, value);
+    if (result.ec != std::errc()) {
+        throw LexerError("Number is out of range: "s + std::string(pos_, length));
     }
+    pos_ += length;
+    Emit(token_type::Number{value});
 }
 
-void Lexer::LoadString(std::istream& input) {
+void Lexer::LoadString() {
     using namespace std::literals;
-    char quote;
-    input >> quote;
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
+    const char quote = *pos_;
+    std::string& s = literal_;
+    s.clear();
+    bool has_escapes = false;
+    size_t length = 1;
     while (true) {
-        if (it == end) {
-            throw LexerError("Eof after opened double quote"s);
+        // Участок без экранирования добавляется в строку целиком. Он может продолжаться
+        // за концом буфера, поэтому после дочитывания поиск продолжается
+        const char* run_end = scan::FindQuoteOrBackslash(pos_ + length, end_, quote);
+        s.append(pos_ + length, run_end);
+        length = run_end - pos_;
+        if (run_end == end_) {
+            if (!HasChar(length)) {
+                throw LexerError("Eof after opened double quote"s);
+            }
+            continue;
         }
-        const char ch = *it;
-        if (ch == quote) {
-            ++it;
+        if (pos_[length] == quote) {
+            ++length;
             break;
-        } else if (ch == '\\') {
-            ++it;
-            if (it == end) {
-                throw LexerError("Eof after opened double quote");
-            }
-            const char escaped_char = *(it);
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\'':
-                    s.push_back('\'');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    throw LexerError("Unrecognized escape sequence \\"s + escaped_char);
-            }
-        } else {
-            s.push_back(ch);
         }
-        ++it;
-    }
-    tokens_.emplace_back(token_type::String{s});
-}
-
-void Lexer::LoadKeyWordOrId(std::istream& input) {
-    using namespace std::literals;
-    std::string s;
-    {
-        char c;
-        while(input) {
-            c = input.get();
-            if (!input.good()) {
+        if (!HasChar(length + 1)) {
+            throw LexerError("Eof after opened double quote");
+        }
+        const char escaped_char = pos_[length + 1];
+        has_escapes = true;
+        switch (escaped_char) {
+            case 'n':
+                s.push_back('\n');
                 break;
-            }
-            if (c == ' ' || c == '\n' || c == '#') {
-                input.putback(c);
+            case 't':
+                s.push_back('\t');
                 break;
-            }
-            if (!std::isalpha(c) && !std::isdigit(c) && c != '_') {
-                input.putback(c);
+            case 'r':
+                s.push_back('\r');
                 break;
-            }
-            s.push_back(c);
+            case '"':
+                s.push_back('"');
+                break;
+            case '\'':
+                s.push_back('\'');
+                break;
+            case '\\':
+                s.push_back('\\');
+                break;
+            default:
+                throw LexerError("Unrecognized escape sequence \\"s + escaped_char);
         }
+        length += 2;
+    }
+    const char* text = pos_ + 1;
+    pos_ += length;
+    // Текст, записанный в исходном тексте без изменений, не копируется. Буфер потока
+    // перезаписывается при дочитывании, поэтому константы из потока копируются всегда
+    if (!input_ && !has_escapes && length <= Token::MAX_LENGTH) {
+        Emit(Token::MakeSourceString(text));
+    } else {
+        Emit(string_literals_.Add(s));
     }
+}
+
+void Lexer::LoadKeyWordOrId() {
+    size_t length = 1;
+    while (HasChar(length) && IsIdChar(pos_[length])) {
+        ++length;
+    }
+    const std::string_view word(pos_, length);
+    pos_ += length;
 
-    if (const auto iter = std::find(key_words_.begin(), key_words_.end(), s); iter != key_words_.end()) {
-        switch(static_cast<KeyWords>(std::distance(key_words_.begin(), iter))) {
-            case KeyWords::CLASS :
-                tokens_.emplace_back(token_type::Class{});
+    if (const std::optional<Keyword> keyword = FindKeyword(word)) {
+        switch(*keyword) {
+            case Keyword::CLASS :
+                Emit(token_type::Class{});
+                break;
+            case Keyword::RETURN :
+                Emit(token_type::Return{});
+                break;
+            case Keyword::IF :
+                Emit(token_type::If{});
+                break;
+            case Keyword::ELSE :
+                Emit(token_type::Else{});
                 break;
-            case KeyWords::RETURN :
-                tokens_.emplace_back(token_type::Return{});
+            case Keyword::DEF :
+                Emit(token_type::Def{});
                 break;
-            case KeyWords::IF :
-                tokens_.emplace_back(token_type::If{});
+            case Keyword::PRINT :
+                Emit(token_type::Print{});
                 break;
-            case KeyWords::ELSE :
-                tokens_.emplace_back(token_type::Else{});
+            case Keyword::AND :
+                Emit(token_type::And{});
                 break;
-            case KeyWords::DEF :
-                tokens_.emplace_back(token_type::Def{});
+            case Keyword::OR :
+                Emit(token_type::Or{});
                 break;
-            case KeyWords::PRINT :
-                tokens_.emplace_back(token_type::Print{});
+            case Keyword::NOT :
+                Emit(token_type::Not{});
                 break;
-            case KeyWords::AND :
-                tokens_.emplace_back(token_type::And{});
+            case Keyword::NONE :
+                Emit(token_type::None{});
                 break;
-            case KeyWords::OR :
-                tokens_.emplace_back(token_type::Or{});
+            case Keyword::TRUE :
+                Emit(token_type::True{});
                 break;
-            case KeyWords::NOT :
-                tokens_.emplace_back(token_type::Not{});
+            case Keyword::FALSE :
+                Emit(token_type::False{});
                 break;
-            case KeyWords::NONE :
-                tokens_.emplace_back(token_type::None{});
+            case Keyword::WHILE :
+                Emit(token_type::While{});
                 break;
-            case KeyWords::TRUE :
-                tokens_.emplace_back(token_type::True{});
+            case Keyword::FOR :
+                Emit(token_type::For{});
                 break;
-            case KeyWords::FALSE :
-                tokens_.emplace_back(token_type::False{});
+            case Keyword::IN :
+                Emit(token_type::In{});
                 break;
         }
     } else {
-        tokens_.emplace_back(token_type::Id{s});
+        Emit(token_type::Id{runtime::Symbol(word)});
     }
 }
 
-void Lexer::SkipComment(std::istream& input) {
-    char c;
-    while (input) {
-        c = input.get();
-        if (c == '\n') {
+void Lexer::SkipComment() {
+    while (HasChar(0)) {
+        pos_ = scan::FindNewline(pos_, end_);
+        if (pos_ != end_) {
             break;
         }
     }
@@ -1,168 +1,436 @@
 #pragma once
 
+#include "symbol.h"
+
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <deque>
 #include <iosfwd>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 namespace parse {
 
+class LexerError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Вид токена. Каждой лексеме из token_type соответствует свой вид
+enum class TokenKind : std::uint8_t {
+    NUMBER,
+    ID,
+    CHAR,
+    STRING,
+    CLASS,
+    RETURN,
+    IF,
+    ELSE,
+    DEF,
+    WHILE,
+    FOR,
+    IN,
+    NEWLINE,
+    PRINT,
+    INDENT,
+    DEDENT,
+    AND,
+    OR,
+    NOT,
+    EQ,
+    NOT_EQ,
+    LESS_OR_EQ,
+    GREATER_OR_EQ,
+    NONE,
+    TRUE,
+    FALSE,
+    END_OF_FILE
+};
+
 namespace token_type {
 struct Number {  // Лексема «число»
+    static constexpr TokenKind KIND = TokenKind::NUMBER;
     int value;   // число
 };
 
-struct Id {             // Лексема «идентификатор»
-    std::string value;  // Имя идентификатора
+struct Id {                 // Лексема «идентификатор»
+    static constexpr TokenKind KIND = TokenKind::ID;
+    runtime::Symbol value;  // Интернированное имя идентификатора
 };
 
 struct Char {    // Лексема «символ»
+    static constexpr TokenKind KIND = TokenKind::CHAR;
     char value;  // код символа
 };
 
 struct String {  // Лексема «строковая константа»
-    std::string value;
+    static constexpr TokenKind KIND = TokenKind::STRING;
+    std::string_view value;  // Текст константы после замены escape-последовательностей
 };
 
-struct Class {};    // Лексема «class»
-struct Return {};   // Лексема «return»
-struct If {};       // Лексема «if»
-struct Else {};     // Лексема «else»
-struct Def {};      // Лексема «def»
-struct Newline {};  // Лексема «конец строки»
-struct Print {};    // Лексема «print»
-struct Indent {};  // Лексема «увеличение отступа», соответствует двум пробелам
-struct Dedent {};  // Лексема «уменьшение отступа»
-struct Eof {};     // Лексема «конец файла»
-struct And {};     // Лексема «and»
-struct Or {};      // Лексема «or»
-struct Not {};     // Лексема «not»
-struct Eq {};      // Лексема «==»
-struct NotEq {};   // Лексема «!=»
-struct LessOrEq {};     // Лексема «<=»
-struct GreaterOrEq {};  // Лексема «>=»
-struct None {};         // Лексема «None»
-struct True {};         // Лексема «True»
-struct False {};        // Лексема «False»
+#define UNVALUED_TOKEN(type, kind) \
+    struct type {                  \
+        static constexpr TokenKind KIND = TokenKind::kind; \
+    }
+
+UNVALUED_TOKEN(Class, CLASS);          // Лексема «class»
+UNVALUED_TOKEN(Return, RETURN);        // Лексема «return»
+UNVALUED_TOKEN(If, IF);                // Лексема «if»
+UNVALUED_TOKEN(Else, ELSE);            // Лексема «else»
+UNVALUED_TOKEN(Def, DEF);              // Лексема «def»
+UNVALUED_TOKEN(While, WHILE);          // Лексема «while»
+UNVALUED_TOKEN(For, FOR);              // Лексема «for»
+UNVALUED_TOKEN(In, IN);                // Лексема «in»
+UNVALUED_TOKEN(Newline, NEWLINE);      // Лексема «конец строки»
+UNVALUED_TOKEN(Print, PRINT);          // Лексема «print»
+UNVALUED_TOKEN(Indent, INDENT);        // Лексема «увеличение отступа», соответствует двум пробелам
+UNVALUED_TOKEN(Dedent, DEDENT);        // Лексема «уменьшение отступа»
+UNVALUED_TOKEN(Eof, END_OF_FILE);      // Лексема «конец файла»
+UNVALUED_TOKEN(And, AND);              // Лексема «and»
+UNVALUED_TOKEN(Or, OR);                // Лексема «or»
+UNVALUED_TOKEN(Not, NOT);              // Лексема «not»
+UNVALUED_TOKEN(Eq, EQ);                // Лексема «==»
+UNVALUED_TOKEN(NotEq, NOT_EQ);         // Лексема «!=»
+UNVALUED_TOKEN(LessOrEq, LESS_OR_EQ);  // Лексема «<=»
+UNVALUED_TOKEN(GreaterOrEq, GREATER_OR_EQ);  // Лексема «>=»
+UNVALUED_TOKEN(None, NONE);            // Лексема «None»
+UNVALUED_TOKEN(True, TRUE);            // Лексема «True»
+UNVALUED_TOKEN(False, FALSE);          // Лексема «False»
+
+#undef UNVALUED_TOKEN
 
 }  // namespace token_type
 
-using TokenBase
-    = std::variant<token_type::Number, token_type::Id, token_type::Char, token_type::String,
-                   token_type::Class, token_type::Return, token_type::If, token_type::Else,
-                   token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
-                   token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
-                   token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-                   token_type::None, token_type::True, token_type::False, token_type::Eof>;
+// Токен - вид лексемы, её значение и положение в исходном тексте.
+// Занимает 16 байт и тривиально копируется: идентификаторы хранятся в таблице символов,
+// а текст строковой константы - в исходном тексте или в хранилище лексера (StringLiterals),
+// и токен содержит только ссылку на него
+class Token {
+public:
+    // Наибольшая длина, которую хранит токен. Длина более длинных лексем ограничивается ею
+    static constexpr size_t MAX_LENGTH = (1U << 24) - 1;
+
+    // Создаёт токен token_type::Number{0}
+    Token()
+        : length_(0)
+        , kind_(static_cast<std::uint32_t>(TokenKind::NUMBER))
+        , has_source_text_(0) {
+    }
+
+    // Создаёт токен лексемы value без сведений о положении в тексте.
+    // Токен строковой константы ссылается на value.value, поэтому value должен существовать,
+    // пока используется токен
+    template <typename T, typename = decltype(T::KIND)>
+    Token(const T& value)  // NOLINT(google-explicit-constructor)
+        : length_(0)
+        , kind_(static_cast<std::uint32_t>(T::KIND))
+        , has_source_text_(0) {
+        if constexpr (std::is_same_v<T, token_type::Number>) {
+            payload_.number = value.value;
+        } else if constexpr (std::is_same_v<T, token_type::Char>) {
+            payload_.character = value.value;
+        } else if constexpr (std::is_same_v<T, token_type::Id>) {
+            payload_.symbol = value.value;
+        } else if constexpr (std::is_same_v<T, token_type::String>) {
+            payload_.text = &value.value;
+        }
+    }
 
-struct Token : TokenBase {
-    using TokenBase::TokenBase;
+    [[nodiscard]] TokenKind GetKind() const {
+        return static_cast<TokenKind>(kind_);
+    }
 
     template <typename T>
     [[nodiscard]] bool Is() const {
-        return std::holds_alternative<T>(*this);
+        return GetKind() == T::KIND;
     }
 
+    // Возвращает лексему токена. Если токен имеет другой тип, выбрасывает LexerError
     template <typename T>
-    [[nodiscard]] const T& As() const {
-        return std::get<T>(*this);
+    [[nodiscard]] T As() const {
+        using namespace std::literals;
+        if (!Is<T>()) {
+            throw LexerError("Token has another type"s);
+        }
+        return Get<T>();
+    }
+
+    // Возвращает лексему токена либо nullopt, если токен имеет другой тип
+    template <typename T>
+    [[nodiscard]] std::optional<T> TryAs() const {
+        if (!Is<T>()) {
+            return std::nullopt;
+        }
+        return Get<T>();
+    }
+
+    // Возвращает смещение начала лексемы от начала текста
+    [[nodiscard]] size_t GetOffset() const {
+        return offset_;
+    }
+
+    // Возвращает длину лексемы в исходном тексте. Для токенов, не записанных в тексте явно
+    // (Dedent, Eof и завершающий Newline), длина равна 0
+    [[nodiscard]] size_t GetLength() const {
+        return length_;
+    }
+
+    // Запоминает положение лексемы в исходном тексте
+    void SetPosition(size_t offset, size_t length) {
+        offset_ = static_cast<std::uint32_t>(std::min<size_t>(offset, UINT32_MAX));
+        length_ = static_cast<std::uint32_t>(std::min(length, MAX_LENGTH));
+    }
+
+private:
+    friend class Lexer;
+
+    // Создаёт токен строковой константы без escape-последовательностей, текст которой
+    // начинается с символа text исходного текста. Длина текста на 2 символа (кавычки) меньше
+    // длины лексемы, поэтому токен должен получить положение в тексте (SetPosition)
+    static Token MakeSourceString(const char* text) {
+        Token token(token_type::String{});
+        token.has_source_text_ = 1;
+        token.payload_.source_text = text;
+        return token;
     }
 
     template <typename T>
-    [[nodiscard]] const T* TryAs() const {
-        return std::get_if<T>(this);
+    T Get() const {
+        if constexpr (std::is_same_v<T, token_type::Number>) {
+            return T{payload_.number};
+        } else if constexpr (std::is_same_v<T, token_type::Char>) {
+            return T{payload_.character};
+        } else if constexpr (std::is_same_v<T, token_type::Id>) {
+            return T{payload_.symbol};
+        } else if constexpr (std::is_same_v<T, token_type::String>) {
+            if (has_source_text_) {
+                return T{std::string_view(payload_.source_text, length_ - 2)};
+            }
+            return T{*payload_.text};
+        } else {
+            return T{};
+        }
     }
+
+    // Значение лексемы. Активный член определяется видом токена и has_source_text_
+    union Payload {
+        Payload()
+            : number(0) {
+        }
+
+        int number;
+        char character;
+        runtime::Symbol symbol;
+        // Текст строковой константы в исходном тексте
+        const char* source_text;
+        // Текст строковой константы вне исходного текста
+        const std::string_view* text;
+    };
+
+    std::uint32_t offset_ = 0;
+    std::uint32_t length_ : 24;
+    std::uint32_t kind_ : 7;
+    std::uint32_t has_source_text_ : 1;
+    Payload payload_;
 };
 
+static_assert(sizeof(Token) == 16);
+static_assert(std::is_trivially_copyable_v<Token>);
+
 bool operator==(const Token& lhs, const Token& rhs);
 bool operator!=(const Token& lhs, const Token& rhs);
 
 std::ostream& operator<<(std::ostream& os, const Token& rhs);
 
-class LexerError : public std::runtime_error {
+// Тексты строковых констант, которые нельзя взять из исходного текста: константы
+// с escape-последовательностями и константы, прочитанные из потока. Хранилище принадлежит
+// лексеру и освобождается вместе с ним. Записи не перемещаются ни при добавлении новых,
+// ни при перемещении хранилища, поэтому токены, ссылающиеся на них, остаются действительными
+class StringLiterals {
 public:
-    using std::runtime_error::runtime_error;
+    StringLiterals() = default;
+    StringLiterals(const StringLiterals&) = delete;
+    StringLiterals(StringLiterals&& other);
+    StringLiterals& operator=(const StringLiterals&) = delete;
+    StringLiterals& operator=(StringLiterals&& rhs);
+
+    // Копирует text в хранилище и возвращает лексему с копией
+    const token_type::String& Add(std::string_view text);
+
+    // Переносит в хранилище записи other
+    void Append(StringLiterals&& other);
+
+private:
+    static constexpr size_t BLOCK_SIZE = 4 * 1024;
+
+    std::deque<token_type::String> literals_;
+    // Символы текстов лежат подряд в блоках. Текст, не помещающийся в блок, получает свой блок
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* pos_ = nullptr;
+    char* end_ = nullptr;
+    std::vector<StringLiterals> appended_;
+};
+
+// Заранее прочитанные токены и тексты их строковых констант
+struct TokenList {
+    std::vector<Token> tokens;
+    StringLiterals literals;
 };
 
+// Ключевые слова языка
+enum class Keyword : std::uint8_t {
+    CLASS,
+    RETURN,
+    IF,
+    ELSE,
+    DEF,
+    PRINT,
+    AND,
+    OR,
+    NOT,
+    NONE,
+    TRUE,
+    FALSE,
+    WHILE,
+    FOR,
+    IN
+};
+
+// Возвращает ключевое слово, записанное как word, либо nullopt, если word - не ключевое слово.
+// Выполняется за постоянное время: одно обращение к совершенной хеш-таблице и одно сравнение
+[[nodiscard]] std::optional<Keyword> FindKeyword(std::string_view word);
+
+// Лексический анализатор. Читает токены по мере того, как их запрашивает парсер.
+// Текст разбирается непосредственно в непрерывном буфере: идентификаторы интернируются
+// и числа разбираются прямо из него, без промежуточных строк. Токены строковых констант
+// действительны, пока существует лексер (и текст source, из которого он читает)
 class Lexer {
 public:
-    explicit Lexer(std::istream& input);
+    // Размер блока, которым дочитывается поток
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    // Читает текст из потока input блоками по chunk_size символов.
+    // Объём занимаемой памяти не зависит от длины входных данных
+    explicit Lexer(std::istream& input, size_t chunk_size = DEFAULT_CHUNK_SIZE);
 
-    // Возвращает ссылку на текущий токен или token_type::Eof, если поток токенов закончился
+    // Читает текст source, находящийся в памяти (например, отображённый в память файл).
+    // source должен существовать, пока существует лексер
+    explicit Lexer(std::string_view source);
+
+    // Выдаёт заранее прочитанные токены tokens (например, результат LexParallel).
+    // Последним токеном должен быть token_type::Eof
+    explicit Lexer(TokenList tokens);
+
+    // Возвращает ссылку на текущий токен или token_type::Eof, если поток токенов закончился.
+    // Ссылка указывает на текущий токен и после вызова NextToken
     [[nodiscard]] const Token& CurrentToken() const;
 
-    // Возвращает следующий токен, либо token_type::Eof, если поток токенов закончился
-    Token NextToken();
+    // Читает следующий токен и возвращает ссылку на него,
+    // либо token_type::Eof, если поток токенов закончился
+    const Token& NextToken();
 
-    // Если текущий токен имеет тип T, метод возвращает ссылку на него.
+    // Если текущий токен имеет тип T, метод возвращает его лексему.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& Expect() const;
+    T Expect() const;
 
     // Метод проверяет, что текущий токен имеет тип T, а сам токен содержит значение value.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T, typename U>
     void Expect(const U& value) const;
 
-    // Если следующий токен имеет тип T, метод возвращает ссылку на него.
+    // Если следующий токен имеет тип T, метод возвращает его лексему.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& ExpectNext();
+    T ExpectNext();
 
     // Метод проверяет, что следующий токен имеет тип T, а сам токен содержит значение value.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T, typename U>
     void ExpectNext(const U& value);
 
+    // Передаёт вызывающему хранилище текстов строковых констант прочитанных токенов.
+    // Токены, прочитанные после этого, ссылаются на новое хранилище
+    StringLiterals TakeStringLiterals();
+
 private:
-    std::deque<Token> tokens_;
-    std::deque<Token>::iterator iter_;
+    // Поток, из которого дочитывается buffer_, либо nullptr, если весь текст уже в памяти
+    std::istream* input_ = nullptr;
+    size_t chunk_size_ = DEFAULT_CHUNK_SIZE;
+    std::vector<char> buffer_;
+    // Ещё не прочитанная часть текста
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+    // Символ base_ находится на расстоянии base_offset_ от начала текста
+    const char* base_ = nullptr;
+    size_t base_offset_ = 0;
+    // Смещение начала читаемой лексемы
+    size_t token_begin_ = 0;
+
+    Token current_;
+    // Токены, прочитанные из потока, но ещё не ставшие текущими: pending_[pending_pos_..].
+    // За одно чтение появляется не больше одного токена и следующих за ним Newline и Dedent.
+    // Вектор очищается, когда все его токены прочитаны, поэтому память выделяется однажды
+    std::vector<Token> pending_;
+    size_t pending_pos_ = 0;
+
+    // Состояние чтения потока
+    bool is_stream_begin_ = true;
+    bool is_line_begin_ = true;
+    bool has_tokens_ = false;
+    bool last_is_newline_ = false;
+    int indent_count_ = 0;
+    // Текст читаемой строковой константы. Память под него переиспользуется
+    std::string literal_;
+    StringLiterals string_literals_;
 
 private:
     const std::string operations_{"+-*/"};
-    enum class KeyWords {
-        CLASS,
-        RETURN,
-        IF,
-        ELSE,
-        DEF,
-        PRINT,
-        AND,
-        OR,
-        NOT,
-        NONE,
-        TRUE,
-        FALSE
-    };
-    const std::vector<std::string> key_words_{
-        "class", "return", "if", "else",
-        "def", "print", "and", "or", "not",
-        "None", "True", "False"};
 
 private:
-    void ReadInput(std::istream& input);
+    // Возвращает true, если доступен символ pos_[n], при необходимости дочитывая поток
+    bool HasChar(size_t n);
+
+    // Дочитывает поток, пока в буфере не окажется хотя бы min_size непрочитанных символов.
+    // Непрочитанный текст может переместиться в памяти, поэтому позиции внутри токена
+    // следует хранить относительно pos_. Возвращает false, если поток закончился раньше
+    bool Refill(size_t min_size);
+
+    // Читает символы, пока в pending_ не появится хотя бы один токен
+    void ReadTokens();
+
+    // Завершает поток токенов: добавляет Newline, закрывающие Dedent и Eof
+    void Finish();
+
+    // Возвращает смещение символа *pos_ от начала текста
+    [[nodiscard]] size_t GetOffset() const;
+
+    // Добавляет token в конец pending_. Лексема token занимает текст от token_begin_ до pos_
+    void Emit(Token token);
 
-    int IsNonemptyLine(std::istream& input);
+    int IsNonemptyLine();
 
     void AdjustIndentCount(int& indent_count, int space_count);
 
-    void LoadNumber(std::istream& input);
+    void LoadNumber();
 
-    void LoadString(std::istream& input);
+    void LoadString();
 
-    void LoadKeyWordOrId(std::istream& input);
+    void LoadKeyWordOrId();
 
-    void SkipComment(std::istream& input);
+    // Пропускает комментарий до конца строки, не считывая сам символ конца строки
+    void SkipComment();
 };
 
 template <typename T>
-const T& Lexer::Expect() const {
+T Lexer::Expect() const {
     using namespace std::literals;
     if (CurrentToken().Is<T>()) {
         return CurrentToken().As<T>();
@@ -180,7 +448,7 @@ void Lexer::Expect(const U& value) const {
 }
 
 template <typename T>
-const T& Lexer::ExpectNext() {
+T Lexer::ExpectNext() {
     NextToken();
     return Expect<T>();
 }
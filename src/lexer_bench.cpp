@@ -0,0 +1,267 @@
+#include "bench_runner_p.h"
+#include "char_scan.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// ---- Память при чтении длинной программы ----
+
+constexpr int SCRIPT_BLOCKS = 20'000;
+constexpr size_t HEAP_SAMPLE_PERIOD = 256;
+
+// Возвращает программу из SCRIPT_BLOCKS одинаковых по структуре фрагментов
+string MakeLongScript() {
+    string script;
+    for (int i = 0; i < SCRIPT_BLOCKS; ++i) {
+        const string n = to_string(i);
+        script += "class Counter:\n"s
+                  "  def add(value):\n"s
+                  "    if value > "s + n + ":\n"s
+                  "      return value * 2 + "s + n + "\n"s
+                  "    return 'block "s + n + "'\n"s
+                  "counter = Counter()\n"s
+                  "print counter.add("s + n + ")\n"s;
+    }
+    return script;
+}
+
+// Читает все токены программы, передавая каждый в consume, и возвращает наибольший
+// прирост памяти в куче за время чтения
+template <typename Consume>
+BenchResult BenchLexLongScript(Consume consume) {
+    istringstream input(MakeLongScript());
+    const size_t heap_before = HeapInUse();
+    size_t heap_peak = heap_before;
+    size_t tokens = 0;
+
+    Lexer lexer(input);
+    for (; !lexer.CurrentToken().Is<token_type::Eof>(); lexer.NextToken()) {
+        consume(lexer.CurrentToken());
+        if (++tokens % HEAP_SAMPLE_PERIOD == 0) {
+            heap_peak = max(heap_peak, HeapInUse());
+        }
+    }
+    return {tokens, static_cast<double>(heap_peak - heap_before) / 1024, "KiB peak heap"s};
+}
+
+BenchResult BenchLexLongScriptStreaming() {
+    return BenchLexLongScript([](const Token& token) {
+        DoNotOptimize(token);
+    });
+}
+
+// Прежнее поведение: все токены программы накапливаются до начала разбора
+BenchResult BenchLexLongScriptCollected() {
+    deque<Token> tokens;
+    return BenchLexLongScript([&tokens](const Token& token) {
+        tokens.push_back(token);
+    });
+}
+
+// ---- Скорость чтения ----
+
+constexpr int THROUGHPUT_ROUNDS = 5;
+
+// Читает все токены программы script THROUGHPUT_ROUNDS раз.
+// make_lexer создаёт лексер по тексту программы. Метрика - скорость чтения в МБ/с
+template <typename MakeLexer>
+BenchResult BenchLexThroughput(const string& script, MakeLexer make_lexer) {
+    size_t tokens = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int round = 0; round < THROUGHPUT_ROUNDS; ++round) {
+        Lexer lexer = make_lexer(script);
+        for (; !lexer.CurrentToken().Is<token_type::Eof>(); lexer.NextToken()) {
+            DoNotOptimize(lexer.CurrentToken());
+            ++tokens;
+        }
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    const double megabytes = static_cast<double>(script.size()) * THROUGHPUT_ROUNDS / 1e6;
+    return {tokens, megabytes / elapsed.count(), "MB/s"s};
+}
+
+BenchResult BenchLexThroughputStream() {
+    istringstream input;
+    return BenchLexThroughput(MakeLongScript(), [&input](const string& script) {
+        input.clear();
+        input.str(script);
+        return Lexer(input);
+    });
+}
+
+BenchResult BenchLexThroughputBuffer() {
+    return BenchLexThroughput(MakeLongScript(), [](const string& script) {
+        return Lexer(string_view(script));
+    });
+}
+
+// ---- Поиск символов блоками ----
+
+constexpr int DOC_BLOCKS = 5'000;
+
+// Возвращает программу, в которой большую часть текста занимают комментарии,
+// длинные строковые константы и отступы
+string MakeDocumentedScript() {
+    const string comment(72, '-');
+    const string text(120, 'x');
+    string script;
+    for (int i = 0; i < DOC_BLOCKS; ++i) {
+        const string n = to_string(i);
+        script += "# "s + comment + "\n"s
+                  "class Doc"s + n + ":\n"s
+                  "  # "s + comment + "\n"s
+                  "  def text():\n"s
+                  "    return 'line "s + n + ": "s + text + "\\n"s + text + "'\n"s
+                  "                                        # "s + comment + "\n"s
+                  "print Doc"s + n + "().text()\n"s;
+    }
+    return script;
+}
+
+// Читает MakeDocumentedScript, выполняя поиск набором инструкций level.
+// Если процессор его не поддерживает, бенчмарк не выполняется
+BenchResult BenchLexDocumented(scan::Level level) {
+    const scan::Level initial_level = scan::GetLevel();
+    if (!scan::SetLevel(level)) {
+        return {0, 0, "unsupported"s};
+    }
+    BenchResult result = BenchLexThroughput(MakeDocumentedScript(), [](const string& script) {
+        return Lexer(string_view(script));
+    });
+    scan::SetLevel(initial_level);
+    return result;
+}
+
+BenchResult BenchLexDocumentedScalar() {
+    return BenchLexDocumented(scan::Level::SCALAR);
+}
+
+BenchResult BenchLexDocumentedSse2() {
+    return BenchLexDocumented(scan::Level::SSE2);
+}
+
+BenchResult BenchLexDocumentedAvx2() {
+    return BenchLexDocumented(scan::Level::AVX2);
+}
+
+// ---- Параллельное чтение ----
+
+// Читает токены программы, созданной MakeLongScript, в threads потоках
+BenchResult BenchLexParallel(size_t threads) {
+    const string script = MakeLongScript();
+    size_t tokens = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int round = 0; round < THROUGHPUT_ROUNDS; ++round) {
+        tokens += LexParallel(script, threads).tokens.size();
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    const double megabytes = static_cast<double>(script.size()) * THROUGHPUT_ROUNDS / 1e6;
+    return {tokens, megabytes / elapsed.count(), "MB/s"s};
+}
+
+BenchResult BenchLexParallel1Thread() {
+    return BenchLexParallel(1);
+}
+
+BenchResult BenchLexParallel2Threads() {
+    return BenchLexParallel(2);
+}
+
+BenchResult BenchLexParallel4Threads() {
+    return BenchLexParallel(4);
+}
+
+BenchResult BenchLexParallel8Threads() {
+    return BenchLexParallel(8);
+}
+
+BenchResult BenchLexParallel16Threads() {
+    return BenchLexParallel(16);
+}
+
+// ---- Распознавание ключевых слов ----
+
+constexpr int KEYWORD_ROUNDS = 20;
+
+// Возвращает все слова программы, созданной MakeLongScript, - ключевые слова и идентификаторы
+vector<string_view> ExtractWords(const string& script) {
+    const auto is_id_char = [](char c) {
+        return c == '_' || isalnum(static_cast<unsigned char>(c));
+    };
+    vector<string_view> words;
+    for (size_t pos = 0; pos < script.size();) {
+        if (!isalpha(static_cast<unsigned char>(script[pos])) && script[pos] != '_') {
+            ++pos;
+            continue;
+        }
+        size_t end = pos + 1;
+        while (end < script.size() && is_id_char(script[end])) {
+            ++end;
+        }
+        words.emplace_back(script.data() + pos, end - pos);
+        pos = end;
+    }
+    return words;
+}
+
+// Классифицирует каждое слово программы KEYWORD_ROUNDS раз функцией find_keyword
+template <typename FindKeyword>
+size_t BenchKeywordLookup(FindKeyword find_keyword) {
+    const string script = MakeLongScript();
+    const vector<string_view> words = ExtractWords(script);
+    for (int round = 0; round < KEYWORD_ROUNDS; ++round) {
+        for (string_view word : words) {
+            DoNotOptimize(find_keyword(word));
+        }
+    }
+    return words.size() * KEYWORD_ROUNDS;
+}
+
+// Прежний способ: последовательное сравнение со всеми ключевыми словами
+size_t BenchKeywordLookupLinear() {
+    const vector<string> key_words{"class"s, "return"s, "if"s,   "else"s, "def"s,  "print"s,
+                                   "and"s,   "or"s,     "not"s,  "None"s, "True"s, "False"s};
+    return BenchKeywordLookup([&key_words](string_view word) {
+        return find(key_words.begin(), key_words.end(), word) - key_words.begin();
+    });
+}
+
+size_t BenchKeywordLookupPerfectHash() {
+    return BenchKeywordLookup([](string_view word) {
+        return FindKeyword(word);
+    });
+}
+
+}  // namespace
+
+void RunLexerBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, parse::BenchLexLongScriptStreaming);
+    RUN_BENCH(br, parse::BenchLexLongScriptCollected);
+    RUN_BENCH(br, parse::BenchLexThroughputStream);
+    RUN_BENCH(br, parse::BenchLexThroughputBuffer);
+    RUN_BENCH(br, parse::BenchLexDocumentedScalar);
+    RUN_BENCH(br, parse::BenchLexDocumentedSse2);
+    RUN_BENCH(br, parse::BenchLexDocumentedAvx2);
+    RUN_BENCH(br, parse::BenchLexParallel1Thread);
+    RUN_BENCH(br, parse::BenchLexParallel2Threads);
+    RUN_BENCH(br, parse::BenchLexParallel4Threads);
+    RUN_BENCH(br, parse::BenchLexParallel8Threads);
+    RUN_BENCH(br, parse::BenchLexParallel16Threads);
+    RUN_BENCH(br, parse::BenchKeywordLookupLinear);
+    RUN_BENCH(br, parse::BenchKeywordLookupPerfectHash);
+}
+
+}  // namespace parse
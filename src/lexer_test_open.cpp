@@ -1,8 +1,14 @@
+#include "char_scan.h"
 #include "lexer.h"
+#include "parallel_lexer.h"
 #include "test_runner_p.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <vector>
 
 using namespace std;
 
@@ -23,7 +29,7 @@ void TestSimpleAssignment() {
 }
 
 void TestKeywords() {
-    istringstream input("class return if else def print or None and not True False"s);
+    istringstream input("class return if else def print or None and not True False while for in"s);
     Lexer lexer(input);
 
     ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Class{}));
@@ -38,6 +44,9 @@ void TestKeywords() {
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Not{}));
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::True{}));
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::False{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::While{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::For{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::In{}));
 }
 
 void TestNumbers() {
@@ -351,6 +360,310 @@ abc#
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
     }
 }
+
+void TestReadsInputOnDemand() {
+    istringstream input(R"(x = 1
+if x:
+  y = 2
+print y
+)"s);
+
+    // Поток читается блоками по 4 символа
+    Lexer lexer(input, 4);
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"x"s}));
+    ASSERT_EQUAL(input.tellg(), 4);
+
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'='}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{1}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(input.tellg(), 8);
+
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::If{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"x"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{':'}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"y"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'='}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{2}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Print{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"y"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+}
+
+// Возвращает все токены, прочитанные лексером
+vector<Token> ReadAllTokens(Lexer& lexer) {
+    vector<Token> tokens{lexer.CurrentToken()};
+    while (!tokens.back().Is<token_type::Eof>()) {
+        tokens.push_back(lexer.NextToken());
+    }
+    return tokens;
+}
+
+void TestSameTokensFromStreamAndBuffer() {
+    const string program = R"(# comment
+class LongClassName(Base):
+  def method_with_long_name(first_argument, second):
+    # indented comment
+    if first_argument >= 1234567 and second != 'escaped \'quote\'\n':
+      return "long string literal that crosses chunk borders" # tail
+    return None
+
+x = LongClassName()
+print x.method_with_long_name(0, "a\\b\tc"), 2147483647 <= 10
+)"s;
+    const string_view source = program;
+    Lexer buffer_lexer(source);
+    const vector<Token> expected = ReadAllTokens(buffer_lexer);
+    ASSERT_EQUAL(expected.size(), 59U);
+
+    // Токены, пересекающие границы блоков, дочитываются целиком
+    for (size_t chunk_size = 1; chunk_size <= 9; ++chunk_size) {
+        istringstream input(program);
+        Lexer stream_lexer(input, chunk_size);
+        ASSERT_EQUAL(ReadAllTokens(stream_lexer), expected);
+    }
+}
+
+void TestTokenPositions() {
+    const string program = "x = 42\nif x:\n  print 'a\\tb' # c\n"s;
+    // Вид, смещение и длина каждого токена
+    const vector<tuple<TokenKind, size_t, size_t>> expected = {
+        {TokenKind::ID, 0, 1},       {TokenKind::CHAR, 2, 1},       {TokenKind::NUMBER, 4, 2},
+        {TokenKind::NEWLINE, 6, 1},  {TokenKind::IF, 7, 2},         {TokenKind::ID, 10, 1},
+        {TokenKind::CHAR, 11, 1},    {TokenKind::NEWLINE, 12, 1},   {TokenKind::INDENT, 13, 2},
+        {TokenKind::PRINT, 15, 5},   {TokenKind::STRING, 21, 6},    {TokenKind::NEWLINE, 31, 1},
+        {TokenKind::DEDENT, 32, 0},  {TokenKind::END_OF_FILE, 32, 0},
+    };
+    const auto positions = [](const vector<Token>& tokens) {
+        vector<tuple<TokenKind, size_t, size_t>> result;
+        for (const Token& token : tokens) {
+            result.emplace_back(token.GetKind(), token.GetOffset(), token.GetLength());
+        }
+        return result;
+    };
+
+    Lexer buffer_lexer{string_view(program)};
+    const vector<Token> tokens = ReadAllTokens(buffer_lexer);
+    ASSERT(positions(tokens) == expected);
+    ASSERT_EQUAL(tokens[10].As<token_type::String>().value, "a\tb"s);
+
+    // Смещения отсчитываются от начала текста, а не от начала буфера
+    istringstream input(program);
+    Lexer stream_lexer(input, 3);
+    ASSERT(positions(ReadAllTokens(stream_lexer)) == expected);
+}
+
+void TestFindKeyword() {
+    ASSERT(FindKeyword("class"sv) == Keyword::CLASS);
+    ASSERT(FindKeyword("return"sv) == Keyword::RETURN);
+    ASSERT(FindKeyword("if"sv) == Keyword::IF);
+    ASSERT(FindKeyword("else"sv) == Keyword::ELSE);
+    ASSERT(FindKeyword("def"sv) == Keyword::DEF);
+    ASSERT(FindKeyword("print"sv) == Keyword::PRINT);
+    ASSERT(FindKeyword("and"sv) == Keyword::AND);
+    ASSERT(FindKeyword("or"sv) == Keyword::OR);
+    ASSERT(FindKeyword("not"sv) == Keyword::NOT);
+    ASSERT(FindKeyword("None"sv) == Keyword::NONE);
+    ASSERT(FindKeyword("True"sv) == Keyword::TRUE);
+    ASSERT(FindKeyword("False"sv) == Keyword::FALSE);
+    ASSERT(FindKeyword("while"sv) == Keyword::WHILE);
+    ASSERT(FindKeyword("for"sv) == Keyword::FOR);
+    ASSERT(FindKeyword("in"sv) == Keyword::IN);
+
+    // Слова, совпадающие с ключевыми по хешу, длине или префиксу
+    for (string_view word : {""sv, "x"sv, "Class"sv, "classes"sv, "retur"sv, "fi"sv, "none"sv,
+                             "printx"sv, "nto"sv, "_and"sv, "Falsy"sv, "returned"sv,
+                             "While"sv, "fore"sv, "int"sv, "range"sv}) {
+        ASSERT(!FindKeyword(word));
+    }
+}
+
+// Вызывает test для каждого набора инструкций, поддерживаемого процессором,
+// и восстанавливает исходный набор
+template <typename Test>
+void ForEachScanLevel(Test test) {
+    const scan::Level initial_level = scan::GetLevel();
+    for (scan::Level level : {scan::Level::SCALAR, scan::Level::SSE2, scan::Level::AVX2}) {
+        if (scan::SetLevel(level)) {
+            test();
+        }
+    }
+    scan::SetLevel(initial_level);
+}
+
+void TestScanFunctions() {
+    // Искомый символ ставится в каждую позицию текста разной длины, чтобы попасть
+    // и внутрь блоков, и в побайтово просматриваемый остаток
+    constexpr size_t MAX_LENGTH = 80;
+    ForEachScanLevel([] {
+        for (size_t length = 0; length <= MAX_LENGTH; ++length) {
+            string text(length, ' ');
+            const char* begin = text.data();
+            const char* end = begin + length;
+            ASSERT_EQUAL(scan::SkipSpaces(begin, end) - begin, static_cast<ptrdiff_t>(length));
+            fill(text.begin(), text.end(), '\xE9');
+            ASSERT_EQUAL(scan::FindNewline(begin, end) - begin, static_cast<ptrdiff_t>(length));
+            ASSERT_EQUAL(scan::FindQuoteOrBackslash(begin, end, '"') - begin,
+                         static_cast<ptrdiff_t>(length));
+
+            for (size_t pos = 0; pos < length; ++pos) {
+                const auto expected = static_cast<ptrdiff_t>(pos);
+                string spaces(length, ' ');
+                spaces[pos] = 'x';
+                ASSERT_EQUAL(scan::SkipSpaces(spaces.data(), spaces.data() + length) - spaces.data(),
+                             expected);
+
+                string line(length, 'a');
+                line[pos] = '\n';
+                ASSERT_EQUAL(scan::FindNewline(line.data(), line.data() + length) - line.data(),
+                             expected);
+
+                for (char target : {'\'', '"', '\\'}) {
+                    string str(length, '\'');
+                    fill(str.begin(), str.begin() + pos, 'b');
+                    str[pos] = target;
+                    const char* found = scan::FindQuoteOrBackslash(str.data(), str.data() + length,
+                                                                   target == '"' ? '"' : '\'');
+                    ASSERT_EQUAL(found - str.data(), expected);
+                }
+            }
+        }
+    });
+}
+
+void TestSameTokensForEveryScanLevel() {
+    const string long_comment = "# "s + string(100, '-') + " #\n"s;
+    const string program = long_comment + "class Doc:\n"s + "  " + long_comment
+                           + "  def text():\n"s
+                           + "    return '"s + string(70, 'x') + "\\n"s + string(40, '"') + "\\''\n"s
+                           + "  " + string(60, ' ') + "# indented " + string(50, '#') + '\n'
+                           + string(45, ' ') + '\n'
+                           + "print Doc().text(), \""s + string(33, '\'') + "\\\\\" # tail\n"s;
+
+    // Первым проверяется побайтовый поиск, его результат служит эталоном.
+    // Тексты констант эталона хранятся вместе с ним
+    vector<Token> expected;
+    StringLiterals expected_literals;
+    ForEachScanLevel([&program, &expected, &expected_literals] {
+        Lexer buffer_lexer{string_view(program)};
+        if (expected.empty()) {
+            expected = ReadAllTokens(buffer_lexer);
+            expected_literals = buffer_lexer.TakeStringLiterals();
+        } else {
+            ASSERT_EQUAL(ReadAllTokens(buffer_lexer), expected);
+        }
+        for (size_t chunk_size : {1U, 7U, 31U, 64U}) {
+            istringstream input(program);
+            Lexer stream_lexer(input, chunk_size);
+            ASSERT_EQUAL(ReadAllTokens(stream_lexer), expected);
+        }
+    });
+    ASSERT_EQUAL(expected.size(), 29U);
+}
+
+void TestStringLiteralStorage() {
+    // Тексты строковых констант не попадают в таблицу символов. Константа без
+    // escape-последовательностей ссылается на исходный текст, остальные копируются в лексер
+    const string program = "print 'plain literal', 'escaped\\tliteral'\n"s;
+    const size_t symbol_count = runtime::Symbol::GetCount();
+    Lexer buffer_lexer{string_view(program)};
+    const vector<Token> tokens = ReadAllTokens(buffer_lexer);
+    const string_view plain = tokens[1].As<token_type::String>().value;
+    ASSERT_EQUAL(plain, "plain literal"sv);
+    ASSERT(plain.data() == program.data() + tokens[1].GetOffset() + 1);
+    ASSERT_EQUAL(tokens[3].As<token_type::String>().value, "escaped\tliteral"sv);
+
+    istringstream input(program);
+    Lexer stream_lexer(input, 4);
+    ASSERT_EQUAL(ReadAllTokens(stream_lexer), tokens);
+    ASSERT_EQUAL(runtime::Symbol::GetCount(), symbol_count);
+}
+
+// Возвращает вид, значение и положение каждого токена
+vector<tuple<TokenKind, string, size_t, size_t>> Describe(const vector<Token>& tokens) {
+    vector<tuple<TokenKind, string, size_t, size_t>> result;
+    for (const Token& token : tokens) {
+        ostringstream value;
+        value << token;
+        result.emplace_back(token.GetKind(), value.str(), token.GetOffset(), token.GetLength());
+    }
+    return result;
+}
+
+TokenList LexSerially(string_view source) {
+    Lexer lexer(source);
+    TokenList result{ReadAllTokens(lexer), {}};
+    result.literals = lexer.TakeStringLiterals();
+    return result;
+}
+
+void TestSplitAtTopLevel() {
+    const string program = "class A:\n  def f():\n    return 1\n\n# top\n  \nx = A()\n"
+                           "if x:\n  print 'a\nb'\nprint x.f()\n"s;
+    for (size_t part_size = 1; part_size <= program.size(); ++part_size) {
+        const vector<string_view> parts = SplitAtTopLevel(program, 100, part_size);
+        string joined;
+        for (size_t i = 0; i < parts.size(); ++i) {
+            ASSERT(!parts[i].empty());
+            if (i + 1 < parts.size()) {
+                ASSERT(parts[i].size() >= part_size);
+                ASSERT_EQUAL(parts[i].back(), '\n');
+            }
+            if (i > 0) {
+                ASSERT(parts[i][0] != ' ' && parts[i][0] != '#' && parts[i][0] != '\n');
+            }
+            joined += parts[i];
+        }
+        ASSERT_EQUAL(joined, program);
+    }
+    ASSERT(SplitAtTopLevel(""sv, 4).empty());
+    ASSERT_EQUAL(SplitAtTopLevel(program, 4).size(), 1U);
+}
+
+void TestParallelLexingMatchesSerial() {
+    string program;
+    for (int i = 0; i < 40; ++i) {
+        const string n = to_string(i);
+        program += "class C"s + n + ":\n  def m(x):\n    if x > "s + n + ":\n      return 'v"s + n
+                   + "\\t'\n    # inner comment\n    return x\n\n"s + "# top comment\n"s
+                   + "c = C"s + n + "()\nprint c.m("s + n + ")\n"s;
+    }
+    program += "print 'no newline at the end'"s;
+    const auto expected = Describe(LexSerially(program).tokens);
+
+    for (size_t threads = 1; threads <= 5; ++threads) {
+        for (size_t part_size : {1U, 10U, 100U, 1000U}) {
+            ASSERT(Describe(LexParallel(program, threads, part_size).tokens) == expected);
+        }
+    }
+}
+
+void TestParallelLexingFallsBackToSerial() {
+    // Строка без отступа внутри многострочной константы
+    const string multiline = "x = 'first\nprint 1'\nprint x\ny = 2\n"s;
+    ASSERT(Describe(LexParallel(multiline, 4, 1).tokens)
+           == Describe(LexSerially(multiline).tokens));
+
+    // Ошибки совпадают с ошибками последовательного чтения
+    ASSERT_THROWS(LexParallel("x = 1\ny = 'open\nz = 3\n"s, 4, 1), LexerError);
+    ASSERT_THROWS(LexParallel("x = 1\ny = 2\nz = 3\n    w = 4\n"s, 4, 1), LexerError);
+    ASSERT_THROWS(LexParallel(" x = 1\ny = 2\n"s, 4, 1), LexerError);
+}
+
+void TestLexerFromTokens() {
+    const string program = "x = 'a'\ny = 'b\\n'\nprint x, y\n"s;
+    Lexer lexer(LexParallel(program, 2, 1));
+    ASSERT(Describe(ReadAllTokens(lexer)) == Describe(LexSerially(program).tokens));
+    ASSERT(lexer.NextToken().Is<token_type::Eof>());
+
+    Lexer empty(TokenList{});
+    ASSERT(empty.CurrentToken().Is<token_type::Eof>());
+}
 }  // namespace
 
 void RunOpenLexerTests(TestRunner& tr) {
@@ -367,6 +680,17 @@ void RunOpenLexerTests(TestRunner& tr) {
     RUN_TEST(tr, parse::TestMythonProgram);
     RUN_TEST(tr, parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
     RUN_TEST(tr, parse::TestCommentsAreIgnored);
+    RUN_TEST(tr, parse::TestReadsInputOnDemand);
+    RUN_TEST(tr, parse::TestSameTokensFromStreamAndBuffer);
+    RUN_TEST(tr, parse::TestTokenPositions);
+    RUN_TEST(tr, parse::TestFindKeyword);
+    RUN_TEST(tr, parse::TestScanFunctions);
+    RUN_TEST(tr, parse::TestSameTokensForEveryScanLevel);
+    RUN_TEST(tr, parse::TestStringLiteralStorage);
+    RUN_TEST(tr, parse::TestSplitAtTopLevel);
+    RUN_TEST(tr, parse::TestParallelLexingMatchesSerial);
+    RUN_TEST(tr, parse::TestParallelLexingFallsBackToSerial);
+    RUN_TEST(tr, parse::TestLexerFromTokens);
 }
 
 }  // namespace parse
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "bench_runner_p.h"
+#include "bytecode.h"
+#include "lexer.h"
+#include "parse.h"
+
+#include <string>
+
+using namespace std;
+
+namespace vm {
+
+namespace {
+
+// ---- Списки и цепочки экземпляров на виртуальной машине ----
+
+constexpr int ELEMENTS = 20'000;
+constexpr int PASSES = 50;
+
+// Заполняет список числами и несколько раз суммирует его элементы.
+// Если generic == true, первый элемент списка - None: список хранит ObjectHolder,
+// а не int, даже после замены None числом
+string MakeListProgram(bool generic) {
+    return R"(
+class Bench:
+  def run(n, passes):
+    xs = )"s + (generic ? "[None]"s : "[0]"s) + R"(
+    for i in range(1, n):
+      xs.append(i)
+    xs[0] = 0
+    total = 0
+    for p in range(passes):
+      for x in xs:
+        total = total + x
+    return total
+
+b = Bench()
+print b.run()"s + to_string(ELEMENTS) + ", "s + to_string(PASSES) + ")\n"s;
+}
+
+// Та же работа над цепочкой экземпляров, связанных полем next: так хранились
+// коллекции до появления списков
+string MakeLinkedProgram() {
+    return R"(
+class Node:
+  def __init__(value, next):
+    self.value = value
+    self.next = next
+
+class Bench:
+  def run(n, passes):
+    head = None
+    for i in range(n):
+      head = Node(n - 1 - i, head)
+    total = 0
+    for p in range(passes):
+      node = head
+      for i in range(n):
+        total = total + node.value
+        node = node.next
+    return total
+
+b = Bench()
+print b.run()"s + to_string(ELEMENTS) + ", "s + to_string(PASSES) + ")\n"s;
+}
+
+// Измеряет время выполнения program на виртуальной машине.
+// Разбор и компиляция программы в измерение не входят
+BenchResult BenchProgram(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto compiled = Compile(parse::ParseProgram(lexer));
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    const auto start = chrono::steady_clock::now();
+    compiled->Execute(closure, context);
+    const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    DoNotOptimize(context.output.str());
+    return {static_cast<size_t>(ELEMENTS) * PASSES, elapsed.count(), "ms execute"s};
+}
+
+BenchResult BenchNumericList() {
+    return BenchProgram(MakeListProgram(false));
+}
+
+BenchResult BenchGenericList() {
+    return BenchProgram(MakeListProgram(true));
+}
+
+BenchResult BenchLinkedInstances() {
+    return BenchProgram(MakeLinkedProgram());
+}
+
+}  // namespace
+
+void RunListBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, vm::BenchNumericList);
+    RUN_BENCH(br, vm::BenchGenericList);
+    RUN_BENCH(br, vm::BenchLinkedInstances);
+}
+
+}  // namespace vm
@@ -0,0 +1,118 @@
+#include "bench_runner_p.h"
+#include "bytecode.h"
+#include "lexer.h"
+#include "parse.h"
+
+#include <string>
+
+using namespace std;
+
+namespace vm {
+
+namespace {
+
+// ---- Циклы и рекурсия на виртуальной машине ----
+
+constexpr int SUM_LIMIT = 1'000'000;
+
+// Сумма чисел от 0 до SUM_LIMIT циклом for по range()
+string MakeForRangeProgram() {
+    return R"(
+class Sum:
+  def calc(n):
+    total = 0
+    for i in range(n):
+      total = total + i
+    return total
+
+s = Sum()
+print s.calc()"s + to_string(SUM_LIMIT) + ")\n"s;
+}
+
+// Та же сумма циклом while со счётчиком в локальной переменной
+string MakeWhileProgram() {
+    return R"(
+class Sum:
+  def calc(n):
+    total = 0
+    i = 0
+    while i < n:
+      total = total + i
+      i = i + 1
+    return total
+
+s = Sum()
+print s.calc()"s + to_string(SUM_LIMIT) + ")\n"s;
+}
+
+// Та же сумма рекурсией, делящей отрезок пополам: единственный способ повторения
+// до появления циклов. Глубина рекурсии логарифмическая, число вызовов - 2 * SUM_LIMIT
+string MakeRecursiveProgram() {
+    return R"(
+class Sum:
+  def calc(a, b):
+    if b - a == 1:
+      return a
+    m = (a + b) / 2
+    return self.calc(a, m) + self.calc(m, b)
+
+s = Sum()
+print s.calc(0, )"s + to_string(SUM_LIMIT) + ")\n"s;
+}
+
+// Та же сумма хвостовой рекурсией: вызов заменяет кадр метода, поэтому глубина рекурсии
+// равна SUM_LIMIT без роста стека вызовов C++
+string MakeTailRecursiveProgram() {
+    return R"(
+class Sum:
+  def calc(i, n, total):
+    if i == n:
+      return total
+    return self.calc(i + 1, n, total + i)
+
+s = Sum()
+print s.calc(0, )"s + to_string(SUM_LIMIT) + ", 0)\n"s;
+}
+
+// Измеряет время выполнения program на виртуальной машине.
+// Разбор и компиляция программы в измерение не входят
+BenchResult BenchProgram(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto compiled = Compile(parse::ParseProgram(lexer));
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    const auto start = chrono::steady_clock::now();
+    compiled->Execute(closure, context);
+    const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    DoNotOptimize(context.output.str());
+    return {SUM_LIMIT, elapsed.count(), "ms execute"s};
+}
+
+BenchResult BenchSumForRange() {
+    return BenchProgram(MakeForRangeProgram());
+}
+
+BenchResult BenchSumWhile() {
+    return BenchProgram(MakeWhileProgram());
+}
+
+BenchResult BenchSumRecursion() {
+    return BenchProgram(MakeRecursiveProgram());
+}
+
+BenchResult BenchSumTailRecursion() {
+    return BenchProgram(MakeTailRecursiveProgram());
+}
+
+}  // namespace
+
+void RunLoopBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, vm::BenchSumForRange);
+    RUN_BENCH(br, vm::BenchSumWhile);
+    RUN_BENCH(br, vm::BenchSumRecursion);
+    RUN_BENCH(br, vm::BenchSumTailRecursion);
+}
+
+}  // namespace vm
@@ -1,36 +1,123 @@
+#include "bench_runner_p.h"
+#include "bytecode.h"
+#include "flat_ast.h"
 #include "lexer.h"
+#include "mapped_file.h"
+#include "optimize.h"
+#include "parallel_lexer.h"
 #include "parse.h"
+#include "program_cache.h"
 #include "runtime.h"
 #include "statement.h"
 #include "test_runner_p.h"
 
+#include <charconv>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string_view>
 
 using namespace std;
 
 namespace parse {
 void RunOpenLexerTests(TestRunner& tr);
+void RunLexerBenchmarks(BenchRunner& br);
+void RunParseBenchmarks(BenchRunner& br);
 }  // namespace parse
 
 namespace ast {
 void RunUnitTests(TestRunner& tr);
-}
+void RunOptimizeTests(TestRunner& tr);
+void RunOptimizeBenchmarks(BenchRunner& br);
+}  // namespace ast
 namespace runtime {
 void RunObjectHolderTests(TestRunner& tr);
 void RunObjectsTests(TestRunner& tr);
+void RunRuntimeBenchmarks(BenchRunner& br);
 }  // namespace runtime
 
+namespace vm {
+void RunVmTests(TestRunner& tr);
+void RunLoopBenchmarks(BenchRunner& br);
+void RunListBenchmarks(BenchRunner& br);
+}  // namespace vm
+
+namespace flat {
+void RunFlatAstTests(TestRunner& tr);
+void RunFlatAstBenchmarks(BenchRunner& br);
+void RunProgramCacheTests(TestRunner& tr);
+void RunProgramCacheBenchmarks(BenchRunner& br);
+}  // namespace flat
+
 void TestParseProgram(TestRunner& tr);
 
 namespace {
 
-void RunMythonProgram(istream& input, ostream& output) {
-    parse::Lexer lexer(input);
+// Способ выполнения программы
+enum class Engine {
+    AST,   // обход дерева, построенного парсером
+    FLAT,  // обход плоского дерева (flat::Tree), построенного из дерева парсера
+    VM,    // компиляция в байткод и выполнение на стековой виртуальной машине
+};
+
+// Строит из текста, который читает lexer, программу для выполнения способом engine
+unique_ptr<runtime::Executable> BuildProgram(parse::Lexer& lexer, Engine engine, bool optimize) {
     auto program = parse::ParseProgram(lexer);
+    if (optimize) {
+        program = ast::Optimize(std::move(program));
+    }
+    if (engine == Engine::VM) {
+        program = vm::Compile(std::move(program));
+    } else if (engine == Engine::FLAT) {
+        program = flat::Flatten(std::move(program));
+    }
+    return program;
+}
+
+void ExecuteProgram(runtime::Executable& program, ostream& output,
+                    runtime::OutputOptions output_options) {
+    // Когда переменные программы удалены, освобождаются и объекты, ссылающиеся друг на друга
+    // по кругу. Сборка выполняется и если программа завершилась ошибкой
+    struct CollectCyclesOnExit {
+        runtime::Closure closure;
+
+        ~CollectCyclesOnExit() {
+            closure.clear();
+            runtime::CollectCycles();
+        }
+    } globals;
+    runtime::SimpleContext context{output, output_options};
+    // Программа возвращает значение, только если return выполнен вне метода
+    if (program.Execute(globals.closure, context)) {
+        throw runtime_error("Return outside of a method"s);
+    }
+}
 
-    runtime::SimpleContext context{output};
-    runtime::Closure closure;
-    program->Execute(closure, context);
+void RunMythonProgram(parse::Lexer& lexer, ostream& output, Engine engine, bool optimize,
+                      runtime::OutputOptions output_options) {
+    const auto program = BuildProgram(lexer, engine, optimize);
+    ExecuteProgram(*program, output, output_options);
+}
+
+// Выполняет программу с текстом source обходом плоского дерева, взятого из кэша cache.
+// Если программы нет в кэше, она разбирается и сохраняется в кэш
+void RunCachedMythonProgram(string_view source, const flat::ProgramCache& cache,
+                            ostream& output, bool optimize, size_t lex_threads,
+                            runtime::OutputOptions output_options) {
+    unique_ptr<flat::Program> program = cache.Find(source, optimize);
+    if (!program) {
+        auto lexer = lex_threads > 1 ? parse::Lexer(parse::LexParallel(source, lex_threads))
+                                     : parse::Lexer(source);
+        program = flat::Flatten(BuildProgram(lexer, Engine::AST, optimize));
+        cache.Store(source, optimize, *program);
+    }
+    ExecuteProgram(*program, output, output_options);
+}
+
+void RunMythonProgram(istream& input, ostream& output, Engine engine = Engine::VM,
+                      bool optimize = true, runtime::OutputOptions output_options = {}) {
+    parse::Lexer lexer(input);
+    RunMythonProgram(lexer, output, engine, optimize, output_options);
 }
 
 void TestSimplePrints() {
@@ -111,27 +198,301 @@ print y.value
     ASSERT_EQUAL(output.str(), "2\n3\n");
 }
 
+void TestNewInstancePerExecution() {
+    // Один и тот же вызов конструктора, выполненный несколько раз, создаёт разные объекты
+    const string program = R"(
+class Node:
+  def __init__(value):
+    self.value = value
+
+  def __add__(other):
+    return self
+
+class Factory:
+  def make(value):
+    return Node(value)
+
+f = Factory()
+a = f.make(1)
+b = f.make(2)
+c = f.make(3)
+d = Node(4) + 0
+print a.value, b.value, c.value, d.value
+xs = []
+for i in range(3):
+  xs.append(Node(i))
+a.value = 10
+x = xs[0]
+x.value = 5
+y = xs[2]
+print a.value, b.value, x.value, y.value
+)";
+
+    for (const auto engine : {Engine::AST, Engine::FLAT, Engine::VM}) {
+        istringstream input(program);
+        ostringstream output;
+        RunMythonProgram(input, output, engine);
+        ASSERT_EQUAL(output.str(), "1 2 3 4\n10 2 5 2\n"s);
+    }
+}
+
+void TestSelfOutlivesInstance() {
+    // Значение self, прочитанное как поле, продлевает жизнь экземпляра: память объекта f
+    // не должна достаться w
+    const string program = R"(
+class Foo:
+  def __init__():
+    self.x = 7
+
+class Holder:
+  def make():
+    f = Foo()
+    return f.self
+
+h = Holder()
+y = h.make()
+w = Foo()
+w.x = 99
+print y.x
+)";
+
+    for (const auto engine : {Engine::AST, Engine::FLAT, Engine::VM}) {
+        istringstream input(program);
+        ostringstream output;
+        RunMythonProgram(input, output, engine);
+        ASSERT_EQUAL(output.str(), "7\n"s);
+    }
+}
+
+void TestReferenceCyclesAreFreed() {
+    // Циклы через self, через поля двух объектов и через список. Builder создаёт больше
+    // объектов, чем порог сборки, поэтому циклы собираются и во время выполнения программы
+    const string program = R"(
+class Node:
+  def __init__():
+    self.me = self
+    self.items = [self]
+
+  def link(other):
+    self.next = other
+    other.prev = self
+
+class Builder:
+  def build(n):
+    if n > 0:
+      a = Node()
+      a.link(Node())
+      b = Node()
+      return self.build(n - 1) + 1
+    return 0
+
+a = Node()
+b = Node()
+a.link(b)
+c = Node()
+c.next = c.self
+builder = Builder()
+print builder.build(400)
+)";
+
+    const size_t initial_count = runtime::GetCollectableObjectCount();
+    for (const auto engine : {Engine::AST, Engine::FLAT, Engine::VM}) {
+        istringstream input(program);
+        ostringstream output;
+        RunMythonProgram(input, output, engine);
+        ASSERT_EQUAL(output.str(), "400\n"s);
+        ASSERT_EQUAL(runtime::GetCollectableObjectCount(), initial_count);
+    }
+}
+
+void TestReturnOutsideMethod() {
+    // return со значением вне метода - ошибка, а return None ничего не делает
+    for (const auto engine : {Engine::AST, Engine::FLAT, Engine::VM}) {
+        istringstream input("print 1\nreturn 5\nprint 2\n");
+        ostringstream output;
+        ASSERT_THROWS(RunMythonProgram(input, output, engine), runtime_error);
+        ASSERT_EQUAL(output.str(), "1\n"s);
+
+        istringstream none_input("print 1\nreturn None\nprint 2\n");
+        ostringstream none_output;
+        RunMythonProgram(none_input, none_output, engine);
+        ASSERT_EQUAL(none_output.str(), "1\n2\n"s);
+    }
+}
+
 void TestAll() {
     TestRunner tr;
     parse::RunOpenLexerTests(tr);
     runtime::RunObjectHolderTests(tr);
     runtime::RunObjectsTests(tr);
     ast::RunUnitTests(tr);
+    ast::RunOptimizeTests(tr);
     TestParseProgram(tr);
+    vm::RunVmTests(tr);
+    flat::RunFlatAstTests(tr);
+    flat::RunProgramCacheTests(tr);
 
     RUN_TEST(tr, TestSimplePrints);
     RUN_TEST(tr, TestAssignments);
     RUN_TEST(tr, TestArithmetics);
     RUN_TEST(tr, TestVariablesArePointers);
+    RUN_TEST(tr, TestNewInstancePerExecution);
+    RUN_TEST(tr, TestSelfOutlivesInstance);
+    RUN_TEST(tr, TestReferenceCyclesAreFreed);
+    RUN_TEST(tr, TestReturnOutsideMethod);
+}
+
+void BenchAll(const string& filter) {
+    BenchRunner br(filter);
+    parse::RunLexerBenchmarks(br);
+    parse::RunParseBenchmarks(br);
+    ast::RunOptimizeBenchmarks(br);
+    runtime::RunRuntimeBenchmarks(br);
+    flat::RunFlatAstBenchmarks(br);
+    flat::RunProgramCacheBenchmarks(br);
+    vm::RunLoopBenchmarks(br);
+    vm::RunListBenchmarks(br);
+}
+
+// Возвращает политику сброса вывода с именем name
+optional<runtime::FlushPolicy> ParseFlushPolicy(string_view name) {
+    if (name == "line"sv) {
+        return runtime::FlushPolicy::LINE;
+    }
+    if (name == "threshold"sv) {
+        return runtime::FlushPolicy::THRESHOLD;
+    }
+    if (name == "exit"sv) {
+        return runtime::FlushPolicy::EXIT;
+    }
+    return nullopt;
+}
+
+// Возвращает значение опции вида name=value либо nullopt, если arg - другая опция
+optional<string_view> OptionValue(string_view arg, string_view name) {
+    if (arg.size() <= name.size() || arg.substr(0, name.size()) != name
+        || arg[name.size()] != '=') {
+        return nullopt;
+    }
+    return arg.substr(name.size() + 1);
 }
 
 }  // namespace
 
-int main() {
+// Использование: mython [--ast | --flat] [--no-optimize] [--stats] [--flush=policy]
+//                       [--buffer-size=bytes] [--lex-threads=count] [--cache-dir=dir]
+//                       [--bench[=filter]] [script]
+//   script               файл с программой. Файл отображается в память и читается
+//                        без копирования. Без него программа читается из stdin
+//   --lex-threads=count  читать токены файла script в count потоках
+//   --ast                выполнять программу обходом AST вместо виртуальной машины
+//   --flat               выполнять программу обходом плоского AST вместо виртуальной машины
+//   --cache-dir=dir      хранить в каталоге dir программы, переведённые в плоское дерево.
+//                        Программа, найденная в кэше, не разбирается заново и выполняется
+//                        обходом плоского дерева
+//   --no-optimize        не сворачивать константы и не упрощать дерево перед выполнением
+//   --stats              после выполнения программы вывести в stderr счётчики встроенных кэшей
+//   --flush=policy       когда передавать вывод в stdout: line - после каждой строки,
+//                        threshold - при заполнении буфера (по умолчанию),
+//                        exit - по завершении программы
+//   --buffer-size=bytes  размер буфера вывода
+//   --bench[=filter]     вместо выполнения программы запустить бенчмарки,
+//                        в имени которых встречается filter
+int main(int argc, char* argv[]) {
+    Engine engine = Engine::VM;
+    bool optimize = true;
+    bool print_stats = false;
+    runtime::OutputOptions output_options;
+    optional<string> bench_filter;
+    optional<string> script_path;
+    size_t lex_threads = 1;
+    optional<string> cache_dir;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (const auto policy_name = OptionValue(arg, "--flush"sv)) {
+            const auto policy = ParseFlushPolicy(*policy_name);
+            if (!policy) {
+                std::cerr << "Unknown flush policy: "sv << *policy_name << std::endl;
+                return 1;
+            }
+            output_options.policy = *policy;
+        } else if (const auto size = OptionValue(arg, "--buffer-size"sv)) {
+            const auto result = from_chars(size->data(), size->data() + size->size(),
+                                           output_options.buffer_size);
+            if (result.ec != errc() || result.ptr != size->data() + size->size()) {
+                std::cerr << "Invalid buffer size: "sv << *size << std::endl;
+                return 1;
+            }
+        } else if (const auto count = OptionValue(arg, "--lex-threads"sv)) {
+            const auto result = from_chars(count->data(), count->data() + count->size(),
+                                           lex_threads);
+            if (result.ec != errc() || result.ptr != count->data() + count->size()
+                || lex_threads == 0) {
+                std::cerr << "Invalid lex thread count: "sv << *count << std::endl;
+                return 1;
+            }
+        } else if (const auto dir = OptionValue(arg, "--cache-dir"sv)) {
+            cache_dir = string(*dir);
+        } else if (arg == "--ast"sv) {
+            engine = Engine::AST;
+        } else if (arg == "--flat"sv) {
+            engine = Engine::FLAT;
+        } else if (arg == "--no-optimize"sv) {
+            optimize = false;
+        } else if (arg == "--stats"sv) {
+            print_stats = true;
+        } else if (arg == "--bench"sv) {
+            bench_filter = ""s;
+        } else if (arg.substr(0, "--bench="sv.size()) == "--bench="sv) {
+            bench_filter = string(arg.substr("--bench="sv.size()));
+        } else if (!script_path && arg.substr(0, 2) != "--"sv) {
+            script_path = string(arg);
+        } else {
+            std::cerr << "Unknown option: "sv << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (cache_dir && engine == Engine::AST) {
+        std::cerr << "Option --cache-dir can't be used with --ast"sv << std::endl;
+        return 1;
+    }
+
     try {
         TestAll();
 
-        RunMythonProgram(cin, cout);
+        if (bench_filter) {
+            BenchAll(*bench_filter);
+        } else {
+            runtime::inline_cache_counters = {};
+            if (cache_dir) {
+                const flat::ProgramCache cache(*cache_dir);
+                if (script_path) {
+                    const parse::MappedFile script(*script_path);
+                    RunCachedMythonProgram(script.GetContents(), cache, cout, optimize,
+                                           lex_threads, output_options);
+                } else {
+                    const string source{istreambuf_iterator<char>(cin),
+                                        istreambuf_iterator<char>()};
+                    RunCachedMythonProgram(source, cache, cout, optimize, lex_threads,
+                                           output_options);
+                }
+            } else if (script_path) {
+                const parse::MappedFile script(*script_path);
+                if (lex_threads > 1) {
+                    parse::Lexer lexer(parse::LexParallel(script.GetContents(), lex_threads));
+                    RunMythonProgram(lexer, cout, engine, optimize, output_options);
+                } else {
+                    parse::Lexer lexer(script.GetContents());
+                    RunMythonProgram(lexer, cout, engine, optimize, output_options);
+                }
+            } else {
+                RunMythonProgram(cin, cout, engine, optimize, output_options);
+            }
+            if (print_stats) {
+                runtime::PrintInlineCacheStats(cerr, runtime::inline_cache_counters);
+            }
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
 		return 1;
@@ -0,0 +1,47 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace parse {
+
+MappedFile::MappedFile(const std::string& path) {
+    using namespace std::literals;
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw MappedFileError("Failed to open file "s + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw MappedFileError("Failed to get size of file "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    // Пустой файл отобразить нельзя, его содержимое - пустая строка
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw MappedFileError("Failed to map file "s + path);
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+std::string_view MappedFile::GetContents() const {
+    return {data_, size_};
+}
+
+}  // namespace parse
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace parse {
+
+class MappedFileError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Файл, отображённый в память только для чтения.
+// Позволяет лексеру читать текст программы без копирования
+class MappedFile {
+public:
+    // Отображает в память файл path. Если файл не удаётся открыть,
+    // выбрасывает исключение MappedFileError
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    // Возвращает содержимое файла
+    [[nodiscard]] std::string_view GetContents() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace parse
@@ -0,0 +1,212 @@
+#include "optimize.h"
+
+#include "statement.h"
+
+using namespace std;
+
+namespace ast {
+
+using runtime::ObjectHolder;
+
+// ----------- Optimizer -----------------------
+
+// Упрощает узлы дерева, заменяя их в указателях, которые на них ссылаются.
+// Дочерние узлы упрощаются раньше родительских, поэтому цепочки операций над константами
+// сворачиваются целиком
+class Optimizer {
+public:
+    // Новые узлы размещаются в арене program либо, если program равен nullptr, в куче
+    explicit Optimizer(Program* program)
+        : program_(program)
+        {}
+
+    // Упрощает дерево программы program
+    void OptimizeProgram(Program& program) {
+        Optimize(program.tree_);
+    }
+
+    // Упрощает поддерево slot. Если is_condition == true, значение поддерева
+    // используется только после приведения к Bool
+    void Optimize(StatementPtr& slot, bool is_condition = false) {
+        Statement* node = slot.get();
+        if (auto* assign = dynamic_cast<Assignment*>(node)) {
+            Optimize(assign->value_);
+        } else if (auto* field_assign = dynamic_cast<FieldAssignment*>(node)) {
+            Optimize(field_assign->field_value_);
+        } else if (auto* list = dynamic_cast<ListLiteral*>(node)) {
+            OptimizeAll(list->items_);
+        } else if (auto* dict = dynamic_cast<DictLiteral*>(node)) {
+            OptimizeAll(dict->items_);
+        } else if (auto* index = dynamic_cast<Index*>(node)) {
+            Optimize(index->object_);
+            Optimize(index->index_);
+        } else if (auto* index_assign = dynamic_cast<IndexAssignment*>(node)) {
+            Optimize(index_assign->object_);
+            Optimize(index_assign->index_);
+            Optimize(index_assign->value_);
+        } else if (auto* print = dynamic_cast<Print*>(node)) {
+            OptimizeAll(print->args_);
+        } else if (auto* call = dynamic_cast<MethodCall*>(node)) {
+            Optimize(call->object_);
+            OptimizeAll(call->args_);
+        } else if (auto* new_inst = dynamic_cast<NewInstance*>(node)) {
+            OptimizeAll(new_inst->args_);
+        } else if (auto* not_op = dynamic_cast<Not*>(node)) {
+            Optimize(not_op->arg_, true);
+            // В условии not not x равносильно x
+            if (auto* inner = dynamic_cast<Not*>(not_op->arg_.get()); inner && is_condition) {
+                Replace(slot, std::move(inner->arg_));
+                return;
+            }
+            FoldConstants(slot, {not_op->arg_.get()});
+        } else if (auto* unary = dynamic_cast<UnaryOperation*>(node)) {
+            Optimize(unary->arg_);
+            FoldConstants(slot, {unary->arg_.get()});
+        } else if (auto* binary = dynamic_cast<BinaryOperation*>(node)) {
+            // Аргументы and и or приводятся к Bool
+            const bool is_logical = dynamic_cast<And*>(node) || dynamic_cast<Or*>(node);
+            Optimize(binary->lhs_, is_logical);
+            Optimize(binary->rhs_, is_logical);
+            FoldConstants(slot, {binary->lhs_.get(), binary->rhs_.get()});
+        } else if (auto* compound = dynamic_cast<Compound*>(node)) {
+            OptimizeAll(compound->args_);
+        } else if (auto* body = dynamic_cast<MethodBody*>(node)) {
+            Optimize(body->body_);
+        } else if (auto* ret = dynamic_cast<Return*>(node)) {
+            Optimize(ret->statement_);
+        } else if (auto* cls_def = dynamic_cast<ClassDefinition*>(node)) {
+            OptimizeMethods(*cls_def->GetClass().TryAs<runtime::Class>());
+        } else if (auto* if_else = dynamic_cast<IfElse*>(node)) {
+            OptimizeIfElse(slot, *if_else);
+        } else if (auto* while_loop = dynamic_cast<While*>(node)) {
+            OptimizeWhile(slot, *while_loop);
+        } else if (auto* for_range = dynamic_cast<ForRange*>(node)) {
+            for (auto* arg : {&for_range->start_, &for_range->stop_, &for_range->step_}) {
+                if (*arg) {
+                    Optimize(*arg);
+                }
+            }
+            Optimize(for_range->body_);
+        } else if (auto* for_each = dynamic_cast<ForEach*>(node)) {
+            Optimize(for_each->iterable_);
+            Optimize(for_each->body_);
+        }
+    }
+
+private:
+    void OptimizeAll(vector<StatementPtr>& slots) {
+        for (auto& slot : slots) {
+            Optimize(slot);
+        }
+    }
+
+    void OptimizeMethods(const runtime::Class& cls) {
+        for (const auto& method : cls.GetMethods()) {
+            if (auto* body = dynamic_cast<MethodBody*>(method.body.get())) {
+                Optimize(body->body_);
+            }
+        }
+    }
+
+    void OptimizeIfElse(StatementPtr& slot, IfElse& if_else) {
+        Optimize(if_else.condition_, true);
+        Optimize(if_else.if_body_);
+        if (if_else.else_body_) {
+            Optimize(if_else.else_body_);
+        }
+        if (!IsConstant(*if_else.condition_)) {
+            return;
+        }
+        if (IsTrue(Evaluate(*if_else.condition_))) {
+            Replace(slot, std::move(if_else.if_body_));
+        } else if (if_else.else_body_) {
+            Replace(slot, std::move(if_else.else_body_));
+        } else {
+            Replace(slot, MakeNode<None>());
+        }
+    }
+
+    void OptimizeWhile(StatementPtr& slot, While& while_loop) {
+        Optimize(while_loop.condition_, true);
+        Optimize(while_loop.body_);
+        // Цикл с ложным условием не выполняется ни разу
+        if (IsConstant(*while_loop.condition_) && !IsTrue(Evaluate(*while_loop.condition_))) {
+            Replace(slot, MakeNode<None>());
+        }
+    }
+
+    // Заменяет узел slot узлом node. node принимается по значению: он может принадлежать
+    // поддереву slot, которое удаляется при замене
+    static void Replace(StatementPtr& slot, StatementPtr node) {
+        slot = std::move(node);
+    }
+
+    // Заменяет узел slot константой, если все его аргументы args - константы
+    // и вычисление узла не выбрасывает исключение
+    void FoldConstants(StatementPtr& slot, initializer_list<const Statement*> args) {
+        for (const Statement* arg : args) {
+            if (!IsConstant(*arg)) {
+                return;
+            }
+        }
+        try {
+            if (auto constant = MakeConstant(Evaluate(*slot))) {
+                Replace(slot, std::move(constant));
+            }
+        } catch (const runtime_error&) {
+            // Ошибка будет выброшена во время выполнения программы
+        }
+    }
+
+    static bool IsConstant(const Statement& node) {
+        return dynamic_cast<const NumericConst*>(&node) || dynamic_cast<const StringConst*>(&node)
+            || dynamic_cast<const BoolConst*>(&node) || dynamic_cast<const None*>(&node);
+    }
+
+    // Вычисляет узел, значение которого не зависит от переменных и вывода
+    static ObjectHolder Evaluate(Statement& node) {
+        runtime::Closure closure;
+        runtime::DummyContext context;
+        return node.Execute(closure, context);
+    }
+
+    // Возвращает узел-константу со значением value либо nullptr,
+    // если значение нельзя записать константой
+    StatementPtr MakeConstant(const ObjectHolder& value) {
+        switch (value.GetKind()) {
+            case runtime::ObjectKind::NONE:
+                return MakeNode<None>();
+            case runtime::ObjectKind::NUMBER:
+                return MakeNode<NumericConst>(*value.TryAs<runtime::Number>());
+            case runtime::ObjectKind::STRING:
+                return MakeNode<StringConst>(*value.TryAs<runtime::String>());
+            case runtime::ObjectKind::BOOL:
+                return MakeNode<BoolConst>(*value.TryAs<runtime::Bool>());
+            default:
+                return nullptr;
+        }
+    }
+
+    template <typename T, typename... Args>
+    StatementPtr MakeNode(Args&&... args) {
+        if (program_) {
+            return program_->MakeNode<T>(std::forward<Args>(args)...);
+        }
+        return make_unique<T>(std::forward<Args>(args)...);
+    }
+
+    Program* program_;
+};
+
+unique_ptr<runtime::Executable> Optimize(unique_ptr<runtime::Executable> tree) {
+    if (auto* program = dynamic_cast<Program*>(tree.get())) {
+        Optimizer{program}.OptimizeProgram(*program);
+        return tree;
+    }
+    StatementPtr root(tree.release());
+    Optimizer{nullptr}.Optimize(root);
+    // Узлы дерева вне ast::Program размещаются в куче, и root владеет корнем
+    return unique_ptr<runtime::Executable>(root.release());
+}
+
+}  // namespace ast
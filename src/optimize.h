@@ -0,0 +1,20 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <memory>
+
+namespace ast {
+
+// Упрощает дерево, построенное parse::ParseProgram, перед выполнением:
+//  - вычисляет операции над константами (числами, строками, логическими значениями и None),
+//    в том числе отрицательные числа, которые парсер представляет умножением на -1;
+//  - заменяет not not x на x там, где значение используется только как условие
+//    (условия if и while, аргументы and, or и not);
+//  - заменяет if с постоянным условием выполняемой веткой, а while с ложным условием - None.
+// Операции, выбрасывающие при вычислении исключение (например, деление на 0),
+// не вычисляются и выбрасывают его во время выполнения программы, как и без оптимизации.
+// Методы классов, объявленных в программе, оптимизируются так же
+std::unique_ptr<runtime::Executable> Optimize(std::unique_ptr<runtime::Executable> tree);
+
+}  // namespace ast
@@ -0,0 +1,66 @@
+#include "bench_runner_p.h"
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+
+#include <string>
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// ---- Свёртка констант ----
+
+constexpr int CALL_DEPTH = 17;
+
+// Метод, выражения которого содержат отрицательные числа и операции над константами
+const string CONSTANT_EXPRESSIONS_PROGRAM = R"(
+class Clock:
+  def seconds(days, n):
+    if not not (n < 2):
+      return days * (60 * 60 * 24) + -1 * (2 + 3) - (-7)
+    if 1 > 2:
+      print 'never'
+    return self.seconds(days, n - 1) + self.seconds(days + 1 * 1, n - 2)
+
+c = Clock()
+print c.seconds(-1, )"s + to_string(CALL_DEPTH) + R"()
+)"s;
+
+// Измеряет время обхода дерева программы с оптимизацией или без неё.
+// Разбор и оптимизация в измерение не входят
+BenchResult BenchConstantExpressions(bool optimize) {
+    istringstream input(CONSTANT_EXPRESSIONS_PROGRAM);
+    parse::Lexer lexer(input);
+    auto tree = parse::ParseProgram(lexer);
+    if (optimize) {
+        tree = Optimize(std::move(tree));
+    }
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    const auto start = chrono::steady_clock::now();
+    tree->Execute(closure, context);
+    const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    DoNotOptimize(context.output.str());
+    return {0, elapsed.count(), "ms execute"s};
+}
+
+BenchResult BenchConstantExpressionsPlain() {
+    return BenchConstantExpressions(false);
+}
+
+BenchResult BenchConstantExpressionsOptimized() {
+    return BenchConstantExpressions(true);
+}
+
+}  // namespace
+
+void RunOptimizeBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, ast::BenchConstantExpressionsPlain);
+    RUN_BENCH(br, ast::BenchConstantExpressionsOptimized);
+}
+
+}  // namespace ast
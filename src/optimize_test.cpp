@@ -0,0 +1,236 @@
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+#include "transform_test_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+unique_ptr<runtime::Executable> ParseAndOptimize(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    return Optimize(parse::ParseProgram(lexer));
+}
+
+// Возвращает инструкции программы верхнего уровня
+const vector<StatementPtr>& GetStatements(const runtime::Executable& program) {
+    const auto& tree = dynamic_cast<const Program&>(program).GetTree();
+    return dynamic_cast<const Compound&>(tree).GetStatements();
+}
+
+// Возвращает выражение, которое присваивает переменной инструкция statement
+const Statement& GetAssignedValue(const StatementPtr& statement) {
+    return dynamic_cast<const Assignment&>(*statement).GetValue();
+}
+
+void TestFoldNumbers() {
+    const auto program = ParseAndOptimize("x = 1 + 2 * 3 - -4 / 2\ny = -5\nz = x + 1\n"s);
+    const auto& statements = GetStatements(*program);
+
+    const auto* x = dynamic_cast<const NumericConst*>(&GetAssignedValue(statements.at(0)));
+    ASSERT(x != nullptr);
+    ASSERT_EQUAL(x->GetValue().GetValue(), 9);
+
+    const auto* y = dynamic_cast<const NumericConst*>(&GetAssignedValue(statements.at(1)));
+    ASSERT(y != nullptr);
+    ASSERT_EQUAL(y->GetValue().GetValue(), -5);
+
+    // Значение переменной неизвестно до выполнения
+    ASSERT(dynamic_cast<const Add*>(&GetAssignedValue(statements.at(2))) != nullptr);
+}
+
+void TestFoldStringsAndBooleans() {
+    const auto program = ParseAndOptimize(
+        "a = 'ab' + 'c'\nb = str(12) + '!'\nc = 1 < 2 and not 'x' == 'y'\nd = None or 0\n"s
+        "e = len('ab' + 'c')\nf = 'bc' in 'a' + 'bc'\n"s);
+    const auto& statements = GetStatements(*program);
+
+    const auto* a = dynamic_cast<const StringConst*>(&GetAssignedValue(statements.at(0)));
+    ASSERT(a != nullptr);
+    ASSERT_EQUAL(a->GetValue().GetValue(), "abc"s);
+
+    const auto* b = dynamic_cast<const StringConst*>(&GetAssignedValue(statements.at(1)));
+    ASSERT(b != nullptr);
+    ASSERT_EQUAL(b->GetValue().GetValue(), "12!"s);
+
+    const auto* c = dynamic_cast<const BoolConst*>(&GetAssignedValue(statements.at(2)));
+    ASSERT(c != nullptr);
+    ASSERT(c->GetValue().GetValue());
+
+    const auto* d = dynamic_cast<const BoolConst*>(&GetAssignedValue(statements.at(3)));
+    ASSERT(d != nullptr);
+    ASSERT(!d->GetValue().GetValue());
+
+    const auto* e = dynamic_cast<const NumericConst*>(&GetAssignedValue(statements.at(4)));
+    ASSERT(e != nullptr);
+    ASSERT_EQUAL(e->GetValue().GetValue(), 3);
+
+    const auto* f = dynamic_cast<const BoolConst*>(&GetAssignedValue(statements.at(5)));
+    ASSERT(f != nullptr);
+    ASSERT(f->GetValue().GetValue());
+}
+
+void TestKeepRuntimeErrors() {
+    const auto program = ParseAndOptimize("x = 1\nprint x\ny = 1 / 0\n"s);
+    ASSERT(dynamic_cast<const Div*>(&GetAssignedValue(GetStatements(*program).at(2))) != nullptr);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ASSERT_THROWS(program->Execute(closure, context), runtime_error);
+    ASSERT_EQUAL(context.output.str(), "1\n"s);
+
+    ASSERT_THROWS(ParseAndOptimize("print 1 + 'a'\n"s)->Execute(closure, context), runtime_error);
+    ASSERT_THROWS(ParseAndOptimize("print -'a'\n"s)->Execute(closure, context), runtime_error);
+    ASSERT_THROWS(ParseAndOptimize("print 1 < None\n"s)->Execute(closure, context),
+                  runtime_error);
+}
+
+void TestDoubleNegationInConditions() {
+    const auto program = ParseAndOptimize(R"(
+x = 5
+if not not x:
+  print not not x
+y = not not not x or x
+)"s);
+    const auto& statements = GetStatements(*program);
+
+    const auto& if_else = dynamic_cast<const IfElse&>(*statements.at(1));
+    ASSERT(dynamic_cast<const VariableValue*>(&if_else.GetCondition()) != nullptr);
+
+    // Вне условия not not x возвращает True, а не значение x
+    const auto& body = dynamic_cast<const Compound&>(if_else.GetIfBody());
+    const auto& print = dynamic_cast<const Print&>(*body.GetStatements().at(0));
+    const auto& outer = dynamic_cast<const Not&>(*print.GetArgs().at(0));
+    ASSERT(dynamic_cast<const Not*>(&outer.GetArgument()) != nullptr);
+
+    const auto& or_op = dynamic_cast<const Or&>(GetAssignedValue(statements.at(2)));
+    const auto& not_op = dynamic_cast<const Not&>(or_op.GetLhs());
+    ASSERT(dynamic_cast<const VariableValue*>(&not_op.GetArgument()) != nullptr);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "True\n"s);
+}
+
+void TestPruneConstantBranches() {
+    const auto program = ParseAndOptimize(R"(
+if 1 > 2:
+  print 'a'
+else:
+  print 'b'
+if not None:
+  print 'c'
+if 0:
+  print 'd'
+)"s);
+    const auto& statements = GetStatements(*program);
+    ASSERT_EQUAL(statements.size(), 3U);
+    ASSERT(dynamic_cast<const Compound*>(statements.at(0).get()) != nullptr);
+    ASSERT(dynamic_cast<const Compound*>(statements.at(1).get()) != nullptr);
+    ASSERT(dynamic_cast<const None*>(statements.at(2).get()) != nullptr);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "b\nc\n"s);
+}
+
+void TestPruneFalseLoops() {
+    const auto program = ParseAndOptimize(R"(
+while 1 > 2:
+  print 'a'
+for i in range(2 * 2):
+  print i + 1 * 10
+)"s);
+    const auto& statements = GetStatements(*program);
+    ASSERT_EQUAL(statements.size(), 2U);
+    ASSERT(dynamic_cast<const None*>(statements.at(0).get()) != nullptr);
+    const auto& for_range = dynamic_cast<const ForRange&>(*statements.at(1));
+    ASSERT(dynamic_cast<const NumericConst*>(&for_range.GetStop()) != nullptr);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "10\n11\n12\n13\n"s);
+}
+
+void TestOptimizeMethodBodies() {
+    const auto program = ParseAndOptimize(R"(
+class Circle:
+  def area(r):
+    if True:
+      return r * r * (314 / 100)
+)"s);
+    const auto& cls_def = dynamic_cast<const ClassDefinition&>(*GetStatements(*program).at(0));
+    const auto& method = cls_def.GetClass().TryAs<runtime::Class>()->GetMethods().at(0);
+    const auto& body = dynamic_cast<const Compound&>(
+        dynamic_cast<const MethodBody&>(*method.body).GetBody());
+    // Ветка if подставлена вместо условия, а 314 / 100 вычислено
+    const auto& branch = dynamic_cast<const Compound&>(*body.GetStatements().at(0));
+    const auto& ret = dynamic_cast<const Return&>(*branch.GetStatements().at(0));
+    const auto& mult = dynamic_cast<const Mult&>(ret.GetStatement());
+    const auto* factor = dynamic_cast<const NumericConst*>(&mult.GetRhs());
+    ASSERT(factor != nullptr);
+    ASSERT_EQUAL(factor->GetValue().GetValue(), 3);
+}
+
+void TestOptimizeHeapTree() {
+    // Дерево, построенное вне парсера, размещено в куче
+    auto tree = Optimize(make_unique<IfElse>(
+        make_unique<BoolConst>(runtime::Bool(true)),
+        make_unique<Print>(make_unique<Add>(make_unique<NumericConst>(2),
+                                            make_unique<NumericConst>(3))),
+        nullptr));
+    const auto* print = dynamic_cast<const Print*>(tree.get());
+    ASSERT(print != nullptr);
+    ASSERT(dynamic_cast<const NumericConst*>(print->GetArgs().at(0).get()) != nullptr);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "5\n"s);
+}
+
+void TestSameOutput() {
+    const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x + 0 * 1
+    self.y = y - -1
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+p = Point(2 * 3, -4)
+print p, str(1 + 2) + 'x', 'a' < 'b', not not 0, 7 / 2, -(-3)
+if not not p.x and 1 == 1:
+  print 'yes', None or False, True and 'x'
+else:
+  print 'no'
+)"s;
+    const auto [plain_output, optimized_output] = RunBeforeAndAfter(Optimize, program);
+    ASSERT_EQUAL(optimized_output, "(6, -3) 3x True False 3 3\nyes False True\n"s);
+    ASSERT_EQUAL(optimized_output, plain_output);
+}
+
+}  // namespace
+
+void RunOptimizeTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestFoldNumbers);
+    RUN_TEST(tr, ast::TestFoldStringsAndBooleans);
+    RUN_TEST(tr, ast::TestKeepRuntimeErrors);
+    RUN_TEST(tr, ast::TestDoubleNegationInConditions);
+    RUN_TEST(tr, ast::TestPruneConstantBranches);
+    RUN_TEST(tr, ast::TestPruneFalseLoops);
+    RUN_TEST(tr, ast::TestOptimizeMethodBodies);
+    RUN_TEST(tr, ast::TestOptimizeHeapTree);
+    RUN_TEST(tr, ast::TestSameOutput);
+}
+
+}  // namespace ast
@@ -0,0 +1,103 @@
+#include "output_buffer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+// Наибольшая длина десятичной записи int
+constexpr size_t MAX_NUMBER_LENGTH = 11;
+// Наименьший размер буфера
+constexpr size_t MIN_BUFFER_SIZE = 16;
+}  // namespace
+
+OutputBuffer::OutputBuffer(std::ostream& output, OutputOptions options)
+    : output_(output)
+    , policy_(options.policy)
+    , buffer_(std::max(options.buffer_size, MIN_BUFFER_SIZE))
+    {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+OutputBuffer::~OutputBuffer() {
+    Flush();
+}
+
+void OutputBuffer::WriteNumber(int value) {
+    Reserve(MAX_NUMBER_LENGTH);
+    const auto result = to_chars(pptr(), epptr(), value);
+    pbump(static_cast<int>(result.ptr - pptr()));
+}
+
+void OutputBuffer::EndLine() {
+    sputc('\n');
+    if (policy_ == FlushPolicy::LINE) {
+        Flush();
+    }
+}
+
+void OutputBuffer::Flush() {
+    Drain();
+    output_.flush();
+}
+
+FlushPolicy OutputBuffer::GetPolicy() const {
+    return policy_;
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    Reserve(1);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize OutputBuffer::xsputn(const char* s, std::streamsize count) {
+    const auto size = static_cast<size_t>(count);
+    if (size > static_cast<size_t>(epptr() - pptr())
+        && policy_ != FlushPolicy::EXIT && size >= buffer_.size()) {
+        // Блок не меньше буфера передаётся в поток без копирования
+        Flush();
+        output_.write(s, count);
+        return count;
+    }
+    Reserve(size);
+    memcpy(pptr(), s, size);
+    pbump(static_cast<int>(size));
+    return count;
+}
+
+int OutputBuffer::sync() {
+    Flush();
+    return output_ ? 0 : -1;
+}
+
+void OutputBuffer::Drain() {
+    if (pptr() != pbase()) {
+        output_.write(pbase(), pptr() - pbase());
+    }
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+void OutputBuffer::Reserve(size_t count) {
+    if (static_cast<size_t>(epptr() - pptr()) >= count) {
+        return;
+    }
+    if (policy_ != FlushPolicy::EXIT) {
+        Flush();
+        return;
+    }
+    const size_t used = pptr() - pbase();
+    buffer_.resize(std::max(buffer_.size() * 2, used + count));
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    pbump(static_cast<int>(used));
+}
+
+}  // namespace runtime
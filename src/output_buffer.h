@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace runtime {
+
+// Момент, в который накопленный вывод передаётся в выходной поток
+enum class FlushPolicy : std::uint8_t {
+    LINE,       // после каждой строки, для интерактивной работы
+    THRESHOLD,  // при заполнении буфера
+    EXIT,       // только при явном сбросе или разрушении буфера; буфер растёт по мере надобности
+};
+
+// Параметры буферизации вывода
+struct OutputOptions {
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    FlushPolicy policy = FlushPolicy::THRESHOLD;
+    size_t buffer_size = DEFAULT_BUFFER_SIZE;
+};
+
+// Буфер вывода команд print.
+// Накапливает символы и передаёт их в output крупными блоками согласно политике сброса.
+// Оставшиеся в буфере данные передаются в output при разрушении буфера
+class OutputBuffer : public std::streambuf {
+public:
+    explicit OutputBuffer(std::ostream& output, OutputOptions options = {});
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer() override;
+
+    // Записывает десятичное представление value непосредственно в буфер
+    void WriteNumber(int value);
+
+    // Завершает строку. При политике LINE сбрасывает буфер
+    void EndLine();
+
+    // Передаёт содержимое буфера в выходной поток и сбрасывает его
+    void Flush();
+
+    [[nodiscard]] FlushPolicy GetPolicy() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize count) override;
+    int sync() override;
+
+private:
+    // Передаёт содержимое буфера в выходной поток, не сбрасывая сам поток
+    void Drain();
+    // Освобождает в буфере место как минимум под count символов
+    void Reserve(size_t count);
+
+    std::ostream& output_;
+    FlushPolicy policy_;
+    std::vector<char> buffer_;
+};
+
+}  // namespace runtime
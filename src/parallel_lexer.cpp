@@ -0,0 +1,120 @@
+#include "parallel_lexer.h"
+
+#include "char_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// Число частей на поток. Потоки, закончившие раньше, забирают оставшиеся части
+constexpr size_t PARTS_PER_THREAD = 4;
+
+// Возвращает true, если строка, начинающаяся с символа c, не имеет отступа и содержит токены.
+// Перед такой строкой последовательный лексер закрывает все отступы, поэтому с неё
+// можно начать чтение заново
+bool IsTopLevelLineStart(char c) {
+    return c != ' ' && c != '\n' && c != '#';
+}
+
+// Читает все токены части текста part, начинающейся со смещения offset.
+// Положения токенов отсчитываются от начала всего текста
+TokenList LexPart(string_view part, size_t offset) {
+    Lexer lexer(part);
+    TokenList result;
+    for (Token token = lexer.CurrentToken();; token = lexer.NextToken()) {
+        token.SetPosition(offset + token.GetOffset(), token.GetLength());
+        result.tokens.push_back(token);
+        if (token.Is<token_type::Eof>()) {
+            result.literals = lexer.TakeStringLiterals();
+            return result;
+        }
+    }
+}
+
+}  // namespace
+
+vector<string_view> SplitAtTopLevel(string_view source, size_t part_count, size_t min_part_size) {
+    const size_t part_size = max({source.size() / max<size_t>(part_count, 1), min_part_size,
+                                  size_t{1}});
+    const char* const end = source.data() + source.size();
+    vector<string_view> parts;
+    size_t begin = 0;
+    while (source.size() - begin > part_size) {
+        // Часть заканчивается перед первой строкой без отступа, начинающейся
+        // не ближе part_size символов от начала части
+        const char* line = source.data() + begin + part_size - 1;
+        while (true) {
+            line = scan::FindNewline(line, end);
+            if (line == end || ++line == end || IsTopLevelLineStart(*line)) {
+                break;
+            }
+        }
+        const size_t part_end = line - source.data();
+        parts.push_back(source.substr(begin, part_end - begin));
+        begin = part_end;
+    }
+    if (begin < source.size()) {
+        parts.push_back(source.substr(begin));
+    }
+    return parts;
+}
+
+TokenList LexParallel(string_view source, size_t thread_count, size_t min_part_size) {
+    const vector<string_view> parts
+        = SplitAtTopLevel(source, thread_count * PARTS_PER_THREAD, min_part_size);
+    if (thread_count <= 1 || parts.size() <= 1) {
+        return LexPart(source, 0);
+    }
+
+    vector<TokenList> part_tokens(parts.size());
+    atomic<size_t> next_part = 0;
+    atomic<bool> failed = false;
+    const auto lex_parts = [&] {
+        for (size_t i = next_part++; i < parts.size() && !failed; i = next_part++) {
+            try {
+                part_tokens[i] = LexPart(parts[i], parts[i].data() - source.data());
+            } catch (...) {
+                failed = true;
+            }
+        }
+    };
+    vector<thread> threads;
+    for (size_t i = 1; i < min(thread_count, parts.size()); ++i) {
+        threads.emplace_back(lex_parts);
+    }
+    lex_parts();
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    // Строковая константа может содержать перевод строки, и тогда часть текста заканчивается
+    // внутри неё, а чтение части - ошибкой. Последовательное чтение либо прочитает такую
+    // константу, либо выбросит ту же ошибку, что и Lexer(source)
+    if (failed) {
+        return LexPart(source, 0);
+    }
+
+    // Каждая часть, кроме последней, заканчивается переводом строки, поэтому её токены
+    // завершаются Newline и закрывающими Dedent - как перед строкой без отступа
+    // при последовательном чтении. Остаётся убрать Eof частей
+    size_t token_count = 0;
+    for (const TokenList& part : part_tokens) {
+        token_count += part.tokens.size() - 1;
+    }
+    TokenList result;
+    result.tokens.reserve(token_count + 1);
+    for (TokenList& part : part_tokens) {
+        result.tokens.insert(result.tokens.end(), part.tokens.begin(), part.tokens.end() - 1);
+        result.literals.Append(std::move(part.literals));
+    }
+    result.tokens.push_back(part_tokens.back().tokens.back());
+    return result;
+}
+
+}  // namespace parse
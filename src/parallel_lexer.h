@@ -0,0 +1,27 @@
+#pragma once
+
+#include "lexer.h"
+
+#include <string_view>
+#include <vector>
+
+namespace parse {
+
+// Наименьший размер части текста, которую читает отдельный поток
+constexpr size_t DEFAULT_MIN_PART_SIZE = 64 * 1024;
+
+// Делит source на части не короче min_part_size символов (кроме последней), стараясь
+// получить part_count частей. Каждая часть, кроме первой, начинается со строки без отступа,
+// содержащей токены. Части следуют подряд и вместе составляют source
+std::vector<std::string_view> SplitAtTopLevel(std::string_view source, size_t part_count,
+                                              size_t min_part_size = DEFAULT_MIN_PART_SIZE);
+
+// Читает все токены текста source, включая завершающий token_type::Eof, в thread_count потоках.
+// Части, полученные SplitAtTopLevel, читаются независимо, а их токены склеиваются.
+// Результат, включая положения токенов и выбрасываемые ошибки, совпадает
+// с последовательным чтением Lexer(source). Токены ссылаются на source и на хранилище
+// literals результата
+TokenList LexParallel(std::string_view source, size_t thread_count,
+                    size_t min_part_size = DEFAULT_MIN_PART_SIZE);
+
+}  // namespace parse
@@ -9,8 +9,8 @@ namespace TokenType = parse::token_type;
 
 namespace {
 bool operator==(const parse::Token& token, char c) {
-    const auto* p = token.TryAs<TokenType::Char>();
-    return p != nullptr && p->value == c;
+    const auto p = token.TryAs<TokenType::Char>();
+    return p && p->value == c;
 }
 
 bool operator!=(const parse::Token& token, char c) {
@@ -19,14 +19,16 @@ bool operator!=(const parse::Token& token, char c) {
 
 class Parser {
 public:
-    explicit Parser(parse::Lexer& lexer)
-        : lexer_(lexer) {
+    // Узлы дерева создаются в арене program
+    Parser(parse::Lexer& lexer, ast::Program& program)
+        : lexer_(lexer)
+        , program_(program) {
     }
 
     // Program -> eps
     //          | Statement \n Program
-    unique_ptr<ast::Statement> ParseProgram() {
-        auto result = make_unique<ast::Compound>();
+    ast::StatementPtr ParseProgram() {
+        auto result = program_.MakeNode<ast::Compound>();
         while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
             result->AddStatement(ParseStatement());
         }
@@ -36,14 +38,14 @@ public:
 
 private:
     // Suite -> NEWLINE INDENT (Statement)+ DEDENT
-    unique_ptr<ast::Statement> ParseSuite()  // NOLINT
+    ast::StatementPtr ParseSuite()  // NOLINT
     {
         lexer_.Expect<TokenType::Newline>();
         lexer_.ExpectNext<TokenType::Indent>();
 
         lexer_.NextToken();
 
-        auto result = make_unique<ast::Compound>();
+        auto result = program_.MakeNode<ast::Compound>();
         while (!lexer_.CurrentToken().Is<TokenType::Dedent>()) {
             result->AddStatement(ParseStatement());  // NOLINT
         }
@@ -76,7 +78,9 @@ private:
             lexer_.ExpectNext<TokenType::Char>(':');
             lexer_.NextToken();
 
-            m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+            auto body = program_.MakeNode<ast::MethodBody>(ParseSuite());  // NOLINT
+            body->MarkTailCalls(m.name, m.formal_params.size());
+            m.body = std::move(body);
 
             result.push_back(std::move(m));
         }
@@ -84,21 +88,22 @@ private:
     }
 
     // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
-    unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
+    ast::StatementPtr ParseClassDefinition()  // NOLINT
     {
-        string class_name = lexer_.Expect<TokenType::Id>().value;
+        const runtime::Symbol class_name = lexer_.Expect<TokenType::Id>().value;
 
         lexer_.NextToken();
 
         const runtime::Class* base_class = nullptr;
         if (lexer_.CurrentToken() == '(') {
-            auto name = lexer_.ExpectNext<TokenType::Id>().value;
+            const runtime::Symbol name = lexer_.ExpectNext<TokenType::Id>().value;
             lexer_.ExpectNext<TokenType::Char>(')');
             lexer_.NextToken();
 
             auto it = declared_classes_.find(name);
             if (it == declared_classes_.end()) {
-                throw parse::ParseError("Base class "s + name + " not found for class "s + class_name);
+                throw parse::ParseError("Base class "s + name.GetName() + " not found for class "s
+                                        + class_name.GetName());
             }
             base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
         }
@@ -114,18 +119,19 @@ private:
 
         auto [it, inserted] = declared_classes_.insert({
             class_name,
-            runtime::ObjectHolder::Own(runtime::Class(class_name, std::move(methods), base_class)),
+            runtime::ObjectHolder::Own(
+                runtime::Class(class_name.GetName(), std::move(methods), base_class)),
         });
 
         if (!inserted) {
-            throw parse::ParseError("Class "s + class_name + " already exists"s);
+            throw parse::ParseError("Class "s + class_name.GetName() + " already exists"s);
         }
 
-        return make_unique<ast::ClassDefinition>(it->second);
+        return program_.MakeNode<ast::ClassDefinition>(it->second);
     }
 
-    vector<string> ParseDottedIds() {
-        vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+    vector<runtime::Symbol> ParseDottedIds() {
+        vector<runtime::Symbol> result(1, lexer_.Expect<TokenType::Id>().value);
 
         while (lexer_.NextToken() == '.') {
             result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
@@ -135,161 +141,218 @@ private:
     }
 
     //  AssgnOrCall -> DottedIds = Expr
+    //               | DottedIds ('[' Expr ']')+ = Expr
     //               | DottedIds '(' ExprList ')'
-    unique_ptr<ast::Statement> ParseAssignmentOrCall() {
+    ast::StatementPtr ParseAssignmentOrCall() {
         lexer_.Expect<TokenType::Id>();
 
-        vector<string> id_list = ParseDottedIds();
-        string last_name = id_list.back();
+        vector<runtime::Symbol> id_list = ParseDottedIds();
+        if (lexer_.CurrentToken() == '[') {
+            return ParseIndexAssignment(std::move(id_list));
+        }
+        const runtime::Symbol last_name = id_list.back();
         id_list.pop_back();
 
         if (lexer_.CurrentToken() == '=') {
             lexer_.NextToken();
 
             if (id_list.empty()) {
-                return make_unique<ast::Assignment>(std::move(last_name), ParseTest());
+                return program_.MakeNode<ast::Assignment>(last_name, ParseTest());
             }
-            return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)},
-                                                     std::move(last_name), ParseTest());
+            return program_.MakeNode<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)},
+                                                     last_name, ParseTest());
         }
         lexer_.Expect<TokenType::Char>('(');
         lexer_.NextToken();
 
         if (id_list.empty()) {
-            throw parse::ParseError("Mython doesn't support functions, only methods: "s + last_name);
+            throw parse::ParseError("Mython doesn't support functions, only methods: "s
+                                    + last_name.GetName());
         }
 
-        vector<unique_ptr<ast::Statement>> args;
+        vector<ast::StatementPtr> args;
         if (lexer_.CurrentToken() != ')') {
             args = ParseTestList();
         }
         lexer_.Expect<TokenType::Char>(')');
         lexer_.NextToken();
 
-        return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)),
+        return program_.MakeNode<ast::MethodCall>(program_.MakeNode<ast::VariableValue>(std::move(id_list)),
                                             std::move(last_name), std::move(args));
     }
 
+    // Присваивание элементу списка: все индексы, кроме последнего, вычисляют список
+    ast::StatementPtr ParseIndexAssignment(vector<runtime::Symbol> id_list) {
+        ast::StatementPtr object = program_.MakeNode<ast::VariableValue>(std::move(id_list));
+        ast::StatementPtr index = ParseSubscript();
+        while (lexer_.CurrentToken() == '[') {
+            object = program_.MakeNode<ast::Index>(std::move(object), std::move(index));
+            index = ParseSubscript();
+        }
+        lexer_.Expect<TokenType::Char>('=');
+        lexer_.NextToken();
+        return program_.MakeNode<ast::IndexAssignment>(std::move(object), std::move(index),
+                                                       ParseTest());
+    }
+
+    // Subscript -> '[' Expr ']'
+    ast::StatementPtr ParseSubscript() {
+        lexer_.Expect<TokenType::Char>('[');
+        lexer_.NextToken();
+        auto result = ParseTest();
+        lexer_.Expect<TokenType::Char>(']');
+        lexer_.NextToken();
+        return result;
+    }
+
+    // Применяет к выражению object следующие за ним индексы: object[i][j]...
+    ast::StatementPtr ParseSubscripts(ast::StatementPtr object) {
+        while (lexer_.CurrentToken() == '[') {
+            object = program_.MakeNode<ast::Index>(std::move(object), ParseSubscript());
+        }
+        return object;
+    }
+
     // Expr -> Adder ['+'/'-' Adder]*
-    unique_ptr<ast::Statement> ParseExpression()  // NOLINT
+    ast::StatementPtr ParseExpression()  // NOLINT
     {
-        unique_ptr<ast::Statement> result = ParseAdder();
+        ast::StatementPtr result = ParseAdder();
         while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-') {
             char op = lexer_.CurrentToken().As<TokenType::Char>().value;
             lexer_.NextToken();
 
             if (op == '+') {
-                result = make_unique<ast::Add>(std::move(result), ParseAdder());
+                result = program_.MakeNode<ast::Add>(std::move(result), ParseAdder());
             } else {
-                result = make_unique<ast::Sub>(std::move(result), ParseAdder());
+                result = program_.MakeNode<ast::Sub>(std::move(result), ParseAdder());
             }
         }
         return result;
     }
 
     // Adder -> Mult ['*'/'/' Mult]*
-    unique_ptr<ast::Statement> ParseAdder()  // NOLINT
+    ast::StatementPtr ParseAdder()  // NOLINT
     {
-        unique_ptr<ast::Statement> result = ParseMult();
+        ast::StatementPtr result = ParseMult();
         while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/') {
             char op = lexer_.CurrentToken().As<TokenType::Char>().value;
             lexer_.NextToken();
 
             if (op == '*') {
-                result = make_unique<ast::Mult>(std::move(result), ParseMult());
+                result = program_.MakeNode<ast::Mult>(std::move(result), ParseMult());
             } else {
-                result = make_unique<ast::Div>(std::move(result), ParseMult());
+                result = program_.MakeNode<ast::Div>(std::move(result), ParseMult());
             }
         }
         return result;
     }
 
-    // Mult -> '(' Expr ')'
+    // Mult -> '(' Expr ')' Subscript*
+    //       | '[' [ExprList] ']' Subscript*
+    //       | DictLiteral Subscript*
     //       | NUMBER
     //       | '-' Mult
     //       | STRING
     //       | NONE
     //       | TRUE
     //       | FALSE
-    //       | DottedIds '(' ExprList ')'
-    //       | DottedIds
-    unique_ptr<ast::Statement> ParseMult()  // NOLINT
+    //       | DottedIds '(' ExprList ')' Subscript*
+    //       | DottedIds Subscript*
+    ast::StatementPtr ParseMult()  // NOLINT
     {
         if (lexer_.CurrentToken() == '(') {
             lexer_.NextToken();
             auto result = ParseTest();
             lexer_.Expect<TokenType::Char>(')');
             lexer_.NextToken();
-            return result;
+            return ParseSubscripts(std::move(result));
+        }
+        if (lexer_.CurrentToken() == '[') {
+            vector<ast::StatementPtr> items;
+            if (lexer_.NextToken() != ']') {
+                items = ParseTestList();
+            }
+            lexer_.Expect<TokenType::Char>(']');
+            lexer_.NextToken();
+            return ParseSubscripts(program_.MakeNode<ast::ListLiteral>(std::move(items)));
+        }
+        if (lexer_.CurrentToken() == '{') {
+            return ParseSubscripts(ParseDictLiteral());
         }
         if (lexer_.CurrentToken() == '-') {
             lexer_.NextToken();
-            return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
+            return program_.MakeNode<ast::Mult>(ParseMult(), program_.MakeNode<ast::NumericConst>(-1));
         }
-        if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+        if (const auto num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
             int result = num->value;
             lexer_.NextToken();
-            return make_unique<ast::NumericConst>(result);
+            return program_.MakeNode<ast::NumericConst>(result);
         }
-        if (const auto* str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
-            string result = str->value;
+        if (const auto str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
+            string result(str->value);
             lexer_.NextToken();
-            return make_unique<ast::StringConst>(std::move(result));
+            return program_.MakeNode<ast::StringConst>(std::move(result));
         }
         if (lexer_.CurrentToken().Is<TokenType::True>()) {
             lexer_.NextToken();
-            return make_unique<ast::BoolConst>(runtime::Bool(true));
+            return program_.MakeNode<ast::BoolConst>(runtime::Bool(true));
         }
         if (lexer_.CurrentToken().Is<TokenType::False>()) {
             lexer_.NextToken();
-            return make_unique<ast::BoolConst>(runtime::Bool(false));
+            return program_.MakeNode<ast::BoolConst>(runtime::Bool(false));
         }
         if (lexer_.CurrentToken().Is<TokenType::None>()) {
             lexer_.NextToken();
-            return make_unique<ast::None>();
+            return program_.MakeNode<ast::None>();
         }
 
-        return ParseDottedIdsInMultExpr();
+        return ParseSubscripts(ParseDottedIdsInMultExpr());
     }
 
-    std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
-        vector<string> names = ParseDottedIds();
+    ast::StatementPtr ParseDottedIdsInMultExpr() {
+        vector<runtime::Symbol> names = ParseDottedIds();
 
         if (lexer_.CurrentToken() == '(') {
             // various calls
-            vector<unique_ptr<ast::Statement>> args;
+            vector<ast::StatementPtr> args;
             if (lexer_.NextToken() != ')') {
                 args = ParseTestList();
             }
             lexer_.Expect<TokenType::Char>(')');
             lexer_.NextToken();
 
-            auto method_name = names.back();
+            const runtime::Symbol method_name = names.back();
             names.pop_back();
 
             if (!names.empty()) {
-                return make_unique<ast::MethodCall>(
-                    make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
+                return program_.MakeNode<ast::MethodCall>(
+                    program_.MakeNode<ast::VariableValue>(std::move(names)), method_name,
                     std::move(args));
             }
             if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
-                return make_unique<ast::NewInstance>(
+                return program_.MakeNode<ast::NewInstance>(
                     static_cast<const runtime::Class&>(*it->second), std::move(args));  // NOLINT
             }
             if (method_name == "str"sv) {
                 if (args.size() != 1) {
                     throw parse::ParseError("Function str takes exactly one argument"s);
                 }
-                return make_unique<ast::Stringify>(std::move(args.front()));
+                return program_.MakeNode<ast::Stringify>(std::move(args.front()));
             }
-            throw parse::ParseError("Unknown call to "s + method_name + "()"s);
+            if (method_name == "len"sv) {
+                if (args.size() != 1) {
+                    throw parse::ParseError("Function len takes exactly one argument"s);
+                }
+                return program_.MakeNode<ast::Len>(std::move(args.front()));
+            }
+            throw parse::ParseError("Unknown call to "s + method_name.GetName() + "()"s);
         }
-        return make_unique<ast::VariableValue>(std::move(names));
+        return program_.MakeNode<ast::VariableValue>(std::move(names));
     }
 
-    vector<unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
+    vector<ast::StatementPtr> ParseTestList()  // NOLINT
     {
-        vector<unique_ptr<ast::Statement>> result;
+        vector<ast::StatementPtr> result;
         result.push_back(ParseTest());
 
         while (lexer_.CurrentToken() == ',') {
@@ -299,8 +362,32 @@ private:
         return result;
     }
 
+    // DictLiteral -> '{' [Expr ':' Expr (',' Expr ':' Expr)*] '}'
+    ast::StatementPtr ParseDictLiteral()  // NOLINT
+    {
+        lexer_.Expect<TokenType::Char>('{');
+        vector<ast::StatementPtr> items;
+        if (lexer_.NextToken() != '}') {
+            items.push_back(ParseTest());
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+            items.push_back(ParseTest());
+
+            while (lexer_.CurrentToken() == ',') {
+                lexer_.NextToken();
+                items.push_back(ParseTest());
+                lexer_.Expect<TokenType::Char>(':');
+                lexer_.NextToken();
+                items.push_back(ParseTest());
+            }
+        }
+        lexer_.Expect<TokenType::Char>('}');
+        lexer_.NextToken();
+        return program_.MakeNode<ast::DictLiteral>(std::move(items));
+    }
+
     // Condition -> if LogicalExpr: Suite [else: Suite]
-    unique_ptr<ast::Statement> ParseCondition()  // NOLINT
+    ast::StatementPtr ParseCondition()  // NOLINT
     {
         lexer_.Expect<TokenType::If>();
         lexer_.NextToken();
@@ -312,52 +399,105 @@ private:
 
         auto if_body = ParseSuite();
 
-        unique_ptr<ast::Statement> else_body;
+        ast::StatementPtr else_body;
         if (lexer_.CurrentToken().Is<TokenType::Else>()) {
             lexer_.ExpectNext<TokenType::Char>(':');
             lexer_.NextToken();
             else_body = ParseSuite();
         }
 
-        return make_unique<ast::IfElse>(std::move(condition), std::move(if_body),
+        return program_.MakeNode<ast::IfElse>(std::move(condition), std::move(if_body),
                                         std::move(else_body));
     }
 
+    // Loop -> while LogicalExpr: Suite
+    ast::StatementPtr ParseWhile()  // NOLINT
+    {
+        lexer_.Expect<TokenType::While>();
+        lexer_.NextToken();
+
+        auto condition = ParseTest();
+
+        lexer_.Expect<TokenType::Char>(':');
+        lexer_.NextToken();
+
+        return program_.MakeNode<ast::While>(std::move(condition), ParseSuite());
+    }
+
+    // Loop -> for Id in range '(' Expr [',' Expr [',' Expr]] ')': Suite
+    //       | for Id in Expr: Suite
+    ast::StatementPtr ParseFor()  // NOLINT
+    {
+        const runtime::Symbol var_name = lexer_.ExpectNext<TokenType::Id>().value;
+        lexer_.ExpectNext<TokenType::In>();
+        const auto id = lexer_.NextToken().TryAs<TokenType::Id>();
+        if (!id || id->value != runtime::Symbol("range"sv)) {
+            auto iterable = ParseTest();
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+            return program_.MakeNode<ast::ForEach>(var_name, std::move(iterable), ParseSuite());
+        }
+        lexer_.ExpectNext<TokenType::Char>('(');
+        lexer_.NextToken();
+
+        vector<ast::StatementPtr> args;
+        if (lexer_.CurrentToken() != ')') {
+            args = ParseTestList();
+        }
+        lexer_.Expect<TokenType::Char>(')');
+        if (args.empty() || args.size() > 3) {
+            throw parse::ParseError("Function range takes from one to three arguments"s);
+        }
+        lexer_.ExpectNext<TokenType::Char>(':');
+        lexer_.NextToken();
+
+        ast::StatementPtr start;
+        if (args.size() > 1) {
+            start = std::move(args.front());
+            args.erase(args.begin());
+        }
+        ast::StatementPtr stop = std::move(args.front());
+        ast::StatementPtr step = args.size() > 1 ? std::move(args.back()) : nullptr;
+        return program_.MakeNode<ast::ForRange>(var_name, std::move(start), std::move(stop),
+                                                std::move(step), ParseSuite());
+    }
+
     // LogicalExpr -> AndTest [OR AndTest]
     // AndTest -> NotTest [AND NotTest]
     // NotTest -> [NOT] NotTest
     //          | Comparison
-    unique_ptr<ast::Statement> ParseTest()  // NOLINT
+    ast::StatementPtr ParseTest()  // NOLINT
     {
         auto result = ParseAndTest();
         while (lexer_.CurrentToken().Is<TokenType::Or>()) {
             lexer_.NextToken();
-            result = make_unique<ast::Or>(std::move(result), ParseAndTest());
+            result = program_.MakeNode<ast::Or>(std::move(result), ParseAndTest());
         }
         return result;
     }
 
-    unique_ptr<ast::Statement> ParseAndTest()  // NOLINT
+    ast::StatementPtr ParseAndTest()  // NOLINT
     {
         auto result = ParseNotTest();
         while (lexer_.CurrentToken().Is<TokenType::And>()) {
             lexer_.NextToken();
-            result = make_unique<ast::And>(std::move(result), ParseNotTest());
+            result = program_.MakeNode<ast::And>(std::move(result), ParseNotTest());
         }
         return result;
     }
 
-    unique_ptr<ast::Statement> ParseNotTest()  // NOLINT
+    ast::StatementPtr ParseNotTest()  // NOLINT
     {
         if (lexer_.CurrentToken().Is<TokenType::Not>()) {
             lexer_.NextToken();
-            return make_unique<ast::Not>(ParseNotTest());  // NOLINT
+            return program_.MakeNode<ast::Not>(ParseNotTest());  // NOLINT
         }
         return ParseComparison();
     }
 
     // Comparison -> Expr [COMP_OP Expr]
-    unique_ptr<ast::Statement> ParseComparison()  // NOLINT
+    // COMP_OP -> '<' | '>' | '==' | '!=' | '<=' | '>=' | in
+    ast::StatementPtr ParseComparison()  // NOLINT
     {
         auto result = ParseExpression();
 
@@ -365,32 +505,37 @@ private:
 
         if (tok == '<') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Less, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::Less, std::move(result),
                                                 ParseExpression());
         }
         if (tok == '>') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::Greater, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::Eq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::Equal, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::NotEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::NotEqual, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::LessOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::LessOrEqual, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::GreaterOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
+            return program_.MakeNode<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
+                                                ParseExpression());
+        }
+        if (tok.Is<TokenType::In>()) {
+            lexer_.NextToken();
+            return program_.MakeNode<ast::Comparison>(runtime::Contains, std::move(result),
                                                 ParseExpression());
         }
         return result;
@@ -399,7 +544,8 @@ private:
     // Statement -> SimpleStatement Newline
     //           | class ClassDefinition
     //           | if Condition
-    unique_ptr<ast::Statement> ParseStatement()  // NOLINT
+    //           | Loop
+    ast::StatementPtr ParseStatement()  // NOLINT
     {
         const auto& tok = lexer_.CurrentToken();
 
@@ -410,6 +556,12 @@ private:
         if (tok.Is<TokenType::If>()) {
             return ParseCondition();
         }
+        if (tok.Is<TokenType::While>()) {
+            return ParseWhile();
+        }
+        if (tok.Is<TokenType::For>()) {
+            return ParseFor();
+        }
         auto result = ParseSimpleStatement();
         lexer_.Expect<TokenType::Newline>();
         lexer_.NextToken();
@@ -419,30 +571,33 @@ private:
     // StatementBody -> return Expression
     //               | print ExpressionList
     //               | AssignmentOrCall
-    unique_ptr<ast::Statement> ParseSimpleStatement() {
+    ast::StatementPtr ParseSimpleStatement() {
         const auto& tok = lexer_.CurrentToken();
 
         if (tok.Is<TokenType::Return>()) {
             lexer_.NextToken();
-            return make_unique<ast::Return>(ParseTest());
+            return program_.MakeNode<ast::Return>(ParseTest());
         }
         if (tok.Is<TokenType::Print>()) {
             lexer_.NextToken();
-            vector<unique_ptr<ast::Statement>> args;
+            vector<ast::StatementPtr> args;
             if (!lexer_.CurrentToken().Is<TokenType::Newline>()) {
                 args = ParseTestList();
             }
-            return make_unique<ast::Print>(std::move(args));
+            return program_.MakeNode<ast::Print>(std::move(args));
         }
         return ParseAssignmentOrCall();
     }
 
     parse::Lexer& lexer_;
+    ast::Program& program_;
     runtime::Closure declared_classes_;
 };
 
 }  // namespace
 
 unique_ptr<runtime::Executable> parse::ParseProgram(parse::Lexer& lexer) {
-    return Parser{lexer}.ParseProgram();
+    auto program = make_unique<ast::Program>();
+    program->SetTree(Parser{lexer, *program}.ParseProgram());
+    return program;
 }
@@ -16,5 +16,7 @@ struct ParseError : std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+// Разбирает программу и возвращает ast::Program. Все узлы её дерева размещены в арене,
+// которой владеет ast::Program, и освобождаются вместе с ней
 std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
 }  // namespace parse
@@ -0,0 +1,79 @@
+#include "bench_runner_p.h"
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "parse.h"
+#include "runtime.h"
+
+#include <string>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// ---- Разбор длинной программы ----
+
+constexpr int PROGRAM_BLOCKS = 10'000;
+constexpr int STATEMENTS_PER_BLOCK = 10;
+
+// Возвращает программу из PROGRAM_BLOCKS * STATEMENTS_PER_BLOCK инструкций верхнего уровня
+string MakeLongProgram() {
+    string program;
+    for (int i = 0; i < PROGRAM_BLOCKS; ++i) {
+        const string n = to_string(i);
+        program += "class C"s + n + ":\n"s
+                   "  def m(a, b):\n"s
+                   "    return a * "s + n + " + b\n"s
+                   "c = C"s + n + "()\n"s
+                   "x = c.m(1, 2) + 3 * (4 - 5) / 6\n"s
+                   "y = x\n"s
+                   "c.value = 'text "s + n + "'\n"s
+                   "if x > 1 and not y < 0 or x == y:\n"s
+                   "  print x, y, c.value\n"s
+                   "else:\n"s
+                   "  print str(x)\n"s
+                   "z = True\n"s
+                   "w = None\n"s
+                   "print x + y, 'done'\n"s
+                   "x = x + 1\n"s;
+    }
+    return program;
+}
+
+// Измеряет время разбора (parse) либо разрушения дерева (teardown) длинной программы.
+// Токены читаются заранее, чтобы время чтения не входило в измерение
+BenchResult BenchLongProgram(bool measure_teardown) {
+    const string program = MakeLongProgram();
+    Lexer lexer(LexParallel(program, 1));
+
+    auto start = chrono::steady_clock::now();
+    auto tree = ParseProgram(lexer);
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    DoNotOptimize(tree);
+
+    if (measure_teardown) {
+        start = chrono::steady_clock::now();
+        tree.reset();
+        elapsed = chrono::steady_clock::now() - start;
+    }
+    return {PROGRAM_BLOCKS * STATEMENTS_PER_BLOCK, elapsed.count(),
+            measure_teardown ? "ms teardown"s : "ms parse"s};
+}
+
+BenchResult BenchParseLongProgram() {
+    return BenchLongProgram(false);
+}
+
+BenchResult BenchDestroyLongProgram() {
+    return BenchLongProgram(true);
+}
+
+}  // namespace
+
+void RunParseBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, parse::BenchParseLongProgram);
+    RUN_BENCH(br, parse::BenchDestroyLongProgram);
+}
+
+}  // namespace parse
@@ -272,6 +272,114 @@ print origin
 
 }  // namespace custom
 
+void TestLoops() {
+    const string program = R"(
+class Counter:
+  def count_down(n):
+    result = ''
+    while n > 0:
+      result = result + str(n)
+      n = n - 1
+    return result
+
+c = Counter()
+for i in range(3):
+  print i, c.count_down(i)
+for i in range(1, 10, 4):
+  print i
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "0 \n1 1\n2 21\n1\n5\n9\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("for x in foo(3):\n  print x\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("for x in range():\n  print x\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("for x in range(1, 2, 3, 4):\n  print x\n"s),
+                  ParseError);
+}
+
+void TestLists() {
+    const string program = R"(
+class Matrix:
+  def __init__(rows):
+    self.rows = rows
+
+  def get(i, j):
+    return self.rows[i][j]
+
+m = Matrix([[1, 2], [3, 4]])
+m.rows[0][1] = -m.get(1, 0) * (2 + 1)
+row = m.rows[1]
+row.append(len(row))
+print m.rows, [m.get(0, 1), (m.rows)[1][-1]], len([])
+for r in m.rows:
+  for x in r:
+    print x
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "[[1, -9], [3, 4, 2]] [-9, 2] 0\n1\n-9\n3\n4\n2\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("x = len(1, 2)\n"s), ParseError);
+    // Незакрытая скобка и выражение вместо присваивания - ошибки синтаксиса
+    ASSERT_THROWS(ParseProgramFromString("x = [1, 2\n"s), LexerError);
+    ASSERT_THROWS(ParseProgramFromString("x[0] + 1\n"s), LexerError);
+}
+
+void TestDicts() {
+    const string program = R"(
+class Table:
+  def __init__():
+    self.rows = {'x': {1: 'a'}}
+
+t = Table()
+t.rows['y'] = {}
+t.rows['y'][2] = {'k': 'v'}['k']
+print t.rows, {1: 2, 3: 4}[3], len({}), not 'x' in t.rows, 'z' in t.rows
+for key in t.rows:
+  print key, 1 in t.rows[key]
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(),
+                 "{x: {1: a}, y: {2: v}} 4 0 False False\nx True\ny False\n"s);
+
+    // Пара без двоеточия и незакрытая скобка - ошибки синтаксиса
+    ASSERT_THROWS(ParseProgramFromString("x = {1, 2}\n"s), LexerError);
+    ASSERT_THROWS(ParseProgramFromString("x = {1: 2\n"s), LexerError);
+    ASSERT_THROWS(ParseProgramFromString("x = {1: 2,}\n"s), LexerError);
+}
+
+void TestDeepTreeTeardown() {
+    // Дерево из длинной цепочки сложений разрушается вместе с ареной без рекурсии
+    constexpr int TERMS = 100'000;
+    string program = "x = 1"s;
+    for (int i = 1; i < TERMS; ++i) {
+        program += " + 1"s;
+    }
+    program += "\n"s;
+
+    auto tree = ParseProgramFromString(program);
+    const auto* parsed = dynamic_cast<const ast::Program*>(tree.get());
+    ASSERT(parsed != nullptr);
+    // Compound, Assignment, TERMS констант и TERMS - 1 сложений
+    ASSERT_EQUAL(parsed->GetArena().GetObjectCount(), static_cast<size_t>(2 * TERMS + 1));
+    tree.reset();
+}
+
 }  // namespace parse
 
 void TestParseProgram(TestRunner& tr) {
@@ -283,6 +391,10 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestRecursion2);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestLoops);
+    RUN_TEST(tr, parse::TestLists);
+    RUN_TEST(tr, parse::TestDicts);
+    RUN_TEST(tr, parse::TestDeepTreeTeardown);
 
     RUN_TEST(tr, parse::custom::TestProgrammClass);
 }
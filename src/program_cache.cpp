@@ -0,0 +1,620 @@
+#include "program_cache.h"
+
+#include "mapped_file.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+using namespace std;
+
+namespace flat {
+
+using runtime::ObjectHolder;
+
+namespace {
+
+// Признак начала данных программы
+constexpr char MAGIC[4] = {'M', 'Y', 'C', '\0'};
+
+// Функции сравнения, которые создаёт парсер. В файле записывается номер функции
+using ComparatorFunction = bool (*)(const ObjectHolder&, const ObjectHolder&, runtime::Context&);
+constexpr ComparatorFunction COMPARATORS[] = {
+    runtime::Equal,   runtime::NotEqual,    runtime::Less,
+    runtime::Greater, runtime::LessOrEqual, runtime::GreaterOrEqual,
+    runtime::Contains,
+};
+
+// Хеш FNV-1a, не зависящий от реализации стандартной библиотеки
+uint64_t HashBytes(string_view data, uint64_t hash = 14695981039346656037ULL) {
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t HashSource(string_view source, bool optimized) {
+    const uint32_t key[] = {CACHE_FORMAT_VERSION, optimized ? 1U : 0U};
+    return HashBytes(source, HashBytes({reinterpret_cast<const char*>(key), sizeof(key)}));
+}
+
+// ---- Запись ----
+
+class Writer {
+public:
+    template <typename T>
+    void Write(T value) {
+        static_assert(is_trivially_copyable_v<T>);
+        data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void WriteArray(const vector<T>& values) {
+        static_assert(is_trivially_copyable_v<T>);
+        data_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void WriteString(string_view str) {
+        Write(static_cast<uint32_t>(str.size()));
+        data_.append(str);
+    }
+
+    void WriteSize(size_t size) {
+        Write(static_cast<uint32_t>(size));
+    }
+
+    string Release() {
+        return std::move(data_);
+    }
+
+private:
+    string data_;
+};
+
+// ---- Чтение ----
+
+// Читает данные с проверкой границ. При выходе за границы выбрасывает CacheError
+class Reader {
+public:
+    explicit Reader(string_view data)
+        : data_(data)
+        {}
+
+    template <typename T>
+    T Read() {
+        static_assert(is_trivially_copyable_v<T>);
+        T value;
+        memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    // Читает count значений типа T в массив values
+    template <typename T>
+    void ReadArray(vector<T>& values, size_t count) {
+        static_assert(is_trivially_copyable_v<T>);
+        const auto bytes = Take(count * sizeof(T));
+        values.resize(count);
+        // Пустой вектор может не иметь буфера, а memcpy не принимает нулевой указатель
+        if (count != 0) {
+            memcpy(values.data(), bytes.data(), bytes.size());
+        }
+    }
+
+    string_view ReadString() {
+        return Take(Read<uint32_t>());
+    }
+
+    string_view ReadBytes(size_t size) {
+        return Take(size);
+    }
+
+    // Читает количество элементов, каждый из которых занимает хотя бы min_size байт
+    size_t ReadSize(size_t min_size = 1) {
+        const size_t size = Read<uint32_t>();
+        if (size > data_.size() / min_size) {
+            throw CacheError("Invalid element count"s);
+        }
+        return size;
+    }
+
+    [[nodiscard]] bool AtEnd() const {
+        return data_.empty();
+    }
+
+private:
+    string_view Take(size_t size) {
+        if (size > data_.size()) {
+            throw CacheError("Unexpected end of cached program"s);
+        }
+        const auto result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    string_view data_;
+};
+
+// Проверяет, что номер index не выходит за пределы массива размера size
+void CheckIndex(NodeId index, size_t size) {
+    if (index >= size) {
+        throw CacheError("Invalid index in cached program"s);
+    }
+}
+
+}  // namespace
+
+// ----------- Serialize -----------------------
+
+string Serialize(const Program& program) {
+    const Tree& tree = program.GetTree();
+    if (!tree.nodes.empty()) {
+        throw CacheError("Program contains nodes which can't be cached"s);
+    }
+
+    Writer writer;
+    for (const char c : MAGIC) {
+        writer.Write(c);
+    }
+    writer.Write(CACHE_FORMAT_VERSION);
+    writer.Write(program.GetRoot());
+
+    writer.WriteSize(tree.GetSize());
+    writer.WriteArray(tree.kinds);
+    writer.WriteArray(tree.arg0);
+    writer.WriteArray(tree.arg1);
+    writer.WriteArray(tree.arg2);
+    writer.WriteSize(tree.children.size());
+    writer.WriteArray(tree.children);
+
+    writer.WriteSize(tree.constants.size());
+    for (const auto& constant : tree.constants) {
+        const auto kind = constant.GetKind();
+        writer.Write(kind);
+        if (kind == runtime::ObjectKind::NUMBER) {
+            writer.Write(constant.TryAs<runtime::Number>()->GetValue());
+        } else if (kind == runtime::ObjectKind::STRING) {
+            writer.WriteString(constant.TryAs<runtime::String>()->GetValue());
+        } else if (kind == runtime::ObjectKind::BOOL) {
+            writer.Write(static_cast<uint8_t>(constant.TryAs<runtime::Bool>()->GetValue()));
+        } else if (kind != runtime::ObjectKind::NONE) {
+            throw CacheError("Constant can't be cached"s);
+        }
+    }
+
+    writer.WriteSize(tree.names.size());
+    for (const auto name : tree.names) {
+        writer.WriteString(name.GetName());
+    }
+
+    writer.WriteSize(tree.comparators.size());
+    for (const auto& comparator : tree.comparators) {
+        const auto* function = comparator.target<ComparatorFunction>();
+        const auto it = function ? find(begin(COMPARATORS), end(COMPARATORS), *function)
+                                 : end(COMPARATORS);
+        if (it == end(COMPARATORS)) {
+            throw CacheError("Comparator can't be cached"s);
+        }
+        writer.Write(static_cast<uint8_t>(it - begin(COMPARATORS)));
+    }
+
+    // Родитель класса задаётся его номером в tree.classes
+    writer.WriteSize(tree.classes.size());
+    for (const auto& holder : tree.classes) {
+        const auto& cls = *holder.TryAs<runtime::Class>();
+        writer.WriteString(cls.GetName());
+        NodeId parent = NO_NODE;
+        for (NodeId i = 0; i < tree.classes.size(); ++i) {
+            if (tree.classes[i].TryAs<runtime::Class>() == cls.GetParent()) {
+                parent = i;
+            }
+        }
+        writer.Write(parent);
+        writer.WriteSize(cls.GetMethods().size());
+        for (const auto& method : cls.GetMethods()) {
+            writer.WriteString(method.name.GetName());
+            writer.WriteSize(method.formal_params.size());
+            for (const auto param : method.formal_params) {
+                writer.WriteString(param.GetName());
+            }
+            writer.Write(dynamic_cast<const Function&>(*method.body).GetRoot());
+        }
+    }
+
+    // Из встроенных кэшей записываются только имена, кэши заполняются заново
+    const auto write_names = [&writer](const auto& sites) {
+        writer.WriteSize(sites.size());
+        for (const auto& site : sites) {
+            writer.WriteString(site.name.GetName());
+        }
+    };
+    write_names(tree.field_loads);
+    write_names(tree.field_stores);
+    write_names(tree.method_calls);
+    return writer.Release();
+}
+
+// ----------- ProgramReader -----------------------
+
+// Восстанавливает плоское дерево программы из данных, записанных Serialize
+class ProgramReader {
+public:
+    ProgramReader(Program& program, string_view data)
+        : program_(program)
+        , tree_(program.tree_)
+        , reader_(data)
+        {}
+
+    void ReadProgram() {
+        char magic[sizeof(MAGIC)];
+        for (char& c : magic) {
+            c = reader_.Read<char>();
+        }
+        if (!equal(begin(magic), end(magic), begin(MAGIC))
+            || reader_.Read<uint32_t>() != CACHE_FORMAT_VERSION) {
+            throw CacheError("Unsupported cached program format"s);
+        }
+        program_.root_ = reader_.Read<NodeId>();
+
+        const size_t node_count = reader_.ReadSize(sizeof(NodeKind) + 3 * sizeof(NodeId));
+        reader_.ReadArray(tree_.kinds, node_count);
+        reader_.ReadArray(tree_.arg0, node_count);
+        reader_.ReadArray(tree_.arg1, node_count);
+        reader_.ReadArray(tree_.arg2, node_count);
+        reader_.ReadArray(tree_.children, reader_.ReadSize(sizeof(NodeId)));
+
+        const size_t constant_count = reader_.ReadSize();
+        tree_.constants.reserve(constant_count);
+        for (size_t i = 0; i < constant_count; ++i) {
+            tree_.constants.push_back(ReadConstant());
+        }
+
+        const size_t name_count = reader_.ReadSize(sizeof(uint32_t));
+        tree_.names.reserve(name_count);
+        for (size_t i = 0; i < name_count; ++i) {
+            tree_.names.emplace_back(reader_.ReadString());
+        }
+
+        const size_t comparator_count = reader_.ReadSize();
+        tree_.comparators.reserve(comparator_count);
+        for (size_t i = 0; i < comparator_count; ++i) {
+            const auto index = reader_.Read<uint8_t>();
+            CheckIndex(index, size(COMPARATORS));
+            tree_.comparators.emplace_back(COMPARATORS[index]);
+        }
+
+        ReadClasses();
+
+        ReadNames(tree_.field_loads);
+        ReadNames(tree_.field_stores);
+        ReadNames(tree_.method_calls);
+        if (!reader_.AtEnd()) {
+            throw CacheError("Unexpected data after cached program"s);
+        }
+        CheckNodes();
+    }
+
+private:
+    // Класс, прочитанный из файла, до создания объекта runtime::Class
+    struct ClassRecord {
+        string name;
+        NodeId parent;
+        vector<runtime::Method> methods;
+    };
+
+    ObjectHolder ReadConstant() {
+        switch (reader_.Read<runtime::ObjectKind>()) {
+            case runtime::ObjectKind::NONE:
+                return ObjectHolder::None();
+            case runtime::ObjectKind::NUMBER:
+                return ObjectHolder::Own(runtime::Number(reader_.Read<int>()));
+            case runtime::ObjectKind::STRING:
+                return ObjectHolder::Own(runtime::String(string(reader_.ReadString())));
+            case runtime::ObjectKind::BOOL:
+                return ObjectHolder::Own(runtime::Bool(reader_.Read<uint8_t>() != 0));
+            default:
+                throw CacheError("Invalid constant in cached program"s);
+        }
+    }
+
+    void ReadClasses() {
+        const size_t class_count = reader_.ReadSize();
+        vector<ClassRecord> records(class_count);
+        for (auto& record : records) {
+            record.name = reader_.ReadString();
+            record.parent = reader_.Read<NodeId>();
+            if (record.parent != NO_NODE) {
+                CheckIndex(record.parent, class_count);
+            }
+            const size_t method_count = reader_.ReadSize();
+            for (size_t i = 0; i < method_count; ++i) {
+                runtime::Method method;
+                method.name = reader_.ReadString();
+                const size_t param_count = reader_.ReadSize(sizeof(uint32_t));
+                for (size_t j = 0; j < param_count; ++j) {
+                    method.formal_params.emplace_back(reader_.ReadString());
+                }
+                const auto root = reader_.Read<NodeId>();
+                CheckIndex(root, tree_.GetSize());
+                if (tree_.kinds[root] != NodeKind::METHOD_BODY) {
+                    throw CacheError("Invalid method body in cached program"s);
+                }
+                method.body = make_unique<Function>(tree_, root);
+                record.methods.push_back(std::move(method));
+            }
+        }
+
+        // Родитель может иметь больший номер, чем наследник,
+        // поэтому классы создаются рекурсивно, начиная с родителей
+        tree_.classes.resize(class_count);
+        vector<bool> in_progress(class_count);
+        for (NodeId i = 0; i < class_count; ++i) {
+            MakeClass(records, in_progress, i);
+        }
+    }
+
+    const runtime::Class* MakeClass(vector<ClassRecord>& records, vector<bool>& in_progress,
+                                    NodeId index) {
+        if (const auto* cls = tree_.classes[index].TryAs<runtime::Class>()) {
+            return cls;
+        }
+        if (in_progress[index]) {
+            throw CacheError("Cyclic class inheritance in cached program"s);
+        }
+        in_progress[index] = true;
+        auto& record = records[index];
+        const runtime::Class* parent = record.parent == NO_NODE
+            ? nullptr : MakeClass(records, in_progress, record.parent);
+        tree_.classes[index] = ObjectHolder::Own(
+            runtime::Class(std::move(record.name), std::move(record.methods), parent));
+        return tree_.classes[index].TryAs<runtime::Class>();
+    }
+
+    template <typename Site>
+    void ReadNames(vector<Site>& sites) {
+        const size_t count = reader_.ReadSize(sizeof(uint32_t));
+        sites.resize(count);
+        for (auto& site : sites) {
+            site.name = reader_.ReadString();
+        }
+    }
+
+    // Проверяет, что операнды узлов ссылаются на существующие узлы и данные, а объекты
+    // полей и вызовов методов - на узлы, которые вычисляют значение переменной.
+    // Дочерние узлы предшествуют родителю, поэтому обход не может зациклиться
+    void CheckNodes() const {
+        const auto check_child = [](NodeId child, NodeId node) {
+            if (child >= node) {
+                throw CacheError("Invalid node reference in cached program"s);
+            }
+        };
+        // Сообщения об ошибках берут имя объекта из узла LOAD_NAME или LOAD_FIELD
+        const auto check_variable = [this, &check_child](NodeId child, NodeId node) {
+            check_child(child, node);
+            if (tree_.kinds[child] != NodeKind::LOAD_NAME
+                && tree_.kinds[child] != NodeKind::LOAD_FIELD) {
+                throw CacheError("Invalid object node in cached program"s);
+            }
+        };
+        const auto check_children = [this, &check_child](NodeId first, NodeId count,
+                                                         NodeId node) {
+            if (first > tree_.children.size() || count > tree_.children.size() - first) {
+                throw CacheError("Invalid child list in cached program"s);
+            }
+            for (NodeId i = first; i < first + count; ++i) {
+                check_child(tree_.children[i], node);
+            }
+        };
+
+        for (NodeId node = 0; node < tree_.GetSize(); ++node) {
+            const NodeId arg0 = tree_.arg0[node];
+            const NodeId arg1 = tree_.arg1[node];
+            const NodeId arg2 = tree_.arg2[node];
+            switch (tree_.kinds[node]) {
+                case NodeKind::CONST:
+                    CheckIndex(arg0, tree_.constants.size());
+                    break;
+                case NodeKind::NONE:
+                    break;
+                case NodeKind::LOAD_NAME:
+                    CheckIndex(arg0, tree_.names.size());
+                    break;
+                case NodeKind::LOAD_FIELD:
+                    check_variable(arg0, node);
+                    CheckIndex(arg1, tree_.field_loads.size());
+                    break;
+                case NodeKind::ASSIGN:
+                    check_child(arg0, node);
+                    CheckIndex(arg1, tree_.names.size());
+                    break;
+                case NodeKind::FIELD_ASSIGN:
+                    check_variable(arg0, node);
+                    check_child(arg1, node);
+                    CheckIndex(arg2, tree_.field_stores.size());
+                    break;
+                case NodeKind::PRINT:
+                case NodeKind::COMPOUND:
+                case NodeKind::LIST:
+                case NodeKind::DICT:
+                    check_children(arg0, arg1, node);
+                    break;
+                case NodeKind::CALL:
+                case NodeKind::TAIL_CALL:
+                    if (arg1 == 0) {
+                        throw CacheError("Call without object in cached program"s);
+                    }
+                    check_children(arg0, arg1, node);
+                    check_variable(tree_.children[arg0], node);
+                    CheckIndex(arg2, tree_.method_calls.size());
+                    break;
+                case NodeKind::NEW_INSTANCE:
+                    check_children(arg0, arg1, node);
+                    CheckIndex(arg2, tree_.classes.size());
+                    break;
+                case NodeKind::STRINGIFY:
+                case NodeKind::LEN:
+                case NodeKind::NOT:
+                case NodeKind::RETURN:
+                case NodeKind::METHOD_BODY:
+                    check_child(arg0, node);
+                    break;
+                case NodeKind::ADD:
+                case NodeKind::SUB:
+                case NodeKind::MULT:
+                case NodeKind::DIV:
+                case NodeKind::AND:
+                case NodeKind::OR:
+                case NodeKind::INDEX:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    break;
+                case NodeKind::STORE_INDEX:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    check_child(arg2, node);
+                    break;
+                case NodeKind::COMPARE:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    CheckIndex(arg2, tree_.comparators.size());
+                    break;
+                case NodeKind::CLASS_DEF:
+                    CheckIndex(arg0, tree_.classes.size());
+                    break;
+                case NodeKind::IF_ELSE:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    if (arg2 != NO_NODE) {
+                        check_child(arg2, node);
+                    }
+                    break;
+                case NodeKind::WHILE:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    break;
+                case NodeKind::FOR_RANGE:
+                    check_children(arg0, 3, node);
+                    check_child(arg1, node);
+                    CheckIndex(arg2, tree_.names.size());
+                    break;
+                case NodeKind::FOR_EACH:
+                    check_child(arg0, node);
+                    check_child(arg1, node);
+                    CheckIndex(arg2, tree_.names.size());
+                    break;
+                default:
+                    // Узлы EXEC_NODE не записываются
+                    throw CacheError("Invalid node kind in cached program"s);
+            }
+        }
+        CheckIndex(program_.root_, tree_.GetSize());
+    }
+
+    Program& program_;
+    Tree& tree_;
+    Reader reader_;
+};
+
+unique_ptr<Program> Deserialize(string_view data) {
+    auto program = make_unique<Program>(nullptr);
+    ProgramReader{*program, data}.ReadProgram();
+    return program;
+}
+
+// ----------- ProgramCache -----------------------
+
+namespace {
+
+// Заголовок файла кэша. За ним следуют текст программы и данные Serialize.
+// Текст сравнивается с искомым целиком, поэтому программа, хеш которой совпал
+// с хешем другой программы, не будет выполнена вместо неё. Хеш данных Serialize
+// находит повреждения, которые не нарушают структуру дерева (например, в константах)
+struct CacheFileHeader {
+    uint32_t format_version;
+    uint32_t optimized;
+    uint64_t source_size;
+    uint64_t data_hash;
+};
+
+}  // namespace
+
+ProgramCache::ProgramCache(std::filesystem::path dir)
+    : dir_(std::move(dir))
+    {}
+
+unique_ptr<Program> ProgramCache::Find(string_view source, bool optimized) const {
+    const auto path = GetPath(source, optimized);
+    error_code ec;
+    if (!filesystem::is_regular_file(path, ec)) {
+        return nullptr;
+    }
+    try {
+        const parse::MappedFile file(path.string());
+        Reader reader(file.GetContents());
+        const auto header = reader.Read<CacheFileHeader>();
+        if (header.format_version != CACHE_FORMAT_VERSION
+            || header.optimized != (optimized ? 1U : 0U) || header.source_size != source.size()
+            || reader.ReadBytes(source.size()) != source) {
+            return nullptr;
+        }
+        const auto data = file.GetContents().substr(sizeof(CacheFileHeader) + source.size());
+        if (HashBytes(data) != header.data_hash) {
+            return nullptr;
+        }
+        return Deserialize(data);
+    } catch (const parse::MappedFileError&) {
+        return nullptr;
+    } catch (const CacheError&) {
+        // Повреждённый файл будет перезаписан при сохранении программы
+        return nullptr;
+    }
+}
+
+bool ProgramCache::Store(string_view source, bool optimized, const Program& program) const {
+    string data;
+    try {
+        data = Serialize(program);
+    } catch (const CacheError&) {
+        return false;
+    }
+
+    error_code ec;
+    filesystem::create_directories(dir_, ec);
+    const auto path = GetPath(source, optimized);
+    auto temp_path = path;
+    temp_path += ".tmp"s + to_string(getpid());
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        const CacheFileHeader header{CACHE_FORMAT_VERSION, optimized ? 1U : 0U, source.size(),
+                                     HashBytes(data)};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(source.data(), static_cast<streamsize>(source.size()));
+        out.write(data.data(), static_cast<streamsize>(data.size()));
+        if (!out) {
+            out.close();
+            filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+    filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        filesystem::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+filesystem::path ProgramCache::GetPath(string_view source, bool optimized) const {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    uint64_t hash = HashSource(source, optimized);
+    string name(16, '0');
+    for (auto it = name.rbegin(); it != name.rend(); ++it, hash >>= 4) {
+        *it = DIGITS[hash & 0xF];
+    }
+    return dir_ / (name + ".myc"s);
+}
+
+}  // namespace flat
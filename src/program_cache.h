@@ -0,0 +1,58 @@
+#pragma once
+
+#include "flat_ast.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace flat {
+
+// Версия двоичного формата программы. Входит в ключ кэша, поэтому файлы,
+// записанные другой версией интерпретатора, не читаются.
+// Увеличивается при любом изменении формата или видов узлов плоского дерева
+constexpr std::uint32_t CACHE_FORMAT_VERSION = 5;
+
+class CacheError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Записывает плоское дерево программы program в двоичном формате.
+// Выбрасывает CacheError, если дерево нельзя записать: оно содержит узлы EXEC_NODE
+// или функции сравнения, отличные от функций runtime
+std::string Serialize(const Program& program);
+
+// Восстанавливает программу из данных data, записанных Serialize.
+// Выбрасывает CacheError, если данные повреждены
+std::unique_ptr<Program> Deserialize(std::string_view data);
+
+// Кэш программ, переведённых в плоское дерево. Каждая программа хранится в отдельном файле,
+// имя которого - хеш текста программы, версии формата и признака оптимизации.
+// Файл содержит и сам текст: программа с тем же хешем, но другим текстом не находится.
+// Файлы записываются во временный файл и переименовываются, поэтому несколько процессов
+// могут пользоваться одним каталогом одновременно
+class ProgramCache {
+public:
+    // Создаёт кэш в каталоге dir. Каталог создаётся при первой записи
+    explicit ProgramCache(std::filesystem::path dir);
+
+    // Возвращает программу с текстом source из кэша либо nullptr, если её нет в кэше
+    // или файл повреждён. Файл отображается в память, лексер и парсер не используются
+    [[nodiscard]] std::unique_ptr<Program> Find(std::string_view source, bool optimized) const;
+
+    // Сохраняет программу program, построенную из текста source.
+    // Возвращает false, если программу нельзя записать в кэш
+    bool Store(std::string_view source, bool optimized, const Program& program) const;
+
+    // Возвращает путь к файлу программы с текстом source
+    [[nodiscard]] std::filesystem::path GetPath(std::string_view source, bool optimized) const;
+
+private:
+    std::filesystem::path dir_;
+};
+
+}  // namespace flat
@@ -0,0 +1,86 @@
+#include "bench_runner_p.h"
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "program_cache.h"
+
+#include <unistd.h>
+
+#include <string>
+
+using namespace std;
+
+namespace flat {
+
+namespace {
+
+// ---- Запуск программы без кэша и с кэшем ----
+
+constexpr int PROGRAM_BLOCKS = 5'000;
+constexpr int RUNS = 5;
+
+// Длинная программа, которая почти ничего не делает: время запуска определяется
+// её разбором либо чтением из кэша
+string MakeLongProgram() {
+    string program;
+    for (int i = 0; i < PROGRAM_BLOCKS; ++i) {
+        const string n = to_string(i);
+        program += "class C"s + n + ":\n"s
+                   "  def m(a, b):\n"s
+                   "    if a > b and not a == 0:\n"s
+                   "      return a * "s + n + " + b\n"s
+                   "    return str(b) + ' text "s + n + "'\n"s
+                   "c = C"s + n + "()\n"s
+                   "x = c.m(1, 2) + 3 * (4 - 5) / 6\n"s
+                   "c.value = x\n"s;
+    }
+    return program;
+}
+
+// Измеряет время подготовки программы к выполнению от чтения текста до построения
+// плоского дерева. Холодный запуск (warm == false) разбирает программу и записывает её в кэш,
+// тёплый находит её в кэше. Выполнение программы в измерение не входит
+BenchResult BenchStartup(bool warm) {
+    const string source = MakeLongProgram();
+    const auto dir = filesystem::temp_directory_path()
+        / ("mython_cache_bench_"s + to_string(getpid()));
+    const ProgramCache cache(dir);
+
+    chrono::duration<double, milli> elapsed{};
+    for (int run = 0; run < RUNS; ++run) {
+        filesystem::remove_all(dir);
+        if (warm) {
+            parse::Lexer lexer(source);
+            cache.Store(source, true, *Flatten(ast::Optimize(parse::ParseProgram(lexer))));
+        }
+
+        const auto start = chrono::steady_clock::now();
+        auto program = cache.Find(source, true);
+        if (!program) {
+            parse::Lexer lexer(source);
+            program = Flatten(ast::Optimize(parse::ParseProgram(lexer)));
+            cache.Store(source, true, *program);
+        }
+        elapsed += chrono::steady_clock::now() - start;
+        DoNotOptimize(program);
+    }
+    filesystem::remove_all(dir);
+    return {0, elapsed.count() / RUNS, "ms startup"s};
+}
+
+BenchResult BenchColdStartup() {
+    return BenchStartup(false);
+}
+
+BenchResult BenchWarmStartup() {
+    return BenchStartup(true);
+}
+
+}  // namespace
+
+void RunProgramCacheBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, flat::BenchColdStartup);
+    RUN_BENCH(br, flat::BenchWarmStartup);
+}
+
+}  // namespace flat
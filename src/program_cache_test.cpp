@@ -0,0 +1,280 @@
+#include "lexer.h"
+#include "optimize.h"
+#include "parse.h"
+#include "program_cache.h"
+#include "test_runner_p.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace std;
+
+namespace flat {
+
+namespace {
+
+const string PROGRAM = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def area():
+    return 0
+
+  def __str__():
+    return self.name + ': ' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __lt__(other):
+    return self.area() < other.area()
+
+  def __eq__(other):
+    return self.area() == other.area()
+
+class Factory:
+  def make(w, h):
+    return Rect(w, h)
+
+f = Factory()
+a = f.make(2, 3)
+b = f.make(1, 4 + 1)
+print a, b, a < b, a > b, a == a, a != b, 1 <= 2, 'x' >= 'y'
+if not (a < b) or None:
+  print 'no'
+else:
+  print Shape('circle'), -7 / 2, True and 'yes'
+)"s;
+
+unique_ptr<Program> BuildFlatProgram(const string& program, bool optimize = true) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = parse::ParseProgram(lexer);
+    if (optimize) {
+        tree = ast::Optimize(std::move(tree));
+    }
+    return Flatten(std::move(tree));
+}
+
+string Run(Program& program) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program.Execute(closure, context);
+    return context.output.str();
+}
+
+string Dump(const Program& program) {
+    ostringstream dump;
+    dump << program.GetTree();
+    return dump.str();
+}
+
+// Каталог кэша, удаляемый по завершении теста
+class TempDir {
+public:
+    TempDir()
+        : path_(filesystem::temp_directory_path()
+                / ("mython_cache_test_"s + to_string(getpid()))) {
+        filesystem::remove_all(path_);
+    }
+
+    ~TempDir() {
+        error_code ec;
+        filesystem::remove_all(path_, ec);
+    }
+
+    [[nodiscard]] const filesystem::path& GetPath() const {
+        return path_;
+    }
+
+private:
+    filesystem::path path_;
+};
+
+void TestRoundTrip() {
+    auto original = BuildFlatProgram(PROGRAM);
+    const string data = Serialize(*original);
+    auto restored = Deserialize(data);
+
+    ASSERT_EQUAL(Dump(*restored), Dump(*original));
+    ASSERT_EQUAL(restored->GetRoot(), original->GetRoot());
+    ASSERT_EQUAL(Serialize(*restored), data);
+
+    const string expected = Run(*original);
+    ASSERT_EQUAL(expected, "rect: 6 rect: 5 False True True True True False\nno\n"s);
+    ASSERT_EQUAL(Run(*restored), expected);
+}
+
+void TestRoundTripLists() {
+    auto original = BuildFlatProgram(R"(
+xs = [1, 'a', [None]]
+xs.append(len(xs))
+for x in xs:
+  xs[1] = x
+print xs, xs[-2][0]
+)"s);
+    auto restored = Deserialize(Serialize(*original));
+    ASSERT_EQUAL(Dump(*restored), Dump(*original));
+    ASSERT_EQUAL(Run(*restored), "[1, 3, [None], 3] None\n"s);
+}
+
+void TestRoundTripDicts() {
+    auto original = BuildFlatProgram(R"(
+d = {'a': 1, 2: [None]}
+d['b'] = len(d)
+for k in d:
+  print k, d[k], k in d, 'c' in d
+)"s);
+    auto restored = Deserialize(Serialize(*original));
+    ASSERT_EQUAL(Dump(*restored), Dump(*original));
+    ASSERT_EQUAL(Run(*restored), "a 1 True False\n2 [None] True False\nb 2 True False\n"s);
+}
+
+void TestRoundTripTailCalls() {
+    auto original = BuildFlatProgram(R"(
+class Counter:
+  def count(n, acc):
+    if n == 0:
+      return acc
+    return self.count(n - 1, acc + 1)
+
+c = Counter()
+print c.count(100000, 0)
+)"s);
+    auto restored = Deserialize(Serialize(*original));
+    ASSERT_EQUAL(Dump(*restored), Dump(*original));
+    ASSERT(Dump(*restored).find(" TAIL_CALL "s) != string::npos);
+    ASSERT_EQUAL(Run(*restored), "100000\n"s);
+}
+
+void TestRejectCorruptedData() {
+    const string data = Serialize(*BuildFlatProgram(PROGRAM));
+    // Данные, обрезанные в разных местах: внутри заголовка, массивов узлов, констант и классов
+    for (size_t size = 0; size < data.size(); size += 13) {
+        ASSERT_THROWS(Deserialize(string_view(data).substr(0, size)), CacheError);
+    }
+    ASSERT_THROWS(Deserialize(data + '\0'), CacheError);
+
+    // Другая версия формата
+    string other_version = data;
+    ++other_version[sizeof(uint32_t)];
+    ASSERT_THROWS(Deserialize(other_version), CacheError);
+
+    // Корень за пределами дерева
+    string bad_root = data;
+    const auto root = numeric_limits<NodeId>::max() - 1;
+    bad_root.replace(2 * sizeof(uint32_t), sizeof(root),
+                     reinterpret_cast<const char*>(&root), sizeof(root));
+    ASSERT_THROWS(Deserialize(bad_root), CacheError);
+
+    // Объект поля или вызова метода - узел, который не вычисляет значение переменной.
+    // Номера узлов лежат после заголовка и массива видов узлов, номера дочерних узлов -
+    // после трёх массивов операндов и их количества
+    const auto program = Deserialize(data);
+    const Tree& tree = program->GetTree();
+    const size_t node_count = tree.GetSize();
+    const size_t arg0_offset = 4 * sizeof(uint32_t) + node_count * sizeof(NodeKind);
+    const size_t children_offset = arg0_offset + 3 * node_count * sizeof(NodeId)
+        + sizeof(uint32_t);
+    const auto last_node = [&tree](NodeKind kind) {
+        const auto it = find(tree.kinds.rbegin(), tree.kinds.rend(), kind);
+        return static_cast<NodeId>(tree.kinds.rend() - it - 1);
+    };
+    const NodeId constant = static_cast<NodeId>(
+        find(tree.kinds.begin(), tree.kinds.end(), NodeKind::CONST) - tree.kinds.begin());
+    const auto with_id = [&data](size_t offset, NodeId id) {
+        string result = data;
+        result.replace(offset, sizeof(id), reinterpret_cast<const char*>(&id), sizeof(id));
+        return result;
+    };
+    for (const auto kind : {NodeKind::LOAD_FIELD, NodeKind::FIELD_ASSIGN}) {
+        const NodeId node = last_node(kind);
+        ASSERT(constant < node);
+        ASSERT_THROWS(Deserialize(with_id(arg0_offset + node * sizeof(NodeId), constant)),
+                      CacheError);
+    }
+    const NodeId call = last_node(NodeKind::CALL);
+    ASSERT(constant < call);
+    const size_t target_offset = children_offset + tree.arg0[call] * sizeof(NodeId);
+    ASSERT_THROWS(Deserialize(with_id(target_offset, constant)), CacheError);
+}
+
+void TestRejectUncacheablePrograms() {
+    const auto always_true = [](const runtime::ObjectHolder&, const runtime::ObjectHolder&,
+                                runtime::Context&) {
+        return true;
+    };
+    auto tree = make_unique<ast::Print>(make_unique<ast::Comparison>(
+        always_true, make_unique<ast::NumericConst>(1), make_unique<ast::NumericConst>(2)));
+    auto program = Flatten(std::move(tree));
+    ASSERT_EQUAL(Run(*program), "True\n"s);
+    ASSERT_THROWS(Serialize(*program), CacheError);
+
+    TempDir dir;
+    const ProgramCache cache(dir.GetPath());
+    ASSERT(!cache.Store("print 1 < 2"s, true, *program));
+    ASSERT(!filesystem::exists(cache.GetPath("print 1 < 2"s, true)));
+}
+
+void TestCacheHitAndMiss() {
+    TempDir dir;
+    const ProgramCache cache(dir.GetPath() / "nested"s);
+    const string other_program = PROGRAM + "print 1\n"s;
+
+    ASSERT(cache.Find(PROGRAM, true) == nullptr);
+    ASSERT(cache.Store(PROGRAM, true, *BuildFlatProgram(PROGRAM)));
+
+    auto cached = cache.Find(PROGRAM, true);
+    ASSERT(cached != nullptr);
+    ASSERT_EQUAL(Run(*cached), Run(*BuildFlatProgram(PROGRAM)));
+
+    // Ключ зависит от текста программы и признака оптимизации
+    ASSERT(cache.Find(other_program, true) == nullptr);
+    ASSERT(cache.Find(PROGRAM, false) == nullptr);
+    ASSERT(cache.GetPath(PROGRAM, true) != cache.GetPath(PROGRAM, false));
+    ASSERT(cache.GetPath(PROGRAM, true) != cache.GetPath(other_program, true));
+
+    // Файл другой программы с тем же именем (совпадение хешей) считается промахом
+    filesystem::copy_file(cache.GetPath(PROGRAM, true), cache.GetPath(other_program, true));
+    ASSERT(cache.Find(other_program, true) == nullptr);
+    filesystem::copy_file(cache.GetPath(PROGRAM, true), cache.GetPath(PROGRAM, false));
+    ASSERT(cache.Find(PROGRAM, false) == nullptr);
+
+    // Повреждение, которое не нарушает структуру дерева, находит хеш данных
+    {
+        const auto path = cache.GetPath(PROGRAM, true);
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekp(static_cast<streamoff>(filesystem::file_size(path) - 1));
+        file.put('\x7f');
+    }
+    ASSERT(cache.Find(PROGRAM, true) == nullptr);
+
+    // Повреждённый файл считается промахом и перезаписывается
+    ofstream(cache.GetPath(PROGRAM, true), ios::binary | ios::trunc) << "garbage"s;
+    ASSERT(cache.Find(PROGRAM, true) == nullptr);
+    ASSERT(cache.Store(PROGRAM, true, *BuildFlatProgram(PROGRAM)));
+    ASSERT(cache.Find(PROGRAM, true) != nullptr);
+}
+
+}  // namespace
+
+void RunProgramCacheTests(TestRunner& tr) {
+    RUN_TEST(tr, flat::TestRoundTrip);
+    RUN_TEST(tr, flat::TestRoundTripLists);
+    RUN_TEST(tr, flat::TestRoundTripDicts);
+    RUN_TEST(tr, flat::TestRoundTripTailCalls);
+    RUN_TEST(tr, flat::TestRejectCorruptedData);
+    RUN_TEST(tr, flat::TestRejectUncacheablePrograms);
+    RUN_TEST(tr, flat::TestCacheHitAndMiss);
+}
+
+}  // namespace flat
@@ -1,26 +1,64 @@
 #include "runtime.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <charconv>
+#include <cstring>
+#include <functional>
 #include <optional>
+#include <set>
 #include <sstream>
+#include <string_view>
 
 using namespace std;
 
 namespace runtime {
 
+namespace {
+const Symbol SELF{"self"};
+const Symbol STR_METHOD{"__str__"};
+const Symbol APPEND_METHOD{"append"};
+const Symbol HASH_METHOD{"__hash__"};
+}  // namespace
+
+// ------------ Context --------------------
+
+void Context::WriteNumber(int value) {
+    std::array<char, 16> chars;
+    const auto result = to_chars(chars.data(), chars.data() + chars.size(), value);
+    GetOutputStream().write(chars.data(), result.ptr - chars.data());
+}
+
+void Context::EndLine() {
+    GetOutputStream().put('\n');
+}
+
 // ------------ ObjectHolder --------------------
-ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
+ObjectHolder::ObjectHolder(Ptr data)
     : data_(std::move(data)) {
 }
 
+ObjectHolder::ObjectHolder(Number value)
+    : data_(std::move(value)) {
+}
+
+ObjectHolder::ObjectHolder(Bool value)
+    : data_(std::move(value)) {
+}
+
 void ObjectHolder::AssertIsValid() const {
-    assert(data_ != nullptr);
+    assert(Get() != nullptr);
 }
 
 ObjectHolder ObjectHolder::Share(Object& object) {
-    // Возвращаем невладеющий shared_ptr (его deleter ничего не делает)
-    return ObjectHolder(std::shared_ptr<Object>(&object, [](auto* /*p*/) { /* do nothing */ }));
+    // Возвращаем невладеющий shared_ptr: aliasing-конструктор с пустым владельцем
+    // не выделяет блок управления и ничего не удаляет
+    return ObjectHolder(Ptr(Ptr(), &object));
+}
+
+ObjectHolder ObjectHolder::Share(std::shared_ptr<Object> object) {
+    return ObjectHolder(std::move(object));
 }
 
 ObjectHolder ObjectHolder::None() {
@@ -38,38 +76,216 @@ Object* ObjectHolder::operator->() const {
 }
 
 Object* ObjectHolder::Get() const {
-    return data_.get();
+    if (const auto* ptr = std::get_if<Ptr>(&data_)) {
+        return ptr->get();
+    }
+    if (auto* value = std::get_if<Number>(&data_)) {
+        return value;
+    }
+    return std::get_if<Bool>(&data_);
 }
 
 ObjectHolder::operator bool() const {
     return Get() != nullptr;
 }
 
+bool ObjectHolder::OwnsObject() const {
+    const auto* ptr = std::get_if<Ptr>(&data_);
+    return ptr && ptr->use_count() > 0;
+}
+
+// ------------ CollectableObject --------------------
+
+namespace {
+
+// Двусвязный список всех экземпляров классов, списков и словарей
+CollectableObject* collectable_objects = nullptr;
+size_t collectable_object_count = 0;
+// Количество объектов, созданных ObjectHolder::Own после последней сборки циклов
+size_t allocations_since_collection = 0;
+// Наименьшее число созданных объектов, после которого запускается сборка. Порог растёт
+// вместе с числом объектов, поэтому время сборок остаётся линейным от числа созданий
+constexpr size_t MIN_COLLECTION_THRESHOLD = 1000;
+
+CollectableObject* AsCollectable(const ObjectHolder& value) {
+    switch (value.GetKind()) {
+        case ObjectKind::INSTANCE:
+            return value.TryAs<ClassInstance>();
+        case ObjectKind::LIST:
+            return value.TryAs<List>();
+        case ObjectKind::DICT:
+            return value.TryAs<Dict>();
+        default:
+            return nullptr;
+    }
+}
+
+}  // namespace
+
+CollectableObject::CollectableObject(ObjectKind kind)
+    : Object(kind)
+    , next_(collectable_objects) {
+    if (next_) {
+        next_->prev_ = this;
+    }
+    collectable_objects = this;
+    ++collectable_object_count;
+}
+
+CollectableObject::CollectableObject(const CollectableObject& other)
+    : CollectableObject(other.GetKind())
+    {}
+
+CollectableObject::~CollectableObject() {
+    (prev_ ? prev_->next_ : collectable_objects) = next_;
+    if (next_) {
+        next_->prev_ = prev_;
+    }
+    --collectable_object_count;
+}
+
+void CountCollectableAllocation() {
+    if (++allocations_since_collection
+        >= std::max(MIN_COLLECTION_THRESHOLD, collectable_object_count)) {
+        CollectCycles();
+    }
+}
+
+// Поиск циклов вычитанием внутренних ссылок: число ссылок на каждый объект уменьшается
+// на число владеющих ссылок из других объектов списка. Объекты, на которые остались
+// внешние ссылки, и всё достижимое из них живы, остальные образуют недостижимые циклы
+void CollectCycles() {
+    allocations_since_collection = 0;
+    constexpr std::int64_t REACHABLE = -1;
+
+    for (auto* obj = collectable_objects; obj; obj = obj->next_) {
+        // Объект, которым не владеет shared_ptr, считается достижимым
+        const std::int64_t use_count = obj->weak_from_this().use_count();
+        obj->gc_refs_ = use_count > 0 ? use_count : REACHABLE;
+    }
+    for (auto* obj = collectable_objects; obj; obj = obj->next_) {
+        obj->ForEachReference([](const ObjectHolder& value) {
+            auto* target = AsCollectable(value);
+            if (target && target->gc_refs_ != REACHABLE && value.OwnsObject()) {
+                --target->gc_refs_;
+            }
+        });
+    }
+
+    std::vector<CollectableObject*> stack;
+    for (auto* obj = collectable_objects; obj; obj = obj->next_) {
+        if (obj->gc_refs_ != 0) {
+            obj->gc_refs_ = REACHABLE;
+            stack.push_back(obj);
+        }
+    }
+    while (!stack.empty()) {
+        const auto* obj = stack.back();
+        stack.pop_back();
+        obj->ForEachReference([&stack](const ObjectHolder& value) {
+            auto* target = AsCollectable(value);
+            if (target && target->gc_refs_ != REACHABLE) {
+                target->gc_refs_ = REACHABLE;
+                stack.push_back(target);
+            }
+        });
+    }
+
+    // Недостижимые объекты удерживаются, пока разрываются их ссылки, и освобождаются вместе
+    std::vector<std::shared_ptr<CollectableObject>> garbage;
+    for (auto* obj = collectable_objects; obj; obj = obj->next_) {
+        if (obj->gc_refs_ == 0) {
+            garbage.push_back(obj->shared_from_this());
+        }
+    }
+    for (const auto& obj : garbage) {
+        obj->ClearReferences();
+    }
+}
+
+size_t GetCollectableObjectCount() {
+    return collectable_object_count;
+}
+
+// ------------ Shape --------------------
+
+uint32_t Shape::FindField(Symbol name) const {
+    const auto it = offsets_.find(name);
+    return it == offsets_.end() ? NO_FIELD : it->second;
+}
+
+const Shape* Shape::AddField(Symbol name) const {
+    auto& next = transitions_[name];
+    if (!next) {
+        next = std::make_unique<Shape>();
+        next->root_ = root_;
+        next->names_ = names_;
+        next->names_.push_back(name);
+        next->offsets_ = offsets_;
+        next->offsets_.emplace(name, static_cast<uint32_t>(names_.size()));
+        root_->expected_field_count_ = std::max(root_->expected_field_count_,
+                                                next->names_.size());
+    }
+    return next.get();
+}
+
+const std::vector<Symbol>& Shape::GetFieldNames() const {
+    return names_;
+}
+
+size_t Shape::GetExpectedFieldCount() const {
+    return root_->expected_field_count_;
+}
+
 // ------------ Class --------------------
 
 Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
-    : name_(std::move(name))
+    : Object(ObjectKind::CLASS)
+    , name_(std::move(name))
     , methods_(std::move(methods))
     , parent_(parent)
-    {}
-
-const Method* Class::GetMethod(const std::string& name) const {
-    auto result = std::find_if(methods_.begin(), methods_.end(),
-            [&name](const auto& method){return name == method.name;});
-    if (result == methods_.end()) {
+    {
         if (parent_) {
-            return parent_->GetMethod(name);
-        } else {
-            return nullptr;
+            method_table_ = parent_->method_table_;
+        }
+        // Обход в обратном порядке оставляет в таблице первый из одноимённых методов класса
+        for (auto it = methods_.rbegin(); it != methods_.rend(); ++it) {
+            method_table_[it->name] = &*it;
         }
     }
-    return &(*result);
+
+const Method* Class::GetMethod(Symbol name) const {
+    const auto it = method_table_.find(name);
+    return it == method_table_.end() ? nullptr : it->second;
+}
+
+const Method* Class::GetMethod(Symbol name, MethodCache& cache) const {
+    if (const auto cached = cache.Find(this, inline_cache_counters.method_calls)) {
+        return *cached;
+    }
+    const Method* method = GetMethod(name);
+    if (method) {
+        cache.Insert(this, method);
+    }
+    return method;
 }
 
 [[nodiscard]] const std::string& Class::GetName() const {
     return name_;
 }
 
+const std::vector<Method>& Class::GetMethods() const {
+    return methods_;
+}
+
+const Class* Class::GetParent() const {
+    return parent_;
+}
+
+const Shape& Class::GetInstanceShape() const {
+    return *instance_shape_;
+}
+
 void Class::Print(ostream& os, [[maybe_unused]] Context& context) {
     using namespace std::literals;
     os << "Class "s << GetName();
@@ -84,24 +300,44 @@ void Bool::Print(std::ostream& os, [[maybe_unused]] Context& context) {
 // ------------ ClassInstance --------------------
 
 ClassInstance::ClassInstance(const Class& cls)
-    : cls_(cls)
+    : CollectableObject(ObjectKind::INSTANCE)
+    , cls_(cls)
+    , shape_(&cls.GetInstanceShape())
     {
-        using namespace std::literals;
-        fields_["self"] = ObjectHolder::Share(*this);
+        values_.reserve(shape_->GetExpectedFieldCount());
+        values_.push_back(ObjectHolder::Share(*this));
+    }
+
+ClassInstance::ClassInstance(const ClassInstance& other)
+    : CollectableObject(other)
+    , cls_(other.cls_)
+    , shape_(other.shape_)
+    , values_(other.values_)
+    {
+        values_.front() = ObjectHolder::Share(*this);
+    }
+
+ClassInstance::ClassInstance(ClassInstance&& other) noexcept
+    : CollectableObject(other)
+    , cls_(other.cls_)
+    , shape_(other.shape_)
+    , values_(std::move(other.values_))
+    {
+        values_.front() = ObjectHolder::Share(*this);
     }
 
 void ClassInstance::Print(std::ostream& os, Context& context) {
-    using namespace std::literals;
-    if (HasMethod("__str__"s, 0u)) {
-        const auto& obj = Call("__str__"s, {}, context);
-        if (const auto num_ptr = obj.TryAs<Number>()) {
-            os << num_ptr->GetValue();
-        } else if (const auto str_ptr = obj.TryAs<String>()) {
-            os << str_ptr->GetValue();
-        } else if (const auto cls_ptr = obj.TryAs<Class>()) {
-            cls_ptr->Print(os, context);
-        } else if (const auto cls_inst_ptr = obj.TryAs<ClassInstance>()) {
-            cls_inst_ptr->Print(os, context);
+    if (HasMethod(STR_METHOD, 0u)) {
+        const auto& obj = Call(STR_METHOD, {}, context);
+        switch (obj.GetKind()) {
+            case ObjectKind::NUMBER:
+            case ObjectKind::STRING:
+            case ObjectKind::CLASS:
+            case ObjectKind::INSTANCE:
+                obj->Print(os, context);
+                break;
+            default:
+                break;
         }
     } else {
         os << this;
@@ -109,7 +345,7 @@ void ClassInstance::Print(std::ostream& os, Context& context) {
 
 }
 
-bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
+bool ClassInstance::HasMethod(Symbol method, size_t argument_count) const {
     const auto method_ptr = cls_.GetMethod(method);
     if (!method_ptr) {
         return false;
@@ -120,116 +356,855 @@ bool ClassInstance::HasMethod(const std::string& method, size_t argument_count)
     return true;
 }
 
-Closure& ClassInstance::Fields() {
-    return fields_;
+ObjectHolder* ClassInstance::FindField(Symbol name) {
+    const uint32_t offset = shape_->FindField(name);
+    return offset == Shape::NO_FIELD ? nullptr : &values_[offset];
+}
+
+const ObjectHolder* ClassInstance::FindField(Symbol name) const {
+    const uint32_t offset = shape_->FindField(name);
+    return offset == Shape::NO_FIELD ? nullptr : &values_[offset];
+}
+
+ObjectHolder* ClassInstance::FindField(Symbol name, FieldLoadCache& cache) {
+    if (const auto cached = cache.Find(shape_, inline_cache_counters.field_loads)) {
+        return &values_[*cached];
+    }
+    const uint32_t offset = shape_->FindField(name);
+    if (offset == Shape::NO_FIELD) {
+        return nullptr;
+    }
+    cache.Insert(shape_, offset);
+    return &values_[offset];
+}
+
+void ClassInstance::SetField(Symbol name, ObjectHolder value,
+                             FieldStoreCache& cache) {
+    const auto* target = cache.Find(shape_, inline_cache_counters.field_stores);
+    if (!target) {
+        const Shape* shape = shape_;
+        SetField(name, std::move(value));
+        cache.Insert(shape, {shape_, shape_->FindField(name)});
+        return;
+    }
+    if (target->offset < values_.size()) {
+        values_[target->offset] = std::move(value);
+    } else {
+        values_.push_back(std::move(value));
+    }
+    shape_ = target->next_shape;
+}
+
+void ClassInstance::SetField(Symbol name, ObjectHolder value) {
+    if (ObjectHolder* field = FindField(name)) {
+        *field = std::move(value);
+        return;
+    }
+    shape_ = shape_->AddField(name);
+    values_.push_back(std::move(value));
+}
+
+const Shape& ClassInstance::GetShape() const {
+    return *shape_;
+}
+
+ObjectHolder& ClassInstance::FieldAt(uint32_t offset) {
+    return values_[offset];
+}
+
+ObjectHolder ClassInstance::LoadField(const ObjectHolder& field) {
+    return &field == values_.data() ? GetSelf() : field;
+}
+
+ObjectHolder ClassInstance::GetSelf() {
+    if (auto owner = weak_from_this().lock()) {
+        return ObjectHolder::Share(std::move(owner));
+    }
+    return ObjectHolder::Share(*this);
+}
+
+const Class& ClassInstance::GetClass() const {
+    return cls_;
+}
+
+void ClassInstance::ForEachReference(
+        const std::function<void(const ObjectHolder&)>& visit) const {
+    for (const auto& value : values_) {
+        visit(value);
+    }
 }
 
-const Closure& ClassInstance::Fields() const {
-    return fields_;
+void ClassInstance::ClearReferences() {
+    // Поля освобождаются после того, как объект вернулся в исходную форму
+    std::vector<ObjectHolder> values;
+    values.swap(values_);
+    shape_ = &cls_.GetInstanceShape();
+    values_.push_back(std::move(values.front()));
 }
 
-ObjectHolder ClassInstance::Call(const std::string& method,
+ObjectHolder ClassInstance::Call(Symbol method,
                                  const std::vector<ObjectHolder>& actual_args,
                                  Context& context) {
     if (!HasMethod(method, actual_args.size())) {
-        throw std::runtime_error("No such method \""s + method + "\" or wrong count of arguments"s);
+        throw std::runtime_error("No such method \""s + method.GetName()
+                                 + "\" or wrong count of arguments"s);
     }
-    const auto method_ptr = cls_.GetMethod(method);
+    return Call(*cls_.GetMethod(method), actual_args, context);
+}
+
+ObjectHolder ClassInstance::Call(const Method& method,
+                                 const std::vector<ObjectHolder>& actual_args,
+                                 Context& context) {
     Closure arg_name_to_obj;
-    arg_name_to_obj["self"s] = ObjectHolder::Share(*this);
-    for (size_t i = 0; i < actual_args.size(); ++i) {
-        const std::string& name = method_ptr->formal_params[i];
-        arg_name_to_obj[name] = actual_args[i];
+    // Метод разделяет владение экземпляром, чтобы возвращённый self пережил
+    // временный объект, у которого вызван метод
+    BindArguments(method, GetSelf(), actual_args, arg_name_to_obj);
+    return method.body->Execute(arg_name_to_obj, context);
+}
+
+void BindArguments(const Method& method, ObjectHolder self, const std::vector<ObjectHolder>& args,
+                   Closure& closure) {
+    assert(method.formal_params.size() == args.size());
+    closure.clear();
+    closure[SELF] = std::move(self);
+    for (size_t i = 0; i < args.size(); ++i) {
+        closure[method.formal_params[i]] = args[i];
     }
-    return method_ptr->body->Execute(arg_name_to_obj, context);
 }
 
 
+// ------------ List --------------------
 
-// ------------ other funcs --------------------
+List::List()
+    : CollectableObject(ObjectKind::LIST)
+    {}
 
-bool IsTrue(const ObjectHolder& object) {
-    using namespace std::literals;
-    if (!object) {
+List::List(std::vector<ObjectHolder> items)
+    : List() {
+    for (auto& item : items) {
+        Append(std::move(item));
+    }
+}
+
+size_t List::GetSize() const {
+    return only_numbers_ ? numbers_.size() : items_.size();
+}
+
+ObjectHolder List::Get(size_t index) const {
+    if (only_numbers_) {
+        return ObjectHolder::Own(Number(numbers_[index]));
+    }
+    return items_[index];
+}
+
+void List::Set(size_t index, ObjectHolder value) {
+    if (only_numbers_) {
+        if (const auto* number = value.TryAs<Number>()) {
+            numbers_[index] = number->GetValue();
+            return;
+        }
+        Generalize();
+    }
+    items_[index] = std::move(value);
+}
+
+void List::Append(ObjectHolder value) {
+    if (only_numbers_) {
+        if (const auto* number = value.TryAs<Number>()) {
+            numbers_.push_back(number->GetValue());
+            return;
+        }
+        Generalize();
+    }
+    items_.push_back(std::move(value));
+}
+
+size_t List::CheckIndex(const ObjectHolder& index) const {
+    const auto* number = index.TryAs<Number>();
+    if (!number) {
+        throw std::runtime_error("List indices must be numbers"s);
+    }
+    const auto size = static_cast<long long>(GetSize());
+    long long result = number->GetValue();
+    if (result < 0) {
+        result += size;
+    }
+    if (result < 0 || result >= size) {
+        throw std::runtime_error("List index out of range: "s + std::to_string(number->GetValue()));
+    }
+    return static_cast<size_t>(result);
+}
+
+bool List::HasOnlyNumbers() const {
+    return only_numbers_;
+}
+
+ObjectHolder List::Call(Symbol method, ObjectHolder* args, size_t argc) {
+    if (method == APPEND_METHOD && argc == 1) {
+        Append(std::move(args[0]));
+        return ObjectHolder::None();
+    }
+    throw std::runtime_error("List has no method "s + method.GetName() + " with "s
+                             + std::to_string(argc) + " arguments"s);
+}
+
+void List::Print(std::ostream& os, Context& context) {
+    if (is_printing_) {
+        os << "[...]"sv;
+        return;
+    }
+    is_printing_ = true;
+    os << '[';
+    for (size_t i = 0; i < GetSize(); ++i) {
+        if (i != 0) {
+            os << ", "sv;
+        }
+        if (only_numbers_) {
+            os << numbers_[i];
+        } else if (items_[i]) {
+            items_[i]->Print(os, context);
+        } else {
+            os << "None"sv;
+        }
+    }
+    os << ']';
+    is_printing_ = false;
+}
+
+void List::ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const {
+    for (const auto& item : items_) {
+        visit(item);
+    }
+}
+
+void List::ClearReferences() {
+    std::vector<ObjectHolder> items;
+    items.swap(items_);
+    numbers_.clear();
+    only_numbers_ = true;
+}
+
+void List::Generalize() {
+    items_.reserve(std::max(numbers_.capacity(), numbers_.size() + 1));
+    for (const int number : numbers_) {
+        items_.push_back(ObjectHolder::Own(Number(number)));
+    }
+    numbers_ = {};
+    only_numbers_ = false;
+}
+
+// ------------ Dict --------------------
+
+namespace {
+
+// Управляющий байт свободной ячейки. У занятых ячеек старший бит равен 0
+constexpr uint8_t EMPTY_SLOT = 0x80;
+// Количество ячеек в группе, проверяемой одной операцией над uint64_t
+constexpr size_t GROUP_WIDTH = 8;
+constexpr uint64_t LOW_BITS = 0x0101010101010101ULL;
+constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+// Перемешивает биты хеша, чтобы и номер группы, и управляющий байт зависели от всех его битов
+size_t MixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return static_cast<size_t>(hash);
+}
+
+// Семь младших битов хеша хранятся в управляющем байте, остальные выбирают группу
+uint8_t ControlByte(size_t hash) {
+    return static_cast<uint8_t>(hash & 0x7F);
+}
+
+// Загружает управляющие байты группы в uint64_t: байт ctrl[i] занимает биты 8 * i .. 8 * i + 7
+uint64_t LoadGroup(const uint8_t* ctrl) {
+    uint64_t group;
+    std::memcpy(&group, ctrl, sizeof(group));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+#endif
+    return group;
+}
+
+// Возвращает маску со старшими битами байтов группы, равных byte. Маска может содержать
+// ложные совпадения в байтах, следующих за совпавшим, поэтому ключи ячеек сравниваются
+uint64_t MatchByte(uint64_t group, uint8_t byte) {
+    const uint64_t diff = group ^ (LOW_BITS * byte);
+    return (diff - LOW_BITS) & ~diff & HIGH_BITS;
+}
+
+uint64_t MatchEmpty(uint64_t group) {
+    return group & HIGH_BITS;
+}
+
+// Номер ячейки в группе, соответствующий младшему установленному биту маски
+size_t LowestSlot(uint64_t mask) {
+    return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+}
+
+// Сравнивает ключи словаря или элементы списка; по этому же правилу работают оператор in
+// и сравнение списков и словарей на равенство. Значения разных видов не равны, если ни одно
+// из них не экземпляр класса: Equal для них выбросил бы исключение.
+// Числа и строки сравниваются без обращения к таблице Equal
+bool KeysEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (lhs.GetKind() == rhs.GetKind()) {
+        switch (lhs.GetKind()) {
+            case ObjectKind::NUMBER:
+                return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
+            case ObjectKind::STRING:
+                return lhs.TryAs<String>()->GetValue() == rhs.TryAs<String>()->GetValue();
+            default:
+                return Equal(lhs, rhs, context);
+        }
+    }
+    if (lhs.GetKind() == ObjectKind::NONE || rhs.GetKind() == ObjectKind::NONE) {
         return false;
     }
-    if (const auto num_ptr = object.TryAs<Number>()) {
-        return num_ptr->GetValue();
-    } else if (const auto str_ptr = object.TryAs<String>()) {
-        return !str_ptr->GetValue().empty();
-    } else if (const auto bool_ptr = object.TryAs<Bool>()) {
-        return bool_ptr->GetValue();
+    if (lhs.GetKind() == ObjectKind::INSTANCE) {
+        return Equal(lhs, rhs, context);
+    }
+    if (rhs.GetKind() == ObjectKind::INSTANCE) {
+        return Equal(rhs, lhs, context);
     }
     return false;
 }
 
-bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    using namespace std::literals;
+}  // namespace
 
-    if (!lhs && !rhs) {
-        return true;
+size_t Hash(const ObjectHolder& key, Context& context) {
+    switch (key.GetKind()) {
+        case ObjectKind::NONE:
+            return MixHash(0);
+        case ObjectKind::NUMBER:
+            return MixHash(static_cast<uint64_t>(key.TryAs<Number>()->GetValue()));
+        case ObjectKind::STRING:
+            return MixHash(std::hash<std::string>{}(key.TryAs<String>()->GetValue()));
+        case ObjectKind::BOOL:
+            return MixHash(key.TryAs<Bool>()->GetValue() ? 1 : 0);
+        case ObjectKind::INSTANCE: {
+            auto* instance = key.TryAs<ClassInstance>();
+            if (!instance->HasMethod(HASH_METHOD, 0)) {
+                break;
+            }
+            const ObjectHolder hash = instance->Call(HASH_METHOD, {}, context);
+            if (const auto* number = hash.TryAs<Number>()) {
+                return MixHash(static_cast<uint64_t>(number->GetValue()));
+            }
+            throw std::runtime_error("Method __hash__ must return a number"s);
+        }
+        default:
+            break;
+    }
+    throw std::runtime_error("Unhashable dict key"s);
+}
+
+Dict::Dict()
+    : CollectableObject(ObjectKind::DICT)
+    {}
+
+size_t Dict::GetSize() const {
+    return entries_.size();
+}
+
+const ObjectHolder* Dict::Find(const ObjectHolder& key, Context& context) const {
+    const size_t entry = FindEntry(key, Hash(key, context), context);
+    return entry == NO_ENTRY ? nullptr : &entries_[entry].value;
+}
+
+void Dict::Set(ObjectHolder key, ObjectHolder value, Context& context) {
+    const size_t hash = Hash(key, context);
+    if (const size_t entry = FindEntry(key, hash, context); entry != NO_ENTRY) {
+        entries_[entry].value = std::move(value);
+        return;
+    }
+    // Занято не больше 7/8 ячеек, поэтому поиск всегда доходит до группы со свободной ячейкой
+    if ((entries_.size() + 1) * 8 > ctrl_.size() * 7) {
+        Rehash(std::max(ctrl_.size() * 2, GROUP_WIDTH));
+    }
+    InsertSlot(hash, static_cast<uint32_t>(entries_.size()));
+    entries_.push_back({std::move(key), std::move(value), hash});
+}
+
+const ObjectHolder& Dict::GetKey(size_t index) const {
+    return entries_[index].key;
+}
+
+const ObjectHolder& Dict::GetValue(size_t index) const {
+    return entries_[index].value;
+}
+
+void Dict::Print(std::ostream& os, Context& context) {
+    if (is_printing_) {
+        os << "{...}"sv;
+        return;
     }
-    if (!lhs || !rhs) {
-        throw std::runtime_error("Cannot compare objects for equality"s);
+    const auto print = [&os, &context](const ObjectHolder& value) {
+        if (value) {
+            value->Print(os, context);
+        } else {
+            os << "None"sv;
+        }
+    };
+    is_printing_ = true;
+    os << '{';
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (i != 0) {
+            os << ", "sv;
+        }
+        print(entries_[i].key);
+        os << ": "sv;
+        print(entries_[i].value);
     }
+    os << '}';
+    is_printing_ = false;
+}
 
-    if (const auto lhs_num_ptr = lhs.TryAs<Number>(),
-                   rhs_num_ptr = rhs.TryAs<Number>();
-                   lhs_num_ptr && rhs_num_ptr) {
-        return lhs_num_ptr->GetValue() == rhs_num_ptr->GetValue();
+void Dict::ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const {
+    for (const auto& entry : entries_) {
+        visit(entry.key);
+        visit(entry.value);
     }
-    if (const auto lhs_str_ptr = lhs.TryAs<String>(),
-                   rhs_str_ptr = rhs.TryAs<String>();
-                   lhs_str_ptr && rhs_str_ptr) {
-        return lhs_str_ptr->GetValue() == rhs_str_ptr->GetValue();
+}
+
+void Dict::ClearReferences() {
+    std::vector<Entry> entries;
+    entries.swap(entries_);
+    ctrl_.clear();
+    slots_.clear();
+}
+
+size_t Dict::FindEntry(const ObjectHolder& key, size_t hash, Context& context) const {
+    if (ctrl_.empty()) {
+        return NO_ENTRY;
     }
-    if (const auto lhs_bool_ptr = lhs.TryAs<Bool>(),
-                   rhs_bool_ptr = rhs.TryAs<Bool>();
-                   lhs_bool_ptr && rhs_bool_ptr) {
-        return lhs_bool_ptr->GetValue() == rhs_bool_ptr->GetValue();
+    const size_t group_mask = ctrl_.size() / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    // Треугольные шаги 1, 2, 3... обходят все группы, так как их число - степень двойки
+    for (size_t step = 1;; ++step) {
+        const uint64_t ctrl = LoadGroup(&ctrl_[group * GROUP_WIDTH]);
+        for (uint64_t match = MatchByte(ctrl, ControlByte(hash)); match != 0;
+             match &= match - 1) {
+            const uint32_t entry = slots_[group * GROUP_WIDTH + LowestSlot(match)];
+            const Entry& candidate = entries_[entry];
+            if (candidate.hash != hash) {
+                continue;
+            }
+            // __eq__ экземпляра может изменить словарь, поэтому его ключ копируется
+            const bool calls_eq = key.GetKind() == ObjectKind::INSTANCE
+                || candidate.key.GetKind() == ObjectKind::INSTANCE;
+            if (calls_eq ? KeysEqual(key, ObjectHolder(candidate.key), context)
+                         : KeysEqual(key, candidate.key, context)) {
+                return entry;
+            }
+        }
+        if (MatchEmpty(ctrl) != 0) {
+            return NO_ENTRY;
+        }
+        group = (group + step) & group_mask;
     }
+}
 
-    if (const auto lhs_cls_inst_ptr = lhs.TryAs<ClassInstance>()) {
-        if (lhs_cls_inst_ptr->HasMethod("__eq__"s, 1u)) {
-            return lhs_cls_inst_ptr->Call("__eq__"s, {rhs}, context).TryAs<Bool>()->GetValue();
+void Dict::InsertSlot(size_t hash, uint32_t entry) {
+    const size_t group_mask = ctrl_.size() / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    for (size_t step = 1;; ++step) {
+        const uint64_t empty = MatchEmpty(LoadGroup(&ctrl_[group * GROUP_WIDTH]));
+        if (empty != 0) {
+            const size_t slot = group * GROUP_WIDTH + LowestSlot(empty);
+            ctrl_[slot] = ControlByte(hash);
+            slots_[slot] = entry;
+            return;
         }
+        group = (group + step) & group_mask;
     }
+}
 
-    throw std::runtime_error("Cannot compare objects for equality"s);
+void Dict::Rehash(size_t capacity) {
+    ctrl_.assign(capacity, EMPTY_SLOT);
+    slots_.assign(capacity, 0);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        InsertSlot(entries_[i].hash, static_cast<uint32_t>(i));
+    }
 }
 
-bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    using namespace std::literals;
+// ------------ other funcs --------------------
 
-    if (!lhs || !rhs) {
-        throw std::runtime_error("Cannot compare objects for less"s);
+void PrintInlineCacheStats(std::ostream& os, const InlineCacheCounters& counters) {
+    const auto print = [&os](std::string_view name, const InlineCacheStats& stats) {
+        const auto total = stats.hits + stats.misses;
+        os << name << ": "sv << stats.hits << " hits, "sv << stats.misses << " misses"sv;
+        if (total > 0) {
+            os << " ("sv << stats.hits * 100 / total << "% hit rate)"sv;
+        }
+        os << '\n';
+    };
+    print("method calls"sv, counters.method_calls);
+    print("field loads"sv, counters.field_loads);
+    print("field stores"sv, counters.field_stores);
+}
+
+bool IsTrue(const ObjectHolder& object) {
+    switch (object.GetKind()) {
+        case ObjectKind::NUMBER:
+            return object.TryAs<Number>()->GetValue() != 0;
+        case ObjectKind::STRING:
+            return !object.TryAs<String>()->GetValue().empty();
+        case ObjectKind::BOOL:
+            return object.TryAs<Bool>()->GetValue();
+        case ObjectKind::LIST:
+            return object.TryAs<List>()->GetSize() != 0;
+        case ObjectKind::DICT:
+            return object.TryAs<Dict>()->GetSize() != 0;
+        default:
+            return false;
+    }
+}
+
+bool Contains(const ObjectHolder& item, const ObjectHolder& container, Context& context) {
+    if (const auto* dict = container.TryAs<Dict>()) {
+        return dict->Find(item, context) != nullptr;
+    }
+    if (const auto* list = container.TryAs<List>()) {
+        for (size_t i = 0; i < list->GetSize(); ++i) {
+            if (KeysEqual(item, list->Get(i), context)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    const auto* str = container.TryAs<String>();
+    const auto* substr = item.TryAs<String>();
+    if (str && substr) {
+        return str->GetValue().find(substr->GetValue()) != std::string::npos;
     }
+    throw std::runtime_error("Operator in requires a list, a dict or a string"s);
+}
 
-    if (const auto lhs_num_ptr = lhs.TryAs<Number>(),
-                   rhs_num_ptr = rhs.TryAs<Number>();
-                   lhs_num_ptr && rhs_num_ptr) {
-        return lhs_num_ptr->GetValue() < rhs_num_ptr->GetValue();
+ObjectHolder Len(const ObjectHolder& object) {
+    if (const auto* list = object.TryAs<List>()) {
+        return ObjectHolder::Own(Number(static_cast<int>(list->GetSize())));
+    }
+    if (const auto* dict = object.TryAs<Dict>()) {
+        return ObjectHolder::Own(Number(static_cast<int>(dict->GetSize())));
+    }
+    if (const auto* str = object.TryAs<String>()) {
+        return ObjectHolder::Own(Number(static_cast<int>(str->GetValue().size())));
     }
-    if (const auto lhs_str_ptr = lhs.TryAs<String>(),
-                   rhs_str_ptr = rhs.TryAs<String>();
-                   lhs_str_ptr && rhs_str_ptr) {
-        return lhs_str_ptr->GetValue() < rhs_str_ptr->GetValue();
+    throw std::runtime_error("Object has no len()"s);
+}
+
+ObjectHolder GetItem(const ObjectHolder& object, const ObjectHolder& index, Context& context) {
+    if (const auto* list = object.TryAs<List>()) {
+        return list->Get(list->CheckIndex(index));
     }
-    if (const auto lhs_bool_ptr = lhs.TryAs<Bool>(),
-                   rhs_bool_ptr = rhs.TryAs<Bool>();
-                   lhs_bool_ptr && rhs_bool_ptr) {
-        return lhs_bool_ptr->GetValue() < rhs_bool_ptr->GetValue();
+    if (const auto* dict = object.TryAs<Dict>()) {
+        if (const ObjectHolder* value = dict->Find(index, context)) {
+            return *value;
+        }
+        throw std::runtime_error("Key not found in dict"s);
     }
+    throw std::runtime_error("Object is not subscriptable"s);
+}
+
+void SetItem(const ObjectHolder& object, const ObjectHolder& index, ObjectHolder value,
+             Context& context) {
+    if (auto* list = object.TryAs<List>()) {
+        list->Set(list->CheckIndex(index), std::move(value));
+        return;
+    }
+    if (auto* dict = object.TryAs<Dict>()) {
+        dict->Set(index, std::move(value), context);
+        return;
+    }
+    throw std::runtime_error("Object does not support item assignment"s);
+}
 
-    if (const auto lhs_cls_inst_ptr = lhs.TryAs<ClassInstance>()) {
-        if (lhs_cls_inst_ptr->HasMethod("__lt__"s, 1u)) {
-            return lhs_cls_inst_ptr->Call("__lt__"s, {rhs}, context).TryAs<Bool>()->GetValue();
+bool GetIterationItem(const ObjectHolder& iterable, size_t index, ObjectHolder& item) {
+    if (const auto* list = iterable.TryAs<List>()) {
+        if (index >= list->GetSize()) {
+            return false;
         }
+        item = list->Get(index);
+        return true;
+    }
+    if (const auto* dict = iterable.TryAs<Dict>()) {
+        if (index >= dict->GetSize()) {
+            return false;
+        }
+        item = dict->GetKey(index);
+        return true;
+    }
+    throw std::runtime_error("Loop for can iterate only over lists and dicts"s);
+}
+
+namespace {
+
+using namespace std::literals;
+
+const Symbol ADD_METHOD{"__add__"};
+const Symbol EQ_METHOD{"__eq__"};
+const Symbol LT_METHOD{"__lt__"};
+
+using BinaryOperation = ObjectHolder (*)(const ObjectHolder& lhs, const ObjectHolder& rhs,
+                                         Context& context);
+using CompareOperation = bool (*)(const ObjectHolder& lhs, const ObjectHolder& rhs,
+                                  Context& context);
+
+// Таблица реализаций операции, индексированная видами левого и правого операндов
+template <typename Operation>
+using DispatchTable = std::array<std::array<Operation, OBJECT_KIND_COUNT>, OBJECT_KIND_COUNT>;
+
+constexpr size_t Index(ObjectKind kind) {
+    return static_cast<size_t>(kind);
+}
+
+// Создаёт таблицу, все элементы которой равны fallback
+template <typename Operation>
+DispatchTable<Operation> MakeTable(Operation fallback) {
+    DispatchTable<Operation> table;
+    for (auto& row : table) {
+        row.fill(fallback);
     }
+    return table;
+}
+
+// Вызывает у экземпляра lhs метод method с аргументом rhs и приводит результат к bool
+bool CallCompareMethod(const ObjectHolder& lhs, Symbol method,
+                       const ObjectHolder& rhs, Context& context) {
+    return lhs.TryAs<ClassInstance>()->Call(method, {rhs}, context).TryAs<Bool>()->GetValue();
+}
+
+// ---- Add ----
+
+ObjectHolder AddNumbers(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    return ObjectHolder::Own(Number(lhs.TryAs<Number>()->GetValue()
+                                    + rhs.TryAs<Number>()->GetValue()));
+}
+
+ObjectHolder AddStrings(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    return ObjectHolder::Own(String(lhs.TryAs<String>()->GetValue()
+                                    + rhs.TryAs<String>()->GetValue()));
+}
 
+ObjectHolder AddInstance(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    auto* cls_inst_ptr = lhs.TryAs<ClassInstance>();
+    if (cls_inst_ptr->HasMethod(ADD_METHOD, 1u)) {
+        return cls_inst_ptr->Call(ADD_METHOD, {rhs}, context);
+    }
+    throw std::runtime_error("Failed on Add operation"s);
+}
+
+ObjectHolder FailAdd(const ObjectHolder&, const ObjectHolder&, Context&) {
+    throw std::runtime_error("Failed on Add operation"s);
+}
+
+const DispatchTable<BinaryOperation> ADD_TABLE = [] {
+    auto table = MakeTable<BinaryOperation>(FailAdd);
+    table[Index(ObjectKind::NUMBER)][Index(ObjectKind::NUMBER)] = AddNumbers;
+    table[Index(ObjectKind::STRING)][Index(ObjectKind::STRING)] = AddStrings;
+    table[Index(ObjectKind::INSTANCE)].fill(AddInstance);
+    return table;
+}();
+
+// ---- Sub, Mult, Div ----
+
+ObjectHolder SubNumbers(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    return ObjectHolder::Own(Number(lhs.TryAs<Number>()->GetValue()
+                                    - rhs.TryAs<Number>()->GetValue()));
+}
+
+ObjectHolder FailSub(const ObjectHolder&, const ObjectHolder&, Context&) {
+    throw std::runtime_error("Failed on Sub operation"s);
+}
+
+ObjectHolder MultNumbers(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    return ObjectHolder::Own(Number(lhs.TryAs<Number>()->GetValue()
+                                    * rhs.TryAs<Number>()->GetValue()));
+}
+
+ObjectHolder FailMult(const ObjectHolder&, const ObjectHolder&, Context&) {
+    throw std::runtime_error("Failed on Mult operation"s);
+}
+
+ObjectHolder DivNumbers(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    const int divisor = rhs.TryAs<Number>()->GetValue();
+    if (divisor == 0) {
+        throw std::runtime_error("Failed on Div operation"s);
+    }
+    return ObjectHolder::Own(Number(lhs.TryAs<Number>()->GetValue() / divisor));
+}
+
+ObjectHolder FailDiv(const ObjectHolder&, const ObjectHolder&, Context&) {
+    throw std::runtime_error("Failed on Div operation"s);
+}
+
+// Создаёт таблицу, в которой определена только операция над двумя числами
+DispatchTable<BinaryOperation> MakeNumericTable(BinaryOperation numbers, BinaryOperation fail) {
+    auto table = MakeTable<BinaryOperation>(fail);
+    table[Index(ObjectKind::NUMBER)][Index(ObjectKind::NUMBER)] = numbers;
+    return table;
+}
+
+const DispatchTable<BinaryOperation> SUB_TABLE = MakeNumericTable(SubNumbers, FailSub);
+const DispatchTable<BinaryOperation> MULT_TABLE = MakeNumericTable(MultNumbers, FailMult);
+const DispatchTable<BinaryOperation> DIV_TABLE = MakeNumericTable(DivNumbers, FailDiv);
+
+// ---- Equal, Less ----
+
+// Сравнивает значения объектов типа T оператором Cmp
+template <typename T, typename Cmp>
+bool CompareValues(const ObjectHolder& lhs, const ObjectHolder& rhs, Context&) {
+    return Cmp{}(lhs.TryAs<T>()->GetValue(), rhs.TryAs<T>()->GetValue());
+}
+
+bool EqualNones(const ObjectHolder&, const ObjectHolder&, Context&) {
+    return true;
+}
+
+bool EqualInstance(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (lhs.TryAs<ClassInstance>()->HasMethod(EQ_METHOD, 1u)) {
+        return CallCompareMethod(lhs, EQ_METHOD, rhs, context);
+    }
+    throw std::runtime_error("Cannot compare objects for equality"s);
+}
+
+// Пары списков и словарей, которые сравниваются в данный момент
+std::set<std::pair<const Object*, const Object*>> containers_in_comparison;
+
+// Сравнивает контейнеры lhs и rhs функцией equal_items. Контейнер может содержать сам себя,
+// поэтому пара, которая уже сравнивается выше по стеку, считается равной: результат
+// определяют остальные элементы. Так же Print выводит вложенный в себя список как [...]
+template <typename EqualItems>
+bool EqualContainers(const Object& lhs, const Object& rhs, EqualItems equal_items) {
+    if (&lhs == &rhs) {
+        return true;
+    }
+    const auto insertion = containers_in_comparison.emplace(&lhs, &rhs);
+    if (!insertion.second) {
+        return true;
+    }
+    // Пара удаляется и тогда, когда сравнение элементов выбросило исключение
+    struct PairGuard {
+        decltype(insertion.first) it;
+
+        ~PairGuard() {
+            containers_in_comparison.erase(it);
+        }
+    } guard{insertion.first};
+    return equal_items();
+}
+
+bool EqualLists(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    const auto& lhs_list = *lhs.TryAs<List>();
+    const auto& rhs_list = *rhs.TryAs<List>();
+    if (lhs_list.GetSize() != rhs_list.GetSize()) {
+        return false;
+    }
+    return EqualContainers(lhs_list, rhs_list, [&] {
+        // Метод __eq__ элемента может изменить любой из списков, поэтому размеры
+        // проверяются на каждом шаге
+        for (size_t i = 0; i < lhs_list.GetSize() && i < rhs_list.GetSize(); ++i) {
+            if (!KeysEqual(lhs_list.Get(i), rhs_list.Get(i), context)) {
+                return false;
+            }
+        }
+        return lhs_list.GetSize() == rhs_list.GetSize();
+    });
+}
+
+bool EqualDicts(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    const auto& lhs_dict = *lhs.TryAs<Dict>();
+    const auto& rhs_dict = *rhs.TryAs<Dict>();
+    if (lhs_dict.GetSize() != rhs_dict.GetSize()) {
+        return false;
+    }
+    return EqualContainers(lhs_dict, rhs_dict, [&] {
+        for (size_t i = 0; i < lhs_dict.GetSize(); ++i) {
+            const ObjectHolder* rhs_value = rhs_dict.Find(lhs_dict.GetKey(i), context);
+            if (!rhs_value || !KeysEqual(lhs_dict.GetValue(i), *rhs_value, context)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+bool FailEqual(const ObjectHolder&, const ObjectHolder&, Context&) {
+    throw std::runtime_error("Cannot compare objects for equality"s);
+}
+
+bool LessInstance(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (lhs.TryAs<ClassInstance>()->HasMethod(LT_METHOD, 1u)) {
+        return CallCompareMethod(lhs, LT_METHOD, rhs, context);
+    }
+    throw std::runtime_error("Cannot compare objects for less"s);
+}
+
+bool FailLess(const ObjectHolder&, const ObjectHolder&, Context&) {
     throw std::runtime_error("Cannot compare objects for less"s);
 }
 
+// Создаёт таблицу сравнения чисел, строк и логических значений оператором Cmp.
+// Экземпляры классов сравниваются методом instance, если правый операнд не None
+template <template <typename> typename Cmp>
+DispatchTable<CompareOperation> MakeCompareTable(CompareOperation instance,
+                                                 CompareOperation fail) {
+    auto table = MakeTable<CompareOperation>(fail);
+    table[Index(ObjectKind::NUMBER)][Index(ObjectKind::NUMBER)]
+        = CompareValues<Number, Cmp<int>>;
+    table[Index(ObjectKind::STRING)][Index(ObjectKind::STRING)]
+        = CompareValues<String, Cmp<std::string>>;
+    table[Index(ObjectKind::BOOL)][Index(ObjectKind::BOOL)] = CompareValues<Bool, Cmp<bool>>;
+    table[Index(ObjectKind::INSTANCE)].fill(instance);
+    table[Index(ObjectKind::INSTANCE)][Index(ObjectKind::NONE)] = fail;
+    return table;
+}
+
+const DispatchTable<CompareOperation> EQUAL_TABLE = [] {
+    auto table = MakeCompareTable<std::equal_to>(EqualInstance, FailEqual);
+    table[Index(ObjectKind::NONE)][Index(ObjectKind::NONE)] = EqualNones;
+    table[Index(ObjectKind::LIST)][Index(ObjectKind::LIST)] = EqualLists;
+    table[Index(ObjectKind::DICT)][Index(ObjectKind::DICT)] = EqualDicts;
+    return table;
+}();
+
+const DispatchTable<CompareOperation> LESS_TABLE
+    = MakeCompareTable<std::less>(LessInstance, FailLess);
+
+// Выполняет операцию из таблицы table, соответствующую видам операндов
+template <typename Operation>
+auto Dispatch(const DispatchTable<Operation>& table, const ObjectHolder& lhs,
+              const ObjectHolder& rhs, Context& context) {
+    return table[Index(lhs.GetKind())][Index(rhs.GetKind())](lhs, rhs, context);
+}
+
+}  // namespace
+
+bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(EQUAL_TABLE, lhs, rhs, context);
+}
+
+bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(LESS_TABLE, lhs, rhs, context);
+}
+
+ObjectHolder Add(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(ADD_TABLE, lhs, rhs, context);
+}
+
+ObjectHolder Sub(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(SUB_TABLE, lhs, rhs, context);
+}
+
+ObjectHolder Mult(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(MULT_TABLE, lhs, rhs, context);
+}
+
+ObjectHolder Div(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    return Dispatch(DIV_TABLE, lhs, rhs, context);
+}
+
 bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
     return !Equal(lhs, rhs, context);
 }
@@ -246,4 +1221,25 @@ bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& c
     return !Less(lhs, rhs, context);
 }
 
+Range Range::FromArgs(const ObjectHolder& start, const ObjectHolder& stop,
+                      const ObjectHolder& step) {
+    const auto to_int = [](const ObjectHolder& value, int default_value) {
+        if (!value) {
+            return default_value;
+        }
+        if (const auto* number = value.TryAs<Number>()) {
+            return number->GetValue();
+        }
+        throw std::runtime_error("range() arguments must be numbers"s);
+    };
+    if (!stop.TryAs<Number>()) {
+        throw std::runtime_error("range() arguments must be numbers"s);
+    }
+    Range range{to_int(start, 0), stop.TryAs<Number>()->GetValue(), to_int(step, 1)};
+    if (range.step == 0) {
+        throw std::runtime_error("range() step must not be zero"s);
+    }
+    return range;
+}
+
 }  // namespace runtime
@@ -1,31 +1,170 @@
 #pragma once
 
+#include "inline_cache.h"
+#include "output_buffer.h"
+#include "symbol.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 namespace runtime {
 
+// Способ, которым завершилось выполнение инструкции
+enum class Completion : std::uint8_t {
+    NORMAL,     // выполнение продолжается со следующей инструкции
+    RETURN,     // выполнена инструкция return, метод должен завершиться
+    TAIL_CALL,  // метод вызвал сам себя в хвостовой позиции: его область видимости уже
+                // содержит новые аргументы, и тело метода должно выполниться заново
+};
+
 // Контекст исполнения инструкций Mython
 class Context {
 public:
     // Возвращает поток вывода для команд print
     virtual std::ostream& GetOutputStream() = 0;
 
+    // Выводит число value в поток вывода
+    virtual void WriteNumber(int value);
+
+    // Завершает строку, выведенную командой print
+    virtual void EndLine();
+
+    // Сигнал завершения, выставленный последней выполненной инструкцией.
+    // Составные инструкции прекращают выполнение, пока сигнал отличен от NORMAL,
+    // тело метода сбрасывает его
+    [[nodiscard]] Completion GetCompletion() const {
+        return completion_;
+    }
+
+    void SetCompletion(Completion completion) {
+        completion_ = completion;
+    }
+
 protected:
     ~Context() = default;
+
+private:
+    Completion completion_ = Completion::NORMAL;
+};
+
+// Вид объекта. Позволяет определить тип значения без dynamic_cast
+enum class ObjectKind : std::uint8_t {
+    NONE,
+    NUMBER,
+    STRING,
+    BOOL,
+    CLASS,
+    INSTANCE,
+    LIST,
+    DICT,
+    OTHER,  // объекты прочих типов, унаследованных от Object
 };
 
+// Количество значений ObjectKind
+inline constexpr size_t OBJECT_KIND_COUNT = static_cast<size_t>(ObjectKind::OTHER) + 1;
+
 // Базовый класс для всех объектов языка Mython
 class Object {
 public:
+    Object() = default;
+
+    explicit Object(ObjectKind kind)
+        : kind_(kind) {
+    }
+
     virtual ~Object() = default;
     // выводит в os своё представление в виде строки
     virtual void Print(std::ostream& os, Context& context) = 0;
+
+    [[nodiscard]] ObjectKind GetKind() const {
+        return kind_;
+    }
+
+private:
+    ObjectKind kind_ = ObjectKind::OTHER;
 };
 
+// Вид объектов типа T. Для типов, не перечисленных в ObjectKind, равен ObjectKind::OTHER
+template <typename T>
+inline constexpr ObjectKind KIND_OF = ObjectKind::OTHER;
+
+// Объект-значение, хранящий значение типа T
+template <typename T>
+class ValueObject : public Object {
+public:
+    ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+        : Object(KIND_OF<ValueObject>)
+        , value_(v) {
+    }
+
+    void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
+        os << value_;
+    }
+
+    [[nodiscard]] const T& GetValue() const {
+        return value_;
+    }
+
+protected:
+    ValueObject(T v, ObjectKind kind)
+        : Object(kind)
+        , value_(v) {
+    }
+
+private:
+    T value_;
+};
+
+// Строковое значение
+using String = ValueObject<std::string>;
+// Числовое значение
+using Number = ValueObject<int>;
+
+// Логическое значение
+class Bool : public ValueObject<bool> {
+public:
+    Bool(bool v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+        : ValueObject<bool>(v, ObjectKind::BOOL) {
+    }
+
+    void Print(std::ostream& os, Context& context) override;
+};
+
+class Class;
+class ClassInstance;
+class List;
+class Dict;
+class CollectableObject;
+
+// Учитывает создание объекта, который может входить в цикл ссылок, и запускает CollectCycles,
+// когда после прошлой сборки создано не меньше 1000 таких объектов и не меньше, чем их
+// существует сейчас. Вызывается из ObjectHolder::Own
+void CountCollectableAllocation();
+
+template <>
+inline constexpr ObjectKind KIND_OF<Number> = ObjectKind::NUMBER;
+template <>
+inline constexpr ObjectKind KIND_OF<String> = ObjectKind::STRING;
+template <>
+inline constexpr ObjectKind KIND_OF<Bool> = ObjectKind::BOOL;
+template <>
+inline constexpr ObjectKind KIND_OF<Class> = ObjectKind::CLASS;
+template <>
+inline constexpr ObjectKind KIND_OF<ClassInstance> = ObjectKind::INSTANCE;
+template <>
+inline constexpr ObjectKind KIND_OF<List> = ObjectKind::LIST;
+template <>
+inline constexpr ObjectKind KIND_OF<Dict> = ObjectKind::DICT;
+
 // Специальный класс-обёртка, предназначенный для хранения объекта в Mython-программе
 class ObjectHolder {
 public:
@@ -34,14 +173,27 @@ public:
 
     // Возвращает ObjectHolder, владеющий объектом типа T
     // Тип T - конкретный класс-наследник Object.
-    // object копируется или перемещается в кучу
+    // Number и Bool хранятся непосредственно внутри ObjectHolder,
+    // остальные объекты копируются или перемещаются в кучу
     template <typename T>
     [[nodiscard]] static ObjectHolder Own(T&& object) {
-        return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+        using Type = std::decay_t<T>;
+        if constexpr (std::is_same_v<Type, Number> || std::is_same_v<Type, Bool>) {
+            return ObjectHolder(Type(std::forward<T>(object)));
+        } else {
+            auto ptr = std::make_shared<Type>(std::forward<T>(object));
+            if constexpr (std::is_base_of_v<CollectableObject, Type>) {
+                // Новым объектом уже владеет ptr, поэтому сборка циклов его не освободит
+                CountCollectableAllocation();
+            }
+            return ObjectHolder(std::move(ptr));
+        }
     }
 
     // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки)
     [[nodiscard]] static ObjectHolder Share(Object& object);
+    // Создаёт ObjectHolder, разделяющий владение объектом с object
+    [[nodiscard]] static ObjectHolder Share(std::shared_ptr<Object> object);
     // Создаёт пустой ObjectHolder, соответствующий значению None
     [[nodiscard]] static ObjectHolder None();
 
@@ -53,48 +205,70 @@ public:
 
     [[nodiscard]] Object* Get() const;
 
+    // Возвращает true, если ObjectHolder разделяет владение объектом в куче
+    [[nodiscard]] bool OwnsObject() const;
+
+    // Возвращает вид хранимого объекта либо ObjectKind::NONE для пустого ObjectHolder
+    [[nodiscard]] ObjectKind GetKind() const {
+        switch (data_.index()) {
+            case PTR_INDEX: {
+                const Object* ptr = std::get<PTR_INDEX>(data_).get();
+                return ptr ? ptr->GetKind() : ObjectKind::NONE;
+            }
+            case NUMBER_INDEX:
+                return ObjectKind::NUMBER;
+            case BOOL_INDEX:
+                return ObjectKind::BOOL;
+            default:
+                return ObjectKind::NONE;
+        }
+    }
+
     // Возвращает указатель на объект типа T либо nullptr, если внутри ObjectHolder не хранится
-    // объект данного типа
+    // объект данного типа.
+    // Для типов с известным видом (KIND_OF<T> != OTHER) проверяется только вид объекта
     template <typename T>
     [[nodiscard]] T* TryAs() const {
-        return dynamic_cast<T*>(this->Get());
+        if constexpr (KIND_OF<T> != ObjectKind::OTHER) {
+            if (GetKind() != KIND_OF<T>) {
+                return nullptr;
+            }
+            if constexpr (std::is_same_v<T, Number> || std::is_same_v<T, Bool>) {
+                if (auto* value = std::get_if<T>(&data_)) {
+                    return value;
+                }
+            }
+            return static_cast<T*>(std::get<PTR_INDEX>(data_).get());
+        } else {
+            return dynamic_cast<T*>(Get());
+        }
     }
 
     // Возвращает true, если ObjectHolder не пуст
     explicit operator bool() const;
 
 private:
-    explicit ObjectHolder(std::shared_ptr<Object> data);
-    void AssertIsValid() const;
-
-    std::shared_ptr<Object> data_;
-};
-
-// Объект-значение, хранящий значение типа T
-template <typename T>
-class ValueObject : public Object {
-public:
-    ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
-        : value_(v) {
-    }
+    using Ptr = std::shared_ptr<Object>;
 
-    void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
-        os << value_;
-    }
+    explicit ObjectHolder(Ptr data);
+    explicit ObjectHolder(Number value);
+    explicit ObjectHolder(Bool value);
+    void AssertIsValid() const;
 
-    [[nodiscard]] const T& GetValue() const {
-        return value_;
-    }
+    static constexpr size_t PTR_INDEX = 1;
+    static constexpr size_t NUMBER_INDEX = 2;
+    static constexpr size_t BOOL_INDEX = 3;
 
-private:
-    T value_;
+    // Пустое значение (None), объект в куче либо непосредственное значение.
+    // mutable, т.к. Get() возвращает неконстантный указатель на хранимое значение
+    mutable std::variant<std::monostate, Ptr, Number, Bool> data_;
 };
 
 // Таблица символов, связывающая имя объекта с его значением
-using Closure = std::unordered_map<std::string, ObjectHolder>;
+using Closure = std::unordered_map<Symbol, ObjectHolder>;
 
 // Проверяет, содержится ли в object значение, приводимое к True
-// Для 0, False, None, и пустых строк возвращается false, в остальных случаях - true
+// Для 0, False, None, пустых строк и пустых списков возвращается false, в остальных случаях - true
 bool IsTrue(const ObjectHolder& object);
 
 // Интерфейс для выполнения действий над объектами Mython
@@ -106,55 +280,161 @@ public:
     virtual ObjectHolder Execute(Closure& closure, Context& context) = 0;
 };
 
-// Строковое значение
-using String = ValueObject<std::string>;
-// Числовое значение
-using Number = ValueObject<int>;
+// Удаляет Executable, если указатель владеет им. Объекты, созданные в арене (runtime::Arena),
+// разрушает сама арена, поэтому указатели на них создаются с owns_object == false
+struct ExecutableDeleter {
+    ExecutableDeleter() = default;
 
-// Логическое значение
-class Bool : public ValueObject<bool> {
-public:
-    using ValueObject<bool>::ValueObject;
+    explicit ExecutableDeleter(bool owns_object)
+        : owns_object(owns_object) {
+    }
 
-    void Print(std::ostream& os, Context& context) override;
+    // Позволяет передавать std::unique_ptr, созданный make_unique, туда,
+    // где ожидается ExecutablePtr
+    template <typename T>
+    ExecutableDeleter(std::default_delete<T> /*deleter*/) {  // NOLINT(google-explicit-constructor)
+    }
+
+    void operator()(Executable* object) const {
+        if (owns_object) {
+            delete object;
+        }
+    }
+
+    bool owns_object = true;
 };
 
+// Указатель на Executable, размещённый в куче либо в арене
+template <typename T = Executable>
+using ExecutablePtr = std::unique_ptr<T, ExecutableDeleter>;
+
 // Метод класса
 struct Method {
     // Имя метода
-    std::string name;
+    Symbol name;
     // Имена формальных параметров метода
-    std::vector<std::string> formal_params;
+    std::vector<Symbol> formal_params;
     // Тело метода
-    std::unique_ptr<Executable> body;
+    ExecutablePtr<> body;
+};
+
+// Форма объекта: набор его полей и их номера в массиве значений полей.
+// Экземпляры одного класса, получившие одинаковые поля в одинаковом порядке, разделяют форму.
+// Формы образуют дерево переходов, корнем которого является форма класса без полей
+class Shape {
+public:
+    // Номер, возвращаемый FindField для отсутствующего поля
+    static constexpr uint32_t NO_FIELD = std::numeric_limits<uint32_t>::max();
+
+    Shape() = default;
+
+    Shape(const Shape&) = delete;
+    Shape& operator=(const Shape&) = delete;
+
+    // Возвращает номер поля name либо NO_FIELD, если в форме нет такого поля
+    [[nodiscard]] uint32_t FindField(Symbol name) const;
+
+    // Возвращает форму, получаемую из текущей добавлением поля name в конец.
+    // Переходы запоминаются, поэтому одинаковые последовательности добавления полей
+    // приводят к одной и той же форме
+    [[nodiscard]] const Shape* AddField(Symbol name) const;
+
+    // Возвращает имена полей в порядке их номеров
+    [[nodiscard]] const std::vector<Symbol>& GetFieldNames() const;
+
+    // Возвращает наибольшее число полей среди форм, полученных из корня дерева переходов.
+    // Позволяет сразу выделить экземпляру память под все поля, которые он, вероятно, получит
+    [[nodiscard]] size_t GetExpectedFieldCount() const;
+
+private:
+    const Shape* root_ = this;
+    std::vector<Symbol> names_;
+    std::unordered_map<Symbol, uint32_t> offsets_;
+    mutable std::unordered_map<Symbol, std::unique_ptr<Shape>> transitions_;
+    mutable size_t expected_field_count_ = 0;
 };
 
+// Объект, который может ссылаться на другие объекты: экземпляр класса, список или словарь.
+// Такие объекты могут ссылаться друг на друга по кругу, и подсчёт ссылок shared_ptr
+// не освободит их. Все они входят в общий список, по которому CollectCycles находит циклы,
+// недостижимые из программы
+class CollectableObject : public Object, public std::enable_shared_from_this<CollectableObject> {
+public:
+    explicit CollectableObject(ObjectKind kind);
+    // Копия входит в общий список независимо от оригинала
+    CollectableObject(const CollectableObject& other);
+    CollectableObject& operator=(const CollectableObject&) = delete;
+    ~CollectableObject() override;
+
+    // Вызывает visit для каждого значения, на которое ссылается объект
+    virtual void ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const = 0;
+
+    // Удаляет ссылки объекта на другие значения, разрывая циклы, в которые он входит
+    virtual void ClearReferences() = 0;
+
+private:
+    friend void CollectCycles();
+
+    CollectableObject* prev_ = nullptr;
+    CollectableObject* next_ = nullptr;
+    // Число ссылок на объект не из других объектов списка. Используется в CollectCycles
+    std::int64_t gc_refs_ = 0;
+};
+
+// Освобождает объекты, ссылающиеся друг на друга по кругу, если на них нет других ссылок:
+// из переменных, стека значений, узлов программы и объектов, достижимых из них.
+// Объекты, которыми не владеет ObjectHolder (например, размещённые на стеке), не освобождаются
+void CollectCycles();
+
+// Возвращает количество существующих экземпляров классов, списков и словарей
+[[nodiscard]] size_t GetCollectableObjectCount();
+
 // Класс
 class Class : public Object {
 public:
     // Создаёт класс с именем name и набором методов methods, унаследованный от класса parent
-    // Если parent равен nullptr, то создаётся базовый класс
+    // Если parent равен nullptr, то создаётся базовый класс.
+    // Класс parent должен существовать, пока существует создаваемый класс
     explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
 
-    // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
-    [[nodiscard]] const Method* GetMethod(const std::string& name) const;
+    // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует.
+    // Методы класса скрывают одноимённые методы родителей независимо от числа параметров
+    [[nodiscard]] const Method* GetMethod(Symbol name) const;
+    // То же, но сначала ищет метод во встроенном кэше точки вызова cache
+    [[nodiscard]] const Method* GetMethod(Symbol name, MethodCache& cache) const;
 
     // Возвращает имя класса
     [[nodiscard]] const std::string& GetName() const;
 
+    // Возвращает собственные методы класса (без унаследованных)
+    [[nodiscard]] const std::vector<Method>& GetMethods() const;
+
+    // Возвращает родительский класс или nullptr для базового класса
+    [[nodiscard]] const Class* GetParent() const;
+
     // Выводит в os строку "Class <имя класса>", например "Class cat"
     void Print(std::ostream& os, Context& context) override;
 
+    // Возвращает форму, с которой создаются экземпляры класса. Она содержит только поле self
+    [[nodiscard]] const Shape& GetInstanceShape() const;
+
 private:
     std::string name_;
     std::vector<Method> methods_;
     const Class* parent_;
+    // Все методы класса, включая унаследованные, по именам. Строится в конструкторе
+    std::unordered_map<Symbol, const Method*> method_table_;
+    std::unique_ptr<Shape> root_shape_ = std::make_unique<Shape>();
+    const Shape* instance_shape_ = root_shape_->AddField("self");
 };
 
 // Экземпляр класса
-class ClassInstance : public Object {
+class ClassInstance : public CollectableObject {
 public:
     explicit ClassInstance(const Class& cls);
+    // Копия получает собственное поле self, указывающее на неё
+    ClassInstance(const ClassInstance& other);
+    ClassInstance(ClassInstance&& other) noexcept;
 
     /*
      * Если у объекта есть метод __str__, выводит в os результат, возвращённый этим методом.
@@ -168,24 +448,195 @@ public:
      * Если ни сам класс, ни его родители не содержат метод method, метод выбрасывает исключение
      * runtime_error
      */
-    ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args,
+    ObjectHolder Call(Symbol method, const std::vector<ObjectHolder>& actual_args,
+                      Context& context);
+    // Вызывает метод method, уже найденный в классе объекта. Количество actual_args
+    // должно совпадать с количеством параметров метода
+    ObjectHolder Call(const Method& method, const std::vector<ObjectHolder>& actual_args,
                       Context& context);
 
     // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
-    [[nodiscard]] bool HasMethod(const std::string& method, size_t argument_count) const;
+    [[nodiscard]] bool HasMethod(Symbol method, size_t argument_count) const;
+
+    // Возвращает указатель на значение поля name либо nullptr, если у объекта нет такого поля
+    [[nodiscard]] ObjectHolder* FindField(Symbol name);
+    [[nodiscard]] const ObjectHolder* FindField(Symbol name) const;
+    // То же, но сначала ищет номер поля во встроенном кэше cache
+    [[nodiscard]] ObjectHolder* FindField(Symbol name, FieldLoadCache& cache);
+
+    // Присваивает полю name значение value. Добавление нового поля переводит объект
+    // в следующую форму
+    void SetField(Symbol name, ObjectHolder value);
+    // То же, но сначала ищет номер поля и следующую форму во встроенном кэше cache
+    void SetField(Symbol name, ObjectHolder value, FieldStoreCache& cache);
+
+    // Возвращает текущую форму объекта
+    [[nodiscard]] const Shape& GetShape() const;
+
+    // Возвращает значение поля с номером offset в форме объекта
+    [[nodiscard]] ObjectHolder& FieldAt(uint32_t offset);
 
-    // Возвращает ссылку на Closure, содержащий поля объекта
-    [[nodiscard]] Closure& Fields();
-    // Возвращает константную ссылку на Closure, содержащую поля объекта
-    [[nodiscard]] const Closure& Fields() const;
+    // Возвращает значение поля field, найденного FindField. Поле self не владеет объектом,
+    // поэтому вместо него возвращается GetSelf(): прочитанное значение может пережить
+    // все остальные ссылки на объект
+    [[nodiscard]] ObjectHolder LoadField(const ObjectHolder& field);
+
+    // Возвращает ObjectHolder, ссылающийся на объект. Если объектом владеет ObjectHolder,
+    // результат разделяет с ним владение, иначе не владеет объектом
+    [[nodiscard]] ObjectHolder GetSelf();
+
+    // Возвращает класс, экземпляром которого является объект
+    [[nodiscard]] const Class& GetClass() const;
+
+    void ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const override;
+    // Удаляет все поля, кроме self
+    void ClearReferences() override;
 
 private:
     const Class& cls_;
-    Closure fields_;
+    const Shape* shape_;
+    // Значения полей в порядке их номеров в shape_. Поле self имеет номер 0
+    std::vector<ObjectHolder> values_;
 };
 
+// Список значений. Пока все элементы списка - числа, они хранятся подряд как int,
+// а не в ObjectHolder: такие списки в несколько раз плотнее в памяти и в кэше процессора.
+// Первый элемент другого вида переводит список в общее представление
+class List : public CollectableObject {
+public:
+    List();
+    explicit List(std::vector<ObjectHolder> items);
+
+    // Возвращает количество элементов
+    [[nodiscard]] size_t GetSize() const;
+
+    // Возвращает элемент с номером index < GetSize()
+    [[nodiscard]] ObjectHolder Get(size_t index) const;
+    // Присваивает значение value элементу с номером index < GetSize()
+    void Set(size_t index, ObjectHolder value);
+    // Добавляет value в конец списка за амортизированное O(1)
+    void Append(ObjectHolder value);
+
+    // Возвращает номер элемента по индексу index языка Mython: отрицательный индекс
+    // отсчитывается от конца списка. Если index - не число или выходит за пределы списка,
+    // выбрасывает runtime_error
+    [[nodiscard]] size_t CheckIndex(const ObjectHolder& index) const;
+
+    // Возвращает true, если все элементы хранятся как int
+    [[nodiscard]] bool HasOnlyNumbers() const;
+
+    // Вызывает встроенный метод списка method с argc аргументами args. Поддерживается
+    // метод append(value). Для прочих методов выбрасывает runtime_error
+    ObjectHolder Call(Symbol method, ObjectHolder* args, size_t argc);
+
+    // Выводит в os элементы через запятую в квадратных скобках, например "[1, abc, None]"
+    void Print(std::ostream& os, Context& context) override;
+
+    void ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const override;
+    void ClearReferences() override;
+
+private:
+    // Переводит список в общее представление
+    void Generalize();
+
+    bool only_numbers_ = true;
+    std::vector<int> numbers_;
+    std::vector<ObjectHolder> items_;
+    // Защищает от бесконечного вывода списка, содержащего сам себя
+    bool is_printing_ = false;
+};
+
+// Словарь. Пары ключ-значение хранятся в массиве в порядке добавления, а поиск ключа
+// идёт по хеш-таблице с открытой адресацией в духе Swiss table: для каждой ячейки таблицы
+// хранится управляющий байт с 7 битами хеша ключа, и группа из 8 ячеек проверяется
+// одной операцией над uint64_t. Ключи сравниваются только в ячейках с совпавшими битами.
+// Удаление ключей не поддерживается, поэтому в таблице нет «надгробий»
+class Dict : public CollectableObject {
+public:
+    Dict();
+
+    // Возвращает количество ключей
+    [[nodiscard]] size_t GetSize() const;
+
+    // Возвращает указатель на значение ключа key либо nullptr, если ключа нет в словаре.
+    // Если key нельзя хешировать, выбрасывает runtime_error.
+    // Параметр context задаёт контекст для выполнения методов __hash__ и __eq__
+    [[nodiscard]] const ObjectHolder* Find(const ObjectHolder& key, Context& context) const;
+    // Присваивает значение value ключу key, добавляя ключ в конец словаря, если его нет
+    void Set(ObjectHolder key, ObjectHolder value, Context& context);
+
+    // Возвращает ключ и значение пары с номером index < GetSize() в порядке добавления
+    [[nodiscard]] const ObjectHolder& GetKey(size_t index) const;
+    [[nodiscard]] const ObjectHolder& GetValue(size_t index) const;
+
+    // Выводит в os пары в фигурных скобках, например "{a: 1, 2: None}"
+    void Print(std::ostream& os, Context& context) override;
+
+    void ForEachReference(const std::function<void(const ObjectHolder&)>& visit) const override;
+    void ClearReferences() override;
+
+private:
+    struct Entry {
+        ObjectHolder key;
+        ObjectHolder value;
+        // Хеш ключа. Хранится, чтобы при росте таблицы не вызывать __hash__ повторно
+        size_t hash;
+    };
+
+    // Возвращает номер пары с ключом key и хешем hash либо NO_ENTRY
+    [[nodiscard]] size_t FindEntry(const ObjectHolder& key, size_t hash, Context& context) const;
+    // Записывает номер пары entry в свободную ячейку таблицы для хеша hash
+    void InsertSlot(size_t hash, uint32_t entry);
+    // Перестраивает таблицу с capacity ячейками
+    void Rehash(size_t capacity);
+
+    static constexpr size_t NO_ENTRY = std::numeric_limits<size_t>::max();
+
+    std::vector<Entry> entries_;
+    // Управляющие байты ячеек: EMPTY либо 7 младших битов хеша ключа
+    std::vector<uint8_t> ctrl_;
+    // Номера пар в entries_ для занятых ячеек
+    std::vector<uint32_t> slots_;
+    // Защищает от бесконечного вывода словаря, содержащего сам себя
+    bool is_printing_ = false;
+};
+
+// Заменяет содержимое области видимости closure аргументами вызова метода method:
+// объектом self и значениями args его формальных параметров
+void BindArguments(const Method& method, ObjectHolder self, const std::vector<ObjectHolder>& args,
+                   Closure& closure);
+
+// Возвращает хеш ключа словаря: числа, строки, значения типа Bool, None либо объекта
+// с методом __hash__(), который возвращает число. Для прочих значений выбрасывает runtime_error.
+// Параметр context задаёт контекст для выполнения метода __hash__
+size_t Hash(const ObjectHolder& key, Context& context);
+
+// Возвращает true, если item содержится в container: является элементом списка,
+// ключом словаря или подстрокой строки. Для контейнеров других видов выбрасывает runtime_error
+bool Contains(const ObjectHolder& item, const ObjectHolder& container, Context& context);
+
+// Возвращает количество элементов списка или словаря либо длину строки object.
+// Для значений других видов выбрасывает runtime_error
+ObjectHolder Len(const ObjectHolder& object);
+
+// Возвращает элемент списка или значение ключа словаря object[index]. Если object - не список
+// и не словарь или в словаре нет ключа index, выбрасывает runtime_error
+ObjectHolder GetItem(const ObjectHolder& object, const ObjectHolder& index, Context& context);
+
+// Присваивает значение value элементу списка или ключу словаря object[index].
+// Если object - не список и не словарь, выбрасывает runtime_error
+void SetItem(const ObjectHolder& object, const ObjectHolder& index, ObjectHolder value,
+             Context& context);
+
+// Записывает в item элемент номер index, перебираемый циклом for по iterable: элемент списка
+// либо ключ словаря в порядке добавления. Возвращает false, если элементы закончились.
+// Если iterable - не список и не словарь, выбрасывает runtime_error
+bool GetIterationItem(const ObjectHolder& iterable, size_t index, ObjectHolder& item);
+
 /*
- * Возвращает true, если lhs и rhs содержат одинаковые числа, строки или значения типа Bool.
+ * Возвращает true, если lhs и rhs содержат одинаковые числа, строки или значения типа Bool,
+ * либо списки попарно равных элементов, либо словари с одинаковыми ключами и равными
+ * значениями.
  * Если lhs - объект с методом __eq__, функция возвращает результат вызова lhs.__eq__(rhs),
  * приведённый к типу Bool. Если lhs и rhs имеют значение None, функция возвращает true.
  * В остальных случаях функция выбрасывает исключение runtime_error.
@@ -212,6 +663,48 @@ bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& cont
 // Возвращает значение, противоположное Less(lhs, rhs, context)
 bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
 
+/*
+ * Возвращает результат операции + над lhs и rhs. Поддерживается сложение:
+ *  число + число
+ *  строка + строка
+ *  объект1 + объект2, если у объект1 - пользовательский класс с методом __add__(rhs)
+ * В противном случае выбрасывается исключение runtime_error
+ */
+ObjectHolder Add(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+// Возвращает разность чисел lhs и rhs. Если lhs и rhs - не числа, выбрасывается runtime_error
+ObjectHolder Sub(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+// Возвращает произведение чисел lhs и rhs. Если lhs и rhs - не числа, выбрасывается runtime_error
+ObjectHolder Mult(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+// Возвращает частное чисел lhs и rhs. Если lhs и rhs - не числа или rhs равен 0,
+// выбрасывается runtime_error
+ObjectHolder Div(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+
+// Диапазон значений переменной цикла for name in range(start, stop, step)
+struct Range {
+    int start = 0;
+    int stop = 0;
+    int step = 1;
+
+    // Создаёт диапазон из значений аргументов range. Отсутствующий аргумент start
+    // передаётся как None и равен 0, отсутствующий step - как None и равен 1.
+    // Если аргументы - не числа или step равен 0, выбрасывает runtime_error
+    static Range FromArgs(const ObjectHolder& start, const ObjectHolder& stop,
+                          const ObjectHolder& step);
+
+    // Возвращает true, если value - очередное значение переменной цикла, а не конец диапазона
+    [[nodiscard]] bool Contains(int value) const {
+        return step > 0 ? value < stop : value > stop;
+    }
+
+    // Возвращает значение, следующее за value. Если сумма value + step выходит
+    // за пределы диапазона (в том числе за пределы int), возвращает stop
+    [[nodiscard]] int Next(int value) const {
+        const long long next = static_cast<long long>(value) + step;
+        return step > 0 ? static_cast<int>(std::min<long long>(next, stop))
+                        : static_cast<int>(std::max<long long>(next, stop));
+    }
+};
+
 // Контекст-заглушка, применяется в тестах.
 // В этом контексте весь вывод перенаправляется в строковый поток вывода output
 struct DummyContext : Context {
@@ -222,19 +715,36 @@ struct DummyContext : Context {
     std::ostringstream output;
 };
 
-// Простой контекст, в нём вывод происходит в поток output, переданный в конструктор
+// Простой контекст, в нём вывод происходит в поток output, переданный в конструктор.
+// Вывод буферизуется согласно options, остаток буфера передаётся в output
+// при разрушении контекста
 class SimpleContext : public runtime::Context {
 public:
-    explicit SimpleContext(std::ostream& output)
-        : output_(output) {
+    explicit SimpleContext(std::ostream& output, OutputOptions options = {})
+        : buffer_(output, options)
+        , output_(&buffer_) {
     }
 
     std::ostream& GetOutputStream() override {
         return output_;
     }
 
+    void WriteNumber(int value) override {
+        buffer_.WriteNumber(value);
+    }
+
+    void EndLine() override {
+        buffer_.EndLine();
+    }
+
+    // Передаёт накопленный вывод в поток output
+    void Flush() {
+        buffer_.Flush();
+    }
+
 private:
-    std::ostream& output_;
+    OutputBuffer buffer_;
+    std::ostream output_;
 };
 
 }  // namespace runtime
@@ -0,0 +1,510 @@
+#include "bench_runner_p.h"
+#include "runtime.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+
+// Прежняя реализация операций: тип операндов определяется цепочкой dynamic_cast
+namespace legacy {
+
+template <typename T>
+T* TryAs(const ObjectHolder& object) {
+    return dynamic_cast<T*>(object.Get());
+}
+
+bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (!lhs && !rhs) {
+        return true;
+    }
+    if (!lhs || !rhs) {
+        throw runtime_error("Cannot compare objects for equality"s);
+    }
+    if (const auto l = TryAs<Number>(lhs), r = TryAs<Number>(rhs); l && r) {
+        return l->GetValue() == r->GetValue();
+    }
+    if (const auto l = TryAs<String>(lhs), r = TryAs<String>(rhs); l && r) {
+        return l->GetValue() == r->GetValue();
+    }
+    if (const auto l = TryAs<Bool>(lhs), r = TryAs<Bool>(rhs); l && r) {
+        return l->GetValue() == r->GetValue();
+    }
+    if (const auto inst = TryAs<ClassInstance>(lhs)) {
+        if (inst->HasMethod("__eq__"s, 1u)) {
+            return TryAs<Bool>(inst->Call("__eq__"s, {rhs}, context))->GetValue();
+        }
+    }
+    throw runtime_error("Cannot compare objects for equality"s);
+}
+
+bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (!lhs || !rhs) {
+        throw runtime_error("Cannot compare objects for less"s);
+    }
+    if (const auto l = TryAs<Number>(lhs), r = TryAs<Number>(rhs); l && r) {
+        return l->GetValue() < r->GetValue();
+    }
+    if (const auto l = TryAs<String>(lhs), r = TryAs<String>(rhs); l && r) {
+        return l->GetValue() < r->GetValue();
+    }
+    if (const auto l = TryAs<Bool>(lhs), r = TryAs<Bool>(rhs); l && r) {
+        return l->GetValue() < r->GetValue();
+    }
+    if (const auto inst = TryAs<ClassInstance>(lhs)) {
+        if (inst->HasMethod("__lt__"s, 1u)) {
+            return TryAs<Bool>(inst->Call("__lt__"s, {rhs}, context))->GetValue();
+        }
+    }
+    throw runtime_error("Cannot compare objects for less"s);
+}
+
+ObjectHolder Add(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    if (const auto l = TryAs<Number>(lhs), r = TryAs<Number>(rhs); l && r) {
+        return ObjectHolder::Own(Number(l->GetValue() + r->GetValue()));
+    }
+    if (const auto l = TryAs<String>(lhs), r = TryAs<String>(rhs); l && r) {
+        return ObjectHolder::Own(String(l->GetValue() + r->GetValue()));
+    }
+    if (const auto inst = TryAs<ClassInstance>(lhs)) {
+        if (inst->HasMethod("__add__"s, 1u)) {
+            return inst->Call("__add__"s, {rhs}, context);
+        }
+    }
+    throw runtime_error("Failed on Add operation"s);
+}
+
+}  // namespace legacy
+
+constexpr size_t ROUNDS = 200'000;
+
+// Метод, возвращающий заранее заданное значение
+struct ConstantBody : Executable {
+    explicit ConstantBody(ObjectHolder result)
+        : result(std::move(result)) {
+    }
+
+    ObjectHolder Execute(Closure&, Context&) override {
+        return result;
+    }
+
+    ObjectHolder result;
+};
+
+// Операнды всех поддерживаемых сочетаний видов: числа, строки, логические значения,
+// экземпляр класса с методами __eq__, __lt__ и __add__ в роли левого операнда
+struct MixedOperands {
+    MixedOperands() {
+        vector<Method> methods;
+        methods.push_back(
+            {"__eq__"s, {"rhs"s}, make_unique<ConstantBody>(ObjectHolder::Own(Bool(true)))});
+        methods.push_back(
+            {"__lt__"s, {"rhs"s}, make_unique<ConstantBody>(ObjectHolder::Own(Bool(false)))});
+        methods.push_back(
+            {"__add__"s, {"rhs"s}, make_unique<ConstantBody>(ObjectHolder::Own(Number(1)))});
+        cls = make_unique<Class>("Operand"s, std::move(methods), nullptr);
+        instance = make_unique<ClassInstance>(*cls);
+
+        const auto inst = ObjectHolder::Share(*instance);
+        pairs = {
+            {ObjectHolder::Own(Number(1)), ObjectHolder::Own(Number(2))},
+            {ObjectHolder::Own(String("abc"s)), ObjectHolder::Own(String("abd"s))},
+            {ObjectHolder::Own(Number(3)), ObjectHolder::Own(Number(3))},
+            {ObjectHolder::Own(Bool(true)), ObjectHolder::Own(Bool(false))},
+            {ObjectHolder::Own(Number(-7)), ObjectHolder::Own(Number(5))},
+            {inst, ObjectHolder::Own(Number(1))},
+        };
+        // Сложение определено не для логических значений
+        add_pairs = pairs;
+        add_pairs[3] = {ObjectHolder::Own(String("x"s)), ObjectHolder::Own(String("y"s))};
+    }
+
+    unique_ptr<Class> cls;
+    unique_ptr<ClassInstance> instance;
+    vector<pair<ObjectHolder, ObjectHolder>> pairs;
+    vector<pair<ObjectHolder, ObjectHolder>> add_pairs;
+};
+
+template <typename Compare>
+size_t BenchCompare(Compare compare) {
+    const MixedOperands operands;
+    DummyContext context;
+    size_t operations = 0;
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        for (const auto& [lhs, rhs] : operands.pairs) {
+            DoNotOptimize(compare(lhs, rhs, context));
+            ++operations;
+        }
+    }
+    return operations;
+}
+
+template <typename Operation>
+size_t BenchAdd(Operation operation) {
+    const MixedOperands operands;
+    DummyContext context;
+    size_t operations = 0;
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        for (const auto& [lhs, rhs] : operands.add_pairs) {
+            DoNotOptimize(operation(lhs, rhs, context).Get());
+            ++operations;
+        }
+    }
+    return operations;
+}
+
+size_t BenchEqualMixedDispatch() {
+    return BenchCompare(Equal);
+}
+
+size_t BenchEqualMixedDynamicCast() {
+    return BenchCompare(legacy::Equal);
+}
+
+size_t BenchLessMixedDispatch() {
+    return BenchCompare(Less);
+}
+
+size_t BenchLessMixedDynamicCast() {
+    return BenchCompare(legacy::Less);
+}
+
+size_t BenchAddMixedDispatch() {
+    return BenchAdd(Add);
+}
+
+size_t BenchAddMixedDynamicCast() {
+    return BenchAdd(legacy::Add);
+}
+
+// ---- Память на экземпляр класса ----
+
+constexpr size_t SMALL_OBJECTS = 100'000;
+
+// Прежнее представление экземпляра: собственная хеш-таблица полей, включая self
+struct LegacyInstance : Object {
+    explicit LegacyInstance(const Class& cls)
+        : cls(cls) {
+        fields["self"s] = ObjectHolder::Share(*this);
+    }
+
+    void Print(ostream&, Context&) override {
+    }
+
+    const Class& cls;
+    unordered_map<string, ObjectHolder> fields;
+};
+
+// Создаёт SMALL_OBJECTS экземпляров с тремя полями функцией make и измеряет память на экземпляр
+template <typename Make>
+BenchResult BenchSmallObjects(Make make) {
+    Class cls{"Point"s, {}, nullptr};
+    vector<ObjectHolder> objects;
+    objects.reserve(SMALL_OBJECTS);
+
+    const size_t heap_before = HeapInUse();
+    for (size_t i = 0; i < SMALL_OBJECTS; ++i) {
+        objects.push_back(make(cls, static_cast<int>(i)));
+    }
+    const size_t heap_after = HeapInUse();
+    return {SMALL_OBJECTS, static_cast<double>(heap_after - heap_before) / SMALL_OBJECTS,
+            "bytes/object"s};
+}
+
+BenchResult BenchSmallObjectsShapes() {
+    return BenchSmallObjects([](const Class& cls, int i) {
+        auto object = ObjectHolder::Own(ClassInstance(cls));
+        auto* instance = object.TryAs<ClassInstance>();
+        instance->SetField("x"s, ObjectHolder::Own(Number(i)));
+        instance->SetField("y"s, ObjectHolder::Own(Number(i)));
+        instance->SetField("z"s, ObjectHolder::Own(Number(i)));
+        return object;
+    });
+}
+
+BenchResult BenchSmallObjectsHashMap() {
+    return BenchSmallObjects([](const Class& cls, int i) {
+        auto object = ObjectHolder::Own(LegacyInstance(cls));
+        auto* instance = object.TryAs<LegacyInstance>();
+        instance->fields["x"s] = ObjectHolder::Own(Number(i));
+        instance->fields["y"s] = ObjectHolder::Own(Number(i));
+        instance->fields["z"s] = ObjectHolder::Own(Number(i));
+        return object;
+    });
+}
+
+// ---- Поиск методов в иерархии классов ----
+
+constexpr size_t HIERARCHY_DEPTH = 5;
+constexpr size_t METHODS_PER_CLASS = 60;
+constexpr size_t LOOKUP_ROUNDS = 2'000;
+
+// Прежний поиск метода: линейный просмотр методов класса и рекурсия в родителя
+const Method* LinearGetMethod(const Class& cls, Symbol name) {
+    for (const Class* current = &cls; current; current = current->GetParent()) {
+        const auto& methods = current->GetMethods();
+        const auto it = find_if(methods.begin(), methods.end(),
+                                [&name](const Method& method) {
+                                    return method.name.GetName() == name.GetName();
+                                });
+        if (it != methods.end()) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+// Цепочка из HIERARCHY_DEPTH классов, каждый из которых объявляет METHODS_PER_CLASS
+// собственных методов и переопределяет метод __str__
+struct DeepHierarchy {
+    DeepHierarchy() {
+        const Class* parent = nullptr;
+        for (size_t level = 0; level < HIERARCHY_DEPTH; ++level) {
+            vector<Method> methods;
+            for (size_t i = 0; i < METHODS_PER_CLASS; ++i) {
+                const string name = "method_"s + to_string(level) + "_"s + to_string(i);
+                methods.push_back({name, {"arg"s}, make_unique<ConstantBody>(ObjectHolder())});
+                names.push_back(name);
+            }
+            methods.push_back({"__str__"s, {}, make_unique<ConstantBody>(ObjectHolder())});
+            classes.push_back(make_unique<Class>("Level"s + to_string(level), std::move(methods),
+                                                 parent));
+            parent = classes.back().get();
+        }
+        names.push_back("__str__"s);
+        names.push_back("missing"s);
+    }
+
+    [[nodiscard]] const Class& Leaf() const {
+        return *classes.back();
+    }
+
+    vector<unique_ptr<Class>> classes;
+    // Имена методов всех уровней иерархии и одного отсутствующего метода
+    vector<Symbol> names;
+};
+
+template <typename Lookup>
+size_t BenchMethodLookup(Lookup lookup) {
+    const DeepHierarchy hierarchy;
+    size_t operations = 0;
+    for (size_t round = 0; round < LOOKUP_ROUNDS; ++round) {
+        for (const auto& name : hierarchy.names) {
+            DoNotOptimize(lookup(hierarchy.Leaf(), name));
+            ++operations;
+        }
+    }
+    return operations;
+}
+
+size_t BenchDeepHierarchyFlatTable() {
+    return BenchMethodLookup([](const Class& cls, Symbol name) {
+        return cls.GetMethod(name);
+    });
+}
+
+size_t BenchDeepHierarchyLinearSearch() {
+    return BenchMethodLookup(LinearGetMethod);
+}
+
+// ---- Поиск переменных в Closure ----
+
+constexpr size_t CLOSURE_LOOKUP_ROUNDS = 200'000;
+const vector<string> LOCAL_NAMES = {"self"s, "value"s, "result"s, "counter"s,
+                                    "other_value"s, "index"s, "left_border"s, "right_border"s};
+
+// Ищет в таблице closure каждое из имён names CLOSURE_LOOKUP_ROUNDS раз
+template <typename Table, typename Name>
+size_t BenchClosureLookup(const vector<Name>& names) {
+    Table closure;
+    for (const auto& name : names) {
+        closure[name] = ObjectHolder::Own(Number(1));
+    }
+    size_t operations = 0;
+    for (size_t round = 0; round < CLOSURE_LOOKUP_ROUNDS; ++round) {
+        for (const auto& name : names) {
+            DoNotOptimize(closure.find(name)->second);
+            ++operations;
+        }
+    }
+    return operations;
+}
+
+size_t BenchClosureLookupSymbols() {
+    const vector<Symbol> names(LOCAL_NAMES.begin(), LOCAL_NAMES.end());
+    return BenchClosureLookup<Closure>(names);
+}
+
+// Прежняя таблица символов, в которой имена хранятся и хешируются как строки
+size_t BenchClosureLookupStrings() {
+    return BenchClosureLookup<unordered_map<string, ObjectHolder>>(LOCAL_NAMES);
+}
+
+// ---- Словари ----
+
+constexpr int DICT_KEYS = 100'000;
+constexpr int DICT_LOOKUP_ROUNDS = 10;
+
+// Ключи словаря: DICT_KEYS чисел или строк, перемешанных так, чтобы поиск не шёл по порядку
+vector<ObjectHolder> MakeDictKeys(bool strings) {
+    vector<ObjectHolder> keys;
+    keys.reserve(DICT_KEYS);
+    for (int i = 0; i < DICT_KEYS; ++i) {
+        const int key = static_cast<int>((static_cast<long long>(i) * 7919) % DICT_KEYS);
+        keys.push_back(strings ? ObjectHolder::Own(String("key_"s + to_string(key)))
+                               : ObjectHolder::Own(Number(key)));
+    }
+    return keys;
+}
+
+// Заполняет словарь ключами keys и DICT_LOOKUP_ROUNDS раз ищет в нём каждый ключ
+// и столько же отсутствующих ключей missing. Ключи ищутся в другом порядке, чем добавлялись,
+// чтобы обращения к узлам std::unordered_map не шли подряд в порядке их выделения.
+// insert и find принимают ObjectHolder ключа
+template <typename Insert, typename Find>
+size_t BenchDictLookup(const vector<ObjectHolder>& keys, const vector<ObjectHolder>& missing,
+                       Insert insert, Find find) {
+    for (const auto& key : keys) {
+        insert(key);
+    }
+    vector<ObjectHolder> lookups = keys;
+    shuffle(lookups.begin(), lookups.end(), mt19937{42});
+    size_t operations = 0;
+    for (int round = 0; round < DICT_LOOKUP_ROUNDS; ++round) {
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            DoNotOptimize(find(lookups[i]));
+            DoNotOptimize(find(missing[i]));
+            operations += 2;
+        }
+    }
+    return operations;
+}
+
+// Ключи, которых нет в словаре из MakeDictKeys
+vector<ObjectHolder> MakeMissingKeys(bool strings) {
+    vector<ObjectHolder> keys;
+    keys.reserve(DICT_KEYS);
+    for (int i = 0; i < DICT_KEYS; ++i) {
+        keys.push_back(strings ? ObjectHolder::Own(String("missing_"s + to_string(i)))
+                               : ObjectHolder::Own(Number(DICT_KEYS + i)));
+    }
+    return keys;
+}
+
+size_t BenchDictSwissTable(bool strings) {
+    DummyContext context;
+    Dict dict;
+    return BenchDictLookup(
+        MakeDictKeys(strings), MakeMissingKeys(strings),
+        [&](const ObjectHolder& key) {
+            dict.Set(key, key, context);
+        },
+        [&](const ObjectHolder& key) {
+            return dict.Find(key, context) != nullptr;
+        });
+}
+
+size_t BenchDictNumbersSwissTable() {
+    return BenchDictSwissTable(false);
+}
+
+size_t BenchDictStringsSwissTable() {
+    return BenchDictSwissTable(true);
+}
+
+// Хеш-таблица стандартной библиотеки с теми же хешем и сравнением ключей, что и у Dict.
+// Каждая пара хранится в отдельном узле, а группа выбирается делением по модулю
+size_t BenchDictUnorderedMap(bool strings) {
+    DummyContext context;
+    const auto hash = [&context](const ObjectHolder& key) {
+        return Hash(key, context);
+    };
+    const auto equal = [&context](const ObjectHolder& lhs, const ObjectHolder& rhs) {
+        return Equal(lhs, rhs, context);
+    };
+    unordered_map<ObjectHolder, ObjectHolder, decltype(hash), decltype(equal)> map(
+        0, hash, equal);
+    return BenchDictLookup(
+        MakeDictKeys(strings), MakeMissingKeys(strings),
+        [&](const ObjectHolder& key) {
+            map[key] = key;
+        },
+        [&](const ObjectHolder& key) {
+            return map.count(key) != 0;
+        });
+}
+
+size_t BenchDictNumbersUnorderedMap() {
+    return BenchDictUnorderedMap(false);
+}
+
+size_t BenchDictStringsUnorderedMap() {
+    return BenchDictUnorderedMap(true);
+}
+
+// ---- Вывод команд print ----
+
+constexpr int PRINTED_LINES = 200'000;
+
+// Выводит PRINTED_LINES строк из двух чисел через контекст, как это делает команда print
+size_t BenchPrintLines(FlushPolicy policy) {
+    ofstream null_output("/dev/null"s);
+    SimpleContext context(null_output, {policy, OutputOptions::DEFAULT_BUFFER_SIZE});
+    for (int i = 0; i < PRINTED_LINES; ++i) {
+        context.WriteNumber(i);
+        context.GetOutputStream().put(' ');
+        context.WriteNumber(-i);
+        context.EndLine();
+    }
+    return PRINTED_LINES;
+}
+
+size_t BenchPrintLinesThreshold() {
+    return BenchPrintLines(FlushPolicy::THRESHOLD);
+}
+
+size_t BenchPrintLinesLineFlush() {
+    return BenchPrintLines(FlushPolicy::LINE);
+}
+
+// Прежний вывод: числа выводятся оператором <<, каждая строка завершается std::endl
+size_t BenchPrintLinesEndl() {
+    ofstream null_output("/dev/null"s);
+    for (int i = 0; i < PRINTED_LINES; ++i) {
+        null_output << i << " "s << -i << endl;
+    }
+    return PRINTED_LINES;
+}
+
+}  // namespace
+
+void RunRuntimeBenchmarks(BenchRunner& br) {
+    RUN_BENCH(br, runtime::BenchEqualMixedDispatch);
+    RUN_BENCH(br, runtime::BenchEqualMixedDynamicCast);
+    RUN_BENCH(br, runtime::BenchLessMixedDispatch);
+    RUN_BENCH(br, runtime::BenchLessMixedDynamicCast);
+    RUN_BENCH(br, runtime::BenchAddMixedDispatch);
+    RUN_BENCH(br, runtime::BenchAddMixedDynamicCast);
+    RUN_BENCH(br, runtime::BenchSmallObjectsShapes);
+    RUN_BENCH(br, runtime::BenchSmallObjectsHashMap);
+    RUN_BENCH(br, runtime::BenchDeepHierarchyFlatTable);
+    RUN_BENCH(br, runtime::BenchDeepHierarchyLinearSearch);
+    RUN_BENCH(br, runtime::BenchClosureLookupSymbols);
+    RUN_BENCH(br, runtime::BenchClosureLookupStrings);
+    RUN_BENCH(br, runtime::BenchDictNumbersSwissTable);
+    RUN_BENCH(br, runtime::BenchDictNumbersUnorderedMap);
+    RUN_BENCH(br, runtime::BenchDictStringsSwissTable);
+    RUN_BENCH(br, runtime::BenchDictStringsUnorderedMap);
+    RUN_BENCH(br, runtime::BenchPrintLinesThreshold);
+    RUN_BENCH(br, runtime::BenchPrintLinesLineFlush);
+    RUN_BENCH(br, runtime::BenchPrintLinesEndl);
+}
+
+}  // namespace runtime
@@ -1,7 +1,13 @@
+#include "arena.h"
 #include "runtime.h"
 #include "test_runner_p.h"
 
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <string_view>
 
 using namespace std;
 
@@ -19,7 +25,8 @@ public:
     }
 
     Logger(const Logger& rhs)
-        : id_(rhs.id_)  //
+        : Object(rhs)
+        , id_(rhs.id_)  //
     {
         ++instance_count;
     }
@@ -106,7 +113,7 @@ void TestMethodInvocation() {
     base_methods.push_back({"test_2"s, {"arg1"s}, make_unique<TestMethodBody>(base_method_2)});
     Class base_class{"Base"s, std::move(base_methods), nullptr};
     ClassInstance base_inst{base_class};
-    base_inst.Fields()["base_field"s] = ObjectHolder::Own(String{"hello"s});
+    base_inst.SetField("base_field"s, ObjectHolder::Own(String{"hello"s}));
     ASSERT(base_inst.HasMethod("test"s, 2U));
     auto res = base_inst.Call(
         "test"s, {ObjectHolder::Own(Number{1}), ObjectHolder::Own(String{"abc"s})}, context);
@@ -161,6 +168,175 @@ void TestMethodInvocation() {
     ASSERT_THROWS(child_inst.Call("test"s, {ObjectHolder::None()}, context), runtime_error);
 }
 
+void TestMethodTable() {
+    vector<Method> base_methods;
+    base_methods.push_back({"f"s, {"a"s, "b"s}, make_unique<TestMethodBody>(nullptr)});
+    base_methods.push_back({"g"s, {}, make_unique<TestMethodBody>(nullptr)});
+    Class base{"Base"s, std::move(base_methods), nullptr};
+
+    vector<Method> child_methods;
+    child_methods.push_back({"f"s, {"a"s}, make_unique<TestMethodBody>(nullptr)});
+    child_methods.push_back({"f"s, {}, make_unique<TestMethodBody>(nullptr)});
+    Class child{"Child"s, std::move(child_methods), &base};
+
+    // Первый из одноимённых методов класса скрывает методы родителя с любым числом параметров
+    ASSERT_EQUAL(child.GetMethod("f"s), &child.GetMethods()[0]);
+    ASSERT_EQUAL(child.GetMethod("g"s), &base.GetMethods()[1]);
+    ASSERT(child.GetMethod("h"s) == nullptr);
+
+    ClassInstance inst{child};
+    ASSERT(inst.HasMethod("f"s, 1U));
+    ASSERT(!inst.HasMethod("f"s, 2U));
+    ASSERT(!inst.HasMethod("f"s, 0U));
+    ASSERT(inst.HasMethod("g"s, 0U));
+}
+
+void TestSymbols() {
+    const Symbol x{"x"s};
+    const size_t count = Symbol::GetCount();
+
+    // Повторное интернирование возвращает тот же символ и не расширяет таблицу
+    ASSERT(Symbol("x"sv) == x);
+    ASSERT(Symbol("x") == x);
+    ASSERT_EQUAL(Symbol("x"s).GetId(), x.GetId());
+    ASSERT_EQUAL(Symbol::GetCount(), count);
+    ASSERT_EQUAL(x.GetName(), "x"s);
+    ASSERT_EQUAL(x.GetHash(), hash<string_view>{}("x"sv));
+
+    const Symbol y{"y"s};
+    ASSERT(x != y);
+    ASSERT_EQUAL(y.GetName(), "y"s);
+    ASSERT(Symbol().GetName().empty());
+
+    ostringstream out;
+    out << x << y;
+    ASSERT_EQUAL(out.str(), "xy"s);
+
+    Closure closure;
+    closure["x"s] = ObjectHolder::Own(Number(1));
+    ASSERT_EQUAL(closure.count(x), 1U);
+    ASSERT_EQUAL(closure.count(y), 0U);
+}
+
+void TestOutputBuffer() {
+    {
+        ostringstream out;
+        OutputBuffer buffer(out, {FlushPolicy::LINE, 1024});
+        ostream stream(&buffer);
+        stream << "x = "sv;
+        buffer.WriteNumber(numeric_limits<int>::min());
+        ASSERT(out.str().empty());
+        buffer.EndLine();
+        ASSERT_EQUAL(out.str(), "x = -2147483648\n"s);
+    }
+    {
+        ostringstream out;
+        string expected;
+        {
+            OutputBuffer buffer(out, {FlushPolicy::THRESHOLD, 16});
+            ostream stream(&buffer);
+            for (int i = 0; i < 10; ++i) {
+                buffer.WriteNumber(i);
+                buffer.EndLine();
+                expected += to_string(i) + "\n"s;
+            }
+            // При переполнении буфера в поток передаётся только накопленная часть вывода
+            ASSERT(!out.str().empty());
+            ASSERT(out.str().size() < expected.size());
+            // Блок больше буфера передаётся в поток сразу
+            stream << string(100, 'a');
+            expected += string(100, 'a');
+            ASSERT_EQUAL(out.str(), expected);
+            stream << 'b';
+            expected += 'b';
+        }
+        ASSERT_EQUAL(out.str(), expected);
+    }
+    {
+        ostringstream out;
+        OutputBuffer buffer(out, {FlushPolicy::EXIT, 16});
+        ostream stream(&buffer);
+        string expected;
+        for (int i = 0; i < 1000; ++i) {
+            stream << "line "sv;
+            buffer.WriteNumber(-i);
+            buffer.EndLine();
+            expected += "line "s + to_string(-i) + "\n"s;
+        }
+        ASSERT(out.str().empty());
+        buffer.Flush();
+        ASSERT_EQUAL(out.str(), expected);
+    }
+    {
+        ostringstream out;
+        {
+            SimpleContext context(out);
+            context.GetOutputStream() << "n = "sv;
+            context.WriteNumber(42);
+            context.EndLine();
+            ASSERT(out.str().empty());
+        }
+        ASSERT_EQUAL(out.str(), "n = 42\n"s);
+    }
+}
+
+void TestArena() {
+    // Записывает номер объекта в log при разрушении
+    struct Tracked {
+        Tracked(vector<int>& log, int id)
+            : log(log)
+            , id(id) {
+        }
+        ~Tracked() {
+            log.push_back(id);
+        }
+        vector<int>& log;
+        int id;
+    };
+    struct alignas(64) Aligned {
+        char data[3];
+    };
+
+    vector<int> log;
+    {
+        Arena arena(256);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_EQUAL(arena.Make<Tracked>(log, i)->id, i);
+            const auto* aligned = arena.Make<Aligned>();
+            ASSERT_EQUAL(reinterpret_cast<uintptr_t>(aligned) % 64, 0U);
+        }
+        // Объект больше блока размещается в отдельном блоке
+        const auto* big = arena.Make<array<int, 1000>>();
+        ASSERT(big != nullptr);
+        ASSERT_EQUAL(arena.GetObjectCount(), 201U);
+        ASSERT(arena.GetAllocatedSize() >= sizeof(array<int, 1000>));
+        ASSERT(log.empty());
+    }
+    // Объекты разрушаются вместе с ареной в порядке, обратном созданию
+    ASSERT_EQUAL(log.size(), 100U);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQUAL(log[i], 99 - i);
+    }
+
+    // Указатель на узел в арене не удаляет его, а указатель из make_unique - удаляет
+    Logger::instance_count = 0;
+    struct Body : Executable {
+        ObjectHolder Execute(Closure& /*closure*/, Context& /*context*/) override {
+            return ObjectHolder::Own(Logger());
+        }
+    };
+    {
+        Arena arena;
+        ExecutablePtr<> in_arena(arena.Make<Body>(), ExecutableDeleter(false));
+        ExecutablePtr<> on_heap = make_unique<Body>();
+        DummyContext context;
+        Closure closure;
+        ASSERT(in_arena->Execute(closure, context).TryAs<Logger>() != nullptr);
+        ASSERT(on_heap->Execute(closure, context).TryAs<Logger>() != nullptr);
+    }
+    ASSERT_EQUAL(Logger::instance_count, 0);
+}
+
 void TestNonowning() {
     ASSERT_EQUAL(Logger::instance_count, 0);
     Logger logger(784);
@@ -223,6 +399,384 @@ void TestMove() {
     }
 }
 
+void TestInlineValues() {
+    DummyContext context;
+
+    auto num = ObjectHolder::Own(Number(42));
+    auto copy = num;
+    ASSERT(num.TryAs<Number>() != nullptr);
+    ASSERT(num.TryAs<Number>() != copy.TryAs<Number>());
+    ASSERT_EQUAL(copy.TryAs<Number>()->GetValue(), 42);
+    ASSERT(num.TryAs<Bool>() == nullptr);
+    ASSERT(num.TryAs<String>() == nullptr);
+    ASSERT(num.TryAs<Object>() == num.Get());
+
+    auto flag = ObjectHolder::Own(Bool(true));
+    ASSERT(flag.TryAs<Bool>() != nullptr);
+    ASSERT(flag.TryAs<Number>() == nullptr);
+    flag->Print(context.output, context);
+    num->Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "True42"s);
+
+    // Разделяемый Number не копируется внутрь ObjectHolder
+    Number shared(7);
+    auto ref = ObjectHolder::Share(shared);
+    ASSERT(ref.TryAs<Number>() == &shared);
+}
+
+void TestObjectKinds() {
+    DummyContext context;
+    Class cls{"Empty"s, {}, nullptr};
+    ClassInstance inst{cls};
+    Logger logger;
+    String str("abc"s);
+
+    ASSERT(ObjectHolder::None().GetKind() == ObjectKind::NONE);
+    ASSERT(ObjectHolder::Own(Number(1)).GetKind() == ObjectKind::NUMBER);
+    ASSERT(ObjectHolder::Own(Bool(false)).GetKind() == ObjectKind::BOOL);
+    ASSERT(ObjectHolder::Share(str).GetKind() == ObjectKind::STRING);
+    ASSERT(ObjectHolder::Share(cls).GetKind() == ObjectKind::CLASS);
+    ASSERT(ObjectHolder::Share(inst).GetKind() == ObjectKind::INSTANCE);
+    ASSERT(ObjectHolder::Share(logger).GetKind() == ObjectKind::OTHER);
+
+    ASSERT(ObjectHolder::Share(inst).TryAs<ClassInstance>() == &inst);
+    ASSERT(ObjectHolder::Share(inst).TryAs<Class>() == nullptr);
+    ASSERT(ObjectHolder::Share(logger).TryAs<Logger>() == &logger);
+    ASSERT(ObjectHolder::Share(logger).TryAs<Number>() == nullptr);
+
+    // Операции над сочетаниями видов, для которых они не определены
+    ASSERT_THROWS(Equal(ObjectHolder::Share(inst), ObjectHolder::None(), context), runtime_error);
+    ASSERT_THROWS(Equal(ObjectHolder::Share(logger), ObjectHolder::Share(logger), context),
+                  runtime_error);
+    ASSERT_THROWS(Less(ObjectHolder::None(), ObjectHolder::None(), context), runtime_error);
+    ASSERT_THROWS(Add(ObjectHolder::Own(Bool(true)), ObjectHolder::Own(Bool(true)), context),
+                  runtime_error);
+    ASSERT_THROWS(Sub(ObjectHolder::Share(str), ObjectHolder::Share(str), context), runtime_error);
+    ASSERT(!Less(ObjectHolder::Own(Bool(true)), ObjectHolder::Own(Bool(false)), context));
+}
+
+void TestList() {
+    DummyContext context;
+    List list;
+    ASSERT(!IsTrue(ObjectHolder::Share(list)));
+    for (int i = 1; i <= 3; ++i) {
+        list.Append(ObjectHolder::Own(Number(i * 10)));
+    }
+    ASSERT(list.HasOnlyNumbers());
+    ASSERT(IsTrue(ObjectHolder::Share(list)));
+    ASSERT(ObjectHolder::Share(list).GetKind() == ObjectKind::LIST);
+    ASSERT_EQUAL(list.GetSize(), 3U);
+    ASSERT_EQUAL(list.Get(2).TryAs<Number>()->GetValue(), 30);
+    ASSERT_EQUAL(list.CheckIndex(ObjectHolder::Own(Number(-1))), 2U);
+    const auto shared = ObjectHolder::Share(list);
+    ASSERT_THROWS(GetItem(shared, ObjectHolder::Own(Number(3)), context), runtime_error);
+    ASSERT_THROWS(GetItem(shared, ObjectHolder::Own(Number(-4)), context), runtime_error);
+    ASSERT_THROWS(GetItem(shared, ObjectHolder::Own(String("0"s)), context), runtime_error);
+
+    // Числа остаются int, пока в список не попадёт значение другого вида
+    list.Set(0, ObjectHolder::Own(Number(5)));
+    ASSERT(list.HasOnlyNumbers());
+    list.Set(1, ObjectHolder::Own(String("x"s)));
+    ASSERT(!list.HasOnlyNumbers());
+    list.Append(ObjectHolder::None());
+    ASSERT_EQUAL(list.GetSize(), 4U);
+    ASSERT_EQUAL(list.Get(0).TryAs<Number>()->GetValue(), 5);
+    ASSERT_EQUAL(list.Get(1).TryAs<String>()->GetValue(), "x"s);
+
+    list.Append(ObjectHolder::Share(list));
+    list.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "[5, x, 30, None, [...]]"s);
+
+    ObjectHolder arg = ObjectHolder::Own(Number(1));
+    ASSERT(!list.Call("append"s, &arg, 1));
+    ASSERT_EQUAL(list.GetSize(), 6U);
+    ASSERT_THROWS(list.Call("pop"s, nullptr, 0), runtime_error);
+
+    const auto make_list = [](std::vector<int> values) {
+        List result;
+        for (int value : values) {
+            result.Append(ObjectHolder::Own(Number(value)));
+        }
+        return ObjectHolder::Own(std::move(result));
+    };
+    ASSERT(Equal(make_list({1, 2}), make_list({1, 2}), context));
+    ASSERT(!Equal(make_list({1, 2}), make_list({1}), context));
+    ASSERT(NotEqual(make_list({1, 2}), make_list({2, 1}), context));
+    ASSERT_THROWS(Less(make_list({1}), make_list({2}), context), runtime_error);
+
+    ASSERT_EQUAL(Len(make_list({1, 2, 3})).TryAs<Number>()->GetValue(), 3);
+    ASSERT_EQUAL(Len(ObjectHolder::Own(String("abcd"s))).TryAs<Number>()->GetValue(), 4);
+    ASSERT_THROWS(Len(ObjectHolder::Own(Number(1))), runtime_error);
+
+    const auto numbers = make_list({1, 2, 3});
+    SetItem(numbers, ObjectHolder::Own(Number(-2)), ObjectHolder::Own(Bool(true)), context);
+    ASSERT(GetItem(numbers, ObjectHolder::Own(Number(1)), context).TryAs<Bool>()->GetValue());
+    ASSERT_THROWS(
+        GetItem(ObjectHolder::Own(String("ab"s)), ObjectHolder::Own(Number(0)), context),
+        runtime_error);
+
+    ASSERT(Contains(ObjectHolder::Own(Number(3)), numbers, context));
+    ASSERT(!Contains(ObjectHolder::Own(String("3"s)), numbers, context));
+    ASSERT(Contains(ObjectHolder::Own(String("bc"s)), ObjectHolder::Own(String("abc"s)), context));
+
+    // Элементы разных видов не равны и в операторе in, и при сравнении списков
+    List strings;
+    strings.Append(ObjectHolder::Own(String("a"s)));
+    const auto shared_strings = ObjectHolder::Own(std::move(strings));
+    ASSERT(!Contains(ObjectHolder::Own(Number(1)), shared_strings, context));
+    ASSERT(!Equal(make_list({1}), shared_strings, context));
+    ASSERT(NotEqual(shared_strings, make_list({1}), context));
+
+    // Списки, содержащие сами себя, сравниваются без бесконечной рекурсии
+    const auto make_cyclic_list = [&make_list](std::vector<int> values) {
+        auto list = make_list(std::move(values));
+        list.TryAs<List>()->Append(list);
+        return list;
+    };
+    const auto cyclic = make_cyclic_list({1, 2});
+    const auto same_cyclic = make_cyclic_list({1, 2});
+    const auto other_cyclic = make_cyclic_list({1, 3});
+    ASSERT(Equal(cyclic, cyclic, context));
+    ASSERT(Equal(cyclic, same_cyclic, context));
+    ASSERT(!Equal(cyclic, other_cyclic, context));
+    List outer;
+    outer.Append(cyclic);
+    ASSERT(Contains(cyclic, ObjectHolder::Share(outer), context));
+    for (const auto& list : {cyclic, same_cyclic, other_cyclic}) {
+        list.TryAs<List>()->ClearReferences();
+    }
+
+    // Метод __eq__ элемента, удлиняющий список во время сравнения, не приводит к чтению
+    // за концом другого списка
+    vector<Method> methods;
+    methods.push_back({"__eq__"s, {"other"s},
+                       make_unique<TestMethodBody>([](Closure& closure, Context&) {
+                           auto& self = *closure.at("self"s).TryAs<ClassInstance>();
+                           self.FindField("l"s)->TryAs<List>()->Append(closure.at("self"s));
+                           return ObjectHolder::Own(Bool(true));
+                       })});
+    Class growing_class{"Growing"s, std::move(methods), nullptr};
+    const auto make_growing_list = [&growing_class] {
+        auto list = ObjectHolder::Own(List());
+        ClassInstance item{growing_class};
+        item.SetField("l"s, list);
+        list.TryAs<List>()->Append(ObjectHolder::Own(std::move(item)));
+        return list;
+    };
+    const auto growing = make_growing_list();
+    const auto other_growing = make_growing_list();
+    ASSERT(!Equal(growing, other_growing, context));
+    ASSERT_EQUAL(growing.TryAs<List>()->GetSize(), 2U);
+    for (const auto& list : {growing, other_growing}) {
+        list.TryAs<List>()->ClearReferences();
+    }
+}
+
+void TestDict() {
+    DummyContext context;
+    const auto num = [](int value) {
+        return ObjectHolder::Own(Number(value));
+    };
+    const auto str = [](string value) {
+        return ObjectHolder::Own(String(std::move(value)));
+    };
+
+    Dict dict;
+    ASSERT(!IsTrue(ObjectHolder::Share(dict)));
+    ASSERT(ObjectHolder::Share(dict).GetKind() == ObjectKind::DICT);
+    ASSERT(!dict.Find(num(1), context));
+
+    // Несколько перестроений таблицы
+    constexpr int COUNT = 1000;
+    for (int i = 0; i < COUNT; ++i) {
+        dict.Set(num(i), num(i * i), context);
+    }
+    ASSERT_EQUAL(dict.GetSize(), static_cast<size_t>(COUNT));
+    for (int i = 0; i < COUNT; ++i) {
+        ASSERT_EQUAL(dict.Find(num(i), context)->TryAs<Number>()->GetValue(), i * i);
+        ASSERT_EQUAL(dict.GetKey(i).TryAs<Number>()->GetValue(), i);
+    }
+    ASSERT(!dict.Find(num(COUNT), context));
+    ASSERT(!dict.Find(num(-1), context));
+
+    // Повторное присваивание не меняет порядок ключей
+    dict.Set(num(0), str("zero"s), context);
+    ASSERT_EQUAL(dict.GetSize(), static_cast<size_t>(COUNT));
+    ASSERT_EQUAL(dict.GetValue(0).TryAs<String>()->GetValue(), "zero"s);
+
+    // Ключи разных видов не равны друг другу и не выбрасывают исключение при сравнении
+    Dict mixed;
+    mixed.Set(num(1), str("number"s), context);
+    mixed.Set(str("1"s), str("string"s), context);
+    mixed.Set(ObjectHolder::Own(Bool(true)), str("bool"s), context);
+    mixed.Set(ObjectHolder::None(), str("none"s), context);
+    mixed.Set(num(0), ObjectHolder::None(), context);
+    ASSERT_EQUAL(mixed.GetSize(), 5U);
+    ASSERT_EQUAL(mixed.Find(str("1"s), context)->TryAs<String>()->GetValue(), "string"s);
+    ASSERT_EQUAL(mixed.Find(ObjectHolder::None(), context)->TryAs<String>()->GetValue(),
+                 "none"s);
+    ASSERT(!*mixed.Find(num(0), context));
+    ASSERT_THROWS(mixed.Set(ObjectHolder::Own(List()), num(1), context), runtime_error);
+    ASSERT_THROWS(mixed.Set(ObjectHolder::Share(mixed), num(1), context), runtime_error);
+
+    mixed.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "{1: number, 1: string, True: bool, None: none, 0: None}"s);
+
+    // Экземпляры сравниваются методом __eq__. Одинаковый хеш всех экземпляров
+    // проверяет поиск среди коллизий
+    vector<Method> methods;
+    methods.push_back({"__hash__"s, {}, make_unique<TestMethodBody>([](Closure&, Context&) {
+                           return ObjectHolder::Own(Number(7));
+                       })});
+    methods.push_back({"__eq__"s, {"other"s},
+                       make_unique<TestMethodBody>([](Closure& closure, Context&) {
+                           const auto id = [&closure](const char* name) -> optional<int> {
+                               auto* instance = closure.at(name).TryAs<ClassInstance>();
+                               if (!instance) {
+                                   return nullopt;
+                               }
+                               return instance->FindField("id"s)->TryAs<Number>()->GetValue();
+                           };
+                           return ObjectHolder::Own(Bool(id("self") == id("other")));
+                       })});
+    Class key_class{"Key"s, std::move(methods), nullptr};
+    const auto make_key = [&key_class](int id) {
+        ClassInstance key{key_class};
+        key.SetField("id"s, ObjectHolder::Own(Number(id)));
+        return ObjectHolder::Own(std::move(key));
+    };
+    const auto keys = ObjectHolder::Own(Dict());
+    for (int i = 0; i < 20; ++i) {
+        SetItem(keys, make_key(i), num(i), context);
+    }
+    ASSERT_EQUAL(Len(keys).TryAs<Number>()->GetValue(), 20);
+    ASSERT_EQUAL(GetItem(keys, make_key(13), context).TryAs<Number>()->GetValue(), 13);
+    ASSERT(Contains(make_key(19), keys, context));
+    ASSERT(!Contains(make_key(20), keys, context));
+    // Число с тем же хешем сравнивается методом __eq__ экземпляра
+    ASSERT(!Contains(num(7), keys, context));
+    ASSERT_THROWS(GetItem(keys, make_key(20), context), runtime_error);
+
+    // Экземпляры без __hash__ нельзя использовать как ключи
+    Class plain_class{"Plain"s, {}, nullptr};
+    ClassInstance plain{plain_class};
+    ASSERT_THROWS(Hash(ObjectHolder::Share(plain), context), runtime_error);
+
+    ObjectHolder item;
+    ASSERT(GetIterationItem(keys, 19, item));
+    ASSERT(!GetIterationItem(keys, 20, item));
+    ASSERT_THROWS(GetIterationItem(num(1), 0, item), runtime_error);
+
+    const auto make_dict = [&context](std::vector<std::pair<int, int>> pairs) {
+        Dict result;
+        for (const auto& [key, value] : pairs) {
+            result.Set(ObjectHolder::Own(Number(key)), ObjectHolder::Own(Number(value)), context);
+        }
+        return ObjectHolder::Own(std::move(result));
+    };
+    ASSERT(Equal(make_dict({{1, 2}, {3, 4}}), make_dict({{3, 4}, {1, 2}}), context));
+    ASSERT(!Equal(make_dict({{1, 2}}), make_dict({{1, 3}}), context));
+    ASSERT(!Equal(make_dict({{1, 2}}), make_dict({{2, 2}}), context));
+    ASSERT(!Equal(make_dict({{1, 2}}), make_dict({{1, 2}, {3, 4}}), context));
+    Dict strings;
+    strings.Set(num(1), str("2"s), context);
+    ASSERT(!Equal(make_dict({{1, 2}}), ObjectHolder::Own(std::move(strings)), context));
+
+    // Словари, содержащие сами себя, сравниваются без бесконечной рекурсии
+    const auto make_cyclic_dict = [&make_dict, &context](std::vector<std::pair<int, int>> pairs) {
+        auto dict = make_dict(std::move(pairs));
+        dict.TryAs<Dict>()->Set(ObjectHolder::Own(String("self"s)), dict, context);
+        return dict;
+    };
+    const auto cyclic = make_cyclic_dict({{1, 2}});
+    const auto same_cyclic = make_cyclic_dict({{1, 2}});
+    const auto other_cyclic = make_cyclic_dict({{1, 3}});
+    ASSERT(Equal(cyclic, cyclic, context));
+    ASSERT(Equal(cyclic, same_cyclic, context));
+    ASSERT(!Equal(cyclic, other_cyclic, context));
+    for (const auto& dict : {cyclic, same_cyclic, other_cyclic}) {
+        dict.TryAs<Dict>()->ClearReferences();
+    }
+}
+
+void TestShapes() {
+    Class cls{"Point"s, {}, nullptr};
+    ClassInstance a{cls};
+    ClassInstance b{cls};
+    ASSERT_EQUAL(&a.GetShape(), &cls.GetInstanceShape());
+    ASSERT_EQUAL(a.GetShape().GetFieldNames(), vector<Symbol>{"self"s});
+    ASSERT_EQUAL(a.FindField("self"s)->Get(), &a);
+
+    a.SetField("x"s, ObjectHolder::Own(Number(1)));
+    a.SetField("y"s, ObjectHolder::Own(Number(2)));
+    b.SetField("x"s, ObjectHolder::Own(Number(3)));
+    b.SetField("y"s, ObjectHolder::Own(Number(4)));
+    // Одинаковый порядок добавления полей приводит к общей форме
+    ASSERT_EQUAL(&a.GetShape(), &b.GetShape());
+    ASSERT_EQUAL(a.GetShape().GetFieldNames(), (vector<Symbol>{"self"s, "x"s, "y"s}));
+    ASSERT_EQUAL(a.GetShape().FindField("y"s), 2U);
+    ASSERT_EQUAL(a.GetShape().FindField("z"s), Shape::NO_FIELD);
+    ASSERT_EQUAL(b.FieldAt(1).TryAs<Number>()->GetValue(), 3);
+
+    const Shape* shape = &a.GetShape();
+    a.SetField("x"s, ObjectHolder::Own(Number(5)));
+    ASSERT_EQUAL(&a.GetShape(), shape);
+    ASSERT_EQUAL(a.FindField("x"s)->TryAs<Number>()->GetValue(), 5);
+
+    ClassInstance c{cls};
+    c.SetField("y"s, ObjectHolder::None());
+    c.SetField("x"s, ObjectHolder::None());
+    ASSERT(&c.GetShape() != &a.GetShape());
+    ASSERT(c.FindField("z"s) == nullptr);
+
+    // Новые экземпляры сразу получают место под поля, которые получали их предшественники
+    ASSERT_EQUAL(cls.GetInstanceShape().GetExpectedFieldCount(), 3U);
+
+    // Поле self копии указывает на саму копию
+    ClassInstance copy{a};
+    ASSERT_EQUAL(copy.FindField("self"s)->Get(), &copy);
+    ASSERT_EQUAL(copy.FindField("x"s)->TryAs<Number>()->GetValue(), 5);
+}
+
+void TestInlineCaches() {
+    InlineCacheStats stats;
+    InlineCache<const void*, int> cache;
+    int keys[InlineCache<const void*, int>::CAPACITY + 1];
+
+    ASSERT(cache.Find(&keys[0], stats) == nullptr);
+    cache.Insert(&keys[0], 0);
+    ASSERT_EQUAL(*cache.Find(&keys[0], stats), 0);
+    for (int i = 1; i <= static_cast<int>(cache.CAPACITY); ++i) {
+        cache.Insert(&keys[i], i);
+    }
+    // Кэш полиморфен, но не безграничен: самый старый ключ вытеснен
+    ASSERT_EQUAL(cache.GetSize(), cache.CAPACITY);
+    ASSERT(cache.Find(&keys[0], stats) == nullptr);
+    ASSERT_EQUAL(*cache.Find(&keys[cache.CAPACITY], stats), static_cast<int>(cache.CAPACITY));
+    ASSERT_EQUAL(stats.hits, 2U);
+    ASSERT_EQUAL(stats.misses, 2U);
+
+    Class cls{"Point"s, {}, nullptr};
+    ClassInstance a{cls};
+    ClassInstance b{cls};
+    FieldStoreCache store_cache;
+    FieldLoadCache load_cache;
+    const auto counters = inline_cache_counters;
+
+    a.SetField("x"s, ObjectHolder::Own(Number(1)), store_cache);
+    b.SetField("x"s, ObjectHolder::Own(Number(2)), store_cache);
+    b.SetField("x"s, ObjectHolder::Own(Number(3)), store_cache);
+    // Переход к форме с полем x взят из кэша
+    ASSERT_EQUAL(&a.GetShape(), &b.GetShape());
+    ASSERT_EQUAL(a.FindField("x"s, load_cache)->TryAs<Number>()->GetValue(), 1);
+    ASSERT_EQUAL(b.FindField("x"s, load_cache)->TryAs<Number>()->GetValue(), 3);
+
+    ASSERT_EQUAL(inline_cache_counters.field_stores.misses - counters.field_stores.misses, 2U);
+    ASSERT_EQUAL(inline_cache_counters.field_stores.hits - counters.field_stores.hits, 1U);
+    ASSERT_EQUAL(inline_cache_counters.field_loads.misses - counters.field_loads.misses, 1U);
+    ASSERT_EQUAL(inline_cache_counters.field_loads.hits - counters.field_loads.hits, 1U);
+}
+
 void TestNullptr() {
     ObjectHolder oh;
     ASSERT(!oh);
@@ -235,6 +789,14 @@ void RunObjectsTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestNumber);
     RUN_TEST(tr, runtime::TestString);
     RUN_TEST(tr, runtime::TestMethodInvocation);
+    RUN_TEST(tr, runtime::TestMethodTable);
+    RUN_TEST(tr, runtime::TestSymbols);
+    RUN_TEST(tr, runtime::TestOutputBuffer);
+    RUN_TEST(tr, runtime::TestList);
+    RUN_TEST(tr, runtime::TestDict);
+    RUN_TEST(tr, runtime::TestShapes);
+    RUN_TEST(tr, runtime::TestInlineCaches);
+    RUN_TEST(tr, runtime::TestArena);
 }
 
 void RunObjectHolderTests(TestRunner& tr) {
@@ -242,6 +804,8 @@ void RunObjectHolderTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestOwning);
     RUN_TEST(tr, runtime::TestMove);
     RUN_TEST(tr, runtime::TestNullptr);
+    RUN_TEST(tr, runtime::TestInlineValues);
+    RUN_TEST(tr, runtime::TestObjectKinds);
 }
 
 }  // namespace runtime
\ No newline at end of file
@@ -12,28 +12,13 @@ using runtime::Context;
 using runtime::ObjectHolder;
 
 namespace {
-const string ADD_METHOD = "__add__"s;
-const string INIT_METHOD = "__init__"s;
+const runtime::Symbol INIT_METHOD{"__init__"};
+const runtime::Symbol SELF{"self"};
 }  // namespace
 
 namespace detail {
 
-class ReturnObj : public std::exception {
-public:
-    explicit ReturnObj(runtime::ObjectHolder obj)
-    : std::exception()
-    , obj_(std::move(obj))
-    {}
-
-    runtime::ObjectHolder GetObj() const {
-        return obj_;
-    }
-
-private:
-    runtime::ObjectHolder obj_;
-};
-
-void ThrowClassIntanceCastError(const ObjectHolder& obj, const std::string& where) {
+[[noreturn]] void ThrowClassIntanceCastError(const ObjectHolder& obj, const std::string& where) {
     using namespace std::literals;
     if (!obj) {
         throw std::runtime_error("Trying to "s + where + " in <None> object"s);
@@ -49,6 +34,12 @@ void ThrowClassIntanceCastError(const ObjectHolder& obj, const std::string& wher
     if (const auto bool_ptr = obj.TryAs<runtime::Bool>()) {
         throw std::runtime_error("Trying to "s + where + " in <bool> object"s);
     }
+    if (obj.TryAs<runtime::List>()) {
+        throw std::runtime_error("Trying to "s + where + " in <list> object"s);
+    }
+    if (obj.TryAs<runtime::Dict>()) {
+        throw std::runtime_error("Trying to "s + where + " in <dict> object"s);
+    }
     if (const auto cls_ptr = obj.TryAs<runtime::Class>()) {
         throw std::runtime_error("Trying to "s + where + " in <class> object: \""s
                 + cls_ptr->GetName() + "\""s);
@@ -60,52 +51,60 @@ void ThrowClassIntanceCastError(const ObjectHolder& obj, const std::string& wher
 
 // ----------- VariableValue -----------------------
 
-VariableValue::VariableValue(const std::string& var_name) {
+VariableValue::VariableValue(runtime::Symbol var_name) {
     dotted_ids_.emplace_back(var_name);
 }
 
-VariableValue::VariableValue(std::vector<std::string> dotted_ids)
+VariableValue::VariableValue(std::vector<runtime::Symbol> dotted_ids)
     : dotted_ids_(std::move(dotted_ids))
+    , field_caches_(dotted_ids_.empty() ? 0 : dotted_ids_.size() - 1)
     {}
 
 ObjectHolder VariableValue::Execute(Closure& closure,
                    [[maybe_unused]] Context& context) {
     using namespace std::literals;
 
-    if (!closure.count(dotted_ids_.front())) {
-        throw std::runtime_error("No field with name \""s + dotted_ids_.front() + "\""s);
+    const auto var_it = closure.find(dotted_ids_.front());
+    if (var_it == closure.end()) {
+        throw std::runtime_error("No field with name \""s + dotted_ids_.front().GetName() + "\""s);
     }
 
     if (dotted_ids_.size() == 1) {
-        return closure.at(dotted_ids_.front());
+        return var_it->second;
     }
-    auto cls_inst_ptr = closure.at(dotted_ids_.front())
-                                      .TryAs<runtime::ClassInstance>();
+    auto cls_inst_ptr = var_it->second.TryAs<runtime::ClassInstance>();
     if (!cls_inst_ptr) {
-        throw std::runtime_error("Failed to cast \""s + dotted_ids_.front() + "\" to <ClassInstance>"s);
+        throw std::runtime_error("Failed to cast \""s + dotted_ids_.front().GetName()
+                                 + "\" to <ClassInstance>"s);
     }
 
     for (size_t i = 1u; i + 1u < dotted_ids_.size(); ++i) {
-        if (!cls_inst_ptr->Fields().count(dotted_ids_[i])) {
-            throw std::runtime_error("No field with name \""s + dotted_ids_[i] + "\""s);
+        const auto field_ptr = cls_inst_ptr->FindField(dotted_ids_[i], field_caches_[i - 1]);
+        if (!field_ptr) {
+            throw std::runtime_error("No field with name \""s + dotted_ids_[i].GetName() + "\""s);
         }
-        cls_inst_ptr = cls_inst_ptr->Fields()
-                .at(dotted_ids_[i]).TryAs<runtime::ClassInstance>();
+        cls_inst_ptr = field_ptr->TryAs<runtime::ClassInstance>();
         if (!cls_inst_ptr) {
-            throw std::runtime_error("Failed to cast \""s + dotted_ids_[i] + "\" to <ClassInstance>"s);
+            throw std::runtime_error("Failed to cast \""s + dotted_ids_[i].GetName()
+                                     + "\" to <ClassInstance>"s);
         }
     }
 
-    if (!cls_inst_ptr->Fields().count(dotted_ids_.back())) {
-        throw std::runtime_error("No field with name \""s + dotted_ids_.back() + "\""s);
+    const auto field_ptr = cls_inst_ptr->FindField(dotted_ids_.back(), field_caches_.back());
+    if (!field_ptr) {
+        throw std::runtime_error("No field with name \""s + dotted_ids_.back().GetName() + "\""s);
     }
-    return cls_inst_ptr->Fields().at(dotted_ids_.back());
+    return cls_inst_ptr->LoadField(*field_ptr);
+}
+
+const std::vector<runtime::Symbol>& VariableValue::GetDottedIds() const {
+    return dotted_ids_;
 }
 
 // ----------- Assignment -----------------------
 
-Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
-    : var_name_(std::move(var))
+Assignment::Assignment(runtime::Symbol var, StatementPtr rv)
+    : var_name_(var)
     , value_(std::move(rv))
     {}
 
@@ -115,39 +114,146 @@ ObjectHolder Assignment::Execute(Closure& closure,
     return closure.at(var_name_);
 }
 
+runtime::Symbol Assignment::GetVarName() const {
+    return var_name_;
+}
+
+const Statement& Assignment::GetValue() const {
+    return *value_;
+}
+
 // ----------- FieldAssignment -----------------------
 
-FieldAssignment::FieldAssignment(VariableValue object, std::string field_name,
-                                 std::unique_ptr<Statement> rv)
+FieldAssignment::FieldAssignment(VariableValue object, runtime::Symbol field_name,
+                                 StatementPtr rv)
     : object_(std::move(object))
-    , field_name_(std::move(field_name))
+    , field_name_(field_name)
     , field_value_(std::move(rv))
     {}
 
 ObjectHolder FieldAssignment::Execute(Closure& closure, Context& context) {
     using namespace std::literals;
 
-    const auto cls_inst_ptr = object_.Execute(closure, context)
-                                .TryAs<runtime::ClassInstance>();
+    // object удерживает экземпляр, пока вычисляется значение поля
+    const auto object = object_.Execute(closure, context);
+    const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
     if (!cls_inst_ptr) {
-        detail::ThrowClassIntanceCastError(object_.Execute(closure, context), "FieldAssignment"s);
+        detail::ThrowClassIntanceCastError(object, "FieldAssignment"s);
     }
-    cls_inst_ptr->Fields()[field_name_] = field_value_->Execute(closure, context);
+    auto value = field_value_->Execute(closure, context);
+    cls_inst_ptr->SetField(field_name_, value, field_cache_);
+
+    return value;
+}
+
+const VariableValue& FieldAssignment::GetObject() const {
+    return object_;
+}
+
+runtime::Symbol FieldAssignment::GetFieldName() const {
+    return field_name_;
+}
+
+const Statement& FieldAssignment::GetValue() const {
+    return *field_value_;
+}
+
+// ----------- ListLiteral -----------------------
+
+ListLiteral::ListLiteral(std::vector<StatementPtr> items)
+    : items_(std::move(items))
+    {}
+
+ObjectHolder ListLiteral::Execute(Closure& closure, Context& context) {
+    runtime::List list;
+    for (const auto& item : items_) {
+        list.Append(item->Execute(closure, context));
+    }
+    return ObjectHolder::Own(std::move(list));
+}
+
+const std::vector<StatementPtr>& ListLiteral::GetItems() const {
+    return items_;
+}
+
+// ----------- DictLiteral -----------------------
+
+DictLiteral::DictLiteral(std::vector<StatementPtr> items)
+    : items_(std::move(items))
+    {}
+
+ObjectHolder DictLiteral::Execute(Closure& closure, Context& context) {
+    runtime::Dict dict;
+    for (size_t i = 0; i + 1 < items_.size(); i += 2) {
+        auto key = items_[i]->Execute(closure, context);
+        dict.Set(std::move(key), items_[i + 1]->Execute(closure, context), context);
+    }
+    return ObjectHolder::Own(std::move(dict));
+}
+
+const std::vector<StatementPtr>& DictLiteral::GetItems() const {
+    return items_;
+}
+
+// ----------- Index -----------------------
+
+Index::Index(StatementPtr object, StatementPtr index)
+    : object_(std::move(object))
+    , index_(std::move(index))
+    {}
+
+ObjectHolder Index::Execute(Closure& closure, Context& context) {
+    const auto object = object_->Execute(closure, context);
+    return runtime::GetItem(object, index_->Execute(closure, context), context);
+}
+
+const Statement& Index::GetObject() const {
+    return *object_;
+}
 
-    return cls_inst_ptr->Fields().at(field_name_);
+const Statement& Index::GetIndex() const {
+    return *index_;
+}
+
+// ----------- IndexAssignment -----------------------
+
+IndexAssignment::IndexAssignment(StatementPtr object, StatementPtr index, StatementPtr rv)
+    : object_(std::move(object))
+    , index_(std::move(index))
+    , value_(std::move(rv))
+    {}
+
+ObjectHolder IndexAssignment::Execute(Closure& closure, Context& context) {
+    const auto object = object_->Execute(closure, context);
+    const auto index = index_->Execute(closure, context);
+    auto value = value_->Execute(closure, context);
+    runtime::SetItem(object, index, value, context);
+    return value;
+}
+
+const Statement& IndexAssignment::GetObject() const {
+    return *object_;
+}
+
+const Statement& IndexAssignment::GetIndex() const {
+    return *index_;
+}
+
+const Statement& IndexAssignment::GetValue() const {
+    return *value_;
 }
 
 // ----------- Print -----------------------
 
-Print::Print(unique_ptr<Statement> argument) {
+Print::Print(StatementPtr argument) {
     args_.emplace_back(std::move(argument));
 }
 
-Print::Print(vector<unique_ptr<Statement>> args)
+Print::Print(vector<StatementPtr> args)
     : args_(std::move(args))
     {}
 
-unique_ptr<Print> Print::Variable(const std::string& name) {
+unique_ptr<Print> Print::Variable(runtime::Symbol name) {
     return std::make_unique<Print>(std::make_unique<VariableValue>(name));
 }
 
@@ -156,37 +262,50 @@ ObjectHolder Print::Execute(Closure& closure, Context& context) {
     bool is_not_first = false;
     for (const auto& arg : args_) {
         if (is_not_first) {
-            out << " "s;
+            out.put(' ');
         } else {
             is_not_first = true;
         }
         const auto& obj = arg->Execute(closure, context);
         if (!obj) {
-            out << "None"s;
-            continue;
+            out << "None"sv;
+        } else if (const auto* number = obj.TryAs<runtime::Number>()) {
+            context.WriteNumber(number->GetValue());
+        } else {
+            obj->Print(out, context);
         }
-        obj->Print(out, context);
     }
-    out << endl;
+    context.EndLine();
     return ObjectHolder();
 }
 
+const std::vector<StatementPtr>& Print::GetArgs() const {
+    return args_;
+}
+
 // ----------- MethodCall -----------------------
 
-MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method,
-                       std::vector<std::unique_ptr<Statement>> args)
+MethodCall::MethodCall(StatementPtr object, runtime::Symbol method,
+                       std::vector<StatementPtr> args)
     : object_(std::move(object))
-    , method_name_(std::move(method))
+    , method_name_(method)
     , args_(std::move(args))
     {}
 
 ObjectHolder MethodCall::Execute(Closure& closure, Context& context) {
     using namespace std::literals;
 
-    const auto cls_inst_ptr = object_->Execute(closure, context)
-                                .TryAs<runtime::ClassInstance>();
+    const auto object = object_->Execute(closure, context);
+    if (auto* list = object.TryAs<runtime::List>()) {
+        std::vector<ObjectHolder> actual_args;
+        for (const auto& arg : args_) {
+            actual_args.emplace_back(arg->Execute(closure, context));
+        }
+        return list->Call(method_name_, actual_args.data(), actual_args.size());
+    }
+    const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
     if (!cls_inst_ptr) {
-        detail::ThrowClassIntanceCastError(object_->Execute(closure, context), "MethodCall"s);
+        detail::ThrowClassIntanceCastError(object, "MethodCall"s);
     }
 
     std::vector<ObjectHolder> actual_args;
@@ -194,38 +313,80 @@ ObjectHolder MethodCall::Execute(Closure& closure, Context& context) {
         actual_args.emplace_back(arg->Execute(closure, context));
     }
 
+    const auto method = cls_inst_ptr->GetClass().GetMethod(method_name_, method_cache_);
+    if (method && method->formal_params.size() == actual_args.size()) {
+        // Подкласс мог переопределить метод: кадр заменяется, только если вызывается
+        // тот же самый метод
+        if (tail_call_body_ && method->body.get() == tail_call_body_) {
+            runtime::BindArguments(*method, object, actual_args, closure);
+            context.SetCompletion(runtime::Completion::TAIL_CALL);
+            return ObjectHolder::None();
+        }
+        return cls_inst_ptr->Call(*method, actual_args, context);
+    }
+    // Сообщение об ошибке формирует поиск метода по имени
     return cls_inst_ptr->Call(method_name_, actual_args, context);
 }
 
+const Statement& MethodCall::GetObject() const {
+    return *object_;
+}
+
+runtime::Symbol MethodCall::GetMethodName() const {
+    return method_name_;
+}
+
+const std::vector<StatementPtr>& MethodCall::GetArgs() const {
+    return args_;
+}
+
+bool MethodCall::IsTailCall() const {
+    return tail_call_body_ != nullptr;
+}
+
 // ----------- NewInstance -----------------------
 
 NewInstance::NewInstance(const runtime::Class& class_)
-    : cls_inst_(class_)
+    : class_(class_)
     {}
 
-NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args)
-    : cls_inst_(class_)
+NewInstance::NewInstance(const runtime::Class& class_, std::vector<StatementPtr> args)
+    : class_(class_)
     , args_(std::move(args))
     {}
 
 ObjectHolder NewInstance::Execute(Closure& closure, Context& context) {
-    if (cls_inst_.HasMethod(INIT_METHOD, args_.size())) {
+    auto instance = ObjectHolder::Own(runtime::ClassInstance(class_));
+    auto* cls_inst_ptr = instance.TryAs<runtime::ClassInstance>();
+    if (cls_inst_ptr->HasMethod(INIT_METHOD, args_.size())) {
         std::vector<ObjectHolder> actual_args;
         for (const auto& arg : args_) {
             actual_args.emplace_back(arg->Execute(closure, context));
         }
-        cls_inst_.Call(INIT_METHOD, actual_args, context);
+        cls_inst_ptr->Call(INIT_METHOD, actual_args, context);
     }
 
-    return ObjectHolder::Share(cls_inst_);
+    return instance;
+}
+
+const runtime::Class& NewInstance::GetClass() const {
+    return class_;
+}
+
+const std::vector<StatementPtr>& NewInstance::GetArgs() const {
+    return args_;
 }
 
 // ----------- UnaryOperation -----------------------
 
-UnaryOperation::UnaryOperation(std::unique_ptr<Statement> argument)
+UnaryOperation::UnaryOperation(StatementPtr argument)
     : arg_(std::move(argument))
     {}
 
+const Statement& UnaryOperation::GetArgument() const {
+    return *arg_;
+}
+
 // ----------- Stringify -----------------------
 
 ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
@@ -240,36 +401,33 @@ ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
     return ObjectHolder::Own(runtime::String(out.str()));
 }
 
+// ----------- Len -----------------------
+
+ObjectHolder Len::Execute(Closure& closure, Context& context) {
+    return runtime::Len(arg_->Execute(closure, context));
+}
+
 // ----------- BinaryOperation -----------------------
 
-BinaryOperation::BinaryOperation(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
+BinaryOperation::BinaryOperation(StatementPtr lhs, StatementPtr rhs)
     : lhs_(std::move(lhs))
     , rhs_(std::move(rhs))
     {}
 
+const Statement& BinaryOperation::GetLhs() const {
+    return *lhs_;
+}
+
+const Statement& BinaryOperation::GetRhs() const {
+    return *rhs_;
+}
+
 // ----------- Add -----------------------
 
 ObjectHolder Add::Execute(Closure& closure, Context& context) {
     const auto& lhs_obj = lhs_->Execute(closure, context);
     const auto& rhs_obj = rhs_->Execute(closure, context);
-    if (const auto lhs_num_ptr = lhs_obj.TryAs<runtime::Number>(),
-                   rhs_num_ptr = rhs_obj.TryAs<runtime::Number>();
-                   lhs_num_ptr && rhs_num_ptr) {
-        const auto sum = lhs_num_ptr->GetValue() + rhs_num_ptr->GetValue();
-        return ObjectHolder::Own(runtime::Number(sum));
-    }
-    if (const auto lhs_str_ptr = lhs_obj.TryAs<runtime::String>(),
-                   rhs_str_ptr = rhs_obj.TryAs<runtime::String>();
-                   lhs_str_ptr && rhs_str_ptr) {
-        const auto sum = lhs_str_ptr->GetValue() + rhs_str_ptr->GetValue();
-        return ObjectHolder::Own(runtime::String(sum));
-    }
-    if (const auto lhs_cls_inst_ptr = lhs_obj.TryAs<runtime::ClassInstance>()) {
-        if (lhs_cls_inst_ptr->HasMethod(ADD_METHOD, 1u)) {
-            return lhs_cls_inst_ptr->Call(ADD_METHOD, {rhs_obj}, context);
-        }
-    }
-    throw std::runtime_error("Failed on Add operation"s);
+    return runtime::Add(lhs_obj, rhs_obj, context);
 }
 
 // ----------- Sub -----------------------
@@ -277,13 +435,7 @@ ObjectHolder Add::Execute(Closure& closure, Context& context) {
 ObjectHolder Sub::Execute(Closure& closure, Context& context) {
     const auto& lhs_obj = lhs_->Execute(closure, context);
     const auto& rhs_obj = rhs_->Execute(closure, context);
-    if (const auto lhs_num_ptr = lhs_obj.TryAs<runtime::Number>(),
-                   rhs_num_ptr = rhs_obj.TryAs<runtime::Number>();
-                   lhs_num_ptr && rhs_num_ptr) {
-        const auto sum = lhs_num_ptr->GetValue() - rhs_num_ptr->GetValue();
-        return ObjectHolder::Own(runtime::Number(sum));
-    }
-    throw std::runtime_error("Failed on Sub operation"s);
+    return runtime::Sub(lhs_obj, rhs_obj, context);
 }
 
 // ----------- Mult -----------------------
@@ -291,13 +443,7 @@ ObjectHolder Sub::Execute(Closure& closure, Context& context) {
 ObjectHolder Mult::Execute(Closure& closure, Context& context) {
     const auto& lhs_obj = lhs_->Execute(closure, context);
     const auto& rhs_obj = rhs_->Execute(closure, context);
-    if (const auto lhs_num_ptr = lhs_obj.TryAs<runtime::Number>(),
-                   rhs_num_ptr = rhs_obj.TryAs<runtime::Number>();
-                   lhs_num_ptr && rhs_num_ptr) {
-        const auto sum = lhs_num_ptr->GetValue() * rhs_num_ptr->GetValue();
-        return ObjectHolder::Own(runtime::Number(sum));
-    }
-    throw std::runtime_error("Failed on Mult operation"s);
+    return runtime::Mult(lhs_obj, rhs_obj, context);
 }
 
 // ----------- Div -----------------------
@@ -305,13 +451,7 @@ ObjectHolder Mult::Execute(Closure& closure, Context& context) {
 ObjectHolder Div::Execute(Closure& closure, Context& context) {
     const auto& lhs_obj = lhs_->Execute(closure, context);
     const auto& rhs_obj = rhs_->Execute(closure, context);
-    if (const auto lhs_num_ptr = lhs_obj.TryAs<runtime::Number>(),
-                   rhs_num_ptr = rhs_obj.TryAs<runtime::Number>();
-                   lhs_num_ptr && rhs_num_ptr && rhs_num_ptr->GetValue()) {
-        const auto sum = lhs_num_ptr->GetValue() / rhs_num_ptr->GetValue();
-        return ObjectHolder::Own(runtime::Number(sum));
-    }
-    throw std::runtime_error("Failed on Div operation"s);
+    return runtime::Div(lhs_obj, rhs_obj, context);
 }
 
 // ----------- Or -----------------------
@@ -348,46 +488,93 @@ ObjectHolder Not::Execute(Closure& closure, Context& context) {
 
 // ----------- Compound -----------------------
 
-void Compound::AddStatement(std::unique_ptr<Statement> stmt) {
+void Compound::AddStatement(StatementPtr stmt) {
     args_.emplace_back(std::move(stmt));
 }
 
 ObjectHolder Compound::Execute(Closure& closure, Context& context) {
     for (const auto& arg : args_) {
-        arg->Execute(closure, context);
+        auto result = arg->Execute(closure, context);
+        if (context.GetCompletion() != runtime::Completion::NORMAL) {
+            return result;
+        }
     }
     return ObjectHolder::None();
 }
 
+const std::vector<StatementPtr>& Compound::GetStatements() const {
+    return args_;
+}
+
 // ----------- MethodBody -----------------------
 
-MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
+MethodBody::MethodBody(StatementPtr&& body)
     : body_(std::move(body))
     {}
 
 ObjectHolder MethodBody::Execute(Closure& closure, Context& context) {
-    try {
-        const auto& obj = body_->Execute(closure, context);
-    } catch (detail::ReturnObj& return_obj) {
-        return return_obj.GetObj();
+    auto result = body_->Execute(closure, context);
+    while (context.GetCompletion() == runtime::Completion::TAIL_CALL) {
+        context.SetCompletion(runtime::Completion::NORMAL);
+        result = body_->Execute(closure, context);
+    }
+    if (context.GetCompletion() == runtime::Completion::RETURN) {
+        context.SetCompletion(runtime::Completion::NORMAL);
+        return result;
     }
     return ObjectHolder::None();
 }
 
+const Statement& MethodBody::GetBody() const {
+    return *body_;
+}
+
+void MethodBody::MarkTailCalls(runtime::Symbol method_name, size_t param_count) {
+    MarkTailCalls(*body_, method_name, param_count);
+}
+
+void MethodBody::MarkTailCalls(Statement& node, runtime::Symbol method_name,
+                               size_t param_count) {
+    if (auto* compound = dynamic_cast<Compound*>(&node)) {
+        if (!compound->args_.empty()) {
+            MarkTailCalls(*compound->args_.back(), method_name, param_count);
+        }
+    } else if (auto* if_else = dynamic_cast<IfElse*>(&node)) {
+        MarkTailCalls(*if_else->if_body_, method_name, param_count);
+        if (if_else->else_body_) {
+            MarkTailCalls(*if_else->else_body_, method_name, param_count);
+        }
+    } else if (auto* ret = dynamic_cast<Return*>(&node)) {
+        auto* call = dynamic_cast<MethodCall*>(ret->statement_.get());
+        if (!call || call->method_name_ != method_name || call->args_.size() != param_count) {
+            return;
+        }
+        const auto* object = dynamic_cast<const VariableValue*>(call->object_.get());
+        if (object && object->GetDottedIds() == std::vector<runtime::Symbol>{SELF}) {
+            call->tail_call_body_ = this;
+        }
+    }
+}
+
 // ----------- Return -----------------------
 
-Return::Return(std::unique_ptr<Statement> statement)
+Return::Return(StatementPtr statement)
     : statement_(std::move(statement))
     {}
 
 ObjectHolder Return::Execute(Closure& closure, Context& context) {
-    const auto& obj = statement_->Execute(closure, context);
+    auto obj = statement_->Execute(closure, context);
+    // return None не прерывает выполнение метода
     if (obj) {
-        throw detail::ReturnObj(obj);
+        context.SetCompletion(runtime::Completion::RETURN);
     }
     return obj;
 }
 
+const Statement& Return::GetStatement() const {
+    return *statement_;
+}
+
 // ----------- ClassDefinition -----------------------
 
 ClassDefinition::ClassDefinition(ObjectHolder cls)
@@ -405,11 +592,15 @@ ObjectHolder ClassDefinition::Execute(Closure& closure,
     return cls_;
 }
 
+const ObjectHolder& ClassDefinition::GetClass() const {
+    return cls_;
+}
+
 // ----------- IfElse -----------------------
 
-IfElse::IfElse(std::unique_ptr<Statement> condition,
-               std::unique_ptr<Statement> if_body,
-               std::unique_ptr<Statement> else_body)
+IfElse::IfElse(StatementPtr condition,
+               StatementPtr if_body,
+               StatementPtr else_body)
     : condition_(std::move(condition))
     , if_body_(std::move(if_body))
     , else_body_(std::move(else_body))
@@ -425,9 +616,137 @@ ObjectHolder IfElse::Execute(Closure& closure, Context& context) {
     return {};
 }
 
+const Statement& IfElse::GetCondition() const {
+    return *condition_;
+}
+
+const Statement& IfElse::GetIfBody() const {
+    return *if_body_;
+}
+
+const Statement* IfElse::GetElseBody() const {
+    return else_body_.get();
+}
+
+// ----------- While -----------------------
+
+While::While(StatementPtr condition, StatementPtr body)
+    : condition_(std::move(condition))
+    , body_(std::move(body))
+    {}
+
+ObjectHolder While::Execute(Closure& closure, Context& context) {
+    while (IsTrue(condition_->Execute(closure, context))) {
+        auto result = body_->Execute(closure, context);
+        if (context.GetCompletion() != runtime::Completion::NORMAL) {
+            return result;
+        }
+    }
+    return ObjectHolder::None();
+}
+
+const Statement& While::GetCondition() const {
+    return *condition_;
+}
+
+const Statement& While::GetBody() const {
+    return *body_;
+}
+
+// ----------- ForRange -----------------------
+
+ForRange::ForRange(runtime::Symbol var_name, StatementPtr start, StatementPtr stop,
+                   StatementPtr step, StatementPtr body)
+    : var_name_(var_name)
+    , start_(std::move(start))
+    , stop_(std::move(stop))
+    , step_(std::move(step))
+    , body_(std::move(body))
+    {}
+
+ObjectHolder ForRange::Execute(Closure& closure, Context& context) {
+    const ObjectHolder start = start_ ? start_->Execute(closure, context) : ObjectHolder::None();
+    const ObjectHolder stop = stop_->Execute(closure, context);
+    const ObjectHolder step = step_ ? step_->Execute(closure, context) : ObjectHolder::None();
+    const auto range = runtime::Range::FromArgs(start, stop, step);
+
+    // Переменная ищется в closure один раз: элементы unordered_map не перемещаются
+    // при вставке новых переменных в теле цикла
+    ObjectHolder* var = nullptr;
+    for (int value = range.start; range.Contains(value); value = range.Next(value)) {
+        if (!var) {
+            var = &closure[var_name_];
+        }
+        *var = ObjectHolder::Own(runtime::Number(value));
+        auto result = body_->Execute(closure, context);
+        if (context.GetCompletion() != runtime::Completion::NORMAL) {
+            return result;
+        }
+    }
+    return ObjectHolder::None();
+}
+
+runtime::Symbol ForRange::GetVarName() const {
+    return var_name_;
+}
+
+const Statement* ForRange::GetStart() const {
+    return start_.get();
+}
+
+const Statement& ForRange::GetStop() const {
+    return *stop_;
+}
+
+const Statement* ForRange::GetStep() const {
+    return step_.get();
+}
+
+const Statement& ForRange::GetBody() const {
+    return *body_;
+}
+
+// ----------- ForEach -----------------------
+
+ForEach::ForEach(runtime::Symbol var_name, StatementPtr iterable, StatementPtr body)
+    : var_name_(var_name)
+    , iterable_(std::move(iterable))
+    , body_(std::move(body))
+    {}
+
+ObjectHolder ForEach::Execute(Closure& closure, Context& context) {
+    const ObjectHolder iterable = iterable_->Execute(closure, context);
+    ObjectHolder item;
+    // Как и в ForRange, переменная ищется в closure один раз
+    ObjectHolder* var = nullptr;
+    for (size_t i = 0; runtime::GetIterationItem(iterable, i, item); ++i) {
+        if (!var) {
+            var = &closure[var_name_];
+        }
+        *var = std::move(item);
+        auto result = body_->Execute(closure, context);
+        if (context.GetCompletion() != runtime::Completion::NORMAL) {
+            return result;
+        }
+    }
+    return ObjectHolder::None();
+}
+
+runtime::Symbol ForEach::GetVarName() const {
+    return var_name_;
+}
+
+const Statement& ForEach::GetIterable() const {
+    return *iterable_;
+}
+
+const Statement& ForEach::GetBody() const {
+    return *body_;
+}
+
 // ----------- Comparison -----------------------
 
-Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
+Comparison::Comparison(Comparator cmp, StatementPtr lhs, StatementPtr rhs)
     : BinaryOperation(std::move(lhs), std::move(rhs))
     , cmp_(cmp)
     {}
@@ -438,6 +757,28 @@ ObjectHolder Comparison::Execute(Closure& closure, Context& context) {
     return ObjectHolder::Own(runtime::Bool(cmp_(lhs_obj, rhs_obj, context)));
 }
 
+const Comparison::Comparator& Comparison::GetComparator() const {
+    return cmp_;
+}
+
+// ----------- Program -----------------------
+
+void Program::SetTree(StatementPtr tree) {
+    tree_ = std::move(tree);
+}
+
+ObjectHolder Program::Execute(Closure& closure, Context& context) {
+    return tree_->Execute(closure, context);
+}
+
+const Statement& Program::GetTree() const {
+    return *tree_;
+}
+
+const runtime::Arena& Program::GetArena() const {
+    return arena_;
+}
+
 
 
 }  // namespace ast
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arena.h"
 #include "runtime.h"
 
 #include <functional>
@@ -8,6 +9,10 @@ namespace ast {
 
 using Statement = runtime::Executable;
 
+// Указатель на узел дерева. Узлы, построенные парсером, размещаются в арене программы
+// (ast::Program), и указатели на них не владеют ими
+using StatementPtr = runtime::ExecutablePtr<>;
+
 // Выражение, возвращающее значение типа T,
 // используется как основа для создания констант
 template <typename T>
@@ -19,7 +24,16 @@ public:
 
     runtime::ObjectHolder Execute(runtime::Closure& /*closure*/,
                                   runtime::Context& /*context*/) override {
-        return runtime::ObjectHolder::Share(value_);
+        if constexpr (std::is_same_v<T, runtime::Number> || std::is_same_v<T, runtime::Bool>) {
+            // Числа и логические значения копируются в ObjectHolder без выделения памяти
+            return runtime::ObjectHolder::Own(T(value_));
+        } else {
+            return runtime::ObjectHolder::Share(value_);
+        }
+    }
+
+    [[nodiscard]] const T& GetValue() const {
+        return value_;
     }
 
 private:
@@ -33,42 +47,138 @@ using BoolConst = ValueStatement<runtime::Bool>;
 // Вычисляет значение переменной либо цепочки вызовов полей объектов id1.id2.id3
 class VariableValue : public Statement {
 public:
-    explicit VariableValue(const std::string& var_name);
-    explicit VariableValue(std::vector<std::string> dotted_ids);
+    explicit VariableValue(runtime::Symbol var_name);
+    explicit VariableValue(std::vector<runtime::Symbol> dotted_ids);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure,
                  [[maybe_unused]] runtime::Context& context) override;
 
+    [[nodiscard]] const std::vector<runtime::Symbol>& GetDottedIds() const;
+
 private:
-    std::vector<std::string> dotted_ids_;
+    std::vector<runtime::Symbol> dotted_ids_;
+    // Встроенные кэши обращений к полям dotted_ids_[1], dotted_ids_[2], ...
+    std::vector<runtime::FieldLoadCache> field_caches_;
 };
 
 // Присваивает переменной, имя которой задано в параметре var, значение выражения rv
 class Assignment : public Statement {
 public:
-    Assignment(std::string var, std::unique_ptr<Statement> rv);
+    Assignment(runtime::Symbol var, StatementPtr rv);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure,
                  [[maybe_unused]] runtime::Context& context) override;
 
+    [[nodiscard]] runtime::Symbol GetVarName() const;
+    [[nodiscard]] const Statement& GetValue() const;
+
 private:
-    std::string var_name_;
-    std::unique_ptr<Statement> value_;
+    friend class Optimizer;
+
+    runtime::Symbol var_name_;
+    StatementPtr value_;
 };
 
 // Присваивает полю object.field_name значение выражения rv
 class FieldAssignment : public Statement {
 public:
-    FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
+    FieldAssignment(VariableValue object, runtime::Symbol field_name,
+                    StatementPtr rv);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const VariableValue& GetObject() const;
+    [[nodiscard]] runtime::Symbol GetFieldName() const;
+    [[nodiscard]] const Statement& GetValue() const;
+
 private:
+    friend class Optimizer;
+
     VariableValue object_;
-    std::string field_name_;
-    std::unique_ptr<Statement> field_value_;
+    runtime::Symbol field_name_;
+    StatementPtr field_value_;
+    runtime::FieldStoreCache field_cache_;
+};
+
+// Создаёт новый список из значений выражений items. Каждое выполнение создаёт отдельный список
+class ListLiteral : public Statement {
+public:
+    explicit ListLiteral(std::vector<StatementPtr> items);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const std::vector<StatementPtr>& GetItems() const;
+
+private:
+    friend class Optimizer;
+
+    std::vector<StatementPtr> items_;
+};
+
+// Создаёт новый словарь из значений выражений items, в котором ключи и значения чередуются:
+// key0, value0, key1, value1... Выражения вычисляются в этом порядке.
+// Каждое выполнение создаёт отдельный словарь
+class DictLiteral : public Statement {
+public:
+    explicit DictLiteral(std::vector<StatementPtr> items);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const std::vector<StatementPtr>& GetItems() const;
+
+private:
+    friend class Optimizer;
+
+    std::vector<StatementPtr> items_;
 };
 
+// Возвращает элемент object[index] списка или значение ключа index словаря.
+// Отрицательный индекс отсчитывается от конца списка
+class Index : public Statement {
+public:
+    Index(StatementPtr object, StatementPtr index);
+
+    // Если object - не список и не словарь, индекс списка не число или выходит за его пределы
+    // либо ключа нет в словаре, выбрасывает runtime_error
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Statement& GetObject() const;
+    [[nodiscard]] const Statement& GetIndex() const;
+
+private:
+    friend class Optimizer;
+
+    StatementPtr object_;
+    StatementPtr index_;
+};
+
+// Присваивает элементу object[index] списка или ключу index словаря значение выражения rv
+class IndexAssignment : public Statement {
+public:
+    IndexAssignment(StatementPtr object, StatementPtr index, StatementPtr rv);
+
+    // Вычисляет object, index и rv в этом порядке и возвращает присвоенное значение
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Statement& GetObject() const;
+    [[nodiscard]] const Statement& GetIndex() const;
+    [[nodiscard]] const Statement& GetValue() const;
+
+private:
+    friend class Optimizer;
+
+    StatementPtr object_;
+    StatementPtr index_;
+    StatementPtr value_;
+};
+
+namespace detail {
+// Выбрасывает runtime_error с описанием объекта obj, который не удалось привести
+// к runtime::ClassInstance в инструкции where
+[[noreturn]] void ThrowClassIntanceCastError(const runtime::ObjectHolder& obj,
+                                             const std::string& where);
+}  // namespace detail
+
 // Значение None
 class None : public Statement {
 public:
@@ -82,55 +192,86 @@ public:
 class Print : public Statement {
 public:
     // Инициализирует команду print для вывода значения выражения argument
-    explicit Print(std::unique_ptr<Statement> argument);
+    explicit Print(StatementPtr argument);
     // Инициализирует команду print для вывода списка значений args
-    explicit Print(std::vector<std::unique_ptr<Statement>> args);
+    explicit Print(std::vector<StatementPtr> args);
 
     // Инициализирует команду print для вывода значения переменной name
-    static std::unique_ptr<Print> Variable(const std::string& name);
+    static std::unique_ptr<Print> Variable(runtime::Symbol name);
 
     // Во время выполнения команды print вывод должен осуществляться в поток, возвращаемый из
     // context.GetOutputStream()
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const std::vector<StatementPtr>& GetArgs() const;
+
 private:
-    std::vector<std::unique_ptr<Statement>> args_;
+    friend class Optimizer;
+
+    std::vector<StatementPtr> args_;
 };
 
-// Вызывает метод object.method со списком параметров args
+// Вызывает метод object.method со списком параметров args. У списков вызывается
+// встроенный метод (runtime::List::Call)
 class MethodCall : public Statement {
 public:
-    explicit MethodCall(std::unique_ptr<Statement> object, std::string method,
-               std::vector<std::unique_ptr<Statement>> args);
+    explicit MethodCall(StatementPtr object, runtime::Symbol method,
+               std::vector<StatementPtr> args);
 
+    // Хвостовой вызов метода, в теле которого он находится, не вызывает метод, а заменяет
+    // аргументы в closure и выставляет в context сигнал Completion::TAIL_CALL.
+    // Тело метода (MethodBody) получает сигнал и выполняется заново без нового кадра
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const Statement& GetObject() const;
+    [[nodiscard]] runtime::Symbol GetMethodName() const;
+    [[nodiscard]] const std::vector<StatementPtr>& GetArgs() const;
+    // Возвращает true, если парсер нашёл вызов в хвостовой позиции своего метода
+    // (см. MethodBody::MarkTailCalls)
+    [[nodiscard]] bool IsTailCall() const;
+
 private:
-    std::unique_ptr<Statement> object_;
-    std::string method_name_;
-    std::vector<std::unique_ptr<Statement>> args_;
+    friend class Optimizer;
+    friend class MethodBody;
+
+    StatementPtr object_;
+    runtime::Symbol method_name_;
+    std::vector<StatementPtr> args_;
+    runtime::MethodCache method_cache_;
+    // Тело метода, в хвостовой позиции которого находится вызов, либо nullptr
+    const Statement* tail_call_body_ = nullptr;
 };
 
-// Создаёт новый экземпляр класса class_, передавая его конструктору набор параметров args
+// Создаёт новый экземпляр класса class_, передавая его конструктору набор параметров args.
+// Каждое выполнение создаёт отдельный экземпляр
 class NewInstance : public Statement {
 public:
     explicit NewInstance(const runtime::Class& class_);
-    NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
+    NewInstance(const runtime::Class& class_, std::vector<StatementPtr> args);
     // Возвращает объект, содержащий значение типа ClassInstance
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const runtime::Class& GetClass() const;
+    [[nodiscard]] const std::vector<StatementPtr>& GetArgs() const;
+
 private:
-    runtime::ClassInstance cls_inst_;
-    std::vector<std::unique_ptr<Statement>> args_;
+    friend class Optimizer;
+
+    const runtime::Class& class_;
+    std::vector<StatementPtr> args_;
 };
 
 // Базовый класс для унарных операций
 class UnaryOperation : public Statement {
 public:
-    explicit UnaryOperation(std::unique_ptr<Statement> argument);
+    explicit UnaryOperation(StatementPtr argument);
+
+    [[nodiscard]] const Statement& GetArgument() const;
 
 protected:
-    std::unique_ptr<Statement> arg_;
+    friend class Optimizer;
+
+    StatementPtr arg_;
 };
 
 // Операция str, возвращающая строковое значение своего аргумента
@@ -140,14 +281,26 @@ public:
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 };
 
+// Операция len, возвращающая количество элементов списка или длину строки
+class Len : public UnaryOperation {
+public:
+    using UnaryOperation::UnaryOperation;
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+};
+
 // Родительский класс Бинарная операция с аргументами lhs и rhs
 class BinaryOperation : public Statement {
 public:
-    BinaryOperation(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+    BinaryOperation(StatementPtr lhs, StatementPtr rhs);
+
+    [[nodiscard]] const Statement& GetLhs() const;
+    [[nodiscard]] const Statement& GetRhs() const;
 
 protected:
-    std::unique_ptr<Statement> lhs_;
-    std::unique_ptr<Statement> rhs_;
+    friend class Optimizer;
+
+    StatementPtr lhs_;
+    StatementPtr rhs_;
 };
 
 // Возвращает результат операции + над аргументами lhs и rhs
@@ -225,7 +378,7 @@ public:
 // Составная инструкция (например: тело метода, содержимое ветки if, либо else)
 class Compound : public Statement {
 public:
-    // Конструирует Compound из нескольких инструкций типа unique_ptr<Statement>
+    // Конструирует Compound из нескольких инструкций типа StatementPtr или std::unique_ptr
     template <typename... Args>
     explicit Compound(Args&&... args) {
         if constexpr (sizeof...(args) != 0) {
@@ -234,13 +387,20 @@ public:
     }
 
     // Добавляет очередную инструкцию в конец составной инструкции
-    void AddStatement(std::unique_ptr<Statement> stmt);
+    void AddStatement(StatementPtr stmt);
 
-    // Последовательно выполняет добавленные инструкции. Возвращает None
+    // Последовательно выполняет добавленные инструкции. Возвращает None.
+    // Если инструкция выставила в context сигнал завершения, прекращает выполнение
+    // и возвращает её результат
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const std::vector<StatementPtr>& GetStatements() const;
+
 private:
-    std::vector<std::unique_ptr<Statement>> args_;
+    friend class Optimizer;
+    friend class MethodBody;
+
+    std::vector<StatementPtr> args_;
 
     template <typename Arg0, typename... Args>
     void FillArgs(Arg0&& arg0, Args&&... args) {
@@ -254,28 +414,47 @@ private:
 // Тело метода. Как правило, содержит составную инструкцию
 class MethodBody : public Statement {
 public:
-    explicit MethodBody(std::unique_ptr<Statement>&& body);
+    explicit MethodBody(StatementPtr&& body);
 
     // Вычисляет инструкцию, переданную в качестве body.
     // Если внутри body была выполнена инструкция return, возвращает результат return
-    // В противном случае возвращает None
+    // В противном случае возвращает None.
+    // Пока body завершается сигналом Completion::TAIL_CALL, body выполняется заново
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const Statement& GetBody() const;
+
+    // Отмечает вызовы return self.method_name(...) с param_count аргументами в хвостовых
+    // позициях тела: в последней инструкции тела и в последних инструкциях веток if, которая
+    // сама находится в хвостовой позиции. После такого return метод не выполняет других
+    // инструкций, даже если вызов вернул None
+    void MarkTailCalls(runtime::Symbol method_name, size_t param_count);
+
 private:
-    std::unique_ptr<Statement> body_;
+    friend class Optimizer;
+
+    void MarkTailCalls(Statement& node, runtime::Symbol method_name, size_t param_count);
+
+    StatementPtr body_;
 };
 
 // Выполняет инструкцию return с выражением statement
 class Return : public Statement {
 public:
-    explicit Return(std::unique_ptr<Statement> statement);
+    explicit Return(StatementPtr statement);
 
     // Останавливает выполнение текущего метода. Метод возвращает результат вычисления statement,
-    // переданного в конструктор
+    // переданного в конструктор. Остановка сообщается выставлением в context сигнала
+    // Completion::RETURN, если результат не None
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const Statement& GetStatement() const;
+
 private:
-    std::unique_ptr<Statement> statement_;
+    friend class Optimizer;
+    friend class MethodBody;
+
+    StatementPtr statement_;
 };
 
 // Объявляет класс
@@ -288,6 +467,8 @@ public:
     // конструктор
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const runtime::ObjectHolder& GetClass() const;
+
 private:
     runtime::ObjectHolder cls_;
 };
@@ -296,15 +477,99 @@ private:
 class IfElse : public Statement {
 public:
     // Параметр else_body может быть равен nullptr
-    IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
-           std::unique_ptr<Statement> else_body);
+    IfElse(StatementPtr condition, StatementPtr if_body,
+           StatementPtr else_body);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Statement& GetCondition() const;
+    [[nodiscard]] const Statement& GetIfBody() const;
+    // Возвращает nullptr, если ветка else отсутствует
+    [[nodiscard]] const Statement* GetElseBody() const;
+
+private:
+    friend class Optimizer;
+    friend class MethodBody;
+
+    StatementPtr condition_;
+    StatementPtr if_body_;
+    StatementPtr else_body_;
+};
+
+// Цикл while condition: body
+class While : public Statement {
+public:
+    While(StatementPtr condition, StatementPtr body);
+
+    // Выполняет body, пока значение condition приводится к True. Тело выполняется
+    // в той же области видимости, что и цикл. Если body выполнил return,
+    // цикл прекращается и возвращает его результат. Иначе возвращает None
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Statement& GetCondition() const;
+    [[nodiscard]] const Statement& GetBody() const;
+
+private:
+    friend class Optimizer;
+
+    StatementPtr condition_;
+    StatementPtr body_;
+};
 
+// Цикл for var_name in range(start, stop, step): body
+class ForRange : public Statement {
+public:
+    // Параметры start и step могут быть равны nullptr, тогда они равны 0 и 1
+    ForRange(runtime::Symbol var_name, StatementPtr start, StatementPtr stop, StatementPtr step,
+             StatementPtr body);
+
+    // Вычисляет аргументы range один раз, затем для каждого значения диапазона
+    // присваивает его переменной var_name и выполняет body в той же области видимости.
+    // Если body выполнил return, цикл прекращается и возвращает его результат.
+    // Иначе возвращает None. Если аргументы range - не числа или step равен 0,
+    // выбрасывает runtime_error
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] runtime::Symbol GetVarName() const;
+    // Возвращает nullptr, если аргумент не указан
+    [[nodiscard]] const Statement* GetStart() const;
+    [[nodiscard]] const Statement& GetStop() const;
+    // Возвращает nullptr, если аргумент не указан
+    [[nodiscard]] const Statement* GetStep() const;
+    [[nodiscard]] const Statement& GetBody() const;
+
 private:
-    std::unique_ptr<Statement> condition_;
-    std::unique_ptr<Statement> if_body_;
-    std::unique_ptr<Statement> else_body_;
+    friend class Optimizer;
+
+    runtime::Symbol var_name_;
+    StatementPtr start_;
+    StatementPtr stop_;
+    StatementPtr step_;
+    StatementPtr body_;
+};
+
+// Цикл for var_name in iterable: body по элементам списка или ключам словаря
+class ForEach : public Statement {
+public:
+    ForEach(runtime::Symbol var_name, StatementPtr iterable, StatementPtr body);
+
+    // Вычисляет iterable один раз, затем для каждого элемента списка или ключа словаря
+    // в порядке добавления присваивает его переменной var_name и выполняет body в той же
+    // области видимости. Элементы, добавленные телом цикла, тоже перебираются. Если body
+    // выполнил return, цикл прекращается и возвращает его результат. Иначе возвращает None.
+    // Если iterable - не список и не словарь, выбрасывает runtime_error
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] runtime::Symbol GetVarName() const;
+    [[nodiscard]] const Statement& GetIterable() const;
+    [[nodiscard]] const Statement& GetBody() const;
+
+private:
+    friend class Optimizer;
+
+    runtime::Symbol var_name_;
+    StatementPtr iterable_;
+    StatementPtr body_;
 };
 
 // Операция сравнения
@@ -314,14 +579,44 @@ public:
     using Comparator = std::function<bool(const runtime::ObjectHolder&,
                                           const runtime::ObjectHolder&, runtime::Context&)>;
 
-    Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+    Comparison(Comparator cmp, StatementPtr lhs, StatementPtr rhs);
 
     // Вычисляет значение выражений lhs и rhs и возвращает результат работы comparator,
     // приведённый к типу runtime::Bool
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    [[nodiscard]] const Comparator& GetComparator() const;
+
 private:
     Comparator cmp_;
 };
 
+// Программа, построенная парсером. Владеет ареной, в которой размещены все узлы её дерева,
+// и освобождает их разом при разрушении
+class Program : public Statement {
+public:
+    // Создаёт в арене программы узел типа T. Узел существует, пока существует программа
+    template <typename T, typename... Args>
+    runtime::ExecutablePtr<T> MakeNode(Args&&... args) {
+        return runtime::ExecutablePtr<T>(arena_.Make<T>(std::forward<Args>(args)...),
+                                         runtime::ExecutableDeleter(false));
+    }
+
+    // Задаёт корень дерева программы
+    void SetTree(StatementPtr tree);
+
+    // Выполняет дерево программы
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Statement& GetTree() const;
+    [[nodiscard]] const runtime::Arena& GetArena() const;
+
+private:
+    friend class Optimizer;
+
+    // Арена объявлена первой, чтобы разрушиться после указателя на корень
+    runtime::Arena arena_;
+    StatementPtr tree_;
+};
+
 }  // namespace ast
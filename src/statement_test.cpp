@@ -7,6 +7,7 @@ namespace ast {
 
 using runtime::Closure;
 using runtime::ObjectHolder;
+using runtime::Symbol;
 
 namespace {
 
@@ -123,12 +124,12 @@ void TestFieldAssignment() {
         ASSERT(o);
         ASSERT_OBJECT_VALUE_EQUAL(o, 57);
     }
-    ASSERT(object.Fields().find("x"s) != object.Fields().end());
-    ASSERT_OBJECT_VALUE_EQUAL(object.Fields().at("x"s), 57);
+    ASSERT(object.FindField("x"s) != nullptr);
+    ASSERT_OBJECT_VALUE_EQUAL(*object.FindField("x"s), 57);
 
     assign_y.Execute(closure, context);
     FieldAssignment assign_yz(
-        VariableValue{vector<string>{"self"s, "y"s}}, "z"s,
+        VariableValue{vector<Symbol>{"self"s, "y"s}}, "z"s,
         make_unique<StringConst>(runtime::String("Hello, world! Hooray! Yes-yes!!!"s)));
     {
         ObjectHolder o = assign_yz.Execute(closure, context);
@@ -136,10 +137,10 @@ void TestFieldAssignment() {
         ASSERT_OBJECT_VALUE_EQUAL(o, "Hello, world! Hooray! Yes-yes!!!"s);
     }
 
-    ASSERT(object.Fields().find("y"s) != object.Fields().end());
-    const auto* subobject = object.Fields().at("y"s).TryAs<runtime::ClassInstance>();
-    ASSERT(subobject != nullptr && subobject->Fields().find("z"s) != subobject->Fields().end());
-    ASSERT_OBJECT_VALUE_EQUAL(subobject->Fields().at("z"s), "Hello, world! Hooray! Yes-yes!!!"s);
+    ASSERT(object.FindField("y"s) != nullptr);
+    const auto* subobject = object.FindField("y"s)->TryAs<runtime::ClassInstance>();
+    ASSERT(subobject != nullptr && subobject->FindField("z"s) != nullptr);
+    ASSERT_OBJECT_VALUE_EQUAL(*subobject->FindField("z"s), "Hello, world! Hooray! Yes-yes!!!"s);
 
     ASSERT(context.output.str().empty());
 }
@@ -161,7 +162,7 @@ void TestPrintMultipleStatements() {
     runtime::String hello("hello"s);
     Closure closure = {{"word"s, ObjectHolder::Share(hello)}, {"empty"s, ObjectHolder::None()}};
 
-    vector<unique_ptr<Statement>> args;
+    vector<StatementPtr> args;
     args.push_back(make_unique<VariableValue>("word"s));
     args.push_back(make_unique<NumericConst>(57));
     args.push_back(make_unique<StringConst>("Python"s));
@@ -318,13 +319,13 @@ void TestFields() {
                        {make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
                                                      make_unique<NumericConst>(0))}});
     methods.push_back(
-        {"value"s, {}, {make_unique<VariableValue>(vector<string>{"self"s, "value"s})}});
+        {"value"s, {}, {make_unique<VariableValue>(vector<Symbol>{"self"s, "value"s})}});
     methods.push_back(
         {"add"s,
          {"x"s},
          {make_unique<FieldAssignment>(
              VariableValue{"self"s}, "value"s,
-             make_unique<Add>(make_unique<VariableValue>(vector<string>{"self"s, "value"s}),
+             make_unique<Add>(make_unique<VariableValue>(vector<Symbol>{"self"s, "value"s}),
                               make_unique<VariableValue>("x"s)))}});
 
     runtime::Class cls("BoxedValue"s, std::move(methods), nullptr);
@@ -346,7 +347,8 @@ void TestFields() {
 
 void TestBaseClass() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back(
+        {"GetValue"s, {}, make_unique<VariableValue>(vector<Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -372,7 +374,8 @@ void TestBaseClass() {
 
 void TestInheritance() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back(
+        {"GetValue"s, {}, make_unique<VariableValue>(vector<Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -453,6 +456,234 @@ void TestNot() {
     test_not(false);
 }
 
+void TestReturn() {
+    runtime::DummyContext context;
+
+    auto if_body = make_unique<Compound>(make_unique<Return>(make_unique<None>()),
+                                         make_unique<Return>(make_unique<NumericConst>(1)));
+    MethodBody body{make_unique<Compound>(
+        make_unique<Print>(make_unique<StringConst>("before"s)),
+        make_unique<IfElse>(make_unique<BoolConst>(true), std::move(if_body), nullptr),
+        make_unique<Print>(make_unique<StringConst>("after"s)))};
+
+    Closure closure;
+    auto result = body.Execute(closure, context);
+
+    // return None не прерывает выполнение, return 1 прерывает вложенные составные инструкции
+    ASSERT_OBJECT_VALUE_EQUAL(result, 1);
+    ASSERT_EQUAL(context.output.str(), "before\n"s);
+    ASSERT(context.GetCompletion() == runtime::Completion::NORMAL);
+
+    MethodBody empty_body{make_unique<Return>(make_unique<None>())};
+    ASSERT(!empty_body.Execute(closure, context));
+    ASSERT(context.GetCompletion() == runtime::Completion::NORMAL);
+}
+
+void TestWhile() {
+    runtime::DummyContext context;
+    Closure closure;
+
+    // i = 0; while i < 3: print i; i = i + 1
+    auto body = make_unique<Compound>(
+        Print::Variable("i"s),
+        make_unique<Assignment>("i"s, make_unique<Add>(make_unique<VariableValue>("i"s),
+                                                       make_unique<NumericConst>(1))));
+    Compound program{
+        make_unique<Assignment>("i"s, make_unique<NumericConst>(0)),
+        make_unique<While>(make_unique<Comparison>(runtime::Less,
+                                                   make_unique<VariableValue>("i"s),
+                                                   make_unique<NumericConst>(3)),
+                           std::move(body))};
+    ASSERT(!program.Execute(closure, context));
+    ASSERT_EQUAL(context.output.str(), "0\n1\n2\n"s);
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("i"s), 3);
+
+    // return прерывает цикл и возвращает значение из метода
+    MethodBody method{make_unique<While>(make_unique<BoolConst>(true),
+                                         make_unique<Return>(make_unique<NumericConst>(7)))};
+    ASSERT_OBJECT_VALUE_EQUAL(method.Execute(closure, context), 7);
+    ASSERT(context.GetCompletion() == runtime::Completion::NORMAL);
+}
+
+void TestForRange() {
+    runtime::DummyContext context;
+    Closure closure;
+
+    ForRange up{"i"s, nullptr, make_unique<NumericConst>(3), nullptr, Print::Variable("i"s)};
+    ASSERT(!up.Execute(closure, context));
+    ForRange down{"j"s, make_unique<NumericConst>(10), make_unique<NumericConst>(0),
+                  make_unique<NumericConst>(-4), Print::Variable("j"s)};
+    down.Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "0\n1\n2\n10\n6\n2\n"s);
+    // Переменная цикла сохраняет последнее значение
+    ASSERT_OBJECT_VALUE_EQUAL(closure.at("i"s), 2);
+
+    // Пустой диапазон не создаёт переменную
+    ForRange empty{"k"s, make_unique<NumericConst>(5), make_unique<NumericConst>(5), nullptr,
+                   Print::Variable("k"s)};
+    empty.Execute(closure, context);
+    ASSERT(closure.count("k"s) == 0);
+
+    // Значение не переполняется у границы int
+    const int max = numeric_limits<int>::max();
+    ForRange near_max{"n"s, make_unique<NumericConst>(max - 3), make_unique<NumericConst>(max),
+                      make_unique<NumericConst>(2), Print::Variable("n"s)};
+    context.output.str(""s);
+    near_max.Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), to_string(max - 3) + "\n"s + to_string(max - 1) + "\n"s);
+
+    ForRange zero_step{"i"s, make_unique<NumericConst>(0), make_unique<NumericConst>(1),
+                       make_unique<NumericConst>(0), make_unique<None>()};
+    ASSERT_THROWS(zero_step.Execute(closure, context), runtime_error);
+    ForRange not_number{"i"s, nullptr, make_unique<StringConst>("3"s), nullptr,
+                        make_unique<None>()};
+    ASSERT_THROWS(not_number.Execute(closure, context), runtime_error);
+
+    MethodBody method{make_unique<ForRange>(
+        "i"s, nullptr, make_unique<NumericConst>(100), nullptr,
+        make_unique<IfElse>(make_unique<Comparison>(runtime::Equal,
+                                                    make_unique<VariableValue>("i"s),
+                                                    make_unique<NumericConst>(4)),
+                            make_unique<Return>(make_unique<VariableValue>("i"s)), nullptr))};
+    ASSERT_OBJECT_VALUE_EQUAL(method.Execute(closure, context), 4);
+}
+
+void TestLists() {
+    runtime::DummyContext context;
+    Closure closure;
+
+    vector<StatementPtr> items;
+    items.push_back(make_unique<NumericConst>(1));
+    items.push_back(make_unique<StringConst>("two"s));
+    Assignment assign{"xs"s, make_unique<ListLiteral>(std::move(items))};
+    assign.Execute(closure, context);
+
+    // Каждое выполнение литерала создаёт новый список
+    ListLiteral empty{{}};
+    ASSERT(empty.Execute(closure, context).Get() != empty.Execute(closure, context).Get());
+
+    IndexAssignment store{make_unique<VariableValue>("xs"s), make_unique<NumericConst>(-1),
+                          make_unique<NumericConst>(3)};
+    ASSERT_OBJECT_VALUE_EQUAL(store.Execute(closure, context), 3);
+    Index load{make_unique<VariableValue>("xs"s), make_unique<NumericConst>(1)};
+    ASSERT_OBJECT_VALUE_EQUAL(load.Execute(closure, context), 3);
+    Len len{make_unique<VariableValue>("xs"s)};
+    ASSERT_OBJECT_VALUE_EQUAL(len.Execute(closure, context), 2);
+
+    vector<StatementPtr> args;
+    args.push_back(make_unique<NumericConst>(7));
+    MethodCall append{make_unique<VariableValue>("xs"s), "append"s, std::move(args)};
+    ASSERT(!append.Execute(closure, context));
+
+    ForEach loop{"x"s, make_unique<VariableValue>("xs"s), Print::Variable("x"s)};
+    ASSERT(!loop.Execute(closure, context));
+    ASSERT_EQUAL(context.output.str(), "1\n3\n7\n"s);
+
+    Index out_of_range{make_unique<VariableValue>("xs"s), make_unique<NumericConst>(3)};
+    ASSERT_THROWS(out_of_range.Execute(closure, context), runtime_error);
+    ForEach not_list{"x"s, make_unique<NumericConst>(3), make_unique<None>()};
+    ASSERT_THROWS(not_list.Execute(closure, context), runtime_error);
+}
+
+void TestDicts() {
+    runtime::DummyContext context;
+    Closure closure;
+
+    vector<StatementPtr> items;
+    items.push_back(make_unique<StringConst>("one"s));
+    items.push_back(make_unique<NumericConst>(1));
+    items.push_back(make_unique<NumericConst>(2));
+    items.push_back(make_unique<StringConst>("two"s));
+    Assignment assign{"d"s, make_unique<DictLiteral>(std::move(items))};
+    assign.Execute(closure, context);
+
+    // Каждое выполнение литерала создаёт новый словарь
+    DictLiteral empty{{}};
+    ASSERT(empty.Execute(closure, context).Get() != empty.Execute(closure, context).Get());
+
+    IndexAssignment store{make_unique<VariableValue>("d"s), make_unique<StringConst>("one"s),
+                          make_unique<NumericConst>(3)};
+    ASSERT_OBJECT_VALUE_EQUAL(store.Execute(closure, context), 3);
+    Index load{make_unique<VariableValue>("d"s), make_unique<StringConst>("one"s)};
+    ASSERT_OBJECT_VALUE_EQUAL(load.Execute(closure, context), 3);
+    Len len{make_unique<VariableValue>("d"s)};
+    ASSERT_OBJECT_VALUE_EQUAL(len.Execute(closure, context), 2);
+    Comparison contains{runtime::Contains, make_unique<NumericConst>(2),
+                        make_unique<VariableValue>("d"s)};
+    ASSERT(contains.Execute(closure, context).TryAs<runtime::Bool>()->GetValue());
+
+    ForEach loop{"k"s, make_unique<VariableValue>("d"s), Print::Variable("k"s)};
+    ASSERT(!loop.Execute(closure, context));
+    ASSERT_EQUAL(context.output.str(), "one\n2\n"s);
+
+    Index missing{make_unique<VariableValue>("d"s), make_unique<NumericConst>(1)};
+    ASSERT_THROWS(missing.Execute(closure, context), runtime_error);
+}
+
+void TestTailCalls() {
+    // Возвращает инструкцию return object.method(n, ...) с argc аргументами и вызов в ней
+    const auto make_return = [](const string& object, const string& method, size_t argc) {
+        vector<StatementPtr> args;
+        for (size_t i = 0; i < argc; ++i) {
+            args.push_back(make_unique<VariableValue>("n"s));
+        }
+        auto call = make_unique<MethodCall>(make_unique<VariableValue>(object), method,
+                                            std::move(args));
+        const MethodCall* call_ptr = call.get();
+        return pair{make_unique<Return>(std::move(call)), call_ptr};
+    };
+
+    auto [middle, middle_call] = make_return("self"s, "f"s, 1);
+    auto [if_tail, if_tail_call] = make_return("self"s, "f"s, 1);
+    auto [else_tail, else_tail_call] = make_return("self"s, "f"s, 1);
+    MethodBody body{make_unique<Compound>(
+        std::move(middle),
+        make_unique<IfElse>(make_unique<VariableValue>("n"s),
+                            make_unique<Compound>(std::move(if_tail)), std::move(else_tail)))};
+    body.MarkTailCalls("f"s, 1);
+    // После return в середине тела выполняются другие инструкции, если вызов вернул None
+    ASSERT(!middle_call->IsTailCall());
+    ASSERT(if_tail_call->IsTailCall());
+    ASSERT(else_tail_call->IsTailCall());
+
+    auto [other_method, other_method_call] = make_return("self"s, "g"s, 1);
+    auto [other_object, other_object_call] = make_return("other"s, "f"s, 1);
+    auto [other_arity, other_arity_call] = make_return("self"s, "f"s, 2);
+    auto [in_loop, in_loop_call] = make_return("self"s, "f"s, 1);
+    auto loop = make_unique<While>(make_unique<VariableValue>("n"s), std::move(in_loop));
+    MethodBody other_body{make_unique<IfElse>(
+        make_unique<VariableValue>("n"s), std::move(other_method),
+        make_unique<IfElse>(
+            make_unique<VariableValue>("n"s), std::move(other_object),
+            make_unique<IfElse>(make_unique<VariableValue>("n"s), std::move(other_arity),
+                                std::move(loop))))};
+    other_body.MarkTailCalls("f"s, 1);
+    for (const MethodCall* call : {other_method_call, other_object_call, other_arity_call,
+                                   in_loop_call}) {
+        ASSERT(!call->IsTailCall());
+    }
+
+    // Хвостовая рекурсия выполняется без роста стека вызовов C++
+    vector<StatementPtr> args;
+    args.push_back(make_unique<Sub>(make_unique<VariableValue>("n"s),
+                                    make_unique<NumericConst>(1)));
+    auto count_body = make_unique<MethodBody>(make_unique<IfElse>(
+        make_unique<VariableValue>("n"s),
+        make_unique<Return>(make_unique<MethodCall>(make_unique<VariableValue>("self"s),
+                                                    "count"s, std::move(args))),
+        make_unique<Return>(make_unique<StringConst>("done"s))));
+    count_body->MarkTailCalls("count"s, 1);
+    vector<runtime::Method> methods;
+    methods.push_back({"count"s, {"n"s}, std::move(count_body)});
+    runtime::Class cls{"Counter"s, std::move(methods), nullptr};
+    runtime::ClassInstance counter{cls};
+    runtime::DummyContext context;
+    const auto result = counter.Call("count"s, {ObjectHolder::Own(runtime::Number(1'000'000))},
+                                     context);
+    ASSERT_OBJECT_VALUE_EQUAL(result, "done"s);
+    ASSERT(context.GetCompletion() == runtime::Completion::NORMAL);
+}
+
 }  // namespace
 
 void RunUnitTests(TestRunner& tr) {
@@ -476,6 +707,12 @@ void RunUnitTests(TestRunner& tr) {
     RUN_TEST(tr, ast::TestOr);
     RUN_TEST(tr, ast::TestAnd);
     RUN_TEST(tr, ast::TestNot);
+    RUN_TEST(tr, ast::TestReturn);
+    RUN_TEST(tr, ast::TestWhile);
+    RUN_TEST(tr, ast::TestForRange);
+    RUN_TEST(tr, ast::TestLists);
+    RUN_TEST(tr, ast::TestDicts);
+    RUN_TEST(tr, ast::TestTailCalls);
 }
 
 }  // namespace ast
@@ -0,0 +1,84 @@
+#include "symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <ostream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace runtime {
+
+// Глобальная таблица символов. Защищена мьютексом, т.к. символы могут создаваться
+// из нескольких потоков (например, при параллельном чтении токенов). Почти все имена
+// уже есть в таблице, поэтому поиск выполняется под разделяемой блокировкой
+class Symbol::Table {
+public:
+    const Entry* Intern(string_view name) {
+        {
+            shared_lock guard(mutex_);
+            if (const auto it = index_.find(name); it != index_.end()) {
+                return it->second;
+            }
+        }
+        lock_guard guard(mutex_);
+        // Пока блокировка не была захвачена, имя мог добавить другой поток
+        if (const auto it = index_.find(name); it != index_.end()) {
+            return it->second;
+        }
+        const size_t hash = std::hash<string_view>{}(name);
+        const Entry& entry = entries_.emplace_back(
+            Entry{string(name), hash, static_cast<uint32_t>(entries_.size())});
+        index_.emplace(entry.name, &entry);
+        return &entry;
+    }
+
+    size_t GetSize() {
+        shared_lock guard(mutex_);
+        return entries_.size();
+    }
+
+private:
+    shared_mutex mutex_;
+    // deque не перемещает элементы при добавлении, поэтому указатели на записи
+    // и ключи index_, ссылающиеся на их имена, остаются действительными
+    deque<Entry> entries_;
+    unordered_map<string_view, const Entry*> index_;
+};
+
+Symbol::Table& Symbol::GetTable() {
+    static Table table;
+    return table;
+}
+
+const Symbol::Entry* Symbol::Intern(string_view name) {
+    return GetTable().Intern(name);
+}
+
+size_t Symbol::GetCount() {
+    return GetTable().GetSize();
+}
+
+Symbol::Symbol() {
+    static const Entry* const empty = Intern({});
+    entry_ = empty;
+}
+
+Symbol::Symbol(string_view name)
+    : entry_(Intern(name)) {
+}
+
+Symbol::Symbol(const string& name)
+    : entry_(Intern(name)) {
+}
+
+Symbol::Symbol(const char* name)
+    : entry_(Intern(name)) {
+}
+
+ostream& operator<<(ostream& os, Symbol symbol) {
+    return os << symbol.GetName();
+}
+
+}  // namespace runtime
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace runtime {
+
+// Интернированное имя (идентификатор) Mython.
+// Все символы с одинаковым именем ссылаются на одну запись глобальной таблицы символов,
+// поэтому сравниваются по указателю, а хеш имени вычисляется один раз при интернировании.
+// Строковое имя нужно только для вывода и сообщений об ошибках
+class Symbol {
+public:
+    // Создаёт символ с пустым именем
+    Symbol();
+
+    // Интернирует name. Конструкторы неявные, чтобы строку можно было передать
+    // везде, где ожидается символ
+    Symbol(std::string_view name);   // NOLINT(google-explicit-constructor)
+    Symbol(const std::string& name);  // NOLINT(google-explicit-constructor)
+    Symbol(const char* name);         // NOLINT(google-explicit-constructor)
+
+    // Возвращает имя символа
+    [[nodiscard]] const std::string& GetName() const {
+        return entry_->name;
+    }
+
+    // Возвращает номер символа в таблице. Номера выдаются подряд, начиная с 0
+    [[nodiscard]] std::uint32_t GetId() const {
+        return entry_->id;
+    }
+
+    // Возвращает хеш имени, вычисленный при интернировании
+    [[nodiscard]] size_t GetHash() const {
+        return entry_->hash;
+    }
+
+    // Возвращает количество имён в таблице символов
+    [[nodiscard]] static size_t GetCount();
+
+    friend bool operator==(Symbol lhs, Symbol rhs) {
+        return lhs.entry_ == rhs.entry_;
+    }
+
+    friend bool operator!=(Symbol lhs, Symbol rhs) {
+        return lhs.entry_ != rhs.entry_;
+    }
+
+private:
+    // Запись таблицы символов. Записи не перемещаются и не удаляются до конца работы программы
+    struct Entry {
+        std::string name;
+        size_t hash;
+        std::uint32_t id;
+    };
+
+    class Table;
+
+    static Table& GetTable();
+    static const Entry* Intern(std::string_view name);
+
+    const Entry* entry_;
+};
+
+// Выводит в os имя символа
+std::ostream& operator<<(std::ostream& os, Symbol symbol);
+
+}  // namespace runtime
+
+namespace std {
+
+template <>
+struct hash<runtime::Symbol> {
+    size_t operator()(runtime::Symbol symbol) const noexcept {
+        return symbol.GetHash();
+    }
+};
+
+}  // namespace std
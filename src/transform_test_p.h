@@ -0,0 +1,36 @@
+#pragma once
+
+#include "lexer.h"
+#include "parse.h"
+#include "runtime.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Выполняет program дважды: дерево разбора как есть и результат transform(дерево)
+// (компиляции, перевода в плоское дерево, оптимизации), возвращает вывод обоих запусков.
+// Если выполнение прервано ошибкой, к выводу добавляется её сообщение в угловых скобках
+template <typename Transform>
+std::pair<std::string, std::string> RunBeforeAndAfter(Transform transform,
+                                                      const std::string& program) {
+    std::string outputs[2];
+    for (int transformed = 0; transformed < 2; ++transformed) {
+        std::istringstream input(program);
+        parse::Lexer lexer(input);
+        auto tree = parse::ParseProgram(lexer);
+        if (transformed) {
+            tree = transform(std::move(tree));
+        }
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        try {
+            tree->Execute(closure, context);
+            outputs[transformed] = context.output.str();
+        } catch (const std::runtime_error& e) {
+            outputs[transformed] = context.output.str() + "<" + e.what() + ">";
+        }
+    }
+    return {outputs[0], outputs[1]};
+}
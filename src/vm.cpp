@@ -0,0 +1,441 @@
+#include "vm.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace vm {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+using namespace std::literals;
+
+const runtime::Symbol INIT_METHOD{"__init__"};
+
+// Кадр выполнения кода: слоты локальных переменных, за которыми следует стек значений.
+// Небольшие кадры размещаются на стеке вызовов C++ без обращения к куче
+class Frame {
+public:
+    explicit Frame(const CodeObject& code) {
+        if (const size_t size = code.slot_names.size() + code.max_stack; size > INLINE_SIZE) {
+            heap_values_ = std::make_unique<ObjectHolder[]>(size);
+            heap_bound_ = std::make_unique<bool[]>(code.slot_names.size());
+            values_ = heap_values_.get();
+            bound_ = heap_bound_.get();
+        }
+    }
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    // Слоты локальных переменных
+    ObjectHolder* Slots() {
+        return values_;
+    }
+
+    // Признаки того, что слоту присвоено значение
+    bool* Bound() {
+        return bound_;
+    }
+
+private:
+    static constexpr size_t INLINE_SIZE = 16;
+
+    ObjectHolder inline_values_[INLINE_SIZE];
+    bool inline_bound_[INLINE_SIZE] = {};
+    std::unique_ptr<ObjectHolder[]> heap_values_;
+    std::unique_ptr<bool[]> heap_bound_;
+    ObjectHolder* values_ = inline_values_;
+    bool* bound_ = inline_bound_;
+};
+
+ObjectHolder Execute(const CodeObject& code, Frame& frame, Closure& closure, Context& context);
+
+// Находит метод method в классе cls
+CachedMethod FindMethod(const runtime::Class& cls, runtime::Symbol method) {
+    CachedMethod result{cls.GetMethod(method)};
+    if (result.method) {
+        const auto* function = dynamic_cast<const Function*>(result.method->body.get());
+        if (function && function->GetCode().HasSlots()) {
+            result.code = &function->GetCode();
+        }
+    }
+    return result;
+}
+
+// Вызывает метод method у экземпляра self. Аргументы args перемещаются в вызываемый метод.
+// Методы, скомпилированные со слотами, выполняются без создания Closure
+ObjectHolder CallMethod(const ObjectHolder& self, const CachedMethod& method, ObjectHolder* args,
+                        size_t argc, Context& context) {
+    if (method.code) {
+        return Call(*method.code, self, args, argc, context);
+    }
+    const std::vector<ObjectHolder> actual_args(std::make_move_iterator(args),
+                                                std::make_move_iterator(args + argc));
+    return self.TryAs<runtime::ClassInstance>()->Call(*method.method, actual_args, context);
+}
+
+// ----------- Execute -----------------------
+
+ObjectHolder Execute(const CodeObject& code, Frame& frame, Closure& closure, Context& context) {
+    ObjectHolder* const slots = frame.Slots();
+    bool* const bound = frame.Bound();
+    ObjectHolder* sp = slots + code.slot_names.size();
+
+    // Снимает значение с вершины стека
+    auto pop = [&sp] {
+        return std::move(*--sp);
+    };
+    auto top = [&sp]() -> ObjectHolder& {
+        return sp[-1];
+    };
+
+    const Instruction* const begin = code.code.data();
+    const Instruction* ip = begin;
+    while (true) {
+        const Instruction& instr = *ip++;
+        switch (instr.op) {
+            case OpCode::LOAD_CONST:
+                *sp++ = code.constants[instr.arg];
+                break;
+            case OpCode::LOAD_NONE:
+                *sp++ = ObjectHolder::None();
+                break;
+            case OpCode::LOAD_NAME: {
+                const runtime::Symbol name = code.names[instr.arg];
+                const auto it = closure.find(name);
+                if (it == closure.end()) {
+                    throw std::runtime_error("No field with name \""s + name.GetName() + "\""s);
+                }
+                *sp++ = it->second;
+                break;
+            }
+            case OpCode::LOAD_LOCAL:
+                if (!bound[instr.arg]) {
+                    throw std::runtime_error("No field with name \""s
+                                             + code.slot_names[instr.arg].GetName() + "\""s);
+                }
+                *sp++ = slots[instr.arg];
+                break;
+            case OpCode::LOAD_FIELD: {
+                const auto cls_inst_ptr = top().TryAs<runtime::ClassInstance>();
+                if (!cls_inst_ptr) {
+                    throw std::runtime_error("Failed to cast \""s + code.names[instr.arg2].GetName()
+                                             + "\" to <ClassInstance>"s);
+                }
+                const runtime::Symbol name = code.names[instr.arg];
+                const ObjectHolder* field_ptr
+                    = cls_inst_ptr->FindField(name, code.field_load_caches[instr.cache]);
+                if (!field_ptr) {
+                    throw std::runtime_error("No field with name \""s + name.GetName() + "\""s);
+                }
+                top() = cls_inst_ptr->LoadField(*field_ptr);
+                break;
+            }
+            case OpCode::STORE_NAME:
+                closure[code.names[instr.arg]] = top();
+                break;
+            case OpCode::STORE_LOCAL:
+                slots[instr.arg] = top();
+                bound[instr.arg] = true;
+                break;
+            case OpCode::STORE_FIELD: {
+                ObjectHolder value = pop();
+                const auto cls_inst_ptr = top().TryAs<runtime::ClassInstance>();
+                if (!cls_inst_ptr) {
+                    ast::detail::ThrowClassIntanceCastError(top(), "FieldAssignment"s);
+                }
+                cls_inst_ptr->SetField(code.names[instr.arg], value,
+                                       code.field_store_caches[instr.cache]);
+                top() = std::move(value);
+                break;
+            }
+            case OpCode::CHECK_RECEIVER:
+                if (!top().TryAs<runtime::ClassInstance>()) {
+                    if (instr.arg == 0) {
+                        ast::detail::ThrowClassIntanceCastError(top(), "FieldAssignment"s);
+                    }
+                    if (!top().TryAs<runtime::List>()) {
+                        ast::detail::ThrowClassIntanceCastError(top(), "MethodCall"s);
+                    }
+                }
+                break;
+            case OpCode::LOAD_INDEX: {
+                const ObjectHolder index = pop();
+                top() = runtime::GetItem(top(), index, context);
+                break;
+            }
+            case OpCode::STORE_INDEX: {
+                ObjectHolder value = pop();
+                const ObjectHolder index = pop();
+                runtime::SetItem(top(), index, value, context);
+                top() = std::move(value);
+                break;
+            }
+            case OpCode::POP:
+                --sp;
+                break;
+            case OpCode::PRINT_SEPARATOR:
+                context.GetOutputStream().put(' ');
+                break;
+            case OpCode::PRINT_ITEM: {
+                std::ostream& out = context.GetOutputStream();
+                const ObjectHolder obj = pop();
+                if (!obj) {
+                    out << "None"sv;
+                } else if (const auto* number = obj.TryAs<runtime::Number>()) {
+                    context.WriteNumber(number->GetValue());
+                } else {
+                    obj->Print(out, context);
+                }
+                break;
+            }
+            case OpCode::PRINT_NEWLINE:
+                context.EndLine();
+                *sp++ = ObjectHolder::None();
+                break;
+            case OpCode::CALL_METHOD:
+            case OpCode::TAIL_CALL: {
+                ObjectHolder* const args = sp - instr.arg2;
+                ObjectHolder& object = args[-1];
+                if (auto* list = object.TryAs<runtime::List>()) {
+                    object = list->Call(code.names[instr.arg], args, instr.arg2);
+                    sp = args;
+                    break;
+                }
+                const auto cls_inst_ptr = object.TryAs<runtime::ClassInstance>();
+                if (!cls_inst_ptr) {
+                    ast::detail::ThrowClassIntanceCastError(object, "MethodCall"s);
+                }
+                const runtime::Class* cls = &cls_inst_ptr->GetClass();
+                auto& cache = code.method_caches[instr.cache];
+                const runtime::Symbol name = code.names[instr.arg];
+                const CachedMethod* method
+                    = cache.Find(cls, runtime::inline_cache_counters.method_calls);
+                if (!method) {
+                    const auto found = FindMethod(*cls, name);
+                    method = found.method ? &cache.Insert(cls, found) : nullptr;
+                }
+                if (!method || method->method->formal_params.size() != instr.arg2) {
+                    // Сообщение об ошибке формирует вызов метода по имени
+                    cls_inst_ptr->Call(name, std::vector<ObjectHolder>(args, sp), context);
+                }
+                // Подкласс мог переопределить метод: кадр заменяется, только если вызывается
+                // тот же самый код
+                if (instr.op == OpCode::TAIL_CALL && method->code == &code) {
+                    slots[0] = std::move(object);
+                    std::move(args, sp, slots + 1);
+                    const size_t num_slots = code.slot_names.size();
+                    std::fill(slots + code.num_params, slots + num_slots, ObjectHolder::None());
+                    std::fill(bound + code.num_params, bound + num_slots, false);
+                    sp = slots + num_slots;
+                    ip = begin;
+                    break;
+                }
+                object = CallMethod(object, *method, args, instr.arg2, context);
+                sp = args;
+                break;
+            }
+            case OpCode::NEW_INSTANCE: {
+                const auto& cls = *code.constants[instr.arg].TryAs<runtime::Class>();
+                ObjectHolder* const args = sp - instr.arg2;
+                ObjectHolder self = ObjectHolder::Own(runtime::ClassInstance(cls));
+                if (const auto init = FindMethod(cls, INIT_METHOD);
+                    init.method && init.method->formal_params.size() == instr.arg2) {
+                    CallMethod(self, init, args, instr.arg2, context);
+                }
+                sp = args;
+                *sp++ = std::move(self);
+                break;
+            }
+            case OpCode::NEW_OBJECT:
+                *sp++ = ObjectHolder::Own(runtime::ClassInstance(
+                        *code.constants[instr.arg].TryAs<runtime::Class>()));
+                break;
+            case OpCode::BUILD_LIST: {
+                ObjectHolder* const items = sp - instr.arg;
+                runtime::List list;
+                for (ObjectHolder* item = items; item != sp; ++item) {
+                    list.Append(std::move(*item));
+                }
+                sp = items;
+                *sp++ = ObjectHolder::Own(std::move(list));
+                break;
+            }
+            case OpCode::BUILD_DICT: {
+                ObjectHolder* const items = sp - 2 * static_cast<size_t>(instr.arg);
+                runtime::Dict dict;
+                for (ObjectHolder* item = items; item != sp; item += 2) {
+                    dict.Set(std::move(item[0]), std::move(item[1]), context);
+                }
+                sp = items;
+                *sp++ = ObjectHolder::Own(std::move(dict));
+                break;
+            }
+            case OpCode::LEN:
+                top() = runtime::Len(top());
+                break;
+            case OpCode::STRINGIFY: {
+                std::ostringstream out;
+                if (!top()) {
+                    out << "None"sv;
+                } else {
+                    top()->Print(out, context);
+                }
+                top() = ObjectHolder::Own(runtime::String(out.str()));
+                break;
+            }
+            case OpCode::ADD: {
+                const ObjectHolder rhs = pop();
+                top() = runtime::Add(top(), rhs, context);
+                break;
+            }
+            case OpCode::SUB: {
+                const ObjectHolder rhs = pop();
+                top() = runtime::Sub(top(), rhs, context);
+                break;
+            }
+            case OpCode::MULT: {
+                const ObjectHolder rhs = pop();
+                top() = runtime::Mult(top(), rhs, context);
+                break;
+            }
+            case OpCode::DIV: {
+                const ObjectHolder rhs = pop();
+                top() = runtime::Div(top(), rhs, context);
+                break;
+            }
+            case OpCode::AND: {
+                const ObjectHolder rhs = pop();
+                const bool result = runtime::IsTrue(top()) && runtime::IsTrue(rhs);
+                top() = ObjectHolder::Own(runtime::Bool(result));
+                break;
+            }
+            case OpCode::OR: {
+                const ObjectHolder rhs = pop();
+                const bool result = runtime::IsTrue(top()) || runtime::IsTrue(rhs);
+                top() = ObjectHolder::Own(runtime::Bool(result));
+                break;
+            }
+            case OpCode::NOT:
+                top() = ObjectHolder::Own(runtime::Bool(!runtime::IsTrue(top())));
+                break;
+            case OpCode::COMPARE: {
+                const ObjectHolder rhs = pop();
+                const bool result = code.comparators[instr.arg](top(), rhs, context);
+                top() = ObjectHolder::Own(runtime::Bool(result));
+                break;
+            }
+            case OpCode::JUMP:
+                ip = begin + instr.arg;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                if (!runtime::IsTrue(pop())) {
+                    ip = begin + instr.arg;
+                }
+                break;
+            case OpCode::FOR_RANGE: {
+                // Текущее значение хранится на месте аргумента start
+                const auto range = runtime::Range::FromArgs(sp[-3], sp[-2], sp[-1]);
+                if (!range.Contains(range.start)) {
+                    for (int i = 0; i < 3; ++i) {
+                        pop();
+                    }
+                    ip = begin + instr.arg;
+                    break;
+                }
+                sp[-3] = ObjectHolder::Own(runtime::Number(range.Next(range.start)));
+                *sp++ = ObjectHolder::Own(runtime::Number(range.start));
+                break;
+            }
+            case OpCode::FOR_EACH: {
+                // Номер очередного элемента - число, которое кладёт компилятор
+                const auto* index = sp[-1].TryAs<runtime::Number>();
+                const auto i = static_cast<size_t>(index->GetValue());
+                ObjectHolder item;
+                if (!runtime::GetIterationItem(sp[-2], i, item)) {
+                    pop();
+                    pop();
+                    ip = begin + instr.arg;
+                    break;
+                }
+                sp[-1] = ObjectHolder::Own(runtime::Number(static_cast<int>(i + 1)));
+                *sp++ = std::move(item);
+                break;
+            }
+            case OpCode::DEFINE_CLASS: {
+                const ObjectHolder& cls = code.constants[instr.arg];
+                closure[cls.TryAs<runtime::Class>()->GetName()] = cls;
+                *sp++ = cls;
+                break;
+            }
+            case OpCode::RETURN:
+                if (top()) {
+                    return pop();
+                }
+                break;
+            case OpCode::RETURN_VALUE:
+                return pop();
+            case OpCode::EXEC_NODE:
+                *sp++ = code.nodes[instr.arg]->Execute(closure, context);
+                // Узел мог выполнить return, завершающий текущий метод
+                if (context.GetCompletion() == runtime::Completion::RETURN) {
+                    context.SetCompletion(runtime::Completion::NORMAL);
+                    return pop();
+                }
+                break;
+        }
+    }
+}
+
+}  // namespace
+
+// ----------- Run -----------------------
+
+ObjectHolder Run(const CodeObject& code, Closure& closure, Context& context) {
+    Frame frame(code);
+    // Код со слотами получает self и аргументы метода из closure
+    for (size_t i = 0; i < code.num_params; ++i) {
+        if (const auto it = closure.find(code.slot_names[i]); it != closure.end()) {
+            frame.Slots()[i] = it->second;
+            frame.Bound()[i] = true;
+        }
+    }
+    return Execute(code, frame, closure, context);
+}
+
+ObjectHolder Call(const CodeObject& code, const ObjectHolder& self, ObjectHolder* args,
+                  size_t argc, Context& context) {
+    Frame frame(code);
+    ObjectHolder* const slots = frame.Slots();
+    slots[0] = self;
+    for (size_t i = 0; i < argc; ++i) {
+        slots[i + 1] = std::move(args[i]);
+    }
+    std::fill(frame.Bound(), frame.Bound() + argc + 1, true);
+    // Имена, не разрешённые в слоты, ищутся в пустой области видимости метода
+    Closure closure;
+    return Execute(code, frame, closure, context);
+}
+
+// ----------- Function -----------------------
+
+Function::Function(std::unique_ptr<CodeObject> code)
+    : code_(std::move(code))
+    {}
+
+ObjectHolder Function::Execute(Closure& closure, Context& context) {
+    return Run(*code_, closure, context);
+}
+
+const CodeObject& Function::GetCode() const {
+    return *code_;
+}
+
+}  // namespace vm
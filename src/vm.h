@@ -0,0 +1,33 @@
+#pragma once
+
+#include "bytecode.h"
+
+#include <memory>
+
+namespace vm {
+
+// Выполняет code на стековой виртуальной машине.
+// Переменные читаются и записываются в closure, вывод осуществляется через context.
+// Код со слотами берёт из closure только self и параметры метода
+runtime::ObjectHolder Run(const CodeObject& code, runtime::Closure& closure,
+                          runtime::Context& context);
+
+// Выполняет метод, скомпилированный в code со слотами, у экземпляра self.
+// Аргументы args[0..argc) перемещаются в слоты параметров, Closure не создаётся
+runtime::ObjectHolder Call(const CodeObject& code, const runtime::ObjectHolder& self,
+                           runtime::ObjectHolder* args, size_t argc, runtime::Context& context);
+
+// Тело метода, скомпилированное в байткод
+class Function : public runtime::Executable {
+public:
+    explicit Function(std::unique_ptr<CodeObject> code);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const CodeObject& GetCode() const;
+
+private:
+    std::unique_ptr<CodeObject> code_;
+};
+
+}  // namespace vm
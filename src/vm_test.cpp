@@ -0,0 +1,525 @@
+#include "bytecode.h"
+#include "lexer.h"
+#include "parse.h"
+#include "test_runner_p.h"
+#include "transform_test_p.h"
+#include "vm.h"
+
+using namespace std;
+
+namespace vm {
+
+namespace {
+
+void TestLinearCode() {
+    istringstream input("x = 1 + 2\nprint x, 'a'\n"s);
+    parse::Lexer lexer(input);
+    auto program = Compile(parse::ParseProgram(lexer));
+
+    ostringstream code;
+    code << program->GetCode();
+    ASSERT_EQUAL(code.str(),
+                 "0 LOAD_CONST 1\n"
+                 "1 LOAD_CONST 2\n"
+                 "2 ADD\n"
+                 "3 STORE_NAME x\n"
+                 "4 POP\n"
+                 "5 LOAD_NAME x\n"
+                 "6 PRINT_ITEM\n"
+                 "7 PRINT_SEPARATOR\n"
+                 "8 LOAD_CONST a\n"
+                 "9 PRINT_ITEM\n"
+                 "10 PRINT_NEWLINE\n"
+                 "11 POP\n"
+                 "12 LOAD_NONE\n"
+                 "13 RETURN_VALUE\n"s);
+    ASSERT_EQUAL(program->GetCode().max_stack, 2U);
+}
+
+void TestMethodSlots() {
+    istringstream input(R"(
+class Point:
+  def move(dx, dy):
+    x = self.x + dx
+    if dy:
+      y = dy
+    return x + y
+)"s);
+    parse::Lexer lexer(input);
+    auto program = Compile(parse::ParseProgram(lexer));
+
+    const auto& cls = *program->GetCode().constants.at(0).TryAs<runtime::Class>();
+    const auto& code = dynamic_cast<const Function&>(*cls.GetMethods().at(0).body).GetCode();
+    ASSERT(code.HasSlots());
+    ASSERT_EQUAL(code.num_params, 3U);
+    ASSERT_EQUAL(code.slot_names, (vector<runtime::Symbol>{"self"s, "dx"s, "dy"s, "x"s, "y"s}));
+
+    ostringstream disasm;
+    disasm << code;
+    ASSERT_EQUAL(disasm.str(),
+                 "0 LOAD_LOCAL self\n"
+                 "1 LOAD_FIELD x\n"
+                 "2 LOAD_LOCAL dx\n"
+                 "3 ADD\n"
+                 "4 STORE_LOCAL x\n"
+                 "5 POP\n"
+                 "6 LOAD_LOCAL dy\n"
+                 "7 JUMP_IF_FALSE 13\n"
+                 "8 LOAD_LOCAL dy\n"
+                 "9 STORE_LOCAL y\n"
+                 "10 POP\n"
+                 "11 LOAD_NONE\n"
+                 "12 JUMP 14\n"
+                 "13 LOAD_NONE\n"
+                 "14 POP\n"
+                 "15 LOAD_LOCAL x\n"
+                 "16 LOAD_LOCAL y\n"
+                 "17 ADD\n"
+                 "18 RETURN\n"
+                 "19 POP\n"
+                 "20 LOAD_NONE\n"
+                 "21 POP\n"
+                 "22 LOAD_NONE\n"
+                 "23 RETURN_VALUE\n"s);
+}
+
+void TestSlotsMatchClosureLookup() {
+    const string program = R"(
+class Point:
+  def __init__(x):
+    self.x = x
+
+  def move(dx, dy):
+    x = self.x + dx
+    if dy:
+      y = dy
+    return x + y
+
+  def __str__():
+    return str(self.x)
+
+p = Point(1)
+print p.move(2, 3), p
+print p.move(2, 0)
+)"s;
+    runtime::DummyContext context;
+    for (const bool use_vm : {false, true}) {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        auto tree = parse::ParseProgram(lexer);
+        if (use_vm) {
+            tree = Compile(std::move(tree));
+        }
+        runtime::Closure closure;
+        // y не присваивается при dy == 0
+        ASSERT_THROWS(tree->Execute(closure, context), std::runtime_error);
+    }
+    ASSERT_EQUAL(context.output.str(), "6 1\n6 1\n"s);
+}
+
+void TestSameOutputAsTreeWalker() {
+    const string program = R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+  def area():
+    return 0
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+  def __eq__(rhs):
+    return True
+
+r = Rect(10, 20)
+s = Shape()
+f = Fib()
+print r, s, r.area(), s.area(), str(r) + '!'
+print f.calc(15), 7 / 2, -3, not 1, 1 and 0, None or 'x', f == 1
+if r.area() > 100 and not s.area():
+  print 'big'
+else:
+  print 'small'
+x = r
+x.w = 1
+print r.area(), x.h, 'a' < 'b', 2 >= 3, None == None, 3 != 4
+)"s;
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, program);
+    ASSERT_EQUAL(vm_output,
+                 "Rect(10x20) Shape 200 0 Rect(10x20)!\n"
+                 "610 3 -3 False False True True\n"
+                 "big\n"
+                 "20 20 True False True True\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+}
+
+void TestPrintOrder() {
+    const string program = R"(
+class Logger:
+  def log(msg):
+    print msg
+    return msg
+
+l = Logger()
+print 'first', l.log('second'), 'third'
+)"s;
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, program);
+    ASSERT_EQUAL(vm_output, "first second\nsecond third\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+}
+
+void TestRuntimeErrors() {
+    runtime::DummyContext context;
+    const auto run = [&context](const string& program) {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        auto tree = Compile(parse::ParseProgram(lexer));
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+    };
+    ASSERT_THROWS(run("print y\n"s), std::runtime_error);
+    ASSERT_THROWS(run("x = 1\nprint x.y\n"s), std::runtime_error);
+    ASSERT_THROWS(run("x = 1\nx.y = 2\n"s), std::runtime_error);
+    ASSERT_THROWS(run("print 1 / 0\n"s), std::runtime_error);
+    ASSERT_THROWS(run("print 1 + 'a'\n"s), std::runtime_error);
+}
+
+// Как и при обходе AST, получатель проверяется до вычисления аргументов и присваиваемого
+// значения, а аргументы конструктора вычисляются, только если есть подходящий __init__
+void TestEvaluationOrder() {
+    const string prologue = R"(
+class P:
+  def noisy():
+    print 'evaluated'
+    return 1
+
+class Q:
+  def __init__():
+    print 'init'
+
+p = P()
+x = 5
+)";
+    for (const string& statement : {"x.foo(p.noisy())"s, "x.field = p.noisy()"s}) {
+        const auto [ast_output, vm_output]
+            = RunBeforeAndAfter(Compile, prologue + statement + "\n"s);
+        ASSERT_EQUAL(vm_output, ast_output);
+        ASSERT_EQUAL(vm_output.find("evaluated"s), string::npos);
+        ASSERT(vm_output.find("<"s) != string::npos);
+    }
+
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, prologue + R"(
+q = Q(p.noisy())
+r = Q()
+items = [0]
+items.append(p.noisy())
+print len(items)
+)");
+    ASSERT_EQUAL(ast_output, "init\nevaluated\n2\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+}
+
+// Узел, неизвестный компилятору
+struct CustomNode : runtime::Executable {
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context&) override {
+        closure["custom"s] = runtime::ObjectHolder::Own(runtime::Number(42));
+        return {};
+    }
+};
+
+void TestUnknownNodeFallback() {
+    auto tree = make_unique<ast::Compound>(make_unique<CustomNode>(),
+                                           ast::Print::Variable("custom"s));
+    auto program = Compile(std::move(tree));
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "42\n"s);
+}
+
+void TestLoops() {
+    istringstream input(R"(
+class C:
+  def sum(n):
+    s = 0
+    for i in range(n):
+      s = s + i
+    return s
+)"s);
+    parse::Lexer lexer(input);
+    auto program = Compile(parse::ParseProgram(lexer));
+
+    // Переменная цикла размещается в слоте, цикл не использует EXEC_NODE
+    const auto& cls = *program->GetCode().constants.at(0).TryAs<runtime::Class>();
+    const auto& code = dynamic_cast<const Function&>(*cls.GetMethods().at(0).body).GetCode();
+    ASSERT(code.HasSlots());
+    ASSERT_EQUAL(code.slot_names, (vector<runtime::Symbol>{"self"s, "n"s, "s"s, "i"s}));
+
+    ostringstream disasm;
+    disasm << code;
+    ASSERT_EQUAL(disasm.str(),
+                 "0 LOAD_CONST 0\n"
+                 "1 STORE_LOCAL s\n"
+                 "2 POP\n"
+                 "3 LOAD_NONE\n"
+                 "4 LOAD_LOCAL n\n"
+                 "5 LOAD_NONE\n"
+                 "6 FOR_RANGE 17\n"
+                 "7 STORE_LOCAL i\n"
+                 "8 POP\n"
+                 "9 LOAD_LOCAL s\n"
+                 "10 LOAD_LOCAL i\n"
+                 "11 ADD\n"
+                 "12 STORE_LOCAL s\n"
+                 "13 POP\n"
+                 "14 LOAD_NONE\n"
+                 "15 POP\n"
+                 "16 JUMP 6\n"
+                 "17 LOAD_NONE\n"
+                 "18 POP\n"
+                 "19 LOAD_LOCAL s\n"
+                 "20 RETURN\n"
+                 "21 POP\n"
+                 "22 LOAD_NONE\n"
+                 "23 POP\n"
+                 "24 LOAD_NONE\n"
+                 "25 RETURN_VALUE\n"s);
+
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, R"(
+class Loops:
+  def sum_range(a, b, step):
+    total = 0
+    for i in range(a, b, step):
+      total = total + i
+    return total
+
+  def first_square_above(limit):
+    n = 0
+    while True:
+      n = n + 1
+      if n * n > limit:
+        return n
+
+  def nested(n):
+    count = 0
+    for i in range(n):
+      j = 0
+      while j < i:
+        j = j + 1
+        count = count + j
+    return count
+
+l = Loops()
+print l.sum_range(0, 10, 1), l.sum_range(10, -10, -3), l.sum_range(3, 3, 1)
+print l.first_square_above(50), l.nested(5)
+for k in range(2):
+  print k
+print k
+)"s);
+    ASSERT_EQUAL(vm_output, "45 7 0\n8 20\n0\n1\n1\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+}
+
+void TestLists() {
+    const string program = R"(
+class Stack:
+  def __init__():
+    self.items = []
+
+  def push(value):
+    self.items.append(value)
+
+  def sum():
+    total = 0
+    for item in self.items:
+      total = total + item
+    return total
+
+  def top():
+    return self.items[len(self.items) - 1]
+
+s = Stack()
+for i in range(5):
+  s.push(i * i)
+print s.items, s.sum(), s.top(), len(s.items)
+grid = [[1, 2], [3, 4]]
+grid[1][0] = grid[0][1] * 10
+print grid, grid[-1][0], [] == [], ['a', None, True]
+words = ['x']
+words.append('y')
+words[0] = words[1] + '!'
+print words, len(words[0]), str(words)
+)"s;
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, program);
+    ASSERT_EQUAL(vm_output,
+                 "[0, 1, 4, 9, 16] 30 16 5\n"
+                 "[[1, 2], [20, 4]] 20 True [a, None, True]\n"
+                 "[y!, y] 2 [y!, y]\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+
+    // Методы со списками выполняются без обращения к интерпретатору AST
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto compiled = Compile(parse::ParseProgram(lexer));
+    const auto& cls = *compiled->GetCode().constants.at(0).TryAs<runtime::Class>();
+    for (const auto& method : cls.GetMethods()) {
+        ASSERT(dynamic_cast<const Function&>(*method.body).GetCode().HasSlots());
+    }
+}
+
+void TestDicts() {
+    const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __hash__():
+    return self.x * 31 + self.y
+
+  def __eq__(other):
+    return self.x == other.x and self.y == other.y
+
+class Counter:
+  def __init__():
+    self.counts = {}
+
+  def add(word):
+    if word in self.counts:
+      self.counts[word] = self.counts[word] + 1
+    else:
+      self.counts[word] = 1
+
+  def total():
+    result = 0
+    for word in self.counts:
+      result = result + self.counts[word]
+    return result
+
+c = Counter()
+for w in ['a', 'b', 'a', 'c', 'a', 'b']:
+  c.add(w)
+print c.counts, c.total(), len(c.counts), 'd' in c.counts
+grid = {Point(0, 0): 'origin', Point(1, 2): 'p'}
+grid[Point(1, 2)] = 'q'
+print grid[Point(0, 0)], grid[Point(1, 2)], len(grid), Point(2, 1) in grid
+mixed = {1: 'one', '1': 'str', True: [1, 2], None: {}}
+print mixed[1], mixed['1'], mixed[True][1], mixed[None], 2 in [1, 2], 'bc' in 'abc'
+print {} == {}, {1: 2} == {1: 2}, str({'k': 'v'})
+)"s;
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, program);
+    ASSERT_EQUAL(vm_output,
+                 "{a: 3, b: 2, c: 1} 6 3 False\n"
+                 "origin q 2 False\n"
+                 "one str 2 {} True True\n"
+                 "True True {k: v}\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+
+    // Методы обоих классов выполняются без обращения к интерпретатору AST
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto compiled = Compile(parse::ParseProgram(lexer));
+    for (size_t i = 0; i < 2; ++i) {
+        const auto& cls = *compiled->GetCode().constants.at(i).TryAs<runtime::Class>();
+        for (const auto& method : cls.GetMethods()) {
+            ASSERT(dynamic_cast<const Function&>(*method.body).GetCode().HasSlots());
+        }
+    }
+}
+
+void TestTailCalls() {
+    const string program = R"(
+class Counter:
+  def count(n, acc):
+    if n == 0:
+      return acc
+    return self.count(n - 1, acc + 1)
+
+  def even(n):
+    if n < 2:
+      return n == 0
+    else:
+      return self.even(n - 2)
+
+  def after(n):
+    if n > 0:
+      return self.after(n - 1)
+    print 'after', n
+
+class Other:
+  def swap(n, other):
+    return 'other ' + str(n)
+
+class Swapper:
+  def swap(n, other):
+    if n == 0:
+      return 'swapper'
+    self = other
+    return self.swap(n - 1, other)
+
+c = Counter()
+print c.count(100000, 0), c.even(100001), c.even(100000)
+c.after(2)
+s = Swapper()
+print s.swap(3, Other()), s.swap(3, Swapper())
+)"s;
+    // Без замены кадра рекурсия глубиной 100000 переполняет стек вызовов C++.
+    // Вызов, который подменяет self экземпляром другого класса, вызывает метод этого класса
+    const auto [ast_output, vm_output] = RunBeforeAndAfter(Compile, program);
+    ASSERT_EQUAL(vm_output,
+                 "100000 False True\n"
+                 "after 0\n"
+                 "after 1\n"
+                 "after 2\n"
+                 "other 2 swapper\n"s);
+    ASSERT_EQUAL(vm_output, ast_output);
+
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto compiled = Compile(parse::ParseProgram(lexer));
+    const auto& cls = *compiled->GetCode().constants.at(0).TryAs<runtime::Class>();
+    const auto disassemble = [&cls](const string& name) {
+        ostringstream disasm;
+        disasm << dynamic_cast<const Function&>(*cls.GetMethod(name)->body).GetCode();
+        return disasm.str();
+    };
+    ASSERT(disassemble("count"s).find("TAIL_CALL count 2\n"s) != string::npos);
+    // После return в середине метода выполняются другие инструкции, если вызов вернул None
+    ASSERT(disassemble("after"s).find("CALL_METHOD after 1\n"s) != string::npos);
+    ASSERT(disassemble("after"s).find("TAIL_CALL"s) == string::npos);
+}
+
+}  // namespace
+
+void RunVmTests(TestRunner& tr) {
+    RUN_TEST(tr, vm::TestLinearCode);
+    RUN_TEST(tr, vm::TestMethodSlots);
+    RUN_TEST(tr, vm::TestSlotsMatchClosureLookup);
+    RUN_TEST(tr, vm::TestSameOutputAsTreeWalker);
+    RUN_TEST(tr, vm::TestPrintOrder);
+    RUN_TEST(tr, vm::TestRuntimeErrors);
+    RUN_TEST(tr, vm::TestEvaluationOrder);
+    RUN_TEST(tr, vm::TestUnknownNodeFallback);
+    RUN_TEST(tr, vm::TestLoops);
+    RUN_TEST(tr, vm::TestLists);
+    RUN_TEST(tr, vm::TestDicts);
+    RUN_TEST(tr, vm::TestTailCalls);
+}
+
+}  // namespace vm